@@ -0,0 +1,61 @@
+/*
+ * FreeRTOSConfig.h - FreeRTOS settings for the FreeRTOS build (see rtos.h)
+ *   Only used when FREERTOS is defined in global.h and the FreeRTOS kernel
+ *   has been added to the project.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#define configUSE_PREEMPTION				1
+#define configCPU_CLOCK_HZ					F_CPU
+#define configTICK_RATE_HZ					1000		// the 1ms tasks need a 1ms tick
+#define configMAX_PRIORITIES				5			// idle + 4 tasks
+#define configMINIMAL_STACK_SIZE			128			// idle task stack (bytes)
+#define configMAX_TASK_NAME_LEN				5
+#define configUSE_16_BIT_TICKS				1			// vTaskDelayUntil copes with the wrap
+#define configIDLE_SHOULD_YIELD				1
+#define configUSE_IDLE_HOOK					1			// watchdog check in
+#define configUSE_TICK_HOOK					0
+#define configUSE_MUTEXES					1
+#define configUSE_RECURSIVE_MUTEXES			0
+#define configUSE_COUNTING_SEMAPHORES		0
+#define configQUEUE_REGISTRY_SIZE			0
+#define configUSE_TRACE_FACILITY			0
+#define configUSE_CO_ROUTINES				0
+#define configUSE_TIMERS					0
+
+// all memory is allocated statically, no heap
+#define configSUPPORT_STATIC_ALLOCATION		1
+#define configSUPPORT_DYNAMIC_ALLOCATION	0
+#define configTOTAL_HEAP_SIZE				0
+
+// stack overflow check on every task switch (watermark and stack pointer)
+#define configCHECK_FOR_STACK_OVERFLOW		2
+
+#define INCLUDE_vTaskDelay					1
+#define INCLUDE_vTaskDelayUntil				1
+#define INCLUDE_xTaskDelayUntil				1
+#define INCLUDE_uxTaskGetStackHighWaterMark	1
+#define INCLUDE_xTaskGetCurrentTaskHandle	1
+#define INCLUDE_xTaskGetIdleTaskHandle		1
+#define INCLUDE_xTaskGetSchedulerState		1
+#define INCLUDE_vTaskSuspend				0
+#define INCLUDE_vTaskDelete					0
+#define INCLUDE_vTaskPrioritySet			0
+#define INCLUDE_uxTaskPriorityGet			0
+
+#endif /* FREERTOS_CONFIG_H */
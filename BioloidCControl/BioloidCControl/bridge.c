@@ -0,0 +1,91 @@
+/*
+ * bridge.c - Dynamixel pass-through bridge for the Robotis CM-510 controller.
+ *   Forwards raw Dynamixel packets between the PC serial port (USART1) and
+ *   the servo bus (USART0). The forwarding itself happens in the USART
+ *   ISRs in serial.c and dxl_hal.c, this file switches the mode.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <avr/interrupt.h>
+#include <util/delay.h>
+#include "global.h"
+#include "hal.h"
+#include "log.h"
+#include "bridge.h"
+#include "serial.h"
+#include "dxl_hal.h"
+#include "led.h"
+#include "motion_f.h"
+#include "watchdog.h"
+
+// flag checked by the USART ISRs
+volatile uint8 bridge_active = 0;
+
+// global variables
+extern volatile bool start_button_pressed;
+extern uint8 motion_state;
+
+
+// run the bridge until the START button is pressed
+int bridge_run()
+{
+	// the motion engine must not use the bus while the PC owns it
+	if ( motion_state != MOTION_STOPPED ) {
+		log_printf("\nStop the robot before entering bridge mode.\n> ");
+		return 0;
+	}
+
+	serial_ackStarted(COMMAND_BRIDGE);
+	log_printf("\nDynamixel bridge at %lu baud - press START to exit.\n", (unsigned long) BRIDGE_BAUDRATE);
+	// make sure the message is out before the baud rate changes
+	log_flush();
+	_delay_ms(2);
+
+	// the PC may keep the bus for as long as it likes
+	watchdog_stop();
+
+	// switch both ports to bridge mode
+	cli();
+	start_button_pressed = FALSE;
+	serial_clear();
+	serial_setBaudrate( BRIDGE_BAUDRATE );
+	dxl_hal_bridge(1);
+	bridge_active = 1;
+	sei();
+	led_on(LED_MANAGE);
+
+	// everything happens in the ISRs
+	while ( !start_button_pressed ) {
+		hal_wait();
+	}
+
+	// give bytes still in flight a chance to get out (a full 128 byte
+	// Dynamixel ring takes 22ms to the PC at 57600 baud, the PC buffer
+	// empties onto the bus at 1Mbps in about 1ms)
+	_delay_ms(25);
+	cli();
+	bridge_active = 0;
+	dxl_hal_bridge(0);
+	hal_uartDisable(HAL_UART_PC, HAL_UART_TX_EMPTY);
+	serial_clear();
+	serial_setBaudrate( 57600 );
+	start_button_pressed = FALSE;
+	sei();
+	led_off(LED_MANAGE);
+	watchdog_start();
+
+	log_printf("\nBridge mode finished.\n> ");
+	return 1;
+}
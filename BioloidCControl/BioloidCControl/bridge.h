@@ -0,0 +1,68 @@
+/*
+ * bridge.h - Dynamixel pass-through bridge for the Robotis CM-510 controller.
+ *   Forwards raw Dynamixel packets between the PC serial port (USART1) and
+ *   the servo bus (USART0), so PC tools can talk to the servos directly
+ *   without swapping cables to a USB2Dynamixel.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Operation
+ *
+ * Send BRDG while the robot is stopped. The PC port switches to
+ * BRIDGE_BAUDRATE and every byte is forwarded in the receive ISRs, the
+ * transmit side is driven by the data register empty interrupts of both
+ * USARTs. The bus is switched back to receive by the transmit complete
+ * interrupt right after the last stop bit. Press START to leave bridge
+ * mode, the PC port returns to 57600 baud.
+ *
+ * Throughput and Latency (calculated for 16MHz, not measured)
+ *
+ * With both ports at 1Mbps the bridge runs at full bus speed: a byte takes
+ * 10us on the wire and each ISR needs well under 160 cycles, so the
+ * transmitter never runs dry while data is queued. Each byte is forwarded
+ * as soon as its stop bit has been received, which adds one byte time
+ * (10us) plus the ISR latency (a few us) in each direction. For an AX-12
+ * read (8 byte request, 7+N byte status) the bridge adds about 25us to a
+ * round trip of roughly 0.7ms, most of which is the servo return delay.
+ * At 57600 baud (Zig2Serial) the PC link limits the throughput. Bytes wait
+ * in the receive buffers until the ISRs forward them: status packets in the
+ * 128 byte Dynamixel ring (dxl_hal.c), requests in the 64 byte PC buffer
+ * (MAXNUM_SERIALBUFF, 128 with the serial cable). That is enough for the
+ * packets of one transaction, not for long bursts.
+ *
+ * Only raw forwarding is implemented. AX-12 servos have no bulk or sync
+ * read, so batching read requests on the controller would not save any
+ * bus time.
+ */
+
+#ifndef BRIDGE_H_
+#define BRIDGE_H_
+
+#include "serial.h"
+
+// baud rate of the PC port in bridge mode
+#ifdef SERIAL_CABLE
+  #define BRIDGE_BAUDRATE		1000000		// same as the Dynamixel bus
+#else
+  #define BRIDGE_BAUDRATE		57600		// ZigBee link can't go faster
+#endif
+
+// run the bridge until the START button is pressed
+// Returns:	(int)	1 - bridge mode was entered and has finished
+//					0 - robot is still moving, command ignored
+int bridge_run(void);
+
+#endif /* BRIDGE_H_ */
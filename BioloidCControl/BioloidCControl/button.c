@@ -1,127 +1,168 @@
-/*
- * Button.c - Functions and Interrupt Service Routines for controlling 
- *	the five push buttons on the Robotis CM-510 controller. 
- *   
- * Version 0.4		30/09/2011
- * Written by Peter Lanius
- * Please send suggestions and bug fixes to PeterLanius@gmail.com
- *
-*/
-
-/*
- * You may freely modify and share this code, as long as you keep this
- * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
- *
- *   http://creativecommons.org/licenses/by-sa/3.0/
- *
- * Disclaimer: To the extent permitted by law, this work is provided
- * without any warranty. It might be defective, in which case you agree
- * to be responsible for all resulting costs and damages.
- */
-
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include <util/delay.h>
-#include "global.h"
-#include "button.h"
-#include "buzzer.h"
-
-// Bring in the global variables for use in the ISRs
-// Button related variables
-extern volatile bool button_up_pressed;
-extern volatile bool button_down_pressed;
-extern volatile bool button_left_pressed;
-extern volatile bool button_right_pressed;
-extern volatile bool start_button_pressed;
-
-
-// define Interrupt Service Routine for START button on INT0 (PD0) pin
-ISR(INT0_vect)      
-{
-	cli();	// disable interrupts
-	
-	// wait 10ms to make sure we debounce the button
-	_delay_ms(10);
-	
-	// set the global variable
-	start_button_pressed = TRUE;
-
-	sei();	// re-enable interrupts
-}
-
-// define Interrupt Service Routine for UP button on INT4 (PE4) pin
-ISR(INT4_vect) 
-{
-	cli();	// disable interrupts
-
-	// wait 10ms to make sure we debounce the button
-	_delay_ms(10);
-	
-	// set the global variable
-	button_up_pressed = TRUE;
-	
-	sei();	// re-enable interrupts
-}
-
-// define Interrupt Service Routine for DOWN button on INT5 (PE5) pin
-ISR(INT5_vect)      
-{
-	cli();	// disable interrupts
-
-	// wait 10ms to make sure we debounce the button
-	_delay_ms(10);
-	
-	// set the global variable
-	button_down_pressed = TRUE;
-	
-	sei();	// re-enable interrupts
-}
-
-// define Interrupt Service Routine for LEFT button on INT6 (PE6) pin
-ISR(INT6_vect)      
-{
-	cli();	// disable interrupts
-
-	// wait 10ms to make sure we debounce the button
-	_delay_ms(10);
-	
-	// set the global variable
-	button_left_pressed = TRUE;
-	
-	sei();	// re-enable interrupts
-}
-
-
-// define Interrupt Service Routine for RIGHT button on INT7 (PE7) pin
-ISR(INT7_vect)      
-{
-	cli();	// disable interrupts
-
-	// wait 10ms to make sure we debounce the button
-	_delay_ms(10);
-	
-	// set the global variable
-	button_right_pressed = TRUE;
-	
-	sei();	// re-enable interrupts
-}
-
-// Initializations of Push Buttons as inputs
-void button_init(void)
-{
-	// configure all five buttons as input
-	BUTTON_DDR &= ~ALL_BUTTONS;		// set the pushbutton pins to be inputs
-	START_BUTTON_DDR &= ~START_BUTTON;	// same for START button
-	// activate the pull-up resistors for PORTE
-	BUTTON_PORT |= 0xF0;
-	
-	// Set up the external interrupts
-	// interrupt on INT0 pin rising edge (button push = HIGH) 
-	EICRA =  (1<<ISC01 | 1<<ISC00);
-
-	// interrupt on INT4/5/6/7 pin on LOW level (button push = LOW) 
-	EICRB = 0x00;
-
-	// turn on interrupts
-	EIMSK = (1<<INT7) | (1<<INT6) | (1<<INT5) | (1<<INT4) | (1<<INT0);
-}
+/*
+ * Button.c - Functions and Interrupt Service Routines for controlling 
+ *	the five push buttons on the Robotis CM-510 controller. 
+ *	Buttons are debounced by sampling them in a timer interrupt.
+ *   
+ * Version 0.4		30/09/2011
+ * Written by Peter Lanius
+ * Please send suggestions and bug fixes to PeterLanius@gmail.com
+ *
+*/
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <avr/interrupt.h>
+#include "global.h"
+#include "clock.h"
+#include "hal.h"
+#include "button.h"
+
+// Bring in the global variables for use in the ISRs
+// Button related variables
+extern volatile bool button_up_pressed;
+extern volatile bool button_down_pressed;
+extern volatile bool button_left_pressed;
+extern volatile bool button_right_pressed;
+extern volatile bool start_button_pressed;
+
+// flag set by a debounced press, by button id
+static volatile bool * const button_flags[BUTTON_COUNT] = {
+	&start_button_pressed, &button_up_pressed, &button_down_pressed, &button_left_pressed, &button_right_pressed
+};
+
+// debouncing, only used in the sampling ISR
+static uint8 button_state = 0;					// debounced state, bit n is button n, 1 = pressed
+static uint8 button_count[BUTTON_COUNT];		// samples the input has differed from the debounced state
+static uint8 button_hold[BUTTON_COUNT];			// samples the button has been held down
+
+// event queue, written by the sampling ISR only
+static volatile uint8 button_queue[BUTTON_QUEUE_LENGTH];
+static volatile uint8 button_queue_head = 0;
+static volatile uint8 button_queue_tail = 0;
+static volatile uint16 button_dropped = 0;
+
+// internal function prototypes
+static void button_queueEvent(uint8 type, uint8 id);
+
+
+// Interrupt Service Routine for the press edge of all five buttons
+// START on INT0 (PD0), UP/DOWN/LEFT/RIGHT on INT4-7 (PE4-7)
+ISR(INT0_vect)
+{
+	// the sampling ISR takes it from here, ignore the bounces
+	hal_buttonEdgeInterrupts(0);
+	if ( !hal_buttonIsSampling() ) {
+		hal_buttonStartSampling(BUTTON_SAMPLE_TICKS);
+	}
+}
+ISR(INT4_vect, ISR_ALIASOF(INT0_vect));
+ISR(INT5_vect, ISR_ALIASOF(INT0_vect));
+ISR(INT6_vect, ISR_ALIASOF(INT0_vect));
+ISR(INT7_vect, ISR_ALIASOF(INT0_vect));
+
+// TIMER5 compare A samples and debounces the buttons every BUTTON_SAMPLE_MS
+// while a button is active
+ISR(TIMER5_COMPA_vect)
+{
+	uint8 raw, id, mask, busy;
+
+	// time since the compare match, the interrupt latency
+	clock_noteLatency(hal_buttonNextSample(BUTTON_SAMPLE_TICKS));
+
+	raw = hal_buttonRead();
+	busy = 0;
+	for (id=0, mask=1; id<BUTTON_COUNT; id++, mask<<=1)
+	{
+		if ( (raw ^ button_state) & mask ) {
+			// the input has changed, accept it once it has been stable long enough
+			if ( ++button_count[id] >= BUTTON_DEBOUNCE_SAMPLES ) {
+				button_count[id] = 0;
+				button_state ^= mask;
+				if ( button_state & mask ) {
+					button_hold[id] = 0;
+					*button_flags[id] = TRUE;
+					button_queueEvent(BUTTON_PRESS, id);
+				} else {
+					button_queueEvent(BUTTON_RELEASE, id);
+				}
+			}
+		} else {
+			// bounced back
+			button_count[id] = 0;
+		}
+		if ( (button_state & mask) && button_hold[id] < BUTTON_LONG_PRESS_SAMPLES ) {
+			if ( ++button_hold[id] == BUTTON_LONG_PRESS_SAMPLES ) {
+				button_queueEvent(BUTTON_LONG_PRESS, id);
+			}
+		}
+		busy |= button_count[id];
+	}
+
+	// all buttons released and stable, wait for the next press edge
+	// (an edge while the interrupts were masked is still flagged in EIFR)
+	if ( button_state == 0 && busy == 0 ) {
+		hal_buttonStopSampling();
+		hal_buttonEdgeInterrupts(1);
+	}
+}
+
+// Initializations of Push Buttons as inputs
+void button_init(void)
+{
+	// configure all five buttons as input, pull-ups for PORTE
+	// interrupt on the press edge: INT0 rising (button push = HIGH),
+	// INT4/5/6/7 falling (button push = LOW)
+	hal_buttonInit();
+}
+
+// take the oldest button event out of the queue
+// Returns:	(uint8) the event, BUTTON_NO_EVENT if the queue is empty
+uint8 button_getEvent()
+{
+	uint8 tail = button_queue_tail;
+	uint8 event;
+
+	if ( tail == button_queue_head ) {
+		return BUTTON_NO_EVENT;
+	}
+	event = button_queue[tail];
+	button_queue_tail = (tail + 1) & (BUTTON_QUEUE_LENGTH - 1);
+	return event;
+}
+
+// Returns:	(uint16) events lost because the queue was full, then clears the count
+uint16 button_getDropped()
+{
+	uint16 dropped;
+	uint8 sreg;
+
+	sreg = SREG;
+	cli();
+	dropped = button_dropped;
+	button_dropped = 0;
+	SREG = sreg;
+	return dropped;
+}
+
+// add an event to the queue, drops it if the queue is full (ISR only)
+static void button_queueEvent(uint8 type, uint8 id)
+{
+	uint8 head = button_queue_head;
+	uint8 next = (head + 1) & (BUTTON_QUEUE_LENGTH - 1);
+
+	if ( next == button_queue_tail ) {
+		button_dropped++;
+		return;
+	}
+	button_queue[head] = BUTTON_EVENT(type, id);
+	button_queue_head = next;
+}
@@ -1,51 +1,92 @@
-/*
- * Button.h - Functions and Interrupt Service Routines for controlling 
- *	the five push buttons on the Robotis CM-510 controller. 
- *   
- * Version 0.4		30/09/2011
- * Written by Peter Lanius
- * Please send suggestions and bug fixes to PeterLanius@gmail.com
- *
-*/
-
-/*
- * You may freely modify and share this code, as long as you keep this
- * notice intact.  Licensed under the Creative Commons BY-SA 3.0 license:
- *
- *   http://creativecommons.org/licenses/by-sa/3.0/
- *
- * Disclaimer: To the extent permitted by law, this work is provided
- * without any warranty. It might be defective, in which case you agree
- * to be responsible for all resulting costs and damages.
- */
-
-
-#ifndef BUTTON_H_
-#define BUTTON_H_
-
-// PORTD
-// Input goes high when button is pressed 
-#define START_BUTTON		0x01	// PORTD0
-#define START_BUTTON_DDR	DDRD
-#define START_BUTTON_PORT	PORTD
-
-// PORTE
-// Input goes high when button is pressed
-#define BUTTON_UP		0x10	// PORTE4
-#define BUTTON_DOWN		0x20	// PORTE5
-#define BUTTON_LEFT		0x40	// PORTE6
-#define BUTTON_RIGHT	0x80	// PORTE7
-
-#define BUTTON_DDR		DDRE
-#define BUTTON_PORT		PORTE
-#define BUTTON_PINS		PINE
-
-#define BUTTONS_HIGH	BUTTON_PINS
-#define BUTTONS_LOW		(~BUTTON_PINS)
-#define ALL_BUTTONS		(BUTTON_UP | BUTTON_DOWN | BUTTON_LEFT | BUTTON_RIGHT)
-#define ANY_BUTTON		ALL_BUTTONS
-
-// function prototypes
-void button_init(void);
-
+/*
+ * Button.h - Functions and Interrupt Service Routines for controlling 
+ *	the five push buttons on the Robotis CM-510 controller. 
+ *   
+ * Version 0.4		30/09/2011
+ * Written by Peter Lanius
+ * Please send suggestions and bug fixes to PeterLanius@gmail.com
+ *
+*/
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact.  Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+
+#ifndef BUTTON_H_
+#define BUTTON_H_
+
+#include "global.h"
+#include "clock.h"
+
+// PORTD
+// Input goes high when button is pressed 
+#define START_BUTTON		0x01	// PORTD0
+#define START_BUTTON_DDR	DDRD
+#define START_BUTTON_PORT	PORTD
+
+// PORTE
+// Input goes low when button is pressed (pull-ups enabled)
+#define BUTTON_UP		0x10	// PORTE4
+#define BUTTON_DOWN		0x20	// PORTE5
+#define BUTTON_LEFT		0x40	// PORTE6
+#define BUTTON_RIGHT	0x80	// PORTE7
+
+#define BUTTON_DDR		DDRE
+#define BUTTON_PORT		PORTE
+#define BUTTON_PINS		PINE
+
+#define BUTTONS_HIGH	BUTTON_PINS
+#define BUTTONS_LOW		(~BUTTON_PINS)
+#define ALL_BUTTONS		(BUTTON_UP | BUTTON_DOWN | BUTTON_LEFT | BUTTON_RIGHT)
+#define ANY_BUTTON		ALL_BUTTONS
+
+// button ids, bit n of the debounced state is button n
+#define BUTTON_ID_START		0
+#define BUTTON_ID_UP		1
+#define BUTTON_ID_DOWN		2
+#define BUTTON_ID_LEFT		3
+#define BUTTON_ID_RIGHT		4
+#define BUTTON_COUNT		5
+
+// Debouncing: a press edge on INT0/INT4-7 masks the button interrupts and
+// starts sampling all five buttons on TIMER5 compare A (the clock timer).
+// An input has to read the same for BUTTON_DEBOUNCE_SAMPLES samples in a
+// row before the debounced state changes. Sampling stops and the edge
+// interrupts are enabled again once all buttons are released and stable.
+#define BUTTON_SAMPLE_MS			5
+#define BUTTON_DEBOUNCE_SAMPLES		3		// 10-15ms
+#define BUTTON_LONG_PRESS_MS		1000
+#define BUTTON_SAMPLE_TICKS			( BUTTON_SAMPLE_MS * 1000 * CLOCK_TICKS_PER_US )
+#define BUTTON_LONG_PRESS_SAMPLES	( BUTTON_LONG_PRESS_MS / BUTTON_SAMPLE_MS )
+#define BUTTON_QUEUE_LENGTH			8		// must be a power of 2
+
+// Events: the debounced press also sets the *_pressed flag of the button,
+// as the interrupts did before. An event is the type in the high nibble
+// and the button id in the low nibble, 0 is no event.
+#define BUTTON_NO_EVENT			0
+#define BUTTON_PRESS			1
+#define BUTTON_RELEASE			2
+#define BUTTON_LONG_PRESS		3		// held for BUTTON_LONG_PRESS_MS, comes before the release
+#define BUTTON_EVENT(type, id)	( ((type) << 4) | (id) )
+#define BUTTON_EVENT_TYPE(e)	( (e) >> 4 )
+#define BUTTON_EVENT_ID(e)		( (e) & 0x0F )
+
+// function prototypes
+void button_init(void);
+
+// take the oldest button event out of the queue
+// Returns:	(uint8) the event, BUTTON_NO_EVENT if the queue is empty
+uint8 button_getEvent(void);
+
+// Returns:	(uint16) events lost because the queue was full, then clears the count
+uint16 button_getDropped(void);
+
 #endif /* BUTTON_H_ */
\ No newline at end of file
@@ -1,124 +1,155 @@
-/*
- * clock.c - millisecond and microsecond clock
- * 
- * Version 0.4		30/09/2011
- * Written by Peter Lanius
- * Please send suggestions and bug fixes to PeterLanius@gmail.com
- *
- */
-
-/*
- * You may freely modify and share this code, as long as you keep this
- * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
- *
- *   http://creativecommons.org/licenses/by-sa/3.0/
- *
- * Disclaimer: To the extent permitted by law, this work is provided
- * without any warranty. It might be defective, in which case you agree
- * to be responsible for all resulting costs and damages.
- */
-
-#include "clock.h"
-
-// The prescaler is set so that TIMER0 ticks every 64 clock cycles, and the
-// the overflow handler is called every 256 ticks.
-#define MICROSECONDS_PER_TIMER0_OVERFLOW (clockCyclesToMicroseconds(64 * 256))
-
-// The whole number of milliseconds per TIMER0 overflow
-#define MILLIS_INC (MICROSECONDS_PER_TIMER0_OVERFLOW / 1000)
-
-// The fractional number of milliseconds per TIMER0 overflow. We shift right
-// by three to fit these numbers into a byte. (for the clock speeds we care
-// about - 8 and 16 MHz - this doesn't lose precision.)
-#define FRACT_INC ((MICROSECONDS_PER_TIMER0_OVERFLOW % 1000) >> 3)
-#define FRACT_MAX (1000 >> 3)
-
-volatile unsigned long timer0_overflow_count = 0;
-volatile unsigned long timer0_millis = 0;
-static unsigned char timer0_fract = 0;
-
-// TIMER0 overflow interrupt is triggered every 1024us at 16MHz
-ISR (TIMER0_OVF_vect)
-{
-   // copy these to local variables so they can be stored in registers
-   // (volatile variables must be read from memory on every access)
-   unsigned long m = timer0_millis;
-   unsigned char f = timer0_fract;
-
-   m += MILLIS_INC;
-   f += FRACT_INC;
-   if (f >= FRACT_MAX) {
-      f -= FRACT_MAX;
-      m += 1;
-   }
-
-   timer0_fract = f;
-   timer0_millis = m;
-   timer0_overflow_count++;
-}
-
-// return the current millisecond count
-unsigned long millis()
-{
-	unsigned long m;
-
-	// disable interrupt while we read timer0_millis or we might get an
-	// inconsistent value (e.g. in the middle of a write to timer0_millis)
-	DISABLE_TIMER0_INTERRUPT();
-	m = timer0_millis;
-	
-	// re-enable TIMER0 overflow interrupt
-	ENABLE_TIMER0_INTERRUPT();
-	
-	// there is a small chance an overflow occurred when interrupt was disabled
-	if ( TIFR0 & _BV(TOV0) ) 
-	{
-		// this should be safe since we have nearly 1ms left until the next overflow
-		m++;
-		timer0_millis++;
-		bit_set_hi(TIFR0,TOV0); // clear the overflow flag since the interrupt didn't execute
-	}	
-
-	return m;
-}
-
-// return current microsecond count by reading TIMER0 value directly
-unsigned long micros() 
-{
-	unsigned long m;
-	uint8 t;
-
-	// disable interrupts and read the timer
-	DISABLE_TIMER0_INTERRUPT();
-	m = timer0_overflow_count;
-	t = TCNT0;
-  
-	// re-enable interrupts
-	ENABLE_TIMER0_INTERRUPT();
-   
-	// there is a small chance an overflow occurred when interrupt was disabled
-	if ((TIFR0 & _BV(TOV0)) && (t < 255))
-	{
-		// this should be safe since we have nearly 1ms until the next overflow
-		m++;
-		timer0_millis++;
-		bit_set_hi(TIFR0,TOV0); // clear the overflow flag since the interrupt didn't execute
-	}	
-
-	return ((m << 8) + t) * (64 / clockCyclesPerMicrosecond());
-}
-
-// initializes the TIMER0 which we use for the clock
-void clock_init()
-{
-	// TIMER0 is an 8-bit timer which we set up in fast PWM mode
-	bit_set_hi(TCCR0A, WGM01);
-	bit_set_hi(TCCR0A, WGM00);
-
-	// set TIMER0 prescale factor to 64 = 250kHz
-	bit_set_hi(TCCR0B, CS01);
-	bit_set_hi(TCCR0B, CS00);
-
-	// enable TIMER0 overflow interrupt
-	bit_set_hi(TIMSK0, TOIE0);
-}
\ No newline at end of file
+/*
+ * clock.c - millisecond and microsecond clock
+ * 
+ * Version 0.9
+ * Written by Peter Lanius
+ * Please send suggestions and bug fixes to PeterLanius@gmail.com
+ *
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include "clock.h"
+#include "hal.h"
+
+// The whole and fractional number of milliseconds per TIMER5 overflow
+#define MILLIS_INC	(CLOCK_OVERFLOW_US / 1000)
+#define FRACT_INC	(CLOCK_OVERFLOW_US % 1000)
+
+// x / 1000 as multiply and shift, exact for x < 34000
+#define DIV1000(x)	( ((uint32)(x) * 33555UL) >> 25 )
+
+volatile uint32 clock_overflows = 0;			// TIMER5 overflows
+volatile uint16 clock_latency_max = 0;			// longest timer interrupt latency (ticks)
+static volatile uint32 clock_millis = 0;		// milliseconds at the last overflow
+static volatile uint16 clock_fract = 0;			// and microseconds on top (0-999)
+static volatile uint8 clock_seq = 0;			// changes with every overflow
+
+// internal function prototypes
+static uint16 clock_snapshot(uint32 *overflows, uint32 *ms, uint16 *fract);
+
+
+// TIMER5 overflow interrupt is triggered every 32768us at 16MHz
+ISR (TIMER5_OVF_vect)
+{
+	// copy these to local variables so they can be stored in registers
+	// (volatile variables must be read from memory on every access)
+	uint32 m = clock_millis + MILLIS_INC;
+	uint16 f = clock_fract + FRACT_INC;
+
+	// the timer count is the time since the overflow
+	clock_noteLatency(hal_clockCount());
+	if (f >= 1000) {
+		f -= 1000;
+		m += 1;
+	}
+	clock_fract = f;
+	clock_millis = m;
+	clock_overflows++;
+	// readers check this to see if they were interrupted
+	clock_seq++;
+}
+
+// return the timebase in ticks (0.5us, wraps after 35 minutes)
+uint32 clock_ticks()
+{
+	uint32 o, m;
+	uint16 f, t;
+
+	t = clock_snapshot(&o, &m, &f);
+	return (o << 16) + t;
+}
+
+// return the full timebase in ticks (48 bits used, wraps after 4.4 years)
+uint64_t clock_ticks64()
+{
+	uint32 o, m;
+	uint16 f, t;
+
+	t = clock_snapshot(&o, &m, &f);
+	return ((uint64_t) o << 16) + t;
+}
+
+// return the current millisecond count
+unsigned long millis()
+{
+	uint32 o, m;
+	uint16 f, t;
+
+	t = clock_snapshot(&o, &m, &f);
+	return m + DIV1000(f + t / CLOCK_TICKS_PER_US);
+}
+
+// return current microsecond count
+unsigned long micros() 
+{
+	uint32 o, m;
+	uint16 f, t;
+
+	t = clock_snapshot(&o, &m, &f);
+	return o * CLOCK_OVERFLOW_US + t / CLOCK_TICKS_PER_US;
+}
+
+// Returns:	(uint16) longest timer interrupt latency in us since the last call, then clears it
+uint16 clock_getLatencyMax()
+{
+	uint16 ticks;
+	uint8 sreg;
+
+	sreg = SREG;
+	cli();
+	ticks = clock_latency_max;
+	clock_latency_max = 0;
+	SREG = sreg;
+	return ticks / CLOCK_TICKS_PER_US;
+}
+
+// initializes TIMER5 which we use for the clock
+void clock_init()
+{
+	// normal mode (counts up to 0xFFFF), prescale factor 8 = 2MHz
+	// and TIMER5 overflow interrupt (compare A belongs to the buttons)
+	hal_clockStart();
+}
+
+// read the overflow count, milliseconds and timer without locking
+// Returns:	(uint16) timer count that goes with the other values
+static uint16 clock_snapshot(uint32 *overflows, uint32 *ms, uint16 *fract)
+{
+	uint8 seq, pending;
+	uint16 t;
+
+	// start again if the overflow ISR ran while we were reading
+	do {
+		seq = clock_seq;
+		*overflows = clock_overflows;
+		*ms = clock_millis;
+		*fract = clock_fract;
+		t = hal_clockCount();
+		pending = hal_clockOverflowPending();
+	} while ( seq != clock_seq );
+
+	// the timer has overflowed but the ISR hasn't run yet (interrupts are 
+	// disabled or it is about to run), count the overflow here
+	// a high count means the overflow came after the timer was read
+	if ( pending && t < 0x8000 )
+	{
+		(*overflows)++;
+		*ms += MILLIS_INC;
+		*fract += FRACT_INC;
+		if ( *fract >= 1000 ) {
+			*fract -= 1000;
+			(*ms)++;
+		}
+	}
+	return t;
+}
@@ -1,58 +1,94 @@
-/*
- * clock.h - millisecond and microsecond clock
- * 
- * Version 0.4		30/09/2011
- * Written by Peter Lanius
- * Please send suggestions and bug fixes to PeterLanius@gmail.com
- *
- */
-
-/*
- * You may freely modify and share this code, as long as you keep this
- * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
- *
- *   http://creativecommons.org/licenses/by-sa/3.0/
- *
- * Disclaimer: To the extent permitted by law, this work is provided
- * without any warranty. It might be defective, in which case you agree
- * to be responsible for all resulting costs and damages.
- */
-
-
-#ifndef _CLOCK_H_
-#define _CLOCK_H_
-
-#include <avr/io.h>
-#include <stdlib.h>
-#include <avr/interrupt.h>
-#include "global.h"
-
-
-#ifdef __cplusplus
-extern "C"{
-#endif
-
-// Interrupt enable/disable macros
-#define ENABLE_TIMER0_INTERRUPT()	TIMSK0 = (1<<TOIE0)
-#define DISABLE_TIMER0_INTERRUPT()	TIMSK0 = 0
-
-// macros for conversions between F_CPU and microseconds
-#define clockCyclesPerMicrosecond()  ( F_CPU / 1000000L )
-#define clockCyclesToMicroseconds(a) ( (a) / clockCyclesPerMicrosecond() )
-#define microsecondsToClockCycles(a) ( (a) * clockCyclesPerMicrosecond() )
-
-// initialize the clock functions
-void clock_init(void);
-
-// return millisecond count
-unsigned long millis(void);
-
-// return microsecond count
-unsigned long micros(void);
-
-#ifdef __cplusplus
-} // extern "C"
-#endif
-
-#endif
-
+/*
+ * clock.h - millisecond and microsecond clock
+ * 
+ * Version 0.9
+ * Written by Peter Lanius
+ * Please send suggestions and bug fixes to PeterLanius@gmail.com
+ *
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+
+#ifndef _CLOCK_H_
+#define _CLOCK_H_
+
+#include <avr/io.h>
+#include <stdlib.h>
+#include <avr/interrupt.h>
+#include "global.h"
+
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// The timebase is TIMER5 running free at F_CPU/8 (0.5us per tick at 16MHz).
+// The overflow ISR (every 32768us) extends it to 48 bits and keeps the
+// millisecond count. Readers take a snapshot of the software part without
+// disabling interrupts: they re-read when the overflow ISR ran in the
+// middle (it changes a sequence byte) and use the overflow flag when called
+// with interrupts disabled. Only the read of TCNT5 itself (hal_clockCount)
+// disables interrupts for a few cycles: the button sampling ISR uses the
+// TEMP register of TIMER5 too. hal_clockCount can be used directly for
+// short intervals (see prof.h).
+#define CLOCK_PRESCALER				8
+#define CLOCK_TICKS_PER_US			( F_CPU / CLOCK_PRESCALER / 1000000L )
+#define CLOCK_OVERFLOW_US			( 65536L / CLOCK_TICKS_PER_US )
+
+// macros for conversions between F_CPU and microseconds
+#define clockCyclesPerMicrosecond()  ( F_CPU / 1000000L )
+#define clockCyclesToMicroseconds(a) ( (a) / clockCyclesPerMicrosecond() )
+#define microsecondsToClockCycles(a) ( (a) * clockCyclesPerMicrosecond() )
+
+// TIMER5 overflow count, the upper part of the timebase
+// only for code that reads it together with TCNT5 with interrupts disabled
+extern volatile uint32 clock_overflows;
+
+// longest wait of a timer interrupt so far (ticks), see clock_noteLatency
+extern volatile uint16 clock_latency_max;
+
+// Timer interrupts record how long they waited to run: the time from the
+// timer event (overflow, compare match) to reading TCNT5 in the ISR. This
+// is the time interrupts were disabled plus a few us for the ISR entry.
+// Call from timer ISRs only (interrupts disabled).
+static inline void clock_noteLatency(uint16 ticks)
+{
+	if ( ticks > clock_latency_max ) {
+		clock_latency_max = ticks;
+	}
+}
+
+// Returns:	(uint16) longest timer interrupt latency in us since the last call, then clears it
+uint16 clock_getLatencyMax(void);
+
+// initialize the clock functions
+void clock_init(void);
+
+// return the timebase in ticks (0.5us, wraps after 35 minutes)
+uint32 clock_ticks(void);
+
+// return the full timebase in ticks (48 bits used, wraps after 4.4 years)
+uint64_t clock_ticks64(void);
+
+// return millisecond count
+unsigned long millis(void);
+
+// return microsecond count (1us resolution, wraps after 71 minutes)
+unsigned long micros(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
+
@@ -0,0 +1,299 @@
+# Perl script to compile the buzzer melodies into note tables for the
+# melody player in buzzer.c of BioloidCControl
+#
+# Usage:	perl compile_melody.pl melodies.txt
+#
+# Output file 1: melody.h - melody ids (MELODY_name) for buzzer_playMelody()
+# Output file 2: melody.c - the note tables (stored in Flash)
+# Both are written to the directory of the input file.
+#
+# Input syntax (one melody per line, lines starting with # are comments):
+#	name	notation
+# The notation is the one of the Pololu buzzer library (GW-BASIC PLAY):
+#	c d e f g a b	notes, r is a rest, followed by an optional length
+#					(4 = quarter note, 8 = eighth note, ...)
+#	+ or # / -		after a note raises / lowers it one half-step
+#	.				after a note makes it 50% longer, each further dot adds
+#					half as much as the previous one
+#	> / <			plays the next note one octave higher / lower
+#	O, T, L, V		followed by a number set the octave (default 4), the
+#					tempo (default 120), the default note length (default 4)
+#					and the volume (0-15, default 15)
+#	MS / ML			staccato (notes play for half their length) / legato
+#	!				resets all settings to their defaults
+# Every melody starts with the defaults. The timer values are calculated
+# with the same integer arithmetic the firmware used when it parsed the
+# strings at run time, so the melodies sound the same.
+#
+# Version: 0.9
+#
+use strict;
+use warnings;
+use File::Basename;
+
+# these need to match buzzer.c
+my $timer1_clk_1 = 0x01;
+my $timer1_clk_8 = 0x02;
+my $div_by_10 = 1 << 15;
+my $silent_note = 0xFF;
+
+# frequencies of the lowest 12 notes (E1 to D#2) in 0.1Hz
+my @base_freq = ( 412, 437, 463, 490, 519, 550, 583, 617, 654, 693, 734, 778 );
+my %keys = ( c => 0, d => 2, e => 4, f => 5, g => 7, a => 9, b => 11 );
+
+# quit unless we have the correct number of command-line args
+my $num_args = $#ARGV + 1;
+if ($num_args != 1) {
+	print "\nNumber of arguments: $num_args\n";
+	print "\nUsage: compile_melody.pl melodies.txt \n";
+	exit;
+}
+
+my $melody_file = $ARGV[0];
+print "\nMelody Input File: $melody_file\n";
+my $dir = dirname($melody_file);
+my $header_file = "$dir/melody.h";
+my $table_file = "$dir/melody.c";
+print "Output Files: $header_file $table_file\n";
+
+open(my $in, "<", $melody_file) or die "Can't open input melody file: $!";
+
+my @melodies;
+my %names;
+my $line_number = 0;
+my $errors = 0;
+while (my $line = <$in>) {
+	$line_number++;
+	# '#' is also a sharp, so only whole lines can be comments
+	$line =~ s/^\s*#.*//;
+	$line =~ s/^\s+|\s+$//g;
+	next if ($line eq "");
+
+	my ($name, $notation) = split(/\s+/, $line, 2);
+	if (!defined $notation || $name !~ /^[A-Za-z]\w*$/) {
+		error("expected: name notation");
+		next;
+	}
+	if (exists $names{lc $name}) {
+		error("melody $name defined twice");
+		next;
+	}
+	$names{lc $name} = 1;
+	my @notes = compile_melody($notation);
+	push(@melodies, [ $name, $notation, @notes ]);
+}
+close $in;
+
+if ($errors > 0) {
+	print STDERR "$errors error(s), no output written.\n";
+	exit 1;
+}
+
+# melody ids
+open(my $out, ">", $header_file) or die "Can't open output file: $!";
+print $out "/*\n * melody.h - melody ids for buzzer_playMelody()\n";
+print $out " *   Generated by compile_melody.pl from " . basename($melody_file) . ", do not edit.\n */\n\n";
+print $out "#ifndef MELODY_H_\n#define MELODY_H_\n\n#include <avr/pgmspace.h>\n#include \"buzzer.h\"\n\n";
+for (my $i = 0; $i <= $#melodies; $i++) {
+	printf $out "#define MELODY_%-16s%i\n", uc $melodies[$i][0], $i;
+}
+printf $out "#define MELODY_COUNT\t\t\t%i\n\n", scalar(@melodies);
+print $out "// note tables by id (melody.c)\n";
+print $out "extern const buzzer_note * const melody_table[MELODY_COUNT] PROGMEM;\n\n";
+print $out "#endif /* MELODY_H_ */\n";
+close $out;
+
+# note tables
+my $size = 0;
+open($out, ">", $table_file) or die "Can't open output file: $!";
+print $out "/*\n * melody.c - note tables of the buzzer melodies\n";
+print $out " *   Generated by compile_melody.pl from " . basename($melody_file) . ", do not edit.\n */\n\n";
+print $out "#include <avr/pgmspace.h>\n#include \"buzzer.h\"\n#include \"melody.h\"\n\n";
+print $out "// TIMER1 top, compare B (volume), overflows, clock select\n";
+foreach my $melody (@melodies) {
+	my ($name, $notation, @notes) = @$melody;
+	print $out "// $notation\n";
+	print $out "static const buzzer_note melody_$name\[\] PROGMEM = {\n";
+	foreach my $note (@notes) {
+		printf $out "\t{ %5u, %5u, %5u, 0x%02X },\n", @$note;
+	}
+	print $out "\t{ 0, 0, 0, 0 }\n};\n\n";
+	$size += (scalar(@notes) + 1) * 7;
+}
+print $out "const buzzer_note * const melody_table[MELODY_COUNT] PROGMEM = {\n";
+print $out join(",\n", map { "\tmelody_$$_[0]" } @melodies) . "\n};\n";
+close $out;
+
+printf "%i melodies, %i bytes\n", scalar(@melodies), $size;
+exit 0;
+
+
+# print an error message with the line number
+sub error {
+	my ($message) = @_;
+	print STDERR "$melody_file line $line_number: $message\n";
+	$errors++;
+}
+
+# turn the notation into a list of [ top, compare B, overflows, clock select ]
+sub compile_melody {
+	my ($notation) = @_;
+	my @c = split(//, lc $notation);
+	my $pos = 0;
+	my @notes;
+
+	# settings, every melody starts with the defaults
+	my ($octave, $whole, $type, $duration, $volume, $staccato) = (4, 2000, 4, 500, 15, 0);
+
+	# current character, skipping spaces, '' at the end
+	my $current = sub {
+		$pos++ while ($pos <= $#c && $c[$pos] eq ' ');
+		return $pos <= $#c ? $c[$pos] : '';
+	};
+	my $number = sub {
+		my $arg = 0;
+		while ($current->() =~ /^\d$/) {
+			$arg = ($arg * 10 + $c[$pos]) & 0xFFFF;
+			$pos++;
+		}
+		return $arg;
+	};
+
+	my $tmp_octave = $octave;		# octave of the next note
+	while (1) {
+		my ($note, $rest) = (0, 0);
+		my $c = $current->();
+		last if ($c eq '');
+		$pos++;
+
+		if ($c eq '>' || $c eq '<') {
+			# shift the octave for the next note only
+			$tmp_octave += ($c eq '>') ? 1 : -1;
+			next;
+		} elsif (exists $keys{$c}) {
+			$note = $keys{$c};
+		} elsif ($c eq 'r') {
+			$rest = 1;
+		} elsif ($c eq 'l') {
+			$type = $number->();
+			if ($type == 0) { error("L0 in '$notation'"); return (); }
+			$duration = int($whole / $type);
+			next;
+		} elsif ($c eq 'm') {
+			$staccato = ($current->() eq 'l') ? 0 : 1;
+			$pos++;
+			next;
+		} elsif ($c eq 'o') {
+			$octave = $number->();
+			$tmp_octave = $octave;
+			next;
+		} elsif ($c eq 't') {
+			my $tempo = $number->();
+			if ($tempo == 0) { error("T0 in '$notation'"); return (); }
+			$whole = (int(60 * 400 / $tempo) * 10) & 0xFFFF;
+			$duration = int($whole / $type);
+			next;
+		} elsif ($c eq 'v') {
+			$volume = $number->();
+			next;
+		} elsif ($c eq '!') {
+			($octave, $whole, $type, $duration, $volume, $staccato) = (4, 2000, 4, 500, 15, 0);
+			$tmp_octave = $octave;
+			next;
+		} else {
+			error("unexpected '$c' in '$notation'");
+			return ();
+		}
+		$note = ($note + $tmp_octave * 12) & 0xFF;
+		$tmp_octave = $octave;
+
+		# sharps and flats
+		while ($current->() eq '+' || $current->() eq '#') { $pos++; $note = ($note + 1) & 0xFF; }
+		while ($current->() eq '-') { $pos++; $note = ($note - 1) & 0xFF; }
+
+		# length of this note and dots
+		my $length = $duration;
+		if ($current->() =~ /^[1-8]$/) {
+			my $n = $number->();
+			if ($n == 0) { error("note length 0 in '$notation'"); return (); }
+			$length = int($whole / $n);
+		}
+		my $dot_add = int($length / 2);
+		while ($current->() eq '.') {
+			$pos++;
+			$length = ($length + $dot_add) & 0xFFFF;
+			$dot_add = int($dot_add / 2);
+		}
+
+		my $staccato_rest = 0;
+		if ($staccato) {
+			$staccato_rest = int($length / 2);
+			$length -= $staccato_rest;
+		}
+		push(@notes, play_note($rest ? $silent_note : $note, $length, $volume & 0xFF));
+		push(@notes, play_note($silent_note, $staccato_rest, 0)) if ($staccato);
+	}
+	return @notes;
+}
+
+# note number to frequency, as buzzer_playNote()
+sub play_note {
+	my ($note, $length, $volume) = @_;
+
+	if ($note == $silent_note || $volume == 0) {
+		return play_frequency(1000, $length, 0);
+	}
+	my $offset = ($note - 16) & 0xFF;
+	if ($note <= 16) {
+		$offset = 0;
+	} elsif ($offset > 95) {
+		$offset = 95;
+	}
+	my $exponent = int($offset / 12);
+	my $freq = $base_freq[$offset - $exponent * 12];
+	if ($exponent < 7) {
+		$freq = $freq << $exponent;
+		if ($exponent > 1) {
+			$freq = int(($freq + 5) / 10);
+		} else {
+			$freq += $div_by_10;
+		}
+	} else {
+		$freq = int(($freq * 64 + 2) / 5);
+	}
+	$volume = 15 if ($volume > 15);
+	return play_frequency($freq, $length, $volume);
+}
+
+# timer settings for a frequency, as buzzer_playFrequency()
+sub play_frequency {
+	my ($freq, $length, $volume) = @_;
+	my ($top, $clock);
+	my $multiplier = 1;
+
+	if ($freq & $div_by_10) {
+		$multiplier = 10;
+		$freq &= ~$div_by_10;
+	}
+	if ($freq > 200 * $multiplier) {
+		$freq = 10000 if ($freq > 10000);
+		$top = int((10000000 + ($freq >> 1)) / $freq);
+		$clock = $timer1_clk_1;
+	} else {
+		# the firmware keeps 40 * multiplier in a byte
+		my $val = (40 * $multiplier) & 0xFF;
+		$freq = $val if ($freq < $val);
+		if ($multiplier == 10) {
+			$top = int((12500000 + ($freq >> 1)) / $freq);
+		} else {
+			$top = int((1250000 + ($freq >> 1)) / $freq);
+		}
+		$clock = $timer1_clk_8;
+	}
+	$top &= 0xFFFF;
+	$freq = int(($freq + 5) / 10) if ($multiplier == 10);
+	my $overflows = ($freq == 1000) ? $length : int($length * $freq / 1000) & 0xFFFF;
+	$volume = 15 if ($volume > 15);
+	my $duty = ($volume == 0) ? 0 : $top >> (16 - $volume);
+	return [ $top, $duty, $overflows, $clock ];
+}
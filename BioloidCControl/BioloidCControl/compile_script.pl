@@ -0,0 +1,251 @@
+# Perl script to compile robot programs into the bytecode run by the stored
+# program interpreter (script.c) of BioloidCControl
+#
+# Usage:	perl compile_script.pl foo.bcs
+#
+# Output file: foo.txt - send this file with a terminal program, it contains
+#				 the LOAD command, the program and the END line with the checksum.
+#				 Use RUN to start the program and SAVE to keep it in EEPROM.
+#
+# Program syntax (one statement per line, # starts a comment):
+#	label:					define a jump target
+#	do CMD					issue a command, e.g. do WFWD (same names as serial commands)
+#	play PAGE				play motion page PAGE
+#	wait MS					wait MS milliseconds (max 65535)
+#	sync					wait until the robot has finished moving
+#	set VAR VALUE			VAR = VALUE
+#	add VAR VALUE			VAR = VAR + VALUE (VALUE can be negative)
+#	read VAR SENSOR			VAR = sensor value, SENSOR is one of battery, gyrox,
+#							gyroy, dms, ultrasonic, accelx, accely, buttons
+#	goto LABEL				continue at LABEL
+#	if VAR OP VALUE goto LABEL	OP is one of == != < > <= >=
+#	repeat VAR LABEL		VAR = VAR - 1, continue at LABEL unless VAR is 0
+#	call LABEL				call subroutine at LABEL
+#	return					return from subroutine
+#	end						stop the program
+# Variables are named freely, up to 8 different names can be used.
+#
+# Version: 0.9
+#
+use strict;
+use warnings;
+
+# these need to match script.h
+my $max_length = 200;
+my $num_vars = 8;
+my %opcodes = ( end => 0, do => 1, play => 2, wait => 3, sync => 4, set => 5, add => 6,
+				read => 7, goto => 8, if => 9, repeat => 10, call => 11, return => 12 );
+my %sizes = ( end => 1, do => 2, play => 2, wait => 3, sync => 1, set => 4, add => 4,
+				read => 3, goto => 2, if => 6, repeat => 3, call => 2, return => 1 );
+my %conditions = ( '==' => 0, '!=' => 1, '<' => 2, '>' => 3, '<=' => 4, '>=' => 5 );
+my %sensors = ( battery => 0, gyrox => 1, gyroy => 2, dms => 3, ultrasonic => 4,
+				accelx => 5, accely => 6, buttons => 7 );
+
+# command names in the same order as COMMANDSTR in serial.c, STOP to RSET
+# only (script.c rejects the others). M has no page here (use play instead),
+# its number is kept free so the ones after it stay in place.
+# WS, W, RUN, LOAD, SAVE and the commands after them are not available in
+# programs (use wait instead of WS and W)
+my @commands = ( qw( STOP WFWD WBWD WLT WRT WLSD WRSD WFLS WFRS WBLS WBRS WAL WAR
+				   WFLT WFRT WBLT WBRT WRDY SIT STND BAL ), undef, qw( FGUP BGUP RSET ) );
+
+# quit unless we have the correct number of command-line args
+my $num_args = $#ARGV + 1;
+if ($num_args != 1) {
+	print "\nNumber of arguments: $num_args\n";
+	print "\nUsage: compile_script.pl foo.bcs \n";
+	exit;
+}
+
+my $program_file = $ARGV[0];
+print "\nProgram Input File: $program_file\n";
+my $output_file = $program_file;
+$output_file =~ s/\.[^.\/\\]*$//;
+$output_file .= ".txt";
+print "Output File: $output_file\n";
+
+open(my $in, "<", $program_file) or die "Can't open input program file: $!";
+
+# first pass: split the statements and find the label addresses
+my @statements;
+my %labels;
+my %variables;
+my $address = 0;
+my $line_number = 0;
+my $errors = 0;
+while (my $line = <$in>) {
+	$line_number++;
+	$line =~ s/#.*//;
+	$line =~ s/^\s+|\s+$//g;
+	next if ($line eq "");
+
+	# labels can be on their own line or in front of a statement
+	while ($line =~ s/^(\w+):\s*//) {
+		if (exists $labels{lc $1}) {
+			error("label $1 defined twice");
+		}
+		$labels{lc $1} = $address;
+	}
+	next if ($line eq "");
+
+	my @words = split(/\s+/, $line);
+	my $keyword = lc $words[0];
+	if (!exists $opcodes{$keyword}) {
+		error("unknown statement $words[0]");
+		next;
+	}
+	push(@statements, [ $line_number, $address, @words ]);
+	$address += $sizes{$keyword};
+}
+close $in;
+
+if ($address > $max_length) {
+	print STDERR "Program is $address bytes long, maximum is $max_length bytes.\n";
+	exit 1;
+}
+
+# second pass: generate the code
+my @code;
+foreach my $statement (@statements) {
+	my ($number, $addr, @words) = @$statement;
+	$line_number = $number;
+	my $keyword = lc $words[0];
+	my @operands;
+
+	if ($keyword eq "do") {
+		check_args(\@words, 1) or next;
+		my $index = command_index($words[1]);
+		push(@operands, $index);
+	} elsif ($keyword eq "play") {
+		check_args(\@words, 1) or next;
+		push(@operands, number($words[1], 0, 255));
+	} elsif ($keyword eq "wait") {
+		check_args(\@words, 1) or next;
+		push(@operands, word(number($words[1], 0, 65535)));
+	} elsif ($keyword eq "set" || $keyword eq "add") {
+		check_args(\@words, 2) or next;
+		push(@operands, variable($words[1]), word(number($words[2], -32768, 65535)));
+	} elsif ($keyword eq "read") {
+		check_args(\@words, 2) or next;
+		if (!exists $sensors{lc $words[2]}) {
+			error("unknown sensor $words[2]");
+			next;
+		}
+		push(@operands, variable($words[1]), $sensors{lc $words[2]});
+	} elsif ($keyword eq "goto" || $keyword eq "call") {
+		check_args(\@words, 1) or next;
+		push(@operands, label($words[1]));
+	} elsif ($keyword eq "if") {
+		check_args(\@words, 5) or next;
+		if (!exists $conditions{$words[2]}) {
+			error("unknown condition $words[2]");
+			next;
+		}
+		if (lc $words[4] ne "goto") {
+			error("if needs the form: if VAR OP VALUE goto LABEL");
+			next;
+		}
+		push(@operands, variable($words[1]), $conditions{$words[2]},
+			 word(number($words[3], -32768, 32767)), label($words[5]));
+	} elsif ($keyword eq "repeat") {
+		check_args(\@words, 2) or next;
+		push(@operands, variable($words[1]), label($words[2]));
+	} else {
+		# end, sync and return have no operands
+		check_args(\@words, 0) or next;
+	}
+	push(@code, $opcodes{$keyword}, @operands);
+}
+
+if ($errors > 0) {
+	print STDERR "$errors error(s), no output written.\n";
+	exit 1;
+}
+
+# write the upload file, 16 bytes per line
+open(my $out, ">", $output_file) or die "Can't open output file: $!";
+print $out "LOAD\n";
+my $checksum = 0;
+for (my $i = 0; $i <= $#code; $i += 16) {
+	my $last = ($i + 15 < $#code) ? $i + 15 : $#code;
+	print $out ":" . join("", map { sprintf("%02X", $_) } @code[$i..$last]) . "\n";
+}
+$checksum = ($checksum + $_) & 0xFF foreach @code;
+printf $out "END %02X\n", $checksum;
+close $out;
+
+printf "Program size: %i bytes, %i variable(s)\n", scalar(@code), scalar(keys %variables);
+exit 0;
+
+
+# print an error message with the line number
+sub error {
+	my ($message) = @_;
+	print STDERR "$program_file line $line_number: $message\n";
+	$errors++;
+}
+
+# check the number of arguments of a statement
+sub check_args {
+	my ($words, $count) = @_;
+	if ($#$words != $count) {
+		error("$$words[0] needs $count argument(s)");
+		return 0;
+	}
+	return 1;
+}
+
+# convert a number and check its range
+sub number {
+	my ($text, $min, $max) = @_;
+	if ($text !~ /^-?\d+$/ || $text < $min || $text > $max) {
+		error("invalid number $text (range $min to $max)");
+		return 0;
+	}
+	return $text;
+}
+
+# split a 16-bit value into low and high byte
+sub word {
+	my ($value) = @_;
+	$value &= 0xFFFF;
+	return ($value & 0xFF, $value >> 8);
+}
+
+# find or allocate a variable
+sub variable {
+	my ($name) = @_;
+	$name = lc $name;
+	if (!exists $variables{$name}) {
+		if (scalar(keys %variables) >= $num_vars) {
+			error("too many variables, maximum is $num_vars");
+			return 0;
+		}
+		$variables{$name} = scalar(keys %variables);
+	}
+	return $variables{$name};
+}
+
+# find the address of a label
+sub label {
+	my ($name) = @_;
+	if (!exists $labels{lc $name}) {
+		error("unknown label $name");
+		return 0;
+	}
+	return $labels{lc $name};
+}
+
+# find the command number
+sub command_index {
+	my ($name) = @_;
+	if (uc $name eq "M") {
+		error("use play PAGE to play a motion page");
+		return 0;
+	}
+	for (my $i = 0; $i <= $#commands; $i++) {
+		return $i if (defined $commands[$i] && $commands[$i] eq uc $name);
+	}
+	error("unknown command $name");
+	return 0;
+}
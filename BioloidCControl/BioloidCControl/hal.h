@@ -0,0 +1,489 @@
+/*
+ * hal.h - Hardware abstraction layer of the CM-510 peripherals
+ *   The register accesses of the drivers (dxl_hal.c, serial.c, adc.c,
+ *   clock.c, button.c, led.c, buzzer.c) as small inline functions. On the
+ *   ATmega2561 they compile to the same instructions as the direct register
+ *   accesses did. The host build implements them with stub devices and a
+ *   virtual clock (host/hal_host.c).
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Operation
+ *
+ * The drivers keep their logic (buffers, debouncing, melodies, the clock
+ * arithmetic) and their interrupt service routines, only the accesses to
+ * the peripheral registers go through this file:
+ *   UART	USART0 (Dynamixel bus, HAL_UART_DXL) and USART1 (PC link, HAL_UART_PC)
+ *   clock	TIMER5 counter and overflow flag
+ *   button	pin change interrupts INT0/INT4-7, sampling on TIMER5 compare A
+ *   ADC	channel selection, conversion and result
+ *   LED	PORTC
+ *   buzzer	TIMER1 phase correct PWM on OC1B
+ * hal_wait() is called in loops that wait for an interrupt to change a
+ * variable, it does nothing on the controller.
+ *
+ * Host build (HOST defined, see host/CMakeLists.txt): the functions are
+ * implemented by stub devices that run on a virtual clock. The ISR macro
+ * turns the interrupt service routines into plain functions, the virtual
+ * clock calls them when a device event (timer overflow, received byte,
+ * empty transmit buffer, button edge) is due and interrupts are enabled.
+ * Time only passes in the HAL: waiting for a device, delays, hal_wait()
+ * and a small amount for every read of the clock, so busy loops finish.
+ * The host side of the stub devices is in host/hal_host.h.
+ */
+
+#ifndef HAL_H_
+#define HAL_H_
+
+#include "global.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// UARTs
+#define HAL_UART_DXL			0		// USART0, Dynamixel bus (half duplex)
+#define HAL_UART_PC				1		// USART1, serial cable or ZigBee
+
+// UCSRnB bits, the same in both UARTs
+#define HAL_UART_TRANSMITTER	0x08	// TXEN, transmitter enabled
+#define HAL_UART_TX_EMPTY		0x20	// UDRIE, transmit buffer empty interrupt
+#define HAL_UART_TX_DONE		0x40	// TXCIE, transmit complete interrupt
+
+// start-up code that runs before main (.init3), see watchdog.c
+#ifdef HOST
+#define HAL_INIT3
+#else
+#define HAL_INIT3				__attribute__((naked)) __attribute__((section(".init3")))
+#endif
+
+#ifdef HOST
+
+// host build: stub devices and virtual clock in host/hal_host.c,
+// the functions do what the AVR versions below do
+void hal_uartOpen(uint8 port);
+void hal_uartSetDivisor(uint8 port, uint16 divisor);
+void hal_uartClose(uint8 port);
+void hal_uartEnable(uint8 port, uint8 flags);
+void hal_uartDisable(uint8 port, uint8 flags);
+uint8 hal_uartIsEnabled(uint8 port, uint8 flags);
+void hal_uartWrite(uint8 port, uint8 data);
+void hal_uartSend(uint8 port, uint8 data);
+void hal_uartWaitSent(uint8 port);
+uint8 hal_uartRead(uint8 port);
+void hal_dxlDirection(uint8 transmit);
+void hal_zigInit(void);
+
+void hal_clockStart(void);
+uint16 hal_clockCount(void);
+uint8 hal_clockOverflowPending(void);
+
+void hal_buttonInit(void);
+void hal_buttonEdgeInterrupts(uint8 enable);
+uint8 hal_buttonIsSampling(void);
+void hal_buttonStartSampling(uint16 ticks);
+void hal_buttonStopSampling(void);
+uint16 hal_buttonNextSample(uint16 ticks);
+uint8 hal_buttonRead(void);
+
+void hal_adcSelect(uint8 channel);
+void hal_adcStart(void);
+uint8 hal_adcIsConverting(void);
+uint16 hal_adcResult(void);
+void hal_adcSetLeftAdjust(uint8 left);
+uint8 hal_adcIsLeftAdjusted(void);
+
+void hal_ledInit(void);
+uint8 hal_ledRead(void);
+void hal_ledWrite(uint8 value);
+
+void hal_buzzerInit(void);
+void hal_buzzerInterrupts(uint8 enable);
+void hal_buzzerSetTone(uint8 clock, uint16 top, uint16 duty);
+uint8 hal_buzzerIsUpcounting(void);
+void hal_buzzerOutput(uint8 on);
+
+void hal_wait(void);
+
+#else
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+// UARTs
+// all functions take the port as a constant, the compiler keeps only the
+// registers of that port
+
+// 8 bit asynchronous, double speed, receive interrupt on
+static inline void hal_uartOpen(uint8 port)
+{
+	// register A
+	// bit6: clear transmit complete, bit1: double speed (asynchronous)
+	// register B
+	// bit7: enable RX interrupt, bit4: enable RX, bit3: enable TX
+	// register C
+	// bit6: asynchronous, bit5,4: no parity, bit3: 1 stop bit, bit2,1: 8 bit
+	if ( port == HAL_UART_DXL ) {
+		UCSR0A = 0b01000010;
+		UCSR0B = 0b10011000;
+		UCSR0C = 0b00000110;
+	} else {
+		UCSR1A = 0b01000010;
+		UCSR1B = 0b10011000;
+		UCSR1C = 0b00000110;
+	}
+}
+
+// baud rate divisor (2MHz base clock in double speed mode)
+static inline void hal_uartSetDivisor(uint8 port, uint16 divisor)
+{
+	if ( port == HAL_UART_DXL ) {
+		UBRR0H = (uint8)(divisor >> 8);
+		UBRR0L = (uint8)(divisor & 0xFF);
+	} else {
+		UBRR1H = (uint8)(divisor >> 8);
+		UBRR1L = (uint8)(divisor & 0xFF);
+	}
+}
+
+// receiver, transmitter and interrupts off
+static inline void hal_uartClose(uint8 port)
+{
+	if ( port == HAL_UART_DXL ) {
+		UCSR0B = 0;
+	} else {
+		UCSR1B = 0;
+	}
+}
+
+// set and clear HAL_UART_TRANSMITTER, HAL_UART_TX_EMPTY and HAL_UART_TX_DONE
+static inline void hal_uartEnable(uint8 port, uint8 flags)
+{
+	if ( port == HAL_UART_DXL ) {
+		UCSR0B |= flags;
+	} else {
+		UCSR1B |= flags;
+	}
+}
+
+static inline void hal_uartDisable(uint8 port, uint8 flags)
+{
+	if ( port == HAL_UART_DXL ) {
+		UCSR0B &= ~flags;
+	} else {
+		UCSR1B &= ~flags;
+	}
+}
+
+// Returns:	(uint8) non-zero if any of the flags is set
+static inline uint8 hal_uartIsEnabled(uint8 port, uint8 flags)
+{
+	return ( port == HAL_UART_DXL ) ? (UCSR0B & flags) : (UCSR1B & flags);
+}
+
+// write the transmit buffer without waiting (transmit ISRs)
+static inline void hal_uartWrite(uint8 port, uint8 data)
+{
+	if ( port == HAL_UART_DXL ) {
+		UDR0 = data;
+	} else {
+		UDR1 = data;
+	}
+}
+
+// wait for room in the transmit buffer, clear the transmit complete flag
+// and send the byte
+static inline void hal_uartSend(uint8 port, uint8 data)
+{
+	if ( port == HAL_UART_DXL ) {
+		while ( !bit_is_set(UCSR0A, UDRE0) );
+		UCSR0A |= (1<<TXC0);
+		UDR0 = data;
+	} else {
+		while ( !bit_is_set(UCSR1A, UDRE1) );
+		UCSR1A |= (1<<TXC1);
+		UDR1 = data;
+	}
+}
+
+// wait until the last byte has left the shift register
+static inline void hal_uartWaitSent(uint8 port)
+{
+	if ( port == HAL_UART_DXL ) {
+		while ( !bit_is_set(UCSR0A, TXC0) );
+	} else {
+		while ( !bit_is_set(UCSR1A, TXC1) );
+	}
+}
+
+// Returns:	(uint8) the received byte (receive ISRs)
+static inline uint8 hal_uartRead(uint8 port)
+{
+	return ( port == HAL_UART_DXL ) ? UDR0 : UDR1;
+}
+
+// direction of the half duplex Dynamixel bus buffer (PE2 transmit, PE3 receive)
+static inline void hal_dxlDirection(uint8 transmit)
+{
+	if ( transmit ) {
+		PORTE &= ~0x08;
+		PORTE |= 0x04;
+	} else {
+		PORTE &= ~0x04;
+		PORTE |= 0x08;
+	}
+}
+
+// switch the ZIG-110 module on
+static inline void hal_zigInit(void)
+{
+	DDRC  = 0x7F;
+	PORTC = 0x7E;
+	// to enable ZigBee communications we need PD5=low, PD6=high, make PD7 input and turn off pull-up on PD7
+	PORTD &= ~0x80;
+	PORTD &= ~0x20;
+	PORTD |= 0x40;
+}
+
+// Clock
+// TIMER5 in normal mode at F_CPU/8, overflow interrupt (compare A belongs to the buttons)
+static inline void hal_clockStart(void)
+{
+	TCCR5A = 0;
+	TCCR5B = (1<<CS51);
+	TCNT5 = 0;
+	TIFR5 = (1<<TOV5);
+	TIMSK5 |= (1<<TOIE5);
+}
+
+// The 16 bit TIMER5 registers share one TEMP register for the high byte,
+// the button sampling ISR (TCNT5, OCR5A) would change it between the two
+// byte reads, so the count is read with interrupts disabled
+// Returns:	(uint16) TIMER5 count
+static inline uint16 hal_clockCount(void)
+{
+	uint8 sreg = SREG;
+	uint16 count;
+
+	cli();
+	count = TCNT5;
+	SREG = sreg;
+	return count;
+}
+
+// Returns:	(uint8) non-zero if TIMER5 has overflowed and the ISR hasn't run yet
+static inline uint8 hal_clockOverflowPending(void)
+{
+	return bit_is_set(TIFR5, TOV5);
+}
+
+// Buttons
+// START on INT0 (PD0, high when pressed), UP/DOWN/LEFT/RIGHT on INT4-7
+// (PE4-7, low when pressed, pull-ups on)
+#define HAL_BUTTON_INTS		( (1<<INT7) | (1<<INT6) | (1<<INT5) | (1<<INT4) | (1<<INT0) )
+
+static inline void hal_buttonInit(void)
+{
+	// all five buttons are inputs, pull-ups for PORTE
+	DDRE &= ~0xF0;
+	DDRD &= ~0x01;
+	PORTE |= 0xF0;
+	// interrupt on INT0 rising edge, INT4-7 falling edge (button pushed)
+	EICRA = (1<<ISC01) | (1<<ISC00);
+	EICRB = (1<<ISC71) | (1<<ISC61) | (1<<ISC51) | (1<<ISC41);
+	EIFR = HAL_BUTTON_INTS;
+	EIMSK = HAL_BUTTON_INTS;
+}
+
+// enable or mask the press edge interrupts (an edge while masked stays flagged)
+static inline void hal_buttonEdgeInterrupts(uint8 enable)
+{
+	if ( enable ) {
+		EIMSK |= HAL_BUTTON_INTS;
+	} else {
+		EIMSK &= ~HAL_BUTTON_INTS;
+	}
+}
+
+// Returns:	(uint8) non-zero while the sampling interrupt (TIMER5 compare A) is on
+static inline uint8 hal_buttonIsSampling(void)
+{
+	return bit_is_set(TIMSK5, OCIE5A);
+}
+
+// first sample in ticks from now
+static inline void hal_buttonStartSampling(uint16 ticks)
+{
+	OCR5A = TCNT5 + ticks;
+	TIFR5 = (1<<OCF5A);
+	TIMSK5 |= (1<<OCIE5A);
+}
+
+static inline void hal_buttonStopSampling(void)
+{
+	TIMSK5 &= ~(1<<OCIE5A);
+}
+
+// schedule the next sample ticks after the current one (sampling ISR)
+// Returns:	(uint16) ticks since the current sample was due (interrupt latency)
+static inline uint16 hal_buttonNextSample(uint16 ticks)
+{
+	uint16 latency = TCNT5 - OCR5A;
+
+	OCR5A += ticks;
+	return latency;
+}
+
+// Returns:	(uint8) bit 0 START, bits 1-4 UP/DOWN/LEFT/RIGHT set if pressed
+static inline uint8 hal_buttonRead(void)
+{
+	uint8 pressed = ((uint8)(~PINE) & 0xF0) >> 3;
+
+	if ( PIND & 0x01 ) {
+		pressed |= 0x01;
+	}
+	return pressed;
+}
+
+// ADC
+// enable the ADC (clock prescaler 128, needed for 10 bit at 16MHz) and
+// connect a channel, AVCC reference
+static inline void hal_adcSelect(uint8 channel)
+{
+	// change ADMUX in one write, clearing the channel bits first would
+	// briefly connect channel 0 to the charge capacitor
+	uint8 tempADMUX = ADMUX;
+
+	ADCSRA = 0x87;
+	tempADMUX |= 1 << REFS0;
+	tempADMUX &= ~(1 << REFS1);
+	tempADMUX &= ~0x1F;
+	tempADMUX |= channel;
+	ADMUX = tempADMUX;
+}
+
+// start a conversion on the selected channel
+static inline void hal_adcStart(void)
+{
+	ADCSRA |= 1 << ADSC;
+}
+
+// Returns:	(uint8) 1 while a conversion is running
+static inline uint8 hal_adcIsConverting(void)
+{
+	return (ADCSRA >> ADSC) & 1;
+}
+
+// Returns:	(uint16) result of the last conversion, 8 bits if left adjusted
+static inline uint16 hal_adcResult(void)
+{
+	return bit_is_set(ADMUX, ADLAR) ? ADCH : ADC;
+}
+
+// left adjusted result is the 8 bit mode (ADCH only)
+static inline void hal_adcSetLeftAdjust(uint8 left)
+{
+	if ( left ) {
+		ADMUX |= 1 << ADLAR;
+	} else {
+		ADMUX &= ~(1 << ADLAR);
+	}
+}
+
+static inline uint8 hal_adcIsLeftAdjusted(void)
+{
+	return (ADMUX >> ADLAR) & 1;
+}
+
+// LEDs
+// PORTC0-6, a low pin switches the LED on
+static inline void hal_ledInit(void)
+{
+	DDRC  = 0x7F;
+	PORTC = 0x00;
+}
+
+static inline uint8 hal_ledRead(void)
+{
+	return PORTC;
+}
+
+static inline void hal_ledWrite(uint8 value)
+{
+	PORTC = value;
+}
+
+// Buzzer
+// TIMER1 in phase correct PWM mode 11 (TOP = OCR1A), the buzzer on PB5 is
+// switched by the compare B interrupt, the overflow interrupt times the notes
+static inline void hal_buzzerInit(void)
+{
+	TIMSK1 = 0;
+	TCCR1A = 0x23;		// OC1A disconnected, OC1B cleared up-counting and set down-counting, mode 11
+	TCCR1B = 0x11;		// mode 11, clock = IO clk (prescaler 1)
+	TCCR1C = 0x00;		// no forced output compare
+	OCR1A = (F_CPU/2) / 1000;	// TOP for 1 kHz
+	OCR1B = 0;					// 0% duty cycle
+	DDRB |= 0x20;		// buzzer pin is an output
+	TIMSK1 = (1<<OCIE1B) | (1<<TOIE1);
+}
+
+// compare B and overflow interrupts on (pending overflows are cleared) or off
+static inline void hal_buzzerInterrupts(uint8 enable)
+{
+	if ( enable ) {
+		TIFR1 |= 0xFF;
+		TIMSK1 = (1<<OCIE1B) | (1<<TOIE1);
+	} else {
+		TIMSK1 = 0;
+	}
+}
+
+// clock select (CS12:0), TOP (frequency) and compare B (volume), interrupts off
+static inline void hal_buzzerSetTone(uint8 clock, uint16 top, uint16 duty)
+{
+	TCCR1B = (TCCR1B & 0xF8) | clock;
+	OCR1A = top;
+	OCR1B = duty;
+}
+
+// Returns:	(uint8) 1 if the timer has passed compare B counting up (compare B ISR)
+static inline uint8 hal_buzzerIsUpcounting(void)
+{
+	return TCNT1 > OCR1B;
+}
+
+static inline void hal_buzzerOutput(uint8 on)
+{
+	if ( on ) {
+		PORTB |= 0x20;
+	} else {
+		PORTB &= ~0x20;
+	}
+}
+
+// nothing to do on the controller, the interrupts run by themselves
+static inline void hal_wait(void)
+{
+}
+
+#endif /* HOST */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_H_ */
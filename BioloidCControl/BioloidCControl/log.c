@@ -0,0 +1,320 @@
+/*
+ * log.c - Lightweight formatted output for the serial port (replaces printf)
+ *   Messages are queued as Flash format string plus raw argument bytes.
+ *   The serial transmit ISR pulls the text one character at a time, so
+ *   logging costs only the argument copy and no output buffer is needed.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <stdarg.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "global.h"
+#include "hal.h"
+#include "log.h"
+
+// serial.c enables the transmit interrupt
+extern void serial_startTransmit(void);
+
+// states of the character generator
+#define LOG_TEXT		0	// copying the format string
+#define LOG_DECIMAL		1	// sending decimal digits
+#define LOG_HEX			2	// sending hex digits
+#define LOG_STRING		3	// sending a %s argument
+
+// one queued message
+typedef struct {
+	PGM_P format;
+	uint8 args[LOG_ARG_BYTES];
+} log_message;
+
+// powers of ten for digit generation without division
+static const uint32_t log_pow10[10] PROGMEM = { 1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL,
+	1000000UL, 10000000UL, 100000000UL, 1000000000UL };
+
+// message queue, written by log_printf_P and read by the transmit ISR
+static log_message log_queue[LOG_QUEUE_LENGTH];
+static volatile uint8 log_head = 0;
+static volatile uint8 log_tail = 0;
+static volatile uint16 log_dropped = 0;
+static uint8 log_enabled = 1;
+
+// character generator state (only used in the transmit ISR)
+static uint8 log_active = 0;		// a message is being sent
+static uint8 log_state = LOG_TEXT;
+static PGM_P log_format;			// position in the format string
+static uint8 log_arg;				// position in the argument bytes
+static uint8 log_digit;				// current digit index (power of ten or nibble)
+static uint32_t log_value;			// number being sent
+static uint8 log_pending_lf = 0;	// LF still to send after CR
+
+// internal function prototypes
+static uint8 log_readArg(void);
+static uint32_t log_readNumber(uint8 bytes);
+
+
+// log a message, format string needs to be in Flash (PSTR or PROGMEM)
+void log_printf_P(PGM_P format, ...)
+{
+	va_list ap;
+	log_message *msg;
+	uint8 next, pos, size;
+	char c;
+	const char *s;
+	uint32_t value;
+
+	if ( !log_enabled ) {
+		return;
+	}
+	next = (log_tail + 1) % LOG_QUEUE_LENGTH;
+	while ( next == log_head )
+	{
+		// queue is full - wait for the transmit ISR unless it can't run
+		if ( bit_is_clear(SREG, SREG_I) ) {
+			log_dropped++;
+			return;
+		}
+		hal_wait();
+	}
+
+	// store the format string and copy the arguments as raw bytes
+	msg = &log_queue[log_tail];
+	msg->format = format;
+	pos = 0;
+	va_start(ap, format);
+	while ( (c = pgm_read_byte(format++)) != 0 )
+	{
+		if ( c != '%' ) {
+			continue;
+		}
+		c = pgm_read_byte(format++);
+		size = 2;
+		if ( c == 'l' ) {
+			size = 4;
+			c = pgm_read_byte(format++);
+		}
+		if ( c == 'i' || c == 'd' || c == 'u' || c == 'x' )
+		{
+			if ( size == 4 ) {
+				value = va_arg(ap, uint32_t);
+			} else {
+				value = (unsigned int) va_arg(ap, int);
+			}
+			// arguments that don't fit are sent as 0
+			for (uint8 i=0; i<size && pos<LOG_ARG_BYTES; i++) {
+				msg->args[pos++] = (uint8) value;
+				value >>= 8;
+			}
+		}
+		else if ( c == 's' )
+		{
+			// copy the string, truncated to the remaining space
+			s = va_arg(ap, const char *);
+			while ( *s != 0 && pos < LOG_ARG_BYTES-1 ) {
+				msg->args[pos++] = *s++;
+			}
+			if ( pos < LOG_ARG_BYTES ) {
+				msg->args[pos++] = 0;
+			}
+		}
+		else if ( c == 0 ) {
+			break;
+		}
+	}
+	va_end(ap);
+	// clear the unused bytes so missing arguments read as 0
+	while ( pos < LOG_ARG_BYTES ) {
+		msg->args[pos++] = 0;
+	}
+
+	// hand the message to the transmit ISR
+	log_tail = next;
+	serial_startTransmit();
+}
+
+// produce the next character to transmit, called by the serial transmit ISR
+// Each call does at most one pass through the digit loop (max 9 subtractions)
+// Returns:	(int16)	next character or -1 if there is nothing to send
+int16 log_getChar()
+{
+	char c;
+	uint8 digit;
+	uint32_t power;
+
+	if ( log_pending_lf ) {
+		log_pending_lf = 0;
+		return '\n';
+	}
+
+	while ( 1 )
+	{
+		if ( log_state == LOG_DECIMAL )
+		{
+			// subtract the current power of ten to get the digit
+			power = pgm_read_dword(&log_pow10[log_digit]);
+			digit = 0;
+			while ( log_value >= power ) {
+				log_value -= power;
+				digit++;
+			}
+			if ( log_digit == 0 ) {
+				log_state = LOG_TEXT;
+			} else {
+				log_digit--;
+			}
+			return '0' + digit;
+		}
+		if ( log_state == LOG_HEX )
+		{
+			digit = (log_value >> (log_digit * 4)) & 0x0F;
+			if ( log_digit == 0 ) {
+				log_state = LOG_TEXT;
+			} else {
+				log_digit--;
+			}
+			return ( digit < 10 ) ? '0' + digit : 'a' + digit - 10;
+		}
+		if ( log_state == LOG_STRING )
+		{
+			c = log_readArg();
+			if ( c != 0 ) {
+				return c;
+			}
+			log_state = LOG_TEXT;
+		}
+
+		// start the next message
+		if ( !log_active )
+		{
+			if ( log_head == log_tail ) {
+				return -1;
+			}
+			log_format = log_queue[log_head].format;
+			log_arg = 0;
+			log_active = 1;
+		}
+
+		c = pgm_read_byte(log_format++);
+		if ( c == 0 ) {
+			// message finished, release it
+			log_active = 0;
+			log_head = (log_head + 1) % LOG_QUEUE_LENGTH;
+			continue;
+		}
+		if ( c == '\n' ) {
+			log_pending_lf = 1;
+			return '\r';
+		}
+		if ( c != '%' ) {
+			return c;
+		}
+
+		// conversion
+		c = pgm_read_byte(log_format++);
+		digit = 2;
+		if ( c == 'l' ) {
+			digit = 4;
+			c = pgm_read_byte(log_format++);
+		}
+		switch ( c )
+		{
+			case 'i':
+			case 'd':
+				log_value = log_readNumber(digit);
+				// sign extend 16-bit values, then send the sign separately
+				if ( digit == 2 ) {
+					log_value = (int32_t)(int16_t) log_value;
+				}
+				log_state = LOG_DECIMAL;
+				log_digit = 9;
+				if ( (int32_t) log_value < 0 ) {
+					log_value = -(int32_t) log_value;
+					// skip leading zeros on the next call
+					while ( log_digit > 0 && log_value < pgm_read_dword(&log_pow10[log_digit]) ) { log_digit--; }
+					return '-';
+				}
+				break;
+			case 'u':
+				log_value = log_readNumber(digit);
+				log_state = LOG_DECIMAL;
+				log_digit = 9;
+				break;
+			case 'x':
+				log_value = log_readNumber(digit);
+				log_state = LOG_HEX;
+				log_digit = digit * 2 - 1;
+				while ( log_digit > 0 && ((log_value >> (log_digit * 4)) & 0x0F) == 0 ) { log_digit--; }
+				break;
+			case 's':
+				log_state = LOG_STRING;
+				break;
+			case 0:
+				// format string ends with '%'
+				log_format--;
+				break;
+			default:
+				// %% and anything unsupported is sent as is
+				return c;
+		}
+
+		// skip leading zeros
+		if ( log_state == LOG_DECIMAL ) {
+			while ( log_digit > 0 && log_value < pgm_read_dword(&log_pow10[log_digit]) ) { log_digit--; }
+		}
+	}
+}
+
+// wait until all logged messages have been sent
+void log_flush()
+{
+	// only possible if the transmit ISR can run
+	if ( bit_is_clear(SREG, SREG_I) ) {
+		return;
+	}
+	while ( log_head != log_tail ) {
+		hal_wait();
+	}
+}
+
+// switch logging off (messages are discarded) or back on
+void log_setEnabled(uint8 enable)
+{
+	log_enabled = enable;
+}
+
+// Returns the number of messages dropped because the queue was full
+uint16 log_getDropped()
+{
+	return log_dropped;
+}
+
+// read the next argument byte of the current message
+static uint8 log_readArg()
+{
+	if ( log_arg >= LOG_ARG_BYTES ) {
+		return 0;
+	}
+	return log_queue[log_head].args[log_arg++];
+}
+
+// read a 2 or 4 byte number from the arguments of the current message
+static uint32_t log_readNumber(uint8 bytes)
+{
+	uint32_t value = 0;
+	for (uint8 i=0; i<bytes; i++) {
+		value |= (uint32_t) log_readArg() << (8 * i);
+	}
+	return value;
+}
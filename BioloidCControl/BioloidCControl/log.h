@@ -0,0 +1,66 @@
+/*
+ * log.h - Lightweight formatted output for the serial port (replaces printf)
+ *   Format strings stay in Flash and formatting is deferred: log_printf
+ *   only stores the arguments, the text is produced one character at a
+ *   time by the serial transmit interrupt when the port is ready.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Supported conversions: %i %u %x (16 bit), %li %lu %lx (32 bit), %s and %%
+ * No field width, precision or floating point. Strings passed with %s are
+ * copied when the message is logged, so they can be changed afterwards.
+ * Newline is sent as CR+LF.
+ */
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <avr/pgmspace.h>
+#include "global.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define LOG_QUEUE_LENGTH	16		// number of messages waiting to be sent
+#define LOG_ARG_BYTES		12		// argument storage per message (int = 2, long = 4 bytes)
+
+// log a message with the format string kept in Flash, usage as for printf
+#define log_printf(format, ...)		log_printf_P(PSTR(format), ##__VA_ARGS__)
+
+// log a message, format string needs to be in Flash (PSTR or PROGMEM)
+// Blocks while the queue is full if interrupts are enabled, otherwise the
+// message is dropped (and counted)
+void log_printf_P(PGM_P format, ...);
+
+// produce the next character to transmit, called by the serial transmit ISR
+// Returns:	(int16)	next character or -1 if there is nothing to send
+int16 log_getChar(void);
+
+// wait until all logged messages have been sent
+void log_flush(void);
+
+// switch logging off (messages are discarded) or back on
+void log_setEnabled(uint8 enable);
+
+// Returns the number of messages dropped because the queue was full
+uint16 log_getDropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_H_ */
@@ -0,0 +1,106 @@
+/*
+ * melody.c - note tables of the buzzer melodies
+ *   Generated by compile_melody.pl from melodies.txt, do not edit.
+ */
+
+#include <avr/pgmspace.h>
+#include "buzzer.h"
+#include "melody.h"
+
+// TIMER1 top, compare B (volume), overflows, clock select
+// !L16 cdefgab>cbagfedc
+static const buzzer_note melody_scale[] PROGMEM = {
+	{ 38168, 19084,    32, 0x01 },
+	{ 34014, 17007,    36, 0x01 },
+	{ 30303, 15151,    41, 0x01 },
+	{ 28571, 14285,    43, 0x01 },
+	{ 25510, 12755,    49, 0x01 },
+	{ 22727, 11363,    55, 0x01 },
+	{ 20243, 10121,    61, 0x01 },
+	{ 19120,  9560,    65, 0x01 },
+	{ 20243, 10121,    61, 0x01 },
+	{ 22727, 11363,    55, 0x01 },
+	{ 25510, 12755,    49, 0x01 },
+	{ 28571, 14285,    43, 0x01 },
+	{ 30303, 15151,    41, 0x01 },
+	{ 34014, 17007,    36, 0x01 },
+	{ 38168, 19084,    32, 0x01 },
+	{ 0, 0, 0, 0 }
+};
+
+// T240 L8 a gafaeada c+adaeafa
+static const buzzer_note melody_bach[] PROGMEM = {
+	{ 22727, 11363,    55, 0x01 },
+	{ 25510, 12755,    49, 0x01 },
+	{ 22727, 11363,    55, 0x01 },
+	{ 28571, 14285,    43, 0x01 },
+	{ 22727, 11363,    55, 0x01 },
+	{ 30303, 15151,    41, 0x01 },
+	{ 22727, 11363,    55, 0x01 },
+	{ 34014, 17007,    36, 0x01 },
+	{ 22727, 11363,    55, 0x01 },
+	{ 36101, 18050,    34, 0x01 },
+	{ 22727, 11363,    55, 0x01 },
+	{ 34014, 17007,    36, 0x01 },
+	{ 22727, 11363,    55, 0x01 },
+	{ 30303, 15151,    41, 0x01 },
+	{ 22727, 11363,    55, 0x01 },
+	{ 28571, 14285,    43, 0x01 },
+	{ 22727, 11363,    55, 0x01 },
+	{ 0, 0, 0, 0 }
+};
+
+// O6 T40 L16 d#<b<f#<d#<f#<bd#f#
+static const buzzer_note melody_arpeggio[] PROGMEM = {
+	{  8032,  4016,   466, 0x01 },
+	{ 10132,  5066,   370, 0x01 },
+	{ 13495,  6747,   277, 0x01 },
+	{ 16077,  8038,   233, 0x01 },
+	{ 13495,  6747,   277, 0x01 },
+	{ 10132,  5066,   370, 0x01 },
+	{  8032,  4016,   466, 0x01 },
+	{  6748,  3374,   555, 0x01 },
+	{ 0, 0, 0, 0 }
+};
+
+// ! O6 L16 dcd<b-d<ad<g d<f+d<gd<ad<b-
+static const buzzer_note melody_pedal[] PROGMEM = {
+	{  8518,  4259,   146, 0x01 },
+	{  9560,  4780,   130, 0x01 },
+	{  8518,  4259,   146, 0x01 },
+	{ 10718,  5359,   116, 0x01 },
+	{  8518,  4259,   146, 0x01 },
+	{ 11364,  5682,   110, 0x01 },
+	{  8518,  4259,   146, 0x01 },
+	{ 12755,  6377,    98, 0x01 },
+	{  8518,  4259,   146, 0x01 },
+	{ 13495,  6747,    92, 0x01 },
+	{  8518,  4259,   146, 0x01 },
+	{ 12755,  6377,    98, 0x01 },
+	{  8518,  4259,   146, 0x01 },
+	{ 11364,  5682,   110, 0x01 },
+	{  8518,  4259,   146, 0x01 },
+	{ 10718,  5359,   116, 0x01 },
+	{ 0, 0, 0, 0 }
+};
+
+// ! O3 T40 f.b.f.b.f.b.f.b.
+static const buzzer_note melody_alarm[] PROGMEM = {
+	{  7143,  3571,   393, 0x02 },
+	{ 40486, 20243,   555, 0x01 },
+	{  7143,  3571,   393, 0x02 },
+	{ 40486, 20243,   555, 0x01 },
+	{  7143,  3571,   393, 0x02 },
+	{ 40486, 20243,   555, 0x01 },
+	{  7143,  3571,   393, 0x02 },
+	{ 40486, 20243,   555, 0x01 },
+	{ 0, 0, 0, 0 }
+};
+
+const buzzer_note * const melody_table[MELODY_COUNT] PROGMEM = {
+	melody_scale,
+	melody_bach,
+	melody_arpeggio,
+	melody_pedal,
+	melody_alarm
+};
@@ -0,0 +1,22 @@
+/*
+ * melody.h - melody ids for buzzer_playMelody()
+ *   Generated by compile_melody.pl from melodies.txt, do not edit.
+ */
+
+#ifndef MELODY_H_
+#define MELODY_H_
+
+#include <avr/pgmspace.h>
+#include "buzzer.h"
+
+#define MELODY_SCALE           0
+#define MELODY_BACH            1
+#define MELODY_ARPEGGIO        2
+#define MELODY_PEDAL           3
+#define MELODY_ALARM           4
+#define MELODY_COUNT			5
+
+// note tables by id (melody.c)
+extern const buzzer_note * const melody_table[MELODY_COUNT] PROGMEM;
+
+#endif /* MELODY_H_ */
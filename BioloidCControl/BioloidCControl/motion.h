@@ -14,7 +14,7 @@
 #include "global.h"
  
 // Array showing which Dynamixel servos are enabled in motion file 
-const uint8 AX12_ENABLED[MAX_AX12_SERVOS] = {0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0,0,0,0,0,0,0}; 
+const uint8 AX12_ENABLED[MAX_AX12_SERVOS] PROGMEM = {0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0,0,0,0,0,0,0}; 
 
 const struct // Bow 
 { 
@@ -5585,7 +5585,239 @@ const struct // B Carpet getup
 const uint8 ACTIVE_MOTION_PAGES = 227;
 
 // Min and max values for the servo values
-const uint16 SERVO_MAX_VALUES[18] = {833,856,770,898,537,868,512,743,541,775,640,968,524,1015,850,601,572,729}; 
-const uint16 SERVO_MIN_VALUES[18] = {166,190,145,253,155,486,280,512,248,482,49,383,28,499,422,181,294,444}; 
+const uint16 SERVO_MAX_VALUES[18] PROGMEM = {833,856,770,898,537,868,512,743,541,775,640,968,524,1015,850,601,572,729}; 
+const uint16 SERVO_MIN_VALUES[18] PROGMEM = {166,190,145,253,155,486,280,512,248,482,49,383,28,499,422,181,294,444}; 
+
+// Table of pointers to the motion pages (page 0 is not used) 
+const uint8 * const motion_pointer[228] PROGMEM = { 
+	NULL,
+	(const uint8 *) &MotionPage1,
+	(const uint8 *) &MotionPage2,
+	(const uint8 *) &MotionPage3,
+	(const uint8 *) &MotionPage4,
+	(const uint8 *) &MotionPage5,
+	(const uint8 *) &MotionPage6,
+	(const uint8 *) &MotionPage7,
+	(const uint8 *) &MotionPage8,
+	(const uint8 *) &MotionPage9,
+	(const uint8 *) &MotionPage10,
+	(const uint8 *) &MotionPage11,
+	(const uint8 *) &MotionPage12,
+	(const uint8 *) &MotionPage13,
+	(const uint8 *) &MotionPage14,
+	(const uint8 *) &MotionPage15,
+	(const uint8 *) &MotionPage16,
+	(const uint8 *) &MotionPage17,
+	(const uint8 *) &MotionPage18,
+	(const uint8 *) &MotionPage19,
+	(const uint8 *) &MotionPage20,
+	(const uint8 *) &MotionPage21,
+	(const uint8 *) &MotionPage22,
+	(const uint8 *) &MotionPage23,
+	(const uint8 *) &MotionPage24,
+	(const uint8 *) &MotionPage25,
+	(const uint8 *) &MotionPage26,
+	(const uint8 *) &MotionPage27,
+	(const uint8 *) &MotionPage28,
+	(const uint8 *) &MotionPage29,
+	(const uint8 *) &MotionPage30,
+	(const uint8 *) &MotionPage31,
+	(const uint8 *) &MotionPage32,
+	(const uint8 *) &MotionPage33,
+	(const uint8 *) &MotionPage34,
+	(const uint8 *) &MotionPage35,
+	(const uint8 *) &MotionPage36,
+	(const uint8 *) &MotionPage37,
+	(const uint8 *) &MotionPage38,
+	(const uint8 *) &MotionPage39,
+	(const uint8 *) &MotionPage40,
+	(const uint8 *) &MotionPage41,
+	(const uint8 *) &MotionPage42,
+	(const uint8 *) &MotionPage43,
+	(const uint8 *) &MotionPage44,
+	(const uint8 *) &MotionPage45,
+	(const uint8 *) &MotionPage46,
+	(const uint8 *) &MotionPage47,
+	(const uint8 *) &MotionPage48,
+	(const uint8 *) &MotionPage49,
+	(const uint8 *) &MotionPage50,
+	(const uint8 *) &MotionPage51,
+	(const uint8 *) &MotionPage52,
+	(const uint8 *) &MotionPage53,
+	(const uint8 *) &MotionPage54,
+	(const uint8 *) &MotionPage55,
+	(const uint8 *) &MotionPage56,
+	(const uint8 *) &MotionPage57,
+	(const uint8 *) &MotionPage58,
+	(const uint8 *) &MotionPage59,
+	(const uint8 *) &MotionPage60,
+	(const uint8 *) &MotionPage61,
+	(const uint8 *) &MotionPage62,
+	(const uint8 *) &MotionPage63,
+	(const uint8 *) &MotionPage64,
+	(const uint8 *) &MotionPage65,
+	(const uint8 *) &MotionPage66,
+	(const uint8 *) &MotionPage67,
+	(const uint8 *) &MotionPage68,
+	(const uint8 *) &MotionPage69,
+	(const uint8 *) &MotionPage70,
+	(const uint8 *) &MotionPage71,
+	(const uint8 *) &MotionPage72,
+	(const uint8 *) &MotionPage73,
+	(const uint8 *) &MotionPage74,
+	(const uint8 *) &MotionPage75,
+	(const uint8 *) &MotionPage76,
+	(const uint8 *) &MotionPage77,
+	(const uint8 *) &MotionPage78,
+	(const uint8 *) &MotionPage79,
+	(const uint8 *) &MotionPage80,
+	(const uint8 *) &MotionPage81,
+	(const uint8 *) &MotionPage82,
+	(const uint8 *) &MotionPage83,
+	(const uint8 *) &MotionPage84,
+	(const uint8 *) &MotionPage85,
+	(const uint8 *) &MotionPage86,
+	(const uint8 *) &MotionPage87,
+	(const uint8 *) &MotionPage88,
+	(const uint8 *) &MotionPage89,
+	(const uint8 *) &MotionPage90,
+	(const uint8 *) &MotionPage91,
+	(const uint8 *) &MotionPage92,
+	(const uint8 *) &MotionPage93,
+	(const uint8 *) &MotionPage94,
+	(const uint8 *) &MotionPage95,
+	(const uint8 *) &MotionPage96,
+	(const uint8 *) &MotionPage97,
+	(const uint8 *) &MotionPage98,
+	(const uint8 *) &MotionPage99,
+	(const uint8 *) &MotionPage100,
+	(const uint8 *) &MotionPage101,
+	(const uint8 *) &MotionPage102,
+	(const uint8 *) &MotionPage103,
+	(const uint8 *) &MotionPage104,
+	(const uint8 *) &MotionPage105,
+	(const uint8 *) &MotionPage106,
+	(const uint8 *) &MotionPage107,
+	(const uint8 *) &MotionPage108,
+	(const uint8 *) &MotionPage109,
+	(const uint8 *) &MotionPage110,
+	(const uint8 *) &MotionPage111,
+	(const uint8 *) &MotionPage112,
+	(const uint8 *) &MotionPage113,
+	(const uint8 *) &MotionPage114,
+	(const uint8 *) &MotionPage115,
+	(const uint8 *) &MotionPage116,
+	(const uint8 *) &MotionPage117,
+	(const uint8 *) &MotionPage118,
+	(const uint8 *) &MotionPage119,
+	(const uint8 *) &MotionPage120,
+	(const uint8 *) &MotionPage121,
+	(const uint8 *) &MotionPage122,
+	(const uint8 *) &MotionPage123,
+	(const uint8 *) &MotionPage124,
+	(const uint8 *) &MotionPage125,
+	(const uint8 *) &MotionPage126,
+	(const uint8 *) &MotionPage127,
+	(const uint8 *) &MotionPage128,
+	(const uint8 *) &MotionPage129,
+	(const uint8 *) &MotionPage130,
+	(const uint8 *) &MotionPage131,
+	(const uint8 *) &MotionPage132,
+	(const uint8 *) &MotionPage133,
+	(const uint8 *) &MotionPage134,
+	(const uint8 *) &MotionPage135,
+	(const uint8 *) &MotionPage136,
+	(const uint8 *) &MotionPage137,
+	(const uint8 *) &MotionPage138,
+	(const uint8 *) &MotionPage139,
+	(const uint8 *) &MotionPage140,
+	(const uint8 *) &MotionPage141,
+	(const uint8 *) &MotionPage142,
+	(const uint8 *) &MotionPage143,
+	(const uint8 *) &MotionPage144,
+	(const uint8 *) &MotionPage145,
+	(const uint8 *) &MotionPage146,
+	(const uint8 *) &MotionPage147,
+	(const uint8 *) &MotionPage148,
+	(const uint8 *) &MotionPage149,
+	(const uint8 *) &MotionPage150,
+	(const uint8 *) &MotionPage151,
+	(const uint8 *) &MotionPage152,
+	(const uint8 *) &MotionPage153,
+	(const uint8 *) &MotionPage154,
+	(const uint8 *) &MotionPage155,
+	(const uint8 *) &MotionPage156,
+	(const uint8 *) &MotionPage157,
+	(const uint8 *) &MotionPage158,
+	(const uint8 *) &MotionPage159,
+	(const uint8 *) &MotionPage160,
+	(const uint8 *) &MotionPage161,
+	(const uint8 *) &MotionPage162,
+	(const uint8 *) &MotionPage163,
+	(const uint8 *) &MotionPage164,
+	(const uint8 *) &MotionPage165,
+	(const uint8 *) &MotionPage166,
+	(const uint8 *) &MotionPage167,
+	(const uint8 *) &MotionPage168,
+	(const uint8 *) &MotionPage169,
+	(const uint8 *) &MotionPage170,
+	(const uint8 *) &MotionPage171,
+	(const uint8 *) &MotionPage172,
+	(const uint8 *) &MotionPage173,
+	(const uint8 *) &MotionPage174,
+	(const uint8 *) &MotionPage175,
+	(const uint8 *) &MotionPage176,
+	(const uint8 *) &MotionPage177,
+	(const uint8 *) &MotionPage178,
+	(const uint8 *) &MotionPage179,
+	(const uint8 *) &MotionPage180,
+	(const uint8 *) &MotionPage181,
+	(const uint8 *) &MotionPage182,
+	(const uint8 *) &MotionPage183,
+	(const uint8 *) &MotionPage184,
+	(const uint8 *) &MotionPage185,
+	(const uint8 *) &MotionPage186,
+	(const uint8 *) &MotionPage187,
+	(const uint8 *) &MotionPage188,
+	(const uint8 *) &MotionPage189,
+	(const uint8 *) &MotionPage190,
+	(const uint8 *) &MotionPage191,
+	(const uint8 *) &MotionPage192,
+	(const uint8 *) &MotionPage193,
+	(const uint8 *) &MotionPage194,
+	(const uint8 *) &MotionPage195,
+	(const uint8 *) &MotionPage196,
+	(const uint8 *) &MotionPage197,
+	(const uint8 *) &MotionPage198,
+	(const uint8 *) &MotionPage199,
+	(const uint8 *) &MotionPage200,
+	(const uint8 *) &MotionPage201,
+	(const uint8 *) &MotionPage202,
+	(const uint8 *) &MotionPage203,
+	(const uint8 *) &MotionPage204,
+	(const uint8 *) &MotionPage205,
+	(const uint8 *) &MotionPage206,
+	(const uint8 *) &MotionPage207,
+	(const uint8 *) &MotionPage208,
+	(const uint8 *) &MotionPage209,
+	(const uint8 *) &MotionPage210,
+	(const uint8 *) &MotionPage211,
+	(const uint8 *) &MotionPage212,
+	(const uint8 *) &MotionPage213,
+	(const uint8 *) &MotionPage214,
+	(const uint8 *) &MotionPage215,
+	(const uint8 *) &MotionPage216,
+	(const uint8 *) &MotionPage217,
+	(const uint8 *) &MotionPage218,
+	(const uint8 *) &MotionPage219,
+	(const uint8 *) &MotionPage220,
+	(const uint8 *) &MotionPage221,
+	(const uint8 *) &MotionPage222,
+	(const uint8 *) &MotionPage223,
+	(const uint8 *) &MotionPage224,
+	(const uint8 *) &MotionPage225,
+	(const uint8 *) &MotionPage226,
+	(const uint8 *) &MotionPage227 
+}; 
 
 #endif /* MOTION_H_ */
\ No newline at end of file
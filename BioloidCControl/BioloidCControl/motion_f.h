@@ -1,64 +1,91 @@
-/*
- * motion_f.h - function prototypes for motion.c
- * 
- * Version 0.5		31/10/2011
- * Written by Peter Lanius
- * Please send suggestions and bug fixes to PeterLanius@gmail.com
- *
- */
-
-/*
- * You may freely modify and share this code, as long as you keep this
- * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
- *
- *   http://creativecommons.org/licenses/by-sa/3.0/
- *
- * Disclaimer: To the extent permitted by law, this work is provided
- * without any warranty. It might be defective, in which case you agree
- * to be responsible for all resulting costs and damages.
- */
-
-
-#ifndef MOTION_F_H_
-#define MOTION_F_H_
-
-// Initialize the motion pages by constructing a table of pointers to each page
-// Motion pages are stored in Flash (PROGMEM) - see motion.h
-void motionPageInit();
-
-// This function unpacks a motion stored in program memory (Flash) 
-// in a struct stored in RAM to allow execution
-// StartPage - number of the motion page to be unpacked
-void unpackMotion(int StartPage);
-
-// This function initiates the execution of a motion step in the given motion page
-// Page - number of the motion page 
-// Returns (long) start time of the step
-unsigned long executeMotionStep(int Step);
-
-// This function initializes the joint flexibility values for the motion page
-// Returns (int)  0  - all ok
-//				 -1  - communication error
-int setMotionPageJointFlexibility();
-
-// This function executes a single robot motion page defined in motion.h
-// StartPage - number of the first motion page in the motion
-// Returns StartPage of next motion in sequence (0 - no further motions)
-int executeMotion(int StartPage);
-
-// This function executes robot motions consisting of one or more motion 
-// pages defined in motion.h
-// It implements a finite state machine to know what it is doing and what to do next
-// Code is meant to be reentrant so it can easily be converted to a task with a RTOS
-// Returns:		motion_state
-uint8 executeMotionSequence();
-
-// This function executes the exit page motion for the  
-// current motion page
- void executeMotionExitPage();
-
-// Function to check for any remaining servo movement
-// Returns:  (int)	number of servos still moving
-int checkMotionStepFinished();
-
+/*
+ * motion_f.h - function prototypes for motion.c
+ * 
+ * Version 0.5		31/10/2011
+ * Written by Peter Lanius
+ * Please send suggestions and bug fixes to PeterLanius@gmail.com
+ *
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+
+#ifndef MOTION_F_H_
+#define MOTION_F_H_
+
+// define the possible states for executeMotionSequence
+#define MOTION_STOPPED		0
+#define STEP_IN_MOTION		1
+#define STEP_IN_PAUSE		2
+#define STEP_FINISHED		3
+#define PAUSE_FINISHED		4
+#define	PAGE_FINISHED		5
+#define MOTION_ALARM		6
+#define ROBOT_SLIPPED		7
+
+// The command the motion engine works on (executeMotionSequence, walk_shift).
+// The scheduler build runs all tasks in one loop, so the motion engine reads
+// the globals. In the FreeRTOS build the other tasks change the globals while
+// it runs, it works on its own copy that rtos_bus takes from the command queue.
+#ifdef FREERTOS
+extern uint8 motion_command;			// bioloid_command of the command taken
+extern uint8 motion_last_command;		// last_bioloid_command at the hand-over
+extern uint8 motion_next_page;			// next_motion_page at the hand-over
+
+// take over a command from the command queue and flag it as new
+void motion_takeCommand(uint8 command, uint8 last_command, uint8 page);
+#else
+#define motion_command			bioloid_command
+#define motion_last_command		last_bioloid_command
+#define motion_next_page		next_motion_page
+#endif
+
+// Initialize the motion pages by constructing a table of pointers to each page
+// Motion pages are stored in Flash (PROGMEM) - see motion.h
+void motionPageInit();
+
+// This function unpacks a motion stored in program memory (Flash) 
+// in a struct stored in RAM to allow execution
+// StartPage - number of the motion page to be unpacked
+void unpackMotion(int StartPage);
+
+// This function initiates the execution of a motion step in the given motion page
+// Page - number of the motion page 
+// Returns (long) start time of the step
+unsigned long executeMotionStep(int Step);
+
+// This function initializes the joint flexibility values for the motion page
+// Returns (int)  0  - all ok
+//				 -1  - communication error
+int setMotionPageJointFlexibility();
+
+// This function executes a single robot motion page defined in motion.h
+// StartPage - number of the first motion page in the motion
+// Returns StartPage of next motion in sequence (0 - no further motions)
+int executeMotion(int StartPage);
+
+// This function executes robot motions consisting of one or more motion 
+// pages defined in motion.h
+// It implements a finite state machine to know what it is doing and what to do next
+// Code is meant to be reentrant so it can easily be converted to a task with a RTOS
+// Returns:		motion_state
+uint8 executeMotionSequence();
+
+// This function executes the exit page motion for the  
+// current motion page
+ void executeMotionExitPage();
+
+// Function to check for any remaining servo movement
+// Returns:  (int)	number of servos still moving
+int checkMotionStepFinished();
+
 #endif /* MOTION_F_H_ */
\ No newline at end of file
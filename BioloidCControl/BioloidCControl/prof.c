@@ -0,0 +1,115 @@
+/*
+ * prof.c - Main loop profiler with run time histograms
+ *   Keeps the probe statistics and sends them in binary over the serial
+ *   port. The probes themselves are inline macros in prof.h.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "global.h"
+#include "serial.h"
+#include "prof.h"
+
+#ifdef PROFILER
+
+// log2 of 0-15 (0 for 0)
+const uint8 prof_log2_nibble[16] PROGMEM = { 0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3 };
+
+prof_probe prof_probes[PROF_NUM_PROBES];
+static uint16 prof_overhead = 0;		// ticks measured for an empty probe
+
+#endif
+
+// running checksum of the dump
+static uint8 prof_checksum;
+
+// internal function prototypes
+static void prof_send(uint32 value, uint8 bytes);
+
+
+// measure the probe overhead and clear the statistics
+void prof_init()
+{
+#ifdef PROFILER
+	// the timer is the clock.c timebase, it runs from clock_init
+	// measure an empty probe
+	PROF_START(t);
+	prof_overhead = PROF_TIMER - t;
+#endif
+	prof_reset();
+}
+
+// clear the statistics
+void prof_reset()
+{
+#ifdef PROFILER
+	for (uint8 i=0; i<PROF_NUM_PROBES; i++)
+	{
+		prof_probes[i].count = 0;
+		prof_probes[i].sum = 0;
+		prof_probes[i].min = 0xFFFF;
+		prof_probes[i].max = 0;
+		for (uint8 b=0; b<PROF_HISTOGRAM_BINS; b++) {
+			prof_probes[i].histogram[b] = 0;
+		}
+	}
+#endif
+}
+
+// send the statistics in binary over the serial port and clear them
+void prof_dump()
+{
+	serial_write((unsigned char *) "PROF", 4);
+	prof_checksum = 0;
+	prof_send(PROF_VERSION, 1);
+#ifdef PROFILER
+	prof_send(PROF_NUM_PROBES, 1);
+	prof_send(PROF_TICKS_PER_US, 1);
+	prof_send(prof_overhead, 2);
+	for (uint8 i=0; i<PROF_NUM_PROBES; i++)
+	{
+		prof_send(i, 1);
+		prof_send(prof_probes[i].count, 4);
+		prof_send(prof_probes[i].sum, 4);
+		prof_send(prof_probes[i].min, 2);
+		prof_send(prof_probes[i].max, 2);
+		for (uint8 b=0; b<PROF_HISTOGRAM_BINS; b++) {
+			prof_send(prof_probes[i].histogram[b], 2);
+		}
+	}
+#else
+	// profiler not compiled in
+	prof_send(0, 1);
+	prof_send(PROF_TICKS_PER_US, 1);
+	prof_send(0, 2);
+#endif
+	prof_send(prof_checksum, 1);
+	prof_reset();
+}
+
+// send a value little endian and add it to the checksum
+static void prof_send(uint32 value, uint8 bytes)
+{
+	uint8 c;
+
+	while ( bytes-- > 0 )
+	{
+		c = (uint8) value;
+		serial_write(&c, 1);
+		prof_checksum += c;
+		value >>= 8;
+	}
+}
@@ -0,0 +1,146 @@
+/*
+ * prof.h - Main loop profiler with run time histograms
+ *   Probes around the scheduler tasks and the expensive functions keep
+ *   count, min, max, mean and a log2 histogram of their run time in RAM.
+ *   The PROF command sends the whole set in binary over the serial port.
+ *   Only compiled in when PROFILER is defined in global.h.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Timing
+ *
+ * Probes read TCNT5, the hardware part of the clock.c timebase (F_CPU/8,
+ * 0.5us per tick). A probe is one hal_clockCount() at the start (a 16-bit
+ * register read with interrupts off for its two bytes), one at the end and
+ * an inline update of the statistics (no loops, no division).
+ * Times up to 32767us are exact, longer ones wrap around, so the scheduler
+ * task probes record anything its micros() measurement puts above
+ * PROF_MAX_US as 0xFFFF. prof_init measures an empty probe, the dump
+ * reports it as the probe overhead (already included in every sample).
+ *
+ * Histogram bin 0 counts times of 0 or 1 tick, bin n (1-15) times from
+ * 2^n to 2^(n+1)-1 ticks, i.e. bin 1 is 1us, bin 11 is 1-2ms.
+ *
+ * Binary dump (PROF command), all values little endian:
+ *   'P' 'R' 'O' 'F'
+ *   version (1), number of probes (1), ticks per us (1), overhead in ticks (2)
+ *   per probe: probe id (1), count (4), sum of ticks (4), min (2), max (2),
+ *              16 histogram bins (2 each, saturating)
+ *   8-bit sum of all bytes after 'PROF'
+ * The statistics are cleared after the dump. prof_decode.pl prints a dump
+ * captured to a file. With PROFILER undefined the dump has no probes.
+ *
+ * Probe ids
+ *   0  unpackMotion				2  dxl_txrx_packet
+ *   1  calculatePoseServoSpeeds	3  processGyroKalman
+ *   4+ scheduler tasks in the order of the task table (see TASK command)
+ */
+
+#ifndef PROF_H_
+#define PROF_H_
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "global.h"
+#include "clock.h"
+#include "hal.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// probe ids
+#define PROF_UNPACK_MOTION		0
+#define PROF_POSE_SPEEDS		1
+#define PROF_DXL_TXRX			2
+#define PROF_GYRO_KALMAN		3
+#define PROF_TASK_FIRST			4		// first scheduler task
+#define PROF_TASK_PROBES		10		// scheduler tasks with a probe
+#define PROF_NUM_PROBES			(PROF_TASK_FIRST + PROF_TASK_PROBES)
+
+#define PROF_VERSION			1
+#define PROF_HISTOGRAM_BINS		16
+#define PROF_TICKS_PER_US		CLOCK_TICKS_PER_US
+#define PROF_MAX_US				32000	// longer times are recorded as 0xFFFF
+
+// statistics of one probe
+typedef struct {
+	uint32 count;
+	uint32 sum;				// ticks
+	uint16 min;
+	uint16 max;
+	uint16 histogram[PROF_HISTOGRAM_BINS];
+} prof_probe;
+
+#ifdef PROFILER
+
+// free running profiler timer
+#define PROF_TIMER				hal_clockCount()
+
+// start a measurement, declares the variable that holds the start time
+#define PROF_START(var)			uint16 var = PROF_TIMER
+// end a measurement and record it under a probe id
+#define PROF_STOP(var, probe)	prof_record((probe), PROF_TIMER - (var))
+
+extern prof_probe prof_probes[PROF_NUM_PROBES];
+extern const uint8 prof_log2_nibble[16] PROGMEM;
+
+// record a time in ticks (inline to keep the probe cost down)
+static inline void prof_record(uint8 probe, uint16 ticks)
+{
+	prof_probe *p = &prof_probes[probe];
+	uint8 bin = 0, b;
+
+	p->count++;
+	p->sum += ticks;
+	if ( ticks < p->min ) p->min = ticks;
+	if ( ticks > p->max ) p->max = ticks;
+	// log2 from the highest non-zero byte and nibble
+	if ( ticks >= 0x100 ) {
+		b = ticks >> 8;
+		bin = 8;
+	} else {
+		b = ticks;
+	}
+	if ( b >= 0x10 ) {
+		b >>= 4;
+		bin += 4;
+	}
+	bin += pgm_read_byte(&prof_log2_nibble[b]);
+	if ( p->histogram[bin] != 0xFFFF ) p->histogram[bin]++;
+}
+
+#else
+
+#define PROF_START(var)
+#define PROF_STOP(var, probe)
+
+#endif
+
+// measure the probe overhead and clear the statistics
+void prof_init(void);
+
+// clear the statistics
+void prof_reset(void);
+
+// send the statistics in binary over the serial port and clear them
+void prof_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROF_H_ */
@@ -0,0 +1,92 @@
+# Perl script to print the profiler statistics sent by the PROF command
+# of BioloidCControl (see prof.h for the format)
+#
+# Usage:	perl prof_decode.pl capture.bin
+#
+# capture.bin is the serial data received after sending PROF, saved with
+# a terminal program that can log binary data. Anything before the 'PROF'
+# marker (command echo, acknowledgements) is skipped.
+#
+# Version: 0.9
+#
+use strict;
+use warnings;
+
+# these need to match prof.h
+my $version = 1;
+my $bins = 16;
+my @probe_names = ( 'unpackMotion', 'calculatePoseServoSpeeds', 'dxl_txrx_packet', 'processGyroKalman' );
+my $task_first = 4;
+
+# quit unless we have the correct number of command-line args
+my $num_args = $#ARGV + 1;
+if ($num_args != 1) {
+	print "\nUsage: prof_decode.pl capture.bin \n";
+	exit 1;
+}
+
+open(my $in, '<:raw', $ARGV[0]) or die "Can't open $ARGV[0]: $!\n";
+my $data = do { local $/; <$in> };
+close($in);
+
+my $start = index($data, 'PROF');
+die "No profiler dump found in $ARGV[0]\n" if $start < 0;
+my $pos = $start + 4;
+my $sum = 0;
+
+# read an unsigned little endian value and add it to the checksum
+sub take {
+	my ($bytes) = @_;
+	die "Dump is truncated\n" if $pos + $bytes > length($data);
+	my $value = 0;
+	for my $i (0 .. $bytes-1) {
+		my $c = ord(substr($data, $pos + $i, 1));
+		$sum = ($sum + $c) & 0xFF;
+		$value |= $c << (8 * $i);
+	}
+	$pos += $bytes;
+	return $value;
+}
+
+my $dump_version = take(1);
+die "Unknown dump version $dump_version\n" if $dump_version != $version;
+my $num_probes = take(1);
+my $ticks_per_us = take(1);
+my $overhead = take(2);
+
+my @probes;
+for (1 .. $num_probes) {
+	my %p;
+	$p{id} = take(1);
+	$p{count} = take(4);
+	$p{sum} = take(4);
+	$p{min} = take(2);
+	$p{max} = take(2);
+	$p{histogram} = [ map { take(2) } 1 .. $bins ];
+	push @probes, \%p;
+}
+my $expected = $sum;
+my $checksum = take(1);
+die sprintf("Checksum error (0x%02X, expected 0x%02X)\n", $checksum, $expected) if $checksum != $expected;
+
+if ($num_probes == 0) {
+	print "Profiler not compiled in (define PROFILER in global.h)\n";
+	exit 0;
+}
+printf "Probe overhead %.1fus (included in the times below)\n\n", $overhead / $ticks_per_us;
+printf "%-26s %8s %10s %10s %10s\n", 'Probe', 'Count', 'Min us', 'Mean us', 'Max us';
+foreach my $p (@probes) {
+	next if $p->{count} == 0;
+	my $name = $p->{id} < $task_first ? $probe_names[$p->{id}] : sprintf('task %i', $p->{id} - $task_first);
+	my $max = $p->{max} == 0xFFFF ? '>32000' : sprintf('%.1f', $p->{max} / $ticks_per_us);
+	printf "%-26s %8u %10.1f %10.1f %10s\n", $name, $p->{count}, $p->{min} / $ticks_per_us,
+		$p->{sum} / $p->{count} / $ticks_per_us, $max;
+	# histogram, bin n holds times from 2^n ticks
+	my @h = @{$p->{histogram}};
+	for my $b (0 .. $bins-1) {
+		next if $h[$b] == 0;
+		my $lo = $b == 0 ? 0 : (1 << $b) / $ticks_per_us;
+		my $hi = (1 << ($b + 1)) / $ticks_per_us;
+		printf "    %8.1f - %8.1fus %8u %s\n", $lo, $hi, $h[$b], '#' x int(40 * $h[$b] / $p->{count} + 0.5);
+	}
+}
@@ -0,0 +1,124 @@
+# Perl script to report the static RAM use of BioloidCControl per module
+# Run as a post-build step (see BioloidCControl.cproj) or by hand.
+#
+# Usage:	perl ram_report.pl build_directory [BioloidCControl.elf]
+#
+# For every object file in the build directory it prints the bytes in .data
+# (initialised variables, which also take Flash), .bss and .noinit, and the
+# largest stack frame of the module from the .su file gcc writes with
+# -fstack-usage. Constants that are not in PROGMEM show up in .data (AVR
+# copies .rodata into RAM). The totals of the linked program are taken from
+# the .elf file, followed by the largest variables.
+# Stack frames are per function, the deepest call path is not known here.
+# The space left between the variables and the top of the SRAM is what the
+# stack can use (there is no heap), watch it when adding buffers.
+#
+# Version: 0.9
+#
+use strict;
+use warnings;
+use File::Basename;
+
+# these need to match the ATmega2561
+my $sram_size = 8192;
+my $top_variables = 10;
+
+my $size_tool = 'avr-size';
+my $nm_tool = 'avr-nm';
+
+# quit unless we have the correct number of command-line args
+my $num_args = $#ARGV + 1;
+if ($num_args < 1 || $num_args > 2) {
+	print "\nNumber of arguments: $num_args\n";
+	print "\nUsage: ram_report.pl build_directory [BioloidCControl.elf] \n";
+	exit 1;
+}
+
+my $dir = $ARGV[0];
+my $elf_file = ($num_args == 2) ? $ARGV[1] : "$dir/BioloidCControl.elf";
+print "\nRAM Report Build Directory: $dir\n";
+
+my @objects = sort glob("$dir/*.o");
+if (@objects == 0) {
+	print "No object files found.\n";
+	exit 1;
+}
+
+my ($total_data, $total_bss, $total_noinit) = (0, 0, 0);
+my ($deepest_frame, $deepest_function) = (0, '');
+printf "\n%-20s %6s %6s %6s %6s  %s\n", 'Module', '.data', '.bss', '.noinit', 'frame', 'largest frame';
+foreach my $object (@objects) {
+	my $module = basename($object, '.o');
+	my %sections = section_sizes($object);
+	my $data = ($sections{'.data'} || 0) + ($sections{'.rodata'} || 0);
+	my $bss = $sections{'.bss'} || 0;
+	my $noinit = $sections{'.noinit'} || 0;
+	$total_data += $data;
+	$total_bss += $bss;
+	$total_noinit += $noinit;
+
+	# largest stack frame from the .su file (if compiled with -fstack-usage)
+	my ($frame, $function) = ('-', '');
+	if (open(my $su, '<', "$dir/$module.su")) {
+		$frame = 0;
+		while (my $line = <$su>) {
+			# file.c:line:column:function<tab>bytes<tab>static|dynamic|bounded
+			next unless ($line =~ /:([^:\s]+)\t(\d+)\t(\w+)/);
+			if ($2 > $frame) {
+				$frame = $2;
+				$function = ($3 eq 'static') ? $1 : "$1 ($3)";
+			}
+		}
+		close $su;
+		if ($frame > $deepest_frame) {
+			($deepest_frame, $deepest_function) = ($frame, $function);
+		}
+	}
+	printf "%-20s %6i %6i %6i %6s  %s\n", $module, $data, $bss, $noinit, $frame, $function;
+}
+printf "%-20s %6i %6i %6i\n", 'Modules total', $total_data, $total_bss, $total_noinit;
+if ($deepest_frame > 0) {
+	print "Largest stack frame: $deepest_frame bytes in $deepest_function\n";
+} else {
+	print "No .su files, compile with -fstack-usage for the stack frames.\n";
+}
+
+# totals of the linked program (includes the C library)
+if (-e $elf_file) {
+	my %sections = section_sizes($elf_file);
+	my $used = ($sections{'.data'} || 0) + ($sections{'.bss'} || 0) + ($sections{'.noinit'} || 0);
+	printf "\nProgram %s: .data %i, .bss %i, .noinit %i\n", basename($elf_file),
+		$sections{'.data'} || 0, $sections{'.bss'} || 0, $sections{'.noinit'} || 0;
+	printf "Static RAM %i of %i bytes (%.1f%%), %i bytes left for the stack\n",
+		$used, $sram_size, 100.0 * $used / $sram_size, $sram_size - $used;
+
+	# largest variables in RAM
+	my @variables;
+	foreach my $line (`$nm_tool --size-sort -S -r "$elf_file"`) {
+		# address size type name
+		next unless ($line =~ /^[0-9a-f]+\s+([0-9a-f]+)\s+([bBdD])\s+(\S+)/);
+		push(@variables, [ $3, hex($1) ]);
+	}
+	print "\nLargest variables:\n" if (@variables > 0);
+	foreach my $variable (@variables[0 .. ($#variables < $top_variables-1 ? $#variables : $top_variables-1)]) {
+		printf "  %-32s %6i\n", @$variable;
+	}
+} else {
+	print "\n$elf_file not found, no program totals.\n";
+}
+exit 0;
+
+
+# section sizes of an object or program file as reported by avr-size -A
+sub section_sizes {
+	my ($file) = @_;
+	my %sections;
+	foreach my $line (`$size_tool -A "$file"`) {
+		# section size address
+		if ($line =~ /^(\.\w+)\s+(\d+)/) {
+			$sections{$1} += $2;
+		}
+	}
+	die "$size_tool failed on $file\n" if ($? != 0);
+	return %sections;
+}
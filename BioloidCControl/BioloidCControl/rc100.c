@@ -1,150 +1,288 @@
-/*
- * rc100.c - Functions for the RC100 remote control 
- * using the Zig-110 module in the remote
- *
- * Based on the embedded C library provided by Robotis  
- * Version 0.7		31/01/2013
- * Modified by Peter Lanius
- * Please send suggestions and bug fixes to PeterLanius@gmail.com
- * 
-*/
-
-#include "serial.h"
-#include "rc100.h"
-#include <avr/io.h>
-
-// RC-100 data packet related variables
-unsigned char  gbRcvPacket[6];
-unsigned char  gbRcvPacketNum;
-unsigned short gwRcvData;
-unsigned char  gbRcvFlag;
-
-// Initialise the RC-100 related variables
-// The RC-100 uses a 6-byte data packet format
-void rc100_initialize( void )
-{
-	gbRcvFlag = 0;
-	gwRcvData = 0;
-	gbRcvPacketNum = 0;
-	return;
-}
-
-// send a data packet to the RC-100
-// there is no documentation that the RC-100 will receive / interpret a packet
-// return value:	1 - success
-//					0 - error
-int rc100_tx_data(int data)
-{
-	unsigned char SndPacket[6];
-	unsigned short word = (unsigned short)data;
-	unsigned char lowbyte = (unsigned char)(word & 0xff);
-	unsigned char highbyte = (unsigned char)((word >> 8) & 0xff);
-
-	// construct the data packet in the RC-100 format
-	SndPacket[0] = 0xff;
-	SndPacket[1] = 0x55;
-	SndPacket[2] = lowbyte;
-	SndPacket[3] = ~lowbyte;
-	SndPacket[4] = highbyte;
-	SndPacket[5] = ~highbyte;
-	
-	// write the packet to the serial port (ZigBee)
-	if( serial_write( SndPacket, 6 ) != 6 )
-		return 0;
-
-	return 1;
-}
-
-// The RC-100 uses the communication packet in the form below
-//			FF 55 Data_L ~Data_L Data_H ~Data_H
-// Example: DATA : 0x 1234
-// Packet : 0x FF 0x 55 0x 34 0x CB 0x 12 0x ED
-// function returns the value of the receive flag
-int rc100_rx_check( void )
-{
-	unsigned char RcvNum;
-	unsigned char checksum;
-	int i, j;
-
-	// have unprocessed received data word, return
-	if( gbRcvFlag == 1 )
-		return 1;
-	
-	// Fill packet buffer
-	if( gbRcvPacketNum < 6 )
-	{
-		RcvNum = serial_read( &gbRcvPacket[gbRcvPacketNum], (6 - gbRcvPacketNum) );
-		if( RcvNum != -1 )
-			gbRcvPacketNum += RcvNum;
-	}
-	
-	// Find header	
-	if( gbRcvPacketNum >= 2 )
-	{
-		for( i=0; i<gbRcvPacketNum; i++ )
-		{
-			if( gbRcvPacket[i] == 0xff )
-			{
-				if(i <= (gbRcvPacketNum - 2))
-				{
-					if(gbRcvPacket[i+1] == 0x55)
-						break;
-				}
-			}
-		}
-		if(i > 0)
-		{
-			if( i == gbRcvPacketNum )
-			{
-				// Cannot find header
-				if(gbRcvPacket[i - 1] == 0xff)
-					i--;
-			}
-
-			// Remove data before header
-			for( j=i; j<gbRcvPacketNum; j++)
-			{
-				gbRcvPacket[j - i] = gbRcvPacket[j];
-			}
-			gbRcvPacketNum -= i;
-		}
-	}
-	
-	// Verify packet, expect 6 bytes
-	if(gbRcvPacketNum == 6)
-	{
-		// first byte needs to be 0xFF, second byte 0x55
-		if(gbRcvPacket[0] == 0xff && gbRcvPacket[1] == 0x55)
-		{
-			// check that ~(Byte 3) = Byte 4
-			checksum = ~gbRcvPacket[3];
-			if(gbRcvPacket[2] == checksum)
-			{
-				// check that ~(Byte 5) = Byte 6
-				checksum = ~gbRcvPacket[5];
-				if(gbRcvPacket[4] == checksum)
-				{
-					// all checks OK, assemble data word from low and high byte
-					gwRcvData = (unsigned short)((gbRcvPacket[4] << 8) & 0xff00);
-					gwRcvData += gbRcvPacket[2];
-					// set receive flag
-					gbRcvFlag = 1;
-				}
-			}
-		}
-
-		gbRcvPacket[0] = 0x00;
-		gbRcvPacketNum = 0;
-	}
-	return gbRcvFlag;
-}
-
-// return the data byte extracted from the packet
-int rc100_rx_data( void )
-{
-	// reset the receive flag
-	gbRcvFlag = 0;
-	
-	// return the data byte
-	return (int)gwRcvData;
-}
+/*
+ * rc100.c - Functions for the RC100 remote control 
+ * using the Zig-110 module in the remote
+ *
+ * Based on the embedded C library provided by Robotis  
+ * Version 0.7		31/01/2013
+ * Modified by Peter Lanius
+ * Please send suggestions and bug fixes to PeterLanius@gmail.com
+ * 
+*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "global.h"
+#include "serial.h"
+#include "rc100.h"
+#include "clock.h"
+
+// Button mapping table - define your RC-100 button-command assignments here
+// Buttons need to match exactly (chords are the sum of the button values)
+// Motion page 0 means use the default page of the command
+const rc100_mapping RC100_MAPPING[] PROGMEM = {
+	// walking, the robot stops as soon as the buttons are released
+	{ RC100_BTN_U,			RC100_PRESS,	COMMAND_WALK_FORWARD,		0 },
+	{ RC100_BTN_D,			RC100_PRESS,	COMMAND_WALK_BACKWARD,		0 },
+	{ RC100_BTN_L,			RC100_PRESS,	COMMAND_WALK_TURN_LEFT,		0 },
+	{ RC100_BTN_R,			RC100_PRESS,	COMMAND_WALK_TURN_RIGHT,	0 },
+	{ RC100_BTN_U_AND_L,	RC100_PRESS,	COMMAND_WALK_FWD_LEFT_SIDE,	0 },
+	{ RC100_BTN_U_AND_R,	RC100_PRESS,	COMMAND_WALK_FWD_RIGHT_SIDE,0 },
+	{ RC100_BTN_D_AND_L,	RC100_PRESS,	COMMAND_WALK_LEFT_SIDE,		0 },
+	{ RC100_BTN_D_AND_R,	RC100_PRESS,	COMMAND_WALK_RIGHT_SIDE,	0 },
+	{ RC100_BTN_U,			RC100_RELEASE,	COMMAND_STOP,				0 },
+	{ RC100_BTN_D,			RC100_RELEASE,	COMMAND_STOP,				0 },
+	{ RC100_BTN_L,			RC100_RELEASE,	COMMAND_STOP,				0 },
+	{ RC100_BTN_R,			RC100_RELEASE,	COMMAND_STOP,				0 },
+	{ RC100_BTN_U_AND_L,	RC100_RELEASE,	COMMAND_STOP,				0 },
+	{ RC100_BTN_U_AND_R,	RC100_RELEASE,	COMMAND_STOP,				0 },
+	{ RC100_BTN_D_AND_L,	RC100_RELEASE,	COMMAND_STOP,				0 },
+	{ RC100_BTN_D_AND_R,	RC100_RELEASE,	COMMAND_STOP,				0 },
+	// sit, stop and reset (hold STOP button)
+	{ RC100_BTN_5,			RC100_PRESS,	COMMAND_SIT,				0 },
+	{ RC100_BTN_6,			RC100_PRESS,	COMMAND_STOP,				0 },
+	{ RC100_BTN_6,			RC100_HOLD,		COMMAND_RESET,				0 },
+	// get up and motion pages, these always play to the end
+	{ RC100_BTN_U_AND_1,	RC100_PRESS,	COMMAND_FRONT_GET_UP,		0 },
+	{ RC100_BTN_D_AND_1,	RC100_PRESS,	COMMAND_BACK_GET_UP,		0 },
+	{ RC100_BTN_L_AND_1,	RC100_PRESS,	COMMAND_MOTIONPAGE,			8 },
+	{ RC100_BTN_R_AND_1,	RC100_PRESS,	COMMAND_MOTIONPAGE,			11 },
+	{ RC100_BTN_U_AND_2,	RC100_PRESS,	COMMAND_MOTIONPAGE,			5 },
+	{ RC100_BTN_D_AND_2,	RC100_PRESS,	COMMAND_MOTIONPAGE,			7 },
+	{ RC100_BTN_L_AND_2,	RC100_PRESS,	COMMAND_MOTIONPAGE,			2 },
+	{ RC100_BTN_R_AND_2,	RC100_PRESS,	COMMAND_MOTIONPAGE,			1 },
+};
+#define RC100_MAPPING_LENGTH	(sizeof(RC100_MAPPING) / sizeof(rc100_mapping))
+
+// packet decoder variables (only used in the receive ISR)
+static uint8 rc100_packet_count = 0;
+static uint8 rc100_data_low = 0;
+static uint8 rc100_data_high = 0;
+
+// button state from the last valid packet, written by the receive ISR
+static volatile uint16 rc100_buttons = 0;
+static volatile uint16 rc100_latched = 0;			// last non-zero state (catches short taps)
+static volatile uint8 rc100_press_count = 0;		// number of presses (0 to non-zero changes)
+static volatile unsigned long rc100_changed_time = 0;	// time the state last changed
+static volatile unsigned long rc100_packet_time = 0;	// time of the last valid packet
+
+// event state (only used in rc100_getCommand)
+static uint16 rc100_reported = 0;					// buttons of the last press event
+static unsigned long rc100_event_time = 0;			// time of the press or last repeat event
+static uint8 rc100_hold_sent = 0;
+static uint8 rc100_seen_presses = 0;				// press count when the state was last looked at
+
+// global variables
+extern volatile uint8 bioloid_command;			// current command
+extern volatile uint8 last_bioloid_command;		// last command
+extern volatile uint8 next_motion_page;			// next motion page if we got new command
+
+// internal function prototypes
+static uint8 rc100_mapEvent(uint16 buttons, uint8 event);
+
+// send a data packet to the RC-100
+// there is no documentation that the RC-100 will receive / interpret a packet
+// return value:	1 - success
+//					0 - error
+int rc100_tx_data(int data)
+{
+	unsigned char SndPacket[6];
+	unsigned short word = (unsigned short)data;
+	unsigned char lowbyte = (unsigned char)(word & 0xff);
+	unsigned char highbyte = (unsigned char)((word >> 8) & 0xff);
+
+	// construct the data packet in the RC-100 format
+	SndPacket[0] = 0xff;
+	SndPacket[1] = 0x55;
+	SndPacket[2] = lowbyte;
+	SndPacket[3] = ~lowbyte;
+	SndPacket[4] = highbyte;
+	SndPacket[5] = ~highbyte;
+	
+	// write the packet to the serial port (ZigBee)
+	if( serial_write( SndPacket, 6 ) != 6 )
+		return 0;
+
+	return 1;
+}
+
+// decode RC-100 packets byte by byte, called by the receive ISR
+// The RC-100 uses the communication packet in the form below
+//			FF 55 Data_L ~Data_L Data_H ~Data_H
+// Example: DATA : 0x 1234
+// Packet : 0x FF 0x 55 0x 34 0x CB 0x 12 0x ED
+// Each byte is checked as it arrives, so a packet is decoded the moment its
+// last byte is received. The RC-100 repeats the packet while buttons are
+// held and sends a packet with 0 when they are released.
+void rc100_receiveByte( uint8 c )
+{
+	uint16 buttons;
+
+	switch ( rc100_packet_count )
+	{
+		case 0:
+			// wait for the packet start byte
+			if ( c == 0xFF ) rc100_packet_count = 1;
+			return;
+		case 1:
+			if ( c == 0x55 ) {
+				rc100_packet_count = 2;
+				return;
+			}
+			break;
+		case 2:
+			rc100_data_low = c;
+			rc100_packet_count = 3;
+			return;
+		case 3:
+			if ( c == (uint8)~rc100_data_low ) {
+				rc100_packet_count = 4;
+				return;
+			}
+			break;
+		case 4:
+			rc100_data_high = c;
+			rc100_packet_count = 5;
+			return;
+		case 5:
+			if ( c == (uint8)~rc100_data_high )
+			{
+				// valid packet, update the button state
+				buttons = (rc100_data_high << 8) | rc100_data_low;
+				rc100_packet_time = millis();
+				if ( buttons != rc100_buttons ) {
+					if ( rc100_buttons == 0 ) rc100_press_count++;
+					rc100_buttons = buttons;
+					rc100_changed_time = rc100_packet_time;
+				}
+				if ( buttons != 0 ) {
+					rc100_latched = buttons;
+				}
+				rc100_packet_count = 0;
+				return;
+			}
+			break;
+	}
+
+	// invalid byte, resynchronize (~Data_H can be 0xFF, so this can be a new start)
+	rc100_packet_count = ( c == 0xFF ) ? 1 : 0;
+}
+
+// turn the button state into press, hold, repeat and release events and
+// look them up in the button mapping table, called by serialReceiveCommand()
+// Returns:	(int)	1 - new command
+//					0 - no new command
+int rc100_getCommand( void )
+{
+	uint16 buttons, latched;
+	unsigned long changed, packet, now;
+	uint8 presses;
+	uint8 event = RC100_NONE;
+	uint16 event_buttons = 0;
+
+	// take a consistent copy of the state written by the ISR
+	now = millis();
+	cli();
+	buttons = rc100_buttons;
+	latched = rc100_latched;
+	presses = rc100_press_count;
+	changed = rc100_changed_time;
+	packet = rc100_packet_time;
+	// no packets for too long - the release packet got lost
+	if ( buttons != 0 && (now - packet) > RC100_RELEASE_TIMEOUT ) {
+		rc100_buttons = 0;
+		buttons = 0;
+	}
+	sei();
+
+	if ( rc100_reported == 0 )
+	{
+		if ( buttons != 0 && (now - changed) >= RC100_CHORD_TIME ) {
+			// buttons have settled, report the press
+			event = RC100_PRESS;
+		} else if ( buttons == 0 && presses != rc100_seen_presses ) {
+			// short tap, released before it settled
+			buttons = latched;
+			event = RC100_PRESS;
+		}
+		if ( event == RC100_PRESS ) {
+			rc100_reported = buttons;
+			rc100_event_time = now;
+			rc100_hold_sent = 0;
+			event_buttons = buttons;
+			rc100_seen_presses = presses;
+		}
+	}
+	else if ( buttons == 0 )
+	{
+		// released - this is never delayed
+		event = RC100_RELEASE;
+		event_buttons = rc100_reported;
+		rc100_reported = 0;
+		rc100_seen_presses = presses;
+	}
+	else if ( buttons != rc100_reported )
+	{
+		// chord changed (e.g. U to U+L), report the new chord once it has settled
+		if ( (now - changed) >= RC100_CHORD_TIME ) {
+			event = RC100_PRESS;
+			event_buttons = buttons;
+			rc100_reported = buttons;
+			rc100_event_time = now;
+			rc100_hold_sent = 0;
+		}
+	}
+	else if ( !rc100_hold_sent && (now - rc100_event_time) >= RC100_HOLD_TIME )
+	{
+		// held long enough
+		event = RC100_HOLD;
+		event_buttons = buttons;
+		rc100_hold_sent = 1;
+		rc100_event_time = now;
+	}
+	else if ( rc100_hold_sent && (now - rc100_event_time) >= RC100_REPEAT_TIME )
+	{
+		// still held, repeat
+		event = RC100_REPEAT;
+		event_buttons = buttons;
+		rc100_event_time = now;
+	}
+
+	// presses while a gesture is tracked belong to that gesture
+	if ( rc100_reported != 0 ) {
+		rc100_seen_presses = presses;
+	}
+
+	if ( event == RC100_NONE ) {
+		return 0;
+	}
+	return rc100_mapEvent(event_buttons, event);
+}
+
+// look up an event in the button mapping table and set the command
+// Returns:	(uint8)	1 - command found
+//					0 - no command assigned to this event
+static uint8 rc100_mapEvent(uint16 buttons, uint8 event)
+{
+	uint8 command, page;
+
+	for (uint8 i=0; i<RC100_MAPPING_LENGTH; i++)
+	{
+		if ( pgm_read_word(&RC100_MAPPING[i].buttons) != buttons || pgm_read_byte(&RC100_MAPPING[i].event) != event ) {
+			continue;
+		}
+		command = pgm_read_byte(&RC100_MAPPING[i].command);
+		page = pgm_read_byte(&RC100_MAPPING[i].motion_page);
+
+		last_bioloid_command = bioloid_command;
+		bioloid_command = command;
+		if ( page == 0 && command != COMMAND_STOP ) {
+			page = command_getMotionPage(command);
+		}
+		if ( command != COMMAND_STOP ) {
+			next_motion_page = page;
+		}
+		return 1;
+	}
+	return 0;
+}
@@ -1,56 +1,89 @@
-/*
- * rc100.h - Functions for the RC100 remote control 
- * using the Zig-110 module in the remote
- *
- * Based on the embedded C library provided by Robotis  
- * Version 0.7		31/01/2013
- * Modified by Peter Lanius
- * Please send suggestions and bug fixes to PeterLanius@gmail.com
- * 
-*/
-#ifndef _RC100_H_
-#define _RC100_H_
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-////////// define RC-100 button key values ////////////////
-// When more than 2 buttons are pressed, the sum of pressed code values will be sent.
-// EX1)  Button U + Button 3 => Code value of Button U (1) + Code value of Button 3 (64) = Sending Value (65)
-// EX2)  Button 1 + Button 5 => Code value of Button 1 (16) + Code value of Button 5 (256) = Sending Value (272)
-#define RC100_BTN_U		1
-#define RC100_BTN_D		2
-#define RC100_BTN_L		4
-#define RC100_BTN_R		8
-#define RC100_BTN_1		16
-#define RC100_BTN_2		32
-#define RC100_BTN_3		64
-#define RC100_BTN_4		128
-#define RC100_BTN_5		256
-#define RC100_BTN_6		512
-
-// Define the allowed button combinations
-// For now we use the ones defined in the default Task file
-#define RC100_BTN_U_AND_L	(RC100_BTN_U + RC100_BTN_L)
-#define RC100_BTN_U_AND_R	(RC100_BTN_U + RC100_BTN_R)
-#define RC100_BTN_D_AND_L	(RC100_BTN_D + RC100_BTN_L)
-#define RC100_BTN_D_AND_R	(RC100_BTN_D + RC100_BTN_R)
-#define RC100_BTN_U_AND_1	(RC100_BTN_U + RC100_BTN_1)
-#define RC100_BTN_D_AND_1	(RC100_BTN_D + RC100_BTN_1)
-#define RC100_BTN_L_AND_1	(RC100_BTN_L + RC100_BTN_1)
-#define RC100_BTN_R_AND_1	(RC100_BTN_R + RC100_BTN_1)
-#define RC100_BTN_U_AND_2	(RC100_BTN_U + RC100_BTN_2)
-#define RC100_BTN_D_AND_2	(RC100_BTN_D + RC100_BTN_2)
-#define RC100_BTN_L_AND_2	(RC100_BTN_L + RC100_BTN_2)
-#define RC100_BTN_R_AND_2	(RC100_BTN_R + RC100_BTN_2)
-#define RC100_BTN_U_AND_3	(RC100_BTN_U + RC100_BTN_3)
-#define RC100_BTN_D_AND_3	(RC100_BTN_D + RC100_BTN_3)
-#define RC100_BTN_L_AND_3	(RC100_BTN_L + RC100_BTN_3)
-#define RC100_BTN_R_AND_3	(RC100_BTN_R + RC100_BTN_3)
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif
+/*
+ * rc100.h - Functions for the RC100 remote control 
+ * using the Zig-110 module in the remote
+ *
+ * Based on the embedded C library provided by Robotis  
+ * Version 0.7		31/01/2013
+ * Modified by Peter Lanius
+ * Please send suggestions and bug fixes to PeterLanius@gmail.com
+ * 
+*/
+#ifndef _RC100_H_
+#define _RC100_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+////////// define RC-100 button key values ////////////////
+// When more than 2 buttons are pressed, the sum of pressed code values will be sent.
+// EX1)  Button U + Button 3 => Code value of Button U (1) + Code value of Button 3 (64) = Sending Value (65)
+// EX2)  Button 1 + Button 5 => Code value of Button 1 (16) + Code value of Button 5 (256) = Sending Value (272)
+#define RC100_BTN_U		1
+#define RC100_BTN_D		2
+#define RC100_BTN_L		4
+#define RC100_BTN_R		8
+#define RC100_BTN_1		16
+#define RC100_BTN_2		32
+#define RC100_BTN_3		64
+#define RC100_BTN_4		128
+#define RC100_BTN_5		256
+#define RC100_BTN_6		512
+
+// Define the allowed button combinations
+// For now we use the ones defined in the default Task file
+#define RC100_BTN_U_AND_L	(RC100_BTN_U + RC100_BTN_L)
+#define RC100_BTN_U_AND_R	(RC100_BTN_U + RC100_BTN_R)
+#define RC100_BTN_D_AND_L	(RC100_BTN_D + RC100_BTN_L)
+#define RC100_BTN_D_AND_R	(RC100_BTN_D + RC100_BTN_R)
+#define RC100_BTN_U_AND_1	(RC100_BTN_U + RC100_BTN_1)
+#define RC100_BTN_D_AND_1	(RC100_BTN_D + RC100_BTN_1)
+#define RC100_BTN_L_AND_1	(RC100_BTN_L + RC100_BTN_1)
+#define RC100_BTN_R_AND_1	(RC100_BTN_R + RC100_BTN_1)
+#define RC100_BTN_U_AND_2	(RC100_BTN_U + RC100_BTN_2)
+#define RC100_BTN_D_AND_2	(RC100_BTN_D + RC100_BTN_2)
+#define RC100_BTN_L_AND_2	(RC100_BTN_L + RC100_BTN_2)
+#define RC100_BTN_R_AND_2	(RC100_BTN_R + RC100_BTN_2)
+#define RC100_BTN_U_AND_3	(RC100_BTN_U + RC100_BTN_3)
+#define RC100_BTN_D_AND_3	(RC100_BTN_D + RC100_BTN_3)
+#define RC100_BTN_L_AND_3	(RC100_BTN_L + RC100_BTN_3)
+#define RC100_BTN_R_AND_3	(RC100_BTN_R + RC100_BTN_3)
+
+// Button events for the mapping table in rc100.c
+#define RC100_NONE			0
+#define RC100_PRESS			1	// buttons pressed (after the chord has settled)
+#define RC100_HOLD			2	// buttons held for RC100_HOLD_TIME
+#define RC100_REPEAT		3	// sent every RC100_REPEAT_TIME after HOLD
+#define RC100_RELEASE		4	// all buttons released
+
+// Event timing in ms
+#define RC100_CHORD_TIME		40		// state must be stable this long before a press is reported
+#define RC100_HOLD_TIME			1000	// press to hold event
+#define RC100_REPEAT_TIME		250		// hold to repeat events
+#define RC100_RELEASE_TIMEOUT	300		// assume release if packets stop arriving
+
+// entry of the button mapping table
+typedef struct {
+	uint16	buttons;		// button value or chord (sum of button values)
+	uint8	event;			// RC100_PRESS, RC100_HOLD, RC100_REPEAT or RC100_RELEASE
+	uint8	command;		// command as defined in global.h
+	uint8	motion_page;	// motion page for COMMAND_MOTIONPAGE, otherwise 0
+} rc100_mapping;
+
+// decode RC-100 packets byte by byte, called by the receive ISR
+void rc100_receiveByte( uint8 c );
+
+// turn the button state into events and look them up in the mapping table
+// Returns:	(int)	1 - new command
+//					0 - no new command
+int rc100_getCommand( void );
+
+// send a data packet to the RC-100
+// Returns:	(int)	1 - success, 0 - error
+int rc100_tx_data( int data );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
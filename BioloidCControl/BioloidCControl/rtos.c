@@ -0,0 +1,273 @@
+/*
+ * rtos.c - FreeRTOS build of the main control loop
+ *   Creates the tasks, the command queue and the command lock with static
+ *   memory, keeps run time statistics and feeds the watchdog from the idle
+ *   task. Only compiled in when FREERTOS is defined in global.h.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <string.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "global.h"
+
+#ifdef FREERTOS
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "clock.h"
+#include "log.h"
+#include "sched.h"
+#include "watchdog.h"
+#include "rtos.h"
+
+// run time statistics of one task
+typedef struct {
+	uint32 runs;
+	uint32 time_max;		// us, includes time spent in higher priority tasks
+	uint16 overruns;		// runs longer than the period
+} rtos_stats;
+
+// tasks
+static const rtos_task *rtos_table;
+static StaticTask_t rtos_tcb[RTOS_NUM_TASKS];
+static TaskHandle_t rtos_handle[RTOS_NUM_TASKS];
+static StackType_t rtos_stacks[RTOS_STACK_TOTAL];
+static rtos_stats rtos_task_stats[RTOS_NUM_TASKS];
+static volatile uint8 rtos_checked_in = 0;		// one bit per task that ran since the last watchdog check in
+
+// idle task (the timer task is not used)
+static StaticTask_t rtos_idle_tcb;
+static StackType_t rtos_idle_stack[configMINIMAL_STACK_SIZE];
+
+// command lock and the queue to the motion engine
+static StaticSemaphore_t rtos_lock_buffer;
+static SemaphoreHandle_t rtos_command_lock;
+static StaticQueue_t rtos_queue_buffer;
+static uint8_t rtos_queue_storage[RTOS_COMMAND_QUEUE * sizeof(rtos_command)];
+static QueueHandle_t rtos_command_queue;
+
+// internal function prototypes
+static void rtos_taskLoop(void *parameter);
+
+
+// create the tasks from a table in Flash and start FreeRTOS (doesn't return)
+void rtos_start(const rtos_task *table)
+{
+	StackType_t *stack = rtos_stacks;
+	uint16 size;
+	char name[5];
+	uint8 id;
+
+	rtos_table = table;
+	rtos_command_lock = xSemaphoreCreateMutexStatic(&rtos_lock_buffer);
+	rtos_command_queue = xQueueCreateStatic(RTOS_COMMAND_QUEUE, sizeof(rtos_command), rtos_queue_storage, &rtos_queue_buffer);
+
+	for (id=0; id<RTOS_NUM_TASKS; id++)
+	{
+		size = pgm_read_word(&table[id].stack);
+		if ( stack + size > rtos_stacks + RTOS_STACK_TOTAL ) {
+			log_printf("\nTask stacks don't fit in RTOS_STACK_TOTAL.\n");
+			log_flush();
+			while (1);
+		}
+		strncpy_P(name, (PGM_P) pgm_read_word(&table[id].name), 4);
+		name[4] = 0;
+		rtos_handle[id] = xTaskCreateStatic(rtos_taskLoop, name, size, (void *)(uint16) id,
+							pgm_read_byte(&table[id].priority), stack, &rtos_tcb[id]);
+		stack += size;
+	}
+	vTaskStartScheduler();
+	// only gets here if the scheduler could not start
+	while (1);
+}
+
+// take the command lock (bioloid_command and the pending command)
+void rtos_lock()
+{
+	xSemaphoreTake(rtos_command_lock, portMAX_DELAY);
+}
+
+// give back the command lock
+void rtos_unlock()
+{
+	xSemaphoreGive(rtos_command_lock);
+}
+
+// hand a command to the motion engine
+// Returns:	(uint8) 1 if queued, 0 if the queue is full
+uint8 rtos_postCommand(uint8 command, uint8 last_command, uint8 page, uint32 time)
+{
+	rtos_command c;
+
+	c.command = command;
+	c.last_command = last_command;
+	c.page = page;
+	c.time = time;
+	return ( xQueueSend(rtos_command_queue, &c, 0) == pdPASS ) ? 1 : 0;
+}
+
+// take the next command for the motion engine, doesn't wait
+// Returns:	(uint8) 1 if there was one
+uint8 rtos_receiveCommand(rtos_command *command)
+{
+	return ( xQueueReceive(rtos_command_queue, command, 0) == pdPASS ) ? 1 : 0;
+}
+
+// publish a new snapshot (one writer per snapshot)
+void rtos_publish(rtos_snapshot *s, const void *data)
+{
+	uint8 next = s->current ^ 1;
+
+	// nobody reads the other copy
+	memcpy((uint8 *) s->copies + next * s->size, data, s->size);
+	taskENTER_CRITICAL();
+	s->current = next;
+	s->seq++;
+	taskEXIT_CRITICAL();
+}
+
+// Returns a copy of the latest snapshot in data
+void rtos_read(rtos_snapshot *s, void *data)
+{
+	uint8 seq;
+
+	// copy again if the writer published while we were copying
+	do {
+		seq = s->seq;
+		memcpy(data, (uint8 *) s->copies + s->current * s->size, s->size);
+	} while ( seq != s->seq );
+}
+
+// print the task statistics and stack usage, then clear the statistics
+void rtos_report()
+{
+	char name[5];
+	rtos_stats *stats;
+	uint8 id;
+
+	log_printf("\nTask Prio Period Runs Max Over Stack free/size");
+	for (id=0; id<RTOS_NUM_TASKS; id++)
+	{
+		stats = &rtos_task_stats[id];
+		rtos_getTaskName(id, name);
+		name[4] = 0;
+		// split in several messages to stay within the log argument space
+		log_printf("\n%s %u %ums", name, pgm_read_byte(&rtos_table[id].priority), pgm_read_word(&rtos_table[id].period));
+		log_printf(" %lu %luus %u", stats->runs, stats->time_max, stats->overruns);
+		log_printf(" %u/%u", (uint16) uxTaskGetStackHighWaterMark(rtos_handle[id]), pgm_read_word(&rtos_table[id].stack));
+		stats->runs = 0;
+		stats->time_max = 0;
+		stats->overruns = 0;
+	}
+	log_printf("\nIdle stack free %u/%u", (uint16) uxTaskGetStackHighWaterMark(xTaskGetIdleTaskHandle()), configMINIMAL_STACK_SIZE);
+	sched_printLatency();
+	log_printf("\nWatchdog faults %u\n", watchdog_getFaults());
+}
+
+// Returns:	(uint8) id of the running task, WATCHDOG_NO_TASK outside the tasks
+uint8 rtos_currentTask()
+{
+	TaskHandle_t current;
+	uint8 id;
+
+	if ( xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED ) {
+		return WATCHDOG_NO_TASK;
+	}
+	current = xTaskGetCurrentTaskHandle();
+	for (id=0; id<RTOS_NUM_TASKS; id++) {
+		if ( rtos_handle[id] == current ) {
+			return id;
+		}
+	}
+	return WATCHDOG_NO_TASK;
+}
+
+// copy the 4 character name of a task (not 0 terminated)
+void rtos_getTaskName(uint8 task, char *name)
+{
+	if ( task < RTOS_NUM_TASKS ) {
+		strncpy_P(name, (PGM_P) pgm_read_word(&rtos_table[task].name), 4);
+	} else {
+		name[0] = name[1] = name[2] = name[3] = '-';
+	}
+}
+
+// body of all tasks: run the task function once per period
+static void rtos_taskLoop(void *parameter)
+{
+	uint8 id = (uint8)(uint16) parameter;
+	void (*run)(void) = (void (*)(void)) pgm_read_word(&rtos_table[id].run);
+	TickType_t period, wake;
+	uint32 start, elapsed;
+	rtos_stats *stats = &rtos_task_stats[id];
+
+	period = pgm_read_word(&rtos_table[id].period) / portTICK_PERIOD_MS;
+	if ( period == 0 ) {
+		period = 1;
+	}
+	wake = xTaskGetTickCount();
+	for (;;)
+	{
+		start = micros();
+		run();
+		elapsed = micros() - start;
+		stats->runs++;
+		if ( elapsed > stats->time_max ) {
+			stats->time_max = elapsed;
+		}
+		if ( elapsed > period * portTICK_PERIOD_MS * 1000UL ) {
+			stats->overruns++;
+		}
+		taskENTER_CRITICAL();
+		rtos_checked_in |= (1 << id);
+		taskEXIT_CRITICAL();
+		vTaskDelayUntil(&wake, period);
+	}
+}
+
+// FreeRTOS hooks
+
+// the idle task checks in with the watchdog once every task has run
+void vApplicationIdleHook(void)
+{
+	if ( watchdog_isRunning() && rtos_checked_in == (1 << RTOS_NUM_TASKS) - 1 ) {
+		taskENTER_CRITICAL();
+		rtos_checked_in = 0;
+		taskEXIT_CRITICAL();
+		watchdog_checkIn();
+	}
+}
+
+// a task has overrun its stack
+void vApplicationStackOverflowHook(TaskHandle_t task, char *name)
+{
+	uint8 id;
+
+	for (id=0; id<RTOS_NUM_TASKS && rtos_handle[id] != task; id++);
+	watchdog_fault(WATCHDOG_STACK, ( id < RTOS_NUM_TASKS ) ? id : WATCHDOG_NO_TASK);
+}
+
+// memory for the idle task (static allocation only)
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *size)
+{
+	*tcb = &rtos_idle_tcb;
+	*stack = rtos_idle_stack;
+	*size = configMINIMAL_STACK_SIZE;
+}
+
+#endif /* FREERTOS */
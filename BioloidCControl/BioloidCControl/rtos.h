@@ -0,0 +1,156 @@
+/*
+ * rtos.h - FreeRTOS build of the main control loop
+ *   Runs the main loop tasks as four FreeRTOS tasks instead of the table
+ *   driven scheduler in sched.c. Compiled in when FREERTOS is defined in
+ *   global.h, the FreeRTOS kernel needs to be added to the project.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Tasks (highest priority first, see the table in BioloidCControl.c)
+ *   BUS  - motion engine (executeMotionSequence), the only task that uses
+ *          the Dynamixel bus, 1ms
+ *   SENS - gyro, accelerometer, distance and battery readings, slip and
+ *          low voltage detection, static balancing, stack high-water
+ *          check, GYRO_READ_INTERVAL
+ *   MOTN - obstacle avoidance, stored program and the hand-over of new
+ *          commands to the motion engine, 1ms
+ *   COMM - commands from the PC, waits, START button and clock sync, 1ms
+ * Each task runs its function once per period (vTaskDelayUntil), a task
+ * that takes longer than its period runs again right away.
+ *
+ * Data flow
+ *   Commands: COMM, SENS and MOTN change bioloid_command and the pending
+ *   command flag only while holding the command lock (rtos_lock). MOTN
+ *   hands a new command with its motion page to BUS through a queue of
+ *   RTOS_COMMAND_QUEUE entries. BUS takes them out one at a time, in order,
+ *   once the motion engine has started the last one, and copies them into
+ *   the motion engine's own state (motion_takeCommand): the motion engine
+ *   never reads the shared command globals. BUS runs first in a tick, so
+ *   MOTN sees the motion engine's reaction in its next period.
+ *   Sensor values: SENS publishes a snapshot (adc_getSnapshot) that the
+ *   obstacle avoidance and the stored program read.
+ *   Joint offsets: SENS publishes the balance offsets, BUS reads them in
+ *   calculatePoseServoSpeeds (pose.c).
+ * Snapshots are double buffered: the writer fills the copy nobody reads
+ * and then switches over, readers copy the current one and start again if
+ * a new snapshot was published meanwhile. Neither side blocks.
+ *
+ * Stacks are allocated statically (sizes in the task table, in bytes).
+ * FreeRTOS checks them on every task switch, an overflow is a watchdog
+ * fault. The TASK command prints the stack each task has never used
+ * (high water mark) next to its size, leave some margin when trimming.
+ *
+ * Watchdog: every task run checks in, the idle task restarts the watchdog
+ * once all tasks have checked in. A hung or starved task lets it expire.
+ *
+ * Latency: the TASK command reports the time from accepting a command from
+ * the PC to the motion engine taking it, in this build and in the
+ * scheduler build, so both can be compared on the robot.
+ *
+ * Building: add the FreeRTOS kernel (tasks.c, queue.c, list.c) and an
+ * ATmega2560/2561 port to the project. The port must take its tick from a
+ * timer - TIMER0 is free - not from the watchdog, which belongs to
+ * watchdog.c. FreeRTOSConfig.h holds the settings for this application.
+ * Blocking code still blocks its task: executeMotion (walk ready pose,
+ * sitting down on low battery) and waitForPoseFinish keep BUS busy and
+ * starve the lower priority tasks while they run.
+ */
+
+#ifndef RTOS_H_
+#define RTOS_H_
+
+#include <avr/pgmspace.h>
+#include "global.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// task ids, also the order of the task table
+#define RTOS_BUS				0
+#define RTOS_SENSORS			1
+#define RTOS_MOTION				2
+#define RTOS_COMMS				3
+#define RTOS_NUM_TASKS			4
+
+#define RTOS_COMMAND_QUEUE		4		// commands waiting for the motion engine
+#define RTOS_STACK_TOTAL		2048	// sum of the task stacks in the task table (bytes)
+
+// one entry of the task table (stored in Flash)
+typedef struct {
+	void (*run)(void);		// task function, called once per period
+	PGM_P name;				// 4 character name
+	uint16 period;			// ms
+	uint8 priority;			// FreeRTOS priority, higher runs first
+	uint16 stack;			// bytes
+} rtos_task;
+
+// command handed to the motion engine
+typedef struct {
+	uint8 command;			// bioloid_command at the hand-over
+	uint8 last_command;		// last_bioloid_command
+	uint8 page;				// next_motion_page
+	uint32 time;			// micros() when the command was accepted from the PC, 0 otherwise
+} rtos_command;
+
+// double buffered snapshot, see RTOS_SNAPSHOT
+typedef struct {
+	void *copies;			// two copies of size bytes
+	uint8 size;
+	volatile uint8 current;	// copy the readers use
+	volatile uint8 seq;		// counts the snapshots published
+} rtos_snapshot;
+
+// define a snapshot holding a variable of the given type
+#define RTOS_SNAPSHOT(name, type) \
+	static type name##_copies[2]; \
+	rtos_snapshot name = { name##_copies, sizeof(type), 0, 0 }
+
+// create the tasks from a table in Flash and start FreeRTOS (doesn't return)
+void rtos_start(const rtos_task *table) __attribute__((noreturn));
+
+// take and give back the command lock (bioloid_command and the pending command)
+void rtos_lock(void);
+void rtos_unlock(void);
+
+// hand a command to the motion engine
+// Returns:	(uint8) 1 if queued, 0 if the queue is full
+uint8 rtos_postCommand(uint8 command, uint8 last_command, uint8 page, uint32 time);
+
+// take the next command for the motion engine, doesn't wait
+// Returns:	(uint8) 1 if there was one
+uint8 rtos_receiveCommand(rtos_command *command);
+
+// publish a new snapshot (one writer per snapshot)
+void rtos_publish(rtos_snapshot *s, const void *data);
+
+// Returns a copy of the latest snapshot in data
+void rtos_read(rtos_snapshot *s, void *data);
+
+// print the task statistics and stack usage, then clear the statistics
+void rtos_report(void);
+
+// Returns:	(uint8) id of the running task, WATCHDOG_NO_TASK outside the tasks
+uint8 rtos_currentTask(void);
+
+// copy the 4 character name of a task (not 0 terminated)
+void rtos_getTaskName(uint8 task, char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RTOS_H_ */
@@ -0,0 +1,290 @@
+/*
+ * sched.c - Table driven cooperative scheduler for the main control loop
+ *   Releases tasks on a fixed grid of micros() time, runs the due task
+ *   with the highest priority and keeps run time statistics per task.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "global.h"
+#include "clock.h"
+#include "button.h"
+#include "log.h"
+#include "prof.h"
+#include "sched.h"
+#include "watchdog.h"
+
+// task table in Flash and the tasks in order of priority
+static const sched_task *sched_table;
+static uint8 sched_count = 0;
+static uint8 sched_order[SCHED_MAX_TASKS];
+
+// statistics, indexed like the task table
+static sched_stats sched_task_stats[SCHED_MAX_TASKS];
+static uint32 sched_busy = 0;			// time spent in tasks since the last report (us)
+static uint32 sched_window_start = 0;	// start of the measurement (micros)
+static uint32 sched_misses = 0;			// deadline misses since start-up
+static volatile uint8 sched_current = WATCHDOG_NO_TASK;	// task that is running
+
+// command latency since the last report (us)
+static uint32 sched_latency_count = 0;
+static uint32 sched_latency_sum = 0;
+static uint32 sched_latency_min = 0xFFFFFFFF;
+static uint32 sched_latency_max = 0;
+
+// internal function prototypes
+static void sched_monitor(uint32 now);
+
+
+// set up the scheduler with a task table in Flash, releases start now
+void sched_init(const sched_task *table, uint8 count)
+{
+	uint32 now;
+	uint8 i, j, task;
+
+	if ( count > SCHED_MAX_TASKS ) {
+		count = SCHED_MAX_TASKS;
+	}
+	sched_table = table;
+	sched_count = count;
+
+	// sort the tasks by priority, tasks of equal priority keep their table order
+	for (i=0; i<count; i++)
+	{
+		j = i;
+		while ( j > 0 && pgm_read_byte(&table[sched_order[j-1]].priority) > pgm_read_byte(&table[i].priority) ) {
+			sched_order[j] = sched_order[j-1];
+			j--;
+		}
+		sched_order[j] = i;
+	}
+
+	// first releases
+	now = micros();
+	for (i=0; i<count; i++) {
+		task = sched_order[i];
+		sched_task_stats[task].release = now + pgm_read_word(&table[task].phase) * 1000UL;
+		sched_task_stats[task].checkin = now;
+	}
+	sched_resetStats();
+}
+
+// run the highest priority task that is due, call from the main loop
+// Returns:	(uint8)	1 if a task was run, 0 if none was due
+uint8 sched_dispatch()
+{
+	uint32 start, end, elapsed, period, behind;
+	uint8 i, task;
+	sched_stats *stats;
+	void (*run)(void);
+#ifdef PROFILER
+	uint16 prof_ticks;
+#endif
+
+	// deadline monitor, then check in with the watchdog
+	start = micros();
+	if ( watchdog_isRunning() ) {
+		sched_monitor(start);
+		watchdog_checkIn();
+	}
+
+	// find the first due task in priority order
+	for (i=0; i<sched_count; i++)
+	{
+		task = sched_order[i];
+		if ( (int32)(start - sched_task_stats[task].release) >= 0 ) {
+			break;
+		}
+	}
+	if ( i == sched_count ) {
+		return 0;
+	}
+
+	// run it to completion
+	run = (void (*)(void)) pgm_read_word(&sched_table[task].run);
+	sched_current = task;
+	PROF_START(prof_start);
+	run();
+#ifdef PROFILER
+	prof_ticks = PROF_TIMER - prof_start;
+#endif
+	end = micros();
+	sched_current = WATCHDOG_NO_TASK;
+
+	// update the statistics
+	stats = &sched_task_stats[task];
+	elapsed = end - start;
+	stats->checkin = end;
+	stats->runs++;
+	stats->time_sum += elapsed;
+	if ( elapsed > stats->time_max ) {
+		stats->time_max = elapsed;
+	}
+	if ( start - stats->release > stats->late_max ) {
+		stats->late_max = start - stats->release;
+	}
+	if ( end - stats->release > pgm_read_word(&sched_table[task].deadline) ) {
+		stats->overruns++;
+		sched_misses++;
+	}
+	sched_busy += elapsed;
+#ifdef PROFILER
+	// the profiler timer wraps after 32ms, use micros() to spot longer runs
+	if ( task < PROF_TASK_PROBES ) {
+		prof_record(PROF_TASK_FIRST + task, ( elapsed > PROF_MAX_US ) ? 0xFFFF : prof_ticks);
+	}
+#endif
+
+	// next release on the grid, skip the ones we are already a whole period late for
+	period = pgm_read_word(&sched_table[task].period) * 1000UL;
+	stats->release += period;
+	if ( (int32)(end - stats->release) >= (int32) period ) {
+		behind = (end - stats->release) / period;
+		stats->release += behind * period;
+		stats->skipped += behind;
+	}
+	return 1;
+}
+
+// print the task statistics and start a new measurement
+void sched_report()
+{
+	char name[5];
+	uint32 window, mean;
+	uint8 task;
+	sched_stats *stats;
+
+	window = micros() - sched_window_start;
+	log_printf("\nTask Period Runs Mean Max Late Over Skip");
+	for (task=0; task<sched_count; task++)
+	{
+		stats = &sched_task_stats[task];
+		strncpy_P(name, (PGM_P) pgm_read_word(&sched_table[task].name), 4);
+		name[4] = 0;
+		mean = ( stats->runs > 0 ) ? stats->time_sum / stats->runs : 0;
+		// split in several messages to stay within the log argument space
+		log_printf("\n%s %ums %lu", name, pgm_read_word(&sched_table[task].period), stats->runs);
+		log_printf(" %luus %luus", mean, stats->time_max);
+		log_printf(" %luus %u %u", stats->late_max, stats->overruns, stats->skipped);
+	}
+	// load in percent, window is scaled down first to avoid overflows
+	log_printf("\nLoad %lu%% over %lums", ( window >= 100 ) ? sched_busy / (window / 100) : 0, window / 1000);
+	sched_printLatency();
+	log_printf("\nDeadline misses %lu, watchdog faults %u\n", sched_misses, watchdog_getFaults());
+	sched_resetStats();
+}
+
+// clear the statistics
+void sched_resetStats()
+{
+	uint8 task;
+	sched_stats *stats;
+
+	for (task=0; task<sched_count; task++)
+	{
+		stats = &sched_task_stats[task];
+		stats->runs = 0;
+		stats->time_sum = 0;
+		stats->time_max = 0;
+		stats->late_max = 0;
+		stats->overruns = 0;
+		stats->skipped = 0;
+	}
+	sched_busy = 0;
+	sched_window_start = micros();
+}
+
+// Returns:	(const sched_stats *) statistics of a task (index in the task table)
+const sched_stats *sched_getStats(uint8 task)
+{
+	return &sched_task_stats[task];
+}
+
+// Returns:	(uint8) index of the task that is running, WATCHDOG_NO_TASK between tasks
+uint8 sched_currentTask()
+{
+	return sched_current;
+}
+
+// copy the 4 character name of a task (not 0 terminated)
+void sched_getTaskName(uint8 task, char *name)
+{
+	if ( task < sched_count ) {
+		strncpy_P(name, (PGM_P) pgm_read_word(&sched_table[task].name), 4);
+	} else {
+		name[0] = name[1] = name[2] = name[3] = '-';
+	}
+}
+
+// Returns:	(uint32) deadline misses since start-up
+uint32 sched_getMisses()
+{
+	return sched_misses;
+}
+
+// record the time from accepting a command to the motion engine taking it (us)
+void sched_recordLatency(uint32 latency)
+{
+	sched_latency_count++;
+	sched_latency_sum += latency;
+	if ( latency < sched_latency_min ) {
+		sched_latency_min = latency;
+	}
+	if ( latency > sched_latency_max ) {
+		sched_latency_max = latency;
+	}
+}
+
+// print the command latency statistics and clear them (also used by rtos.c)
+void sched_printLatency()
+{
+	if ( sched_latency_count > 0 ) {
+		log_printf("\nCommand latency %lu commands, min %luus", sched_latency_count, sched_latency_min);
+		log_printf(" mean %luus max %luus", sched_latency_sum / sched_latency_count, sched_latency_max);
+	} else {
+		log_printf("\nCommand latency - no commands");
+	}
+	log_printf("\nInterrupt latency max %uus, button events dropped %u", clock_getLatencyMax(), button_getDropped());
+	sched_latency_count = 0;
+	sched_latency_sum = 0;
+	sched_latency_min = 0xFFFFFFFF;
+	sched_latency_max = 0;
+}
+
+// check that the monitored tasks completed a run within their watchdog limit
+// runs before the dispatch, a task that is not served in time is a fault
+static void sched_monitor(uint32 now)
+{
+	uint32 checkin, started, limit;
+	uint8 task;
+
+	started = watchdog_startTime();
+	for (task=0; task<sched_count; task++)
+	{
+		limit = pgm_read_word(&sched_table[task].watchdog) * 1000UL;
+		if ( limit == 0 ) {
+			continue;
+		}
+		// time spent with the watchdog stopped doesn't count
+		checkin = sched_task_stats[task].checkin;
+		if ( (int32)(checkin - started) < 0 ) {
+			checkin = started;
+		}
+		if ( now - checkin > limit ) {
+			watchdog_fault(WATCHDOG_DEADLINE, task);
+		}
+	}
+}
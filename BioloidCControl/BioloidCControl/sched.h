@@ -0,0 +1,128 @@
+/*
+ * sched.h - Table driven cooperative scheduler for the main control loop
+ *   Each task runs at a fixed period on the micros() timebase. The
+ *   scheduler records run time, lateness and deadline overruns for every
+ *   task, the TASK command prints them over the serial port.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Operation
+ *
+ * The application defines its tasks in a table in Flash (see the main
+ * loop in BioloidCControl.c) and calls sched_dispatch() from its loop.
+ * A task is released every period ms, the first release is phase ms after
+ * sched_init(). Phases are used to keep slow tasks from being released in
+ * the same millisecond. Each dispatch runs the due task with the highest
+ * priority (0 is highest) to completion, so a task that blocks delays all
+ * others - that shows up as lateness and overruns in the statistics.
+ *
+ * Releases stay on a fixed grid: the next release of a task is always
+ * one period after the previous one, not after the time it actually ran.
+ * A task that falls more than a whole period behind skips the releases it
+ * missed instead of running several times in a row.
+ *
+ * Statistics (since the last report)
+ *   runs	  - number of times the task ran
+ *   mean/max - run time in us
+ *   late	  - maximum delay between release and start in us
+ *   over	  - runs that finished more than deadline us after their release
+ *   skip	  - releases skipped because the task was a whole period behind
+ *   load	  - share of the time spent in tasks (the rest is idle looping)
+ * The report ends with the command latency (from accepting a command from
+ * the PC to the motion engine taking it), the longest timer interrupt
+ * latency, the button events dropped because their queue was full, the
+ * deadline misses since start-up and the number of watchdog faults since
+ * power-up.
+ *
+ * Watchdog
+ *
+ * While the watchdog runs (see watchdog.h) every dispatch first checks
+ * that each task with a watchdog limit completed a run within that many
+ * ms, then checks in. A task that is not served in time is a fault: the
+ * servos are switched off and the controller resets.
+ */
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include <avr/pgmspace.h>
+#include "global.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define SCHED_MAX_TASKS		12		// size of the statistics tables
+
+// one entry of the task table (stored in Flash)
+typedef struct {
+	void (*run)(void);		// task function
+	PGM_P name;				// 4 character name for the report
+	uint16 period;			// release period (ms)
+	uint16 phase;			// first release after sched_init (ms)
+	uint16 deadline;		// maximum time from release to completion (us)
+	uint8 priority;			// 0 is the highest priority
+	uint16 watchdog;		// maximum time between completed runs (ms), 0 = not monitored
+} sched_task;
+
+// run time statistics of one task
+typedef struct {
+	uint32 release;			// next release time (micros)
+	uint32 checkin;			// end of the last run (micros)
+	uint32 runs;			// number of runs
+	uint32 time_sum;		// sum of the run times (us)
+	uint32 time_max;		// maximum run time (us)
+	uint32 late_max;		// maximum start delay (us)
+	uint16 overruns;		// deadline misses
+	uint16 skipped;			// releases skipped
+} sched_stats;
+
+// set up the scheduler with a task table in Flash, releases start now
+void sched_init(const sched_task *table, uint8 count);
+
+// run the highest priority task that is due, call from the main loop
+// Returns:	(uint8)	1 if a task was run, 0 if none was due
+uint8 sched_dispatch(void);
+
+// print the task statistics and start a new measurement
+void sched_report(void);
+
+// clear the statistics
+void sched_resetStats(void);
+
+// Returns:	(const sched_stats *) statistics of a task (index in the task table)
+const sched_stats *sched_getStats(uint8 task);
+
+// Returns:	(uint8) index of the task that is running, WATCHDOG_NO_TASK between tasks
+uint8 sched_currentTask(void);
+
+// copy the 4 character name of a task (not 0 terminated)
+void sched_getTaskName(uint8 task, char *name);
+
+// Returns:	(uint32) deadline misses since start-up
+uint32 sched_getMisses(void);
+
+// record the time from accepting a command to the motion engine taking it (us)
+void sched_recordLatency(uint32 latency);
+
+// print the command latency statistics and clear them (also used by rtos.c)
+void sched_printLatency(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCHED_H_ */
@@ -0,0 +1,560 @@
+/*
+ * script.c - Stored program interpreter for the Robotis CM-510 controller.
+ *   Runs small bytecode programs compiled on the PC by compile_script.pl
+ *   cooperatively from the main loop. Programs are uploaded over the
+ *   serial port and can be kept in EEPROM.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <avr/eeprom.h>
+#include "global.h"
+#include "log.h"
+#include "script.h"
+#include "serial.h"
+#include "motion_f.h"
+#include "clock.h"
+#include "adc.h"
+
+// interpreter states
+#define SCRIPT_IDLE			0
+#define SCRIPT_RUNNING		1
+#define SCRIPT_WAITING		2	// in a WAIT instruction
+#define SCRIPT_SYNC			3	// in a SYNC instruction
+#define SCRIPT_LOADING		4	// upload in progress
+
+// upload line types
+#define LOAD_LINE_START		0	// nothing received yet
+#define LOAD_LINE_DATA		1	// ':' followed by hex bytes
+#define LOAD_LINE_END		2	// reading the END keyword
+#define LOAD_LINE_SUM		3	// reading the checksum after END
+
+// Global variables related to the finite state machine that governs execution
+extern volatile uint8 bioloid_command;			// current command
+extern volatile uint8 last_bioloid_command;		// last command
+extern volatile bool  new_command;				// flag that we got a new command
+extern volatile uint8 next_motion_page;			// next motion page if we got new command
+extern uint8 motion_state;						// state of executeMotionSequence
+
+// Button related variables
+extern volatile bool button_up_pressed;
+extern volatile bool button_down_pressed;
+extern volatile bool button_left_pressed;
+extern volatile bool button_right_pressed;
+
+// the program is kept in EEPROM together with its length and checksum
+uint8 EEMEM script_ee_length;
+uint8 EEMEM script_ee_checksum;
+uint8 EEMEM script_ee_code[SCRIPT_MAX_LENGTH];
+
+// the program is executed from RAM
+static uint8 script_code[SCRIPT_MAX_LENGTH];
+static uint8 script_length = 0;		// 0 means no valid program
+static uint8 script_state = SCRIPT_IDLE;
+static uint8 script_pc = 0;			// program counter
+static int16 script_var[SCRIPT_NUM_VARS];
+static uint8 script_stack[SCRIPT_STACK_DEPTH];
+static uint8 script_sp = 0;
+static unsigned long script_wait_start = 0;
+static uint16 script_wait_time = 0;
+
+// upload variables
+static uint8 load_checksum = 0;		// running sum of the received bytes
+static uint8 load_nibble = 0;		// high nibble waiting for its low nibble
+static uint8 load_have_nibble = 0;
+static uint8 load_line = 0;			// type of the current line (see below)
+static uint8 load_keyword = 0;		// letters of END matched so far
+static uint8 load_sum_received = 0;	// checksum given on the END line
+static uint8 load_error = 0;
+
+// internal function prototypes
+static uint8 script_checksum(void);
+static void script_error(PGM_P msg);
+static int16 script_readSensor(uint8 sensor);
+static void script_loadCharacter(uint8 c);
+static void script_loadFinish(void);
+
+
+// initialize the interpreter and load the program stored in EEPROM (if any)
+void script_init()
+{
+	uint8 length, checksum;
+
+	script_state = SCRIPT_IDLE;
+	script_length = 0;
+
+	// an erased EEPROM reads 0xFF which is larger than the maximum length
+	length = eeprom_read_byte(&script_ee_length);
+	if ( length == 0 || length > SCRIPT_MAX_LENGTH ) {
+		return;
+	}
+	checksum = eeprom_read_byte(&script_ee_checksum);
+	eeprom_read_block(script_code, script_ee_code, length);
+
+	// only accept the program if it has not been corrupted
+	script_length = length;
+	if ( script_checksum() != checksum ) {
+		script_length = 0;
+		log_printf("\nStored program checksum error - ignored.");
+		return;
+	}
+	log_printf("\nStored program loaded, %i bytes.", script_length);
+}
+
+// handle the stored program commands RUN, LOAD and SAVE
+void script_command(uint8 command)
+{
+	if ( command == COMMAND_SCRIPT_RUN )
+	{
+		if ( script_start() == 0 ) {
+			log_printf("No stored program.\n> ");
+		}
+	}
+	else if ( command == COMMAND_SCRIPT_LOAD )
+	{
+		// discard the current program and wait for the upload
+		script_stop();
+		script_length = 0;
+		load_checksum = 0;
+		load_have_nibble = 0;
+		load_line = LOAD_LINE_START;
+		load_error = 0;
+		script_state = SCRIPT_LOADING;
+		log_printf("Send program, finish with END.\n");
+	}
+	else if ( command == COMMAND_SCRIPT_SAVE )
+	{
+		if ( script_length == 0 ) {
+			log_printf("No stored program.\n> ");
+			return;
+		}
+		// eeprom_update only writes bytes that have changed (3.4ms per byte)
+		eeprom_update_block(script_code, script_ee_code, script_length);
+		eeprom_update_byte(&script_ee_checksum, script_checksum());
+		eeprom_update_byte(&script_ee_length, script_length);
+		log_printf("Program saved, %i bytes.\n> ", script_length);
+	}
+}
+
+// start the stored program from the beginning
+int script_start()
+{
+	if ( script_length == 0 || script_state == SCRIPT_LOADING ) {
+		return 0;
+	}
+
+	// reset program counter, stack and variables
+	for (uint8 i=0; i<SCRIPT_NUM_VARS; i++) { script_var[i] = 0; }
+	script_pc = 0;
+	script_sp = 0;
+	script_state = SCRIPT_RUNNING;
+	return 1;
+}
+
+// stop the stored program
+void script_stop()
+{
+	if ( script_state != SCRIPT_LOADING ) {
+		script_state = SCRIPT_IDLE;
+	}
+}
+
+// Returns 1 if a program is loaded (and can be started), otherwise 0
+uint8 script_isLoaded()
+{
+	return ( script_length > 0 && script_state != SCRIPT_LOADING );
+}
+
+// Returns 1 if a program is running, otherwise 0
+uint8 script_isRunning()
+{
+	return ( script_state == SCRIPT_RUNNING || script_state == SCRIPT_WAITING || script_state == SCRIPT_SYNC );
+}
+
+// Returns 1 if an upload is in progress, otherwise 0
+uint8 script_isLoading()
+{
+	return ( script_state == SCRIPT_LOADING );
+}
+
+// execute the stored program for at most SCRIPT_INSTRUCTION_BUDGET instructions
+// Returns:	(int)	0 - no new command
+//					1 - program issued a new command
+int script_run()
+{
+	uint8 budget = SCRIPT_INSTRUCTION_BUDGET;
+	uint8 op, a, b, taken;
+	int16 value;
+
+	// waits never block, just check whether they are finished
+	if ( script_state == SCRIPT_WAITING )
+	{
+		if ( (millis() - script_wait_start) < script_wait_time ) {
+			return 0;
+		}
+		script_state = SCRIPT_RUNNING;
+	}
+	else if ( script_state == SCRIPT_SYNC )
+	{
+		// the motion engine needs to have picked up the last command and stopped
+		if ( new_command == TRUE || motion_state != MOTION_STOPPED ) {
+			return 0;
+		}
+		script_state = SCRIPT_RUNNING;
+	}
+
+	while ( script_state == SCRIPT_RUNNING && budget > 0 )
+	{
+		budget--;
+
+		// make sure we never execute past the end of the program
+		if ( script_pc >= script_length ) {
+			script_error(PSTR("end of program"));
+			return 0;
+		}
+		op = script_code[script_pc];
+
+		// check that all operands of the instruction are inside the program
+		switch ( op )
+		{
+			case SCRIPT_OP_END: case SCRIPT_OP_SYNC: case SCRIPT_OP_RETURN:
+			a = 1; break;
+			case SCRIPT_OP_CMD: case SCRIPT_OP_PLAY: case SCRIPT_OP_JUMP: case SCRIPT_OP_CALL:
+			a = 2; break;
+			case SCRIPT_OP_WAIT: case SCRIPT_OP_READ: case SCRIPT_OP_LOOP:
+			a = 3; break;
+			case SCRIPT_OP_SET: case SCRIPT_OP_ADD:
+			a = 4; break;
+			case SCRIPT_OP_JUMPIF:
+			a = 6; break;
+			default:
+			script_error(PSTR("invalid instruction"));
+			return 0;
+		}
+		if ( (uint16)script_pc + a > script_length ) {
+			script_error(PSTR("incomplete instruction"));
+			return 0;
+		}
+
+		switch ( op )
+		{
+			case SCRIPT_OP_END:
+				script_state = SCRIPT_IDLE;
+				log_printf("\nProgram finished.\n> ");
+				return 0;
+
+			case SCRIPT_OP_CMD:
+				// only motion commands, PLAY takes the place of M (it needs a page)
+				if ( script_code[script_pc+1] > COMMAND_RESET || script_code[script_pc+1] == COMMAND_MOTIONPAGE ) {
+					script_error(PSTR("invalid command"));
+					return 0;
+				}
+				// same as receiving the command from the serial port
+				last_bioloid_command = bioloid_command;
+				bioloid_command = script_code[script_pc+1];
+				if ( bioloid_command != COMMAND_STOP ) {
+					next_motion_page = command_getMotionPage(bioloid_command);
+				}
+				script_pc += 2;
+				// give the main loop a chance to act on the command first
+				return 1;
+
+			case SCRIPT_OP_PLAY:
+				last_bioloid_command = bioloid_command;
+				bioloid_command = COMMAND_MOTIONPAGE;
+				next_motion_page = script_code[script_pc+1];
+				script_pc += 2;
+				return 1;
+
+			case SCRIPT_OP_WAIT:
+				script_wait_time = script_code[script_pc+1] | (script_code[script_pc+2] << 8);
+				script_wait_start = millis();
+				script_pc += 3;
+				script_state = SCRIPT_WAITING;
+				return 0;
+
+			case SCRIPT_OP_SYNC:
+				script_pc += 1;
+				script_state = SCRIPT_SYNC;
+				return 0;
+
+			case SCRIPT_OP_SET:
+			case SCRIPT_OP_ADD:
+				a = script_code[script_pc+1];
+				value = script_code[script_pc+2] | (script_code[script_pc+3] << 8);
+				if ( a >= SCRIPT_NUM_VARS ) {
+					script_error(PSTR("invalid variable"));
+					return 0;
+				}
+				if ( op == SCRIPT_OP_SET ) {
+					script_var[a] = value;
+				} else {
+					script_var[a] += value;
+				}
+				script_pc += 4;
+				break;
+
+			case SCRIPT_OP_READ:
+				a = script_code[script_pc+1];
+				if ( a >= SCRIPT_NUM_VARS ) {
+					script_error(PSTR("invalid variable"));
+					return 0;
+				}
+				script_var[a] = script_readSensor(script_code[script_pc+2]);
+				script_pc += 3;
+				break;
+
+			case SCRIPT_OP_JUMP:
+				script_pc = script_code[script_pc+1];
+				break;
+
+			case SCRIPT_OP_JUMPIF:
+				a = script_code[script_pc+1];
+				b = script_code[script_pc+2];
+				value = script_code[script_pc+3] | (script_code[script_pc+4] << 8);
+				if ( a >= SCRIPT_NUM_VARS ) {
+					script_error(PSTR("invalid variable"));
+					return 0;
+				}
+				switch ( b )
+				{
+					case SCRIPT_COND_EQ: taken = ( script_var[a] == value ); break;
+					case SCRIPT_COND_NE: taken = ( script_var[a] != value ); break;
+					case SCRIPT_COND_LT: taken = ( script_var[a] <  value ); break;
+					case SCRIPT_COND_GT: taken = ( script_var[a] >  value ); break;
+					case SCRIPT_COND_LE: taken = ( script_var[a] <= value ); break;
+					case SCRIPT_COND_GE: taken = ( script_var[a] >= value ); break;
+					default:
+						script_error(PSTR("invalid condition"));
+						return 0;
+				}
+				if ( taken ) {
+					script_pc = script_code[script_pc+5];
+				} else {
+					script_pc += 6;
+				}
+				break;
+
+			case SCRIPT_OP_LOOP:
+				a = script_code[script_pc+1];
+				if ( a >= SCRIPT_NUM_VARS ) {
+					script_error(PSTR("invalid variable"));
+					return 0;
+				}
+				script_var[a]--;
+				if ( script_var[a] != 0 ) {
+					script_pc = script_code[script_pc+2];
+				} else {
+					script_pc += 3;
+				}
+				break;
+
+			case SCRIPT_OP_CALL:
+				if ( script_sp >= SCRIPT_STACK_DEPTH ) {
+					script_error(PSTR("subroutines nested too deep"));
+					return 0;
+				}
+				script_stack[script_sp++] = script_pc + 2;
+				script_pc = script_code[script_pc+1];
+				break;
+
+			case SCRIPT_OP_RETURN:
+				if ( script_sp == 0 ) {
+					script_error(PSTR("return without call"));
+					return 0;
+				}
+				script_pc = script_stack[--script_sp];
+				break;
+		}
+	}
+
+	// used up the budget (or stopped), continue on the next pass
+	return 0;
+}
+
+// read upload data from the serial port, called by serialReceiveCommand()
+// The serial ISR marks the end of each line with 0xFF
+void script_loadFromSerial()
+{
+	unsigned char buffer[16];
+	uint8 count;
+
+	do
+	{
+		count = serial_read( buffer, sizeof(buffer) );
+		for (uint8 i=0; i<count && script_state == SCRIPT_LOADING; i++) {
+			script_loadCharacter(buffer[i]);
+		}
+	} while ( count > 0 && script_state == SCRIPT_LOADING );
+}
+
+// process one character of the upload
+static void script_loadCharacter(uint8 c)
+{
+	uint8 nibble;
+
+	// end of line
+	if ( c == 0xFF )
+	{
+		if ( load_have_nibble || load_line == LOAD_LINE_END ) {
+			load_error = 1;
+		}
+		if ( load_line == LOAD_LINE_END || load_line == LOAD_LINE_SUM ) {
+			// the END line finishes the upload
+			script_loadFinish();
+		}
+		load_line = LOAD_LINE_START;
+		return;
+	}
+
+	// whitespace is allowed anywhere (terminals may also send LF after CR)
+	if ( c == ' ' || c == '\t' || c == '\n' ) {
+		if ( load_line == LOAD_LINE_END && load_keyword == 3 ) {
+			load_line = LOAD_LINE_SUM;
+		}
+		return;
+	}
+
+	// the first character decides the type of line
+	if ( load_line == LOAD_LINE_START )
+	{
+		load_have_nibble = 0;
+		if ( c == ':' ) {
+			load_line = LOAD_LINE_DATA;
+			return;
+		}
+		load_line = LOAD_LINE_END;
+		load_keyword = 0;
+		load_sum_received = 0;
+	}
+
+	// match the letters of END, the checksum follows after a space
+	if ( load_line == LOAD_LINE_END )
+	{
+		if ( load_keyword < 3 && (c | 0x20) == "end"[load_keyword] ) {
+			load_keyword++;
+		} else {
+			load_error = 1;
+		}
+		return;
+	}
+
+	// convert hex digit
+	if ( c >= '0' && c <= '9' ) {
+		nibble = c - '0';
+	} else if ( c >= 'A' && c <= 'F' ) {
+		nibble = c - 'A' + 10;
+	} else if ( c >= 'a' && c <= 'f' ) {
+		nibble = c - 'a' + 10;
+	} else {
+		load_error = 1;
+		return;
+	}
+
+	if ( load_line == LOAD_LINE_SUM ) {
+		load_sum_received = (load_sum_received << 4) | nibble;
+		return;
+	}
+
+	if ( !load_have_nibble )
+	{
+		load_nibble = nibble;
+		load_have_nibble = 1;
+		return;
+	}
+	load_have_nibble = 0;
+
+	// store the byte unless the program is too long
+	if ( script_length >= SCRIPT_MAX_LENGTH ) {
+		load_error = 1;
+		return;
+	}
+	script_code[script_length] = (load_nibble << 4) | nibble;
+	load_checksum += script_code[script_length];
+	script_length++;
+}
+
+// finish the upload and report the result
+static void script_loadFinish()
+{
+	script_state = SCRIPT_IDLE;
+
+	if ( load_error || script_length == 0 ) {
+		script_length = 0;
+		log_printf("\nUpload failed - invalid data or program too long.\n> ");
+	} else if ( load_sum_received != load_checksum ) {
+		script_length = 0;
+		log_printf("\nUpload failed - checksum error.\n> ");
+	} else {
+		log_printf("\nProgram loaded, %i bytes. Use RUN to start, SAVE to store.\n> ", script_length);
+	}
+}
+
+// calculate the 8-bit sum of the program bytes
+static uint8 script_checksum()
+{
+	uint8 checksum = 0;
+	for (uint8 i=0; i<script_length; i++) { checksum += script_code[i]; }
+	return checksum;
+}
+
+// stop the program after an error
+static void script_error(PGM_P msg)
+{
+	log_printf("\nProgram error at %i: ", script_pc);
+	log_printf_P(msg);
+	log_printf(".\n> ");
+	script_state = SCRIPT_IDLE;
+}
+
+// read a sensor value for the READ instruction
+static int16 script_readSensor(uint8 sensor)
+{
+	adc_snapshot sensors;
+	int16 value = 0;
+
+	switch ( sensor )
+	{
+		case SCRIPT_SENSOR_BATTERY:
+			adc_getSnapshot(&sensors);
+			return sensors.battery;
+		case SCRIPT_SENSOR_GYROX:
+			adc_getSnapshot(&sensors);
+			return sensors.gyrox;
+		case SCRIPT_SENSOR_GYROY:
+			adc_getSnapshot(&sensors);
+			return sensors.gyroy;
+		case SCRIPT_SENSOR_DMS:
+			adc_getSnapshot(&sensors);
+			return sensors.dms;
+		case SCRIPT_SENSOR_ULTRASONIC:
+			adc_getSnapshot(&sensors);
+			return sensors.ultrasonic;
+		case SCRIPT_SENSOR_ACCELX:
+			adc_getSnapshot(&sensors);
+			return sensors.accelx;
+		case SCRIPT_SENSOR_ACCELY:
+			adc_getSnapshot(&sensors);
+			return sensors.accely;
+		case SCRIPT_SENSOR_BUTTONS:
+			// report and reset the button flags set by the button ISRs
+			if ( button_up_pressed )	{ value |= 0x01; button_up_pressed = FALSE; }
+			if ( button_down_pressed )	{ value |= 0x02; button_down_pressed = FALSE; }
+			if ( button_left_pressed )	{ value |= 0x04; button_left_pressed = FALSE; }
+			if ( button_right_pressed )	{ value |= 0x08; button_right_pressed = FALSE; }
+			return value;
+		default:
+			return 0;
+	}
+}
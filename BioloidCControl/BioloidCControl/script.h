@@ -0,0 +1,128 @@
+/*
+ * script.h - Stored program interpreter for the Robotis CM-510 controller.
+ *   Runs small bytecode programs compiled on the PC by compile_script.pl
+ *   cooperatively from the main loop. Programs are uploaded over the
+ *   serial port and can be kept in EEPROM.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Program Format
+ *
+ * A program is a sequence of instructions, each one opcode byte followed
+ * by its operands. 16-bit values are stored low byte first, jump targets
+ * are byte addresses within the program (programs are at most
+ * SCRIPT_MAX_LENGTH bytes long).
+ *
+ * Opcode			Operands			Description
+ * END				-					stop the program
+ * CMD				command				issue a command as if received by serial,
+ *									STOP to RSET without M (use PLAY)
+ * PLAY				page				play a motion page
+ * WAIT				ms_L ms_H			wait (non-blocking)
+ * SYNC				-					wait until the motion engine has stopped
+ * SET				var val_L val_H		var = val
+ * ADD				var val_L val_H		var = var + val
+ * READ				var sensor			var = sensor value (see SCRIPT_SENSOR_x)
+ * JUMP				addr				continue at addr
+ * JUMPIF			var cond val_L val_H addr	continue at addr if (var cond val)
+ * LOOP				var addr			var = var - 1, continue at addr if var != 0
+ * CALL				addr				call subroutine at addr
+ * RETURN			-					return from subroutine
+ *
+ * Upload Protocol
+ *
+ * Send the LOAD command, followed by lines of hex encoded program bytes
+ * starting with ':' and finish with a line "END xx" where xx is the
+ * 8-bit sum of all program bytes in hex. compile_script.pl creates this
+ * text for you.
+ */
+
+#ifndef SCRIPT_H_
+#define SCRIPT_H_
+
+// program size and interpreter resources
+#define SCRIPT_MAX_LENGTH			200		// maximum program size in bytes
+#define SCRIPT_NUM_VARS				8		// number of variables
+#define SCRIPT_STACK_DEPTH			4		// maximum subroutine nesting
+#define SCRIPT_INSTRUCTION_BUDGET	16		// instructions executed per main loop pass
+
+// opcodes
+#define SCRIPT_OP_END			0
+#define SCRIPT_OP_CMD			1
+#define SCRIPT_OP_PLAY			2
+#define SCRIPT_OP_WAIT			3
+#define SCRIPT_OP_SYNC			4
+#define SCRIPT_OP_SET			5
+#define SCRIPT_OP_ADD			6
+#define SCRIPT_OP_READ			7
+#define SCRIPT_OP_JUMP			8
+#define SCRIPT_OP_JUMPIF		9
+#define SCRIPT_OP_LOOP			10
+#define SCRIPT_OP_CALL			11
+#define SCRIPT_OP_RETURN		12
+
+// conditions for JUMPIF
+#define SCRIPT_COND_EQ			0
+#define SCRIPT_COND_NE			1
+#define SCRIPT_COND_LT			2
+#define SCRIPT_COND_GT			3
+#define SCRIPT_COND_LE			4
+#define SCRIPT_COND_GE			5
+
+// sensors for READ
+#define SCRIPT_SENSOR_BATTERY		0	// battery voltage in mV
+#define SCRIPT_SENSOR_GYROX			1	// gyro x deviation from center
+#define SCRIPT_SENSOR_GYROY			2	// gyro y deviation from center
+#define SCRIPT_SENSOR_DMS			3	// DMS distance in cm
+#define SCRIPT_SENSOR_ULTRASONIC	4	// ultrasonic distance in cm
+#define SCRIPT_SENSOR_ACCELX		5	// accelerometer x in mg
+#define SCRIPT_SENSOR_ACCELY		6	// accelerometer y in mg
+#define SCRIPT_SENSOR_BUTTONS		7	// U/D/L/R buttons pressed since last read (bits 0-3)
+
+// initialize the interpreter and load the program stored in EEPROM (if any)
+void script_init(void);
+
+// handle the stored program commands RUN, LOAD and SAVE
+// Input:	(uint8)	command as defined in global.h
+void script_command(uint8 command);
+
+// start the stored program from the beginning
+// Returns:	(int)	1 - started
+//					0 - no valid program loaded
+int script_start(void);
+
+// stop the stored program
+void script_stop(void);
+
+// Returns 1 if a program is loaded (and can be started), otherwise 0
+uint8 script_isLoaded(void);
+
+// Returns 1 if a program is running, otherwise 0
+uint8 script_isRunning(void);
+
+// Returns 1 if an upload is in progress, otherwise 0
+uint8 script_isLoading(void);
+
+// read upload data from the serial port, called by serialReceiveCommand()
+void script_loadFromSerial(void);
+
+// execute the stored program for at most SCRIPT_INSTRUCTION_BUDGET
+// instructions, waits and motion synchronisation never block
+// Returns:	(int)	0 - no new command
+//					1 - program issued a new command
+int script_run(void);
+
+#endif /* SCRIPT_H_ */
@@ -1,722 +1,638 @@
-/*
- * Serial.c - Functions for the serial port PC interface on the 
- * Robotis CM-510 controller. 
- * Can either use serial cable or Zig2Serial/RC-100 via Zig-110
- *
- * Based on the embedded C library provided by Robotis  
- * Version 0.7	31/01/2013
- *
- * Modified by Peter Lanius
- * Please send suggestions and bug fixes to PeterLanius@gmail.com
- * 
-*/
-
-#include <avr/io.h>
-#include <stdio.h>
-#include <avr/interrupt.h>
-#include <string.h>
-#include <ctype.h>
-#include <avr/pgmspace.h>
-#include <util/delay.h>
-#include "global.h"
-#include "serial.h"
-#include "rc100.h"
-
-
-// Command Strings List - kept in Flash to conserve RAM
-const char COMMANDSTR0[]  PROGMEM = "STOP";
-const char COMMANDSTR1[]  PROGMEM = "WFWD";
-const char COMMANDSTR2[]  PROGMEM = "WBWD";
-const char COMMANDSTR3[]  PROGMEM = "WLT ";
-const char COMMANDSTR4[]  PROGMEM = "WRT ";
-const char COMMANDSTR5[]  PROGMEM = "WLSD";
-const char COMMANDSTR6[]  PROGMEM = "WRSD";
-const char COMMANDSTR7[]  PROGMEM = "WFLS";
-const char COMMANDSTR8[]  PROGMEM = "WFRS";
-const char COMMANDSTR9[]  PROGMEM = "WBLS";
-const char COMMANDSTR10[] PROGMEM = "WBRS";
-const char COMMANDSTR11[] PROGMEM = "WAL ";
-const char COMMANDSTR12[] PROGMEM = "WAR ";
-const char COMMANDSTR13[] PROGMEM = "WFLT";
-const char COMMANDSTR14[] PROGMEM = "WFRT";
-const char COMMANDSTR15[] PROGMEM = "WBLT";
-const char COMMANDSTR16[] PROGMEM = "WBRT";
-const char COMMANDSTR17[] PROGMEM = "WRDY";
-const char COMMANDSTR18[] PROGMEM = "SIT ";
-const char COMMANDSTR19[] PROGMEM = "STND";
-const char COMMANDSTR20[] PROGMEM = "BAL ";
-const char COMMANDSTR21[] PROGMEM = "M   ";
-const char COMMANDSTR22[] PROGMEM = "FGUP";
-const char COMMANDSTR23[] PROGMEM = "BGUP";
-const char COMMANDSTR24[] PROGMEM = "RSET";
-const char COMMANDSTR25[] PROGMEM = "WS  ";
-const char COMMANDSTR26[] PROGMEM = "W   ";
-const char *const COMMANDSTR_POINTER[] PROGMEM = { 
-COMMANDSTR0, COMMANDSTR1, COMMANDSTR2, COMMANDSTR3, COMMANDSTR4,
-COMMANDSTR5, COMMANDSTR6, COMMANDSTR7, COMMANDSTR8, COMMANDSTR9,
-COMMANDSTR10, COMMANDSTR11, COMMANDSTR12, COMMANDSTR13, COMMANDSTR14, 
-COMMANDSTR15, COMMANDSTR16, COMMANDSTR17, COMMANDSTR18, COMMANDSTR19,
-COMMANDSTR20, COMMANDSTR21, COMMANDSTR22, COMMANDSTR23, COMMANDSTR24,
-COMMANDSTR25, COMMANDSTR26 };
-
-// set up the read buffer
-volatile unsigned char gbSerialBuffer[MAXNUM_SERIALBUFF] = {0};
-volatile unsigned char gbSerialBufferHead = 0;
-volatile unsigned char gbSerialBufferTail = 0;
-static FILE *device;
-// RC-100 related variables
-volatile uint8 rc100_packet_count = 0;
-// command match variables
-char command[5], buffer[5];
-
-// global variables
-extern volatile uint8 bioloid_command;			// current command
-extern volatile uint8 last_bioloid_command;		// last command
-extern volatile uint8 flag_receive_ready;		// received complete command flag
-extern volatile uint8 current_motion_page;		// current motion page
-extern volatile uint8 next_motion_page;			// next motion page if we got new command
-
-// internal function prototypes
-void serial_interpret_command ( void );
-void command_match_string ( void );
-void rc100_interpret_command ( void );
-void serial_put_queue( unsigned char data );
-unsigned char serial_get_queue(void);
-int std_putchar(char c,  FILE* stream);
-int std_getchar( FILE* stream );
-
-// the new implementation of AVR libc does not allow variables passed to _delay_ms
-static inline void delay_ms(uint16 count) {
-	while(count--) { 
-		_delay_ms(1); 
-	} 
-}
-
-
-// ISR for serial receive, Serial Port/ZigBEE use USART1
-SIGNAL(USART1_RX_vect)
-{
-	unsigned char c;
-	
-	c = UDR1;
-
-// we need two versions of the ISR depending on terminal vs. RC-100 input
-// Terminal input version (serial cable or Zig2Serial)
-#if defined ZIG_2_SERIAL || defined SERIAL_CABLE
-	// check if we have received a CR+LF indicating complete string
-	if (c == '\r')
-	{
-		// command complete, set flag and write termination byte to buffer
-		flag_receive_ready = 1;
-		serial_put_queue( 0xFF );
-		c = '\n';
-		std_putchar(c, device);
-		// test
-		std_putchar(' ', device);
-	} 
-	else
-	{
-		// put each received byte into the buffer until full
-		serial_put_queue( c );
-		// echo the character 
-		std_putchar(c, device);
-	}
-#endif
-
-// RC-100 version, need to assemble 6-byte packets
-// The RC-100 uses the communication packet in the form below
-//			FF 55 Data_L ~Data_L Data_H ~Data_H
-// Example: DATA = 0x1234
-// Packet : 0xFF 0x55 0x34 0xCB 0x12 0xED
-#ifdef RC100
-	// The RC-100 repeats sending packets as long as the button is pressed
-	// This means we need to ignore packets not yet processed
-	if ( flag_receive_ready == 1 ) {
-		return;
-	}
-	// check if we have received a packet start byte (0xFF)
-	// BEWARE: the ~Data_H part of a packet can be 0xFF - need to exclude
-	if ( c == 0xFF && rc100_packet_count == 0 ) {
-		// new packet start - reset packet flag
-		rc100_packet_count = 1;
-	} else if ( rc100_packet_count == 1 ) { 
-		// second byte needs to be 0x55 for valid packet
-		if ( c == 0x55 ) {
-			rc100_packet_count++;
-		} else {
-			// invalid packet, ignore and reset
-			rc100_packet_count = 0;
-		}
-	} else if ( rc100_packet_count >= 2 ) {
-		// have valid header, start putting bytes in queue
-		if ( rc100_packet_count < 5 ) {
-			rc100_packet_count++;
-			serial_put_queue( c );
-		} else if ( rc100_packet_count == 5 ) {
-			// packet is finished, set flag
-			serial_put_queue( c );
-			flag_receive_ready = 1;
-			// reset counter and write termination byte
-			rc100_packet_count = 0;
-			serial_put_queue( 0xFF );
-		}
-	} else {
-		// ignore byte, not part of a valid packet
-		rc100_packet_count == 0;
-	}
-#endif
-}
-
-
-// initialize the serial port with the specified baud rate
-void serial_init(long baudrate)
-{
-	unsigned short Divisor;
-
-	// in case of ZigBee comms, enable the device
-#if defined ZIG_2_SERIAL || defined RC100
-	DDRC  = 0x7F;
-	PORTC = 0x7E;
-	// to enable ZigBee communications we need PD5=low, PD6=high, make PD7 input and turn off pull-up on PD7
-	PORTD &= ~0x80; 
-	PORTD &= ~0x20; 
-	PORTD |= 0x40; 
-	// we need to wait for the connection to get established
-	delay_ms(500);
-#endif
-
-	// set UART register A
-	//Bit 7: USART Receive Complete
-	//Bit 6: USART Transmit Complete
-	//Bit 5: USART Data Register Empty 
-	//Bit 4: Frame Error
-	//Bit 3: Data OverRun
-	//Bit 2: Parity Error
-	//Bit 1: Double The USART Transmission Speed
-	//Bit 0: Multi-Processor Communication Mode
-	UCSR1A = 0b01000010;
-	
-	// set UART register B
-	// bit7: enable rx interrupt
-    // bit6: enable tx interrupt
-    // bit4: enable rx
-    // bit3: enable tx
-    // bit2: set sending size(0 = 8bit)
-	UCSR1B = 0b10011000;
-	
-	// set UART register C
-	// bit6: communication mode (1 = synchronous, 0 = asynchronous)
-    // bit5,bit4: parity bit(00 = no parity) 
-    // bit3: stop bit(0 = stop bit 1, 1 = stop bit 2)
-    // bit2,bit1: data size(11 = 8bit)
-	UCSR1C = 0b00000110;
-
-	// Set baud rate
-	Divisor = (unsigned short)(2000000.0 / baudrate) - 1;
-	UBRR0H = (unsigned char)((Divisor & 0xFF00) >> 8);
-	UBRR0L = (unsigned char)(Divisor & 0x00FF);
-
-	// initialize
-	UDR1 = 0xFF;
-	gbSerialBufferHead = 0;
-	gbSerialBufferTail = 0;
-
-	// open the serial device for printf()
-	device = fdevopen( std_putchar, std_getchar );
-	
-	// reset commands and flags
-	bioloid_command = 0;				
-	last_bioloid_command = 0;		
-	flag_receive_ready = 0;			
-}
-
-
-// Top level serial port task
-// manages all requests to read from or write to the serial port
-// Receives commands from the serial port and writes output (excluding printf)
-// Checks the status flag provided by the ISR for operation
-// Returns:  int flag = 0 when no new command has been received
-//           int flag = 1 when new command has been received
-int serialReceiveCommand()
-{
-	// check for new command	
-	if (flag_receive_ready == 0)
-	{
-		// nothing to do, go straight back to main loop
-		return 0;
-	}
-
-// command interpretation depends on terminal vs. RC-100 input	
-#if defined ZIG_2_SERIAL || defined SERIAL_CABLE
-	serial_interpret_command();
-#endif
-// RC-100 command interpretation
-#ifdef RC100
-	rc100_interpret_command();
-#endif
-	
-	// set command received flag only if valid command
-	if ( bioloid_command == COMMAND_NOT_FOUND ) {
-		return 0;
-	} else {
-		return 1;
-	}
-}
-
-// Re-assemble the 4-byte ASCII string into the matching commands
-void serial_interpret_command ( void )
-{
-	char c1 = ' ';
-	uint8 c_count, s_count; 
-
-	// we have a new command, get characters
-	for ( uint8 i=0; i<4; i++ )
-	{
-		// get next character from queue
-		c1 = serial_get_queue();
-		if ( c1 >= 'a' && c1 <= 'z' ) c1 = toupper(c1); // convert to upper case if required
-		if ( c1 == 0xFF && i>0 ) c1 = ' ';				// pad with blanks 
-		command[i] = c1;
-	}
-	command[4] = 0x00;			// finish the string
-	
-	// flush the queue in case we received more than 4 bytes
-	do
-	{
-		// need to do it once even for 4 bytes to get rid of the 0xFF marking the end of string
-		serial_get_queue();
-	} while (serial_get_qstate() != 0);
-	
-	// see if the string matches a known command
-	command_match_string();
-	
-	// reset the flag
-	flag_receive_ready = 0;
-
-	// finally echo the command and write new command prompt
-	if ( bioloid_command == COMMAND_MOTIONPAGE ) {
-		printf( "%s - MotionPageCommand %i\n> ", command, next_motion_page );
-	} else if( bioloid_command != COMMAND_NOT_FOUND ) {
-		printf( "%s - Command # %i\n> ", command, bioloid_command );
-	} else {
-		printf( "%s - Unknown Command! \n> ", command );
-	}
-}
-
-// function to match received strings to known commands
-void command_match_string ( void )
-{
-	int match;
-
-	// loop over all known commands to find a match
-	for (uint8 i=0; i<NUMBER_OF_COMMANDS; i++)
-	{
-		// the command strings sit in PROGMEM - so need to use pgmspace.h macros
-		strcpy_P(buffer, (PGM_P)pgm_read_word(&(COMMANDSTR_POINTER[i])));
-		match = strcmp(	buffer, command	);
-		if ( match == 0 )
-		{
-			// we found a match set the command
-			last_bioloid_command = bioloid_command;
-			bioloid_command = i;
-			break;
-		}
-		
-		// if we get to end of loop we haven't found a match
-		if ( i== NUMBER_OF_COMMANDS-1 )
-		{
-			last_bioloid_command = bioloid_command;
-			// 0xFF means no match found
-			bioloid_command = COMMAND_NOT_FOUND;
-		}
-	}
-		
-	// find the motion page associated with the command for non-walk commands
-	if ( bioloid_command != COMMAND_NOT_FOUND && bioloid_command >= COMMAND_WALK_READY )
-	{
-	// cross-check against the definitions in global.h
-		switch ( bioloid_command )
-		{
-			case COMMAND_WALK_READY:
-			next_motion_page = COMMAND_WALK_READY_MP;
-			break;
-			case COMMAND_SIT:
-			next_motion_page = COMMAND_SIT_MP;
-			break;
-			case COMMAND_STAND:
-			next_motion_page = COMMAND_STAND_MP;
-			break;
-			case COMMAND_BALANCE:
-			next_motion_page = COMMAND_BALANCE_MP;
-			break;
-			case COMMAND_BACK_GET_UP:
-			next_motion_page = COMMAND_BACK_GET_UP_MP;
-			break;
-			case COMMAND_FRONT_GET_UP:
-			next_motion_page = COMMAND_FRONT_GET_UP_MP;
-			break;
-			case COMMAND_RESET:
-			next_motion_page = COMMAND_RESET_MP;
-			break;
-			default:
-			next_motion_page = 0;
-			break;
-		}
-	}
-	// otherwise it's easier to calculate the motion page for walk commands
-	else if( bioloid_command >= COMMAND_WALK_FORWARD && bioloid_command < COMMAND_WALK_READY )
-	{
-		// all walk command motion pages are in sequence and 12 pages apart each
-		next_motion_page = 12*(bioloid_command-1) + COMMAND_WALK_READY_MP + 1;
-	}
-	
-	// before we leave we need to check for special case of Motion Page command
-	if( bioloid_command == COMMAND_NOT_FOUND )
-	{
-		if ( command[0] == 'M' && (command[1] >= '0' && command[1] <= '9') )
-		{
-			// we definitely have a motion page, find the number
-			bioloid_command = COMMAND_MOTIONPAGE;
-			next_motion_page = command[1] - 48;	// converts ASCII to number
-			// check if next character is still a number
-			if ( command[2] >= '0' && command[2] <= '9' )
-			{
-				next_motion_page = next_motion_page * 10;
-				next_motion_page += (command[2]-48);
-			}
-			// check if next character is still a number
-			if ( command[3] >= '0' && command[3] <= '9' )
-			{
-				next_motion_page = next_motion_page * 10;
-				next_motion_page += (command[3]-48);
-			}
-		}
-	}
-
-	// check for special case of wait commands
-	if( bioloid_command == COMMAND_NOT_FOUND )
-	{
-		if ( command[0] == 'W' && (command[1] >= '0' && command[1] <= '9') )
-		{
-			// we have a wait milliseconds command, find the number
-			bioloid_command = COMMAND_WAIT_MILLISECONDS;
-			next_motion_page = command[1] - 48;	// converts ASCII to number
-			// check if next character is still a number
-			if ( command[2] >= '0' && command[2] <= '9' )
-			{
-				next_motion_page = next_motion_page * 10;
-				next_motion_page += (command[2]-48);
-			}
-			// check if next character is still a number
-			if ( command[3] >= '0' && command[3] <= '9' )
-			{
-				next_motion_page = next_motion_page * 10;
-				next_motion_page += (command[3]-48);
-			}
-		}		
-	} 
-	else if ( command[0] == 'W' && command[1] == 'S' && (command[2] >= '0' && command[2] <= '9') )
-	{
-		// we have a wait seconds command, find the number
-		bioloid_command = COMMAND_WAIT_SECONDS;
-		next_motion_page = command[2] - 48;	// converts ASCII to number
-		// check if next character is still a number
-		if ( command[3] >= '0' && command[3] <= '9' )
-		{
-			next_motion_page = next_motion_page * 10;
-			next_motion_page += (command[3]-48);
-		}
-		// convert to milliseconds
-		next_motion_page = 1000 * next_motion_page;
-	}
-
-}
-
-// verify validity of packet data 
-// match to command assignment for the allowed button combinations
-void rc100_interpret_command ( void )
-{
-	uint8 c1, c2, c3, c4, checksum;
-	uint16 rc100_data;
-	
-	// get the 4 bytes out of the buffer queue
-	c1 = serial_get_queue();
-	c2 = serial_get_queue();
-	c3 = serial_get_queue();
-	c4 = serial_get_queue();
-	
-	// reset data word
-	rc100_data = 0;
-	
-	// check that ~(Byte 4) = Byte 3
-	checksum = ~c2;
-	if( c1 == checksum )
-	{
-		// check that ~(Byte 6) = Byte 5
-		checksum = ~c4;
-		if( c3 == checksum )
-		{
-			// all checks OK, assemble data word from low and high byte
-			rc100_data = (unsigned short)((c3 << 8) & 0xFF00);
-			rc100_data += c1;
-		}
-	}
-
-	// interpret the command
-	if ( rc100_data != 0 )
-	{
-		last_bioloid_command = bioloid_command;
-		
-		// define your RC-100 button-command assignments here
-		switch ( rc100_data )
-		{
-			case RC100_BTN_U:
-				bioloid_command = COMMAND_WALK_FORWARD;
-				next_motion_page = 12*(bioloid_command-1) + COMMAND_WALK_READY_MP + 1;
-			break;
-			case RC100_BTN_D:
-				bioloid_command = COMMAND_WALK_BACKWARD;
-				next_motion_page = 12*(bioloid_command-1) + COMMAND_WALK_READY_MP + 1;
-			break;
-			case RC100_BTN_L:
-				bioloid_command = COMMAND_WALK_TURN_LEFT;
-				next_motion_page = 12*(bioloid_command-1) + COMMAND_WALK_READY_MP + 1;
-			break;
-			case RC100_BTN_R:
-				bioloid_command = COMMAND_WALK_TURN_RIGHT;
-				next_motion_page = 12*(bioloid_command-1) + COMMAND_WALK_READY_MP + 1;
-			break;
-			case RC100_BTN_U_AND_L:
-				bioloid_command = COMMAND_WALK_FWD_LEFT_SIDE;
-				next_motion_page = 12*(bioloid_command-1) + COMMAND_WALK_READY_MP + 1;
-			break;
-			case RC100_BTN_U_AND_R:
-				bioloid_command = COMMAND_WALK_FWD_RIGHT_SIDE;
-				next_motion_page = 12*(bioloid_command-1) + COMMAND_WALK_READY_MP + 1;
-			break;
-			case RC100_BTN_D_AND_L:
-				bioloid_command = COMMAND_WALK_LEFT_SIDE;
-				next_motion_page = 12*(bioloid_command-1) + COMMAND_WALK_READY_MP + 1;
-			break;
-			case RC100_BTN_D_AND_R:
-				bioloid_command = COMMAND_WALK_RIGHT_SIDE;
-				next_motion_page = 12*(bioloid_command-1) + COMMAND_WALK_READY_MP + 1;
-			break;
-			case RC100_BTN_5:
-				bioloid_command = COMMAND_SIT;
-				next_motion_page = COMMAND_SIT_MP;
-			break;
-			case RC100_BTN_6:
-				bioloid_command = COMMAND_STOP;
-			break;
-			case RC100_BTN_U_AND_1:
-				bioloid_command = COMMAND_FRONT_GET_UP;
-				next_motion_page = COMMAND_FRONT_GET_UP_MP;
-			break;
-			case RC100_BTN_D_AND_1:
-				bioloid_command = COMMAND_BACK_GET_UP;
-				next_motion_page = COMMAND_BACK_GET_UP_MP;
-			break;
-			case RC100_BTN_L_AND_1:
-				bioloid_command = COMMAND_MOTIONPAGE;
-				next_motion_page = 8;
-			break;
-			case RC100_BTN_R_AND_1:
-				bioloid_command = COMMAND_MOTIONPAGE;
-				next_motion_page = 11;
-			break;
-			case RC100_BTN_U_AND_2:
-				bioloid_command = COMMAND_MOTIONPAGE;
-				next_motion_page = 5;
-			break;
-			case RC100_BTN_D_AND_2:
-				bioloid_command = COMMAND_MOTIONPAGE;
-				next_motion_page = 7;
-			break;
-			case RC100_BTN_L_AND_2:
-				bioloid_command = COMMAND_MOTIONPAGE;
-				next_motion_page = 2;
-			break;
-			case RC100_BTN_R_AND_2:
-				bioloid_command = COMMAND_MOTIONPAGE;
-				next_motion_page = 1;
-			break;
-			default:
-				bioloid_command = COMMAND_NOT_FOUND;
-			break;
-		}
-
-	} 
-	else
-	{
-		// because the RC-100 sends a 0 byte when you lift the button press
-		// we just ignore the 0 byte and continue executing the last command
-		last_bioloid_command = bioloid_command;
-		bioloid_command = COMMAND_NOT_FOUND;
-	}
-
-	/* TEST
-	// enable ZigBee communications we need PD5=high, PD6=low, make PD7 input and turn off pull-up on PD7
-	PORTD |= 0x80;
-	PORTD |= 0x20;
-	PORTD &= ~0x40;
-	printf("\nRC100-Data = %i, Command = %i, Next MP = %i", rc100_data, bioloid_command, next_motion_page);
-	// re-enable ZigBee communications we need PD5=low, PD6=high, make PD7 input and turn off pull-up on PD7
-	PORTD &= ~0x80;
-	PORTD &= ~0x20;
-	PORTD |= 0x40;
-	TEST */
-
-	// flush the queue in case we received more than 4 bytes
-	do
-	{
-		// need to do it once even for 4 bytes to get rid of the 0xFF marking the end of string
-		serial_get_queue();
-	} while (serial_get_qstate() != 0);
-	
-	// reset the flag
-	flag_receive_ready = 0;
-}
-
-
-// write out a data string to the serial port
-// return the number of bytes sent
-int serial_write( unsigned char *pData, int numbyte )
-{
-	int count;
-
-	for( count=0; count<numbyte; count++ )
-	{
-		// wait for the data register to empty
-		while(!bit_is_set(UCSR1A,5));
-		// before writing the next byte
-		UDR1 = pData[count];
-	}
-	return count;
-}
-
-// read a data string from the serial port
-unsigned char serial_read( unsigned char *pData, int numbyte )
-{
-	int count, numgetbyte;
-	
-	// buffer is empty, nothing to read 
-	if( gbSerialBufferHead == gbSerialBufferTail )
-		return 0;
-	
-	// check number of bytes requested does not exceed whats in the buffer
-	numgetbyte = serial_get_qstate();
-	if( numgetbyte > numbyte )
-		numgetbyte = numbyte;
-	
-	for( count=0; count<numgetbyte; count++ )
-		pData[count] = serial_get_queue();
-	
-	// return how many bytes have been read
-	return numgetbyte;
-}
-
-// get the number of bytes in the buffer
-int serial_get_qstate(void)
-{
-	short NumByte;
-	
-	if( gbSerialBufferHead == gbSerialBufferTail )
-		// buffer is empty
-		NumByte = 0;
-	// buffer is used in cyclic fashion
-	else if( gbSerialBufferHead < gbSerialBufferTail )
-		// head is to the left of the tail
-		NumByte = gbSerialBufferTail - gbSerialBufferHead;
-	else
-		// head is to the right of the tail
-		NumByte = MAXNUM_SERIALBUFF - (gbSerialBufferHead - gbSerialBufferTail);
-	
-	return (int)NumByte;
-}
-
-// puts a received byte into the buffer
-void serial_put_queue( unsigned char data )
-{
-	// buffer is full, character is ignored
-	if( serial_get_qstate() == (MAXNUM_SERIALBUFF-1) )
-		return;
-	
-	// append the received byte to the buffer
-	gbSerialBuffer[gbSerialBufferTail] = data;
-
-	// have reached the end of the buffer, restart at beginning
-	if( gbSerialBufferTail == (MAXNUM_SERIALBUFF-1) )
-		gbSerialBufferTail = 0;
-	else
-	// move the tail by one byte
-		gbSerialBufferTail++;
-}
-
-// get a byte out of the buffer
-unsigned char serial_get_queue(void)
-{
-	unsigned char data;
-	
-	// buffer is empty, return 0xFF
-	if( gbSerialBufferHead == gbSerialBufferTail )
-		return 0xff;
-	
-	// buffer not empty, return next byte	
-	data = gbSerialBuffer[gbSerialBufferHead];
-		
-	// head has reached end of buffer, restart at beginning
-	if( gbSerialBufferHead == (MAXNUM_SERIALBUFF-1) )
-		gbSerialBufferHead = 0;
-	else
-	// move the head by one byte
-		gbSerialBufferHead++;
-		
-	return data;
-}
-
-// writes a single character to the serial port
-// newline is replaced with CR+LF
-int std_putchar(char c,  FILE* stream)
-{
-	char tx[2];
-	int result;
-	
-    if( c == '\n' )
-	{
-        tx[0] = '\r';
-		tx[1] = '\n';
-		result = serial_write( (unsigned char*)tx, 2 );
-		if ( result != 2 ) {
-			return 1;
-		} else {
-			return 0;
-		}
-	}
-	else
-	{
-		tx[0] = c;
-		result = serial_write( (unsigned char*)tx, 1 );
-		if ( result != 1 ) {
-			return 1;
-		} else {
-			return 0;
-		}
-	}
- 
-}
-
-// get a single character out of the read buffer
-// wait for byte to arrive if none in the buffer
-int std_getchar( FILE* stream )
-{
-    char rx;
-	
-	while( serial_get_qstate() == 0 );
-	rx = serial_get_queue();
-	
-	if( rx == '\r' )
-		rx = '\n';
-
-    return rx;
-}
+/*
+ * Serial.c - Functions for the serial port PC interface on the 
+ * Robotis CM-510 controller. 
+ * Can either use serial cable or Zig2Serial/RC-100 via Zig-110
+ *
+ * Based on the embedded C library provided by Robotis  
+ * Version 0.7	31/01/2013
+ *
+ * Modified by Peter Lanius
+ * Please send suggestions and bug fixes to PeterLanius@gmail.com
+ * 
+*/
+
+#include <avr/interrupt.h>
+#include <string.h>
+#include <ctype.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+#include "global.h"
+#include "hal.h"
+#include "serial.h"
+#include "rc100.h"
+#include "script.h"
+#include "log.h"
+#include "dxl_hal.h"
+#include "sync.h"
+#include "clock.h"
+
+
+// Command Strings List - kept in Flash to conserve RAM
+const char COMMANDSTR0[]  PROGMEM = "STOP";
+const char COMMANDSTR1[]  PROGMEM = "WFWD";
+const char COMMANDSTR2[]  PROGMEM = "WBWD";
+const char COMMANDSTR3[]  PROGMEM = "WLT ";
+const char COMMANDSTR4[]  PROGMEM = "WRT ";
+const char COMMANDSTR5[]  PROGMEM = "WLSD";
+const char COMMANDSTR6[]  PROGMEM = "WRSD";
+const char COMMANDSTR7[]  PROGMEM = "WFLS";
+const char COMMANDSTR8[]  PROGMEM = "WFRS";
+const char COMMANDSTR9[]  PROGMEM = "WBLS";
+const char COMMANDSTR10[] PROGMEM = "WBRS";
+const char COMMANDSTR11[] PROGMEM = "WAL ";
+const char COMMANDSTR12[] PROGMEM = "WAR ";
+const char COMMANDSTR13[] PROGMEM = "WFLT";
+const char COMMANDSTR14[] PROGMEM = "WFRT";
+const char COMMANDSTR15[] PROGMEM = "WBLT";
+const char COMMANDSTR16[] PROGMEM = "WBRT";
+const char COMMANDSTR17[] PROGMEM = "WRDY";
+const char COMMANDSTR18[] PROGMEM = "SIT ";
+const char COMMANDSTR19[] PROGMEM = "STND";
+const char COMMANDSTR20[] PROGMEM = "BAL ";
+const char COMMANDSTR21[] PROGMEM = "M   ";
+const char COMMANDSTR22[] PROGMEM = "FGUP";
+const char COMMANDSTR23[] PROGMEM = "BGUP";
+const char COMMANDSTR24[] PROGMEM = "RSET";
+const char COMMANDSTR25[] PROGMEM = "WS  ";
+const char COMMANDSTR26[] PROGMEM = "W   ";
+const char COMMANDSTR27[] PROGMEM = "RUN ";
+const char COMMANDSTR28[] PROGMEM = "LOAD";
+const char COMMANDSTR29[] PROGMEM = "SAVE";
+const char COMMANDSTR30[] PROGMEM = "BRDG";
+const char COMMANDSTR31[] PROGMEM = "SYNM";
+const char COMMANDSTR32[] PROGMEM = "SYNF";
+const char COMMANDSTR33[] PROGMEM = "SYNQ";
+const char COMMANDSTR34[] PROGMEM = "SYNX";
+const char COMMANDSTR35[] PROGMEM = "TASK";
+const char COMMANDSTR36[] PROGMEM = "PROF";
+const char COMMANDSTR37[] PROGMEM = "TRCE";
+const char COMMANDSTR38[] PROGMEM = "STAK";
+const char *const COMMANDSTR_POINTER[] PROGMEM = { 
+COMMANDSTR0, COMMANDSTR1, COMMANDSTR2, COMMANDSTR3, COMMANDSTR4,
+COMMANDSTR5, COMMANDSTR6, COMMANDSTR7, COMMANDSTR8, COMMANDSTR9,
+COMMANDSTR10, COMMANDSTR11, COMMANDSTR12, COMMANDSTR13, COMMANDSTR14, 
+COMMANDSTR15, COMMANDSTR16, COMMANDSTR17, COMMANDSTR18, COMMANDSTR19,
+COMMANDSTR20, COMMANDSTR21, COMMANDSTR22, COMMANDSTR23, COMMANDSTR24,
+COMMANDSTR25, COMMANDSTR26, COMMANDSTR27, COMMANDSTR28, COMMANDSTR29,
+COMMANDSTR30, COMMANDSTR31, COMMANDSTR32, COMMANDSTR33, COMMANDSTR34,
+COMMANDSTR35, COMMANDSTR36, COMMANDSTR37, COMMANDSTR38 };
+
+#if (MAXNUM_SERIALBUFF & (MAXNUM_SERIALBUFF-1)) || MAXNUM_SERIALBUFF > 256
+#error "MAXNUM_SERIALBUFF must be a power of 2 up to 256"
+#endif
+
+// set up the read buffer
+volatile unsigned char gbSerialBuffer[MAXNUM_SERIALBUFF] = {0};
+volatile unsigned char gbSerialBufferHead = 0;
+volatile unsigned char gbSerialBufferTail = 0;
+// echo buffer, the transmit ISR sends these before any logged output
+volatile unsigned char serialEchoBuffer[SERIAL_ECHO_BUFF] = {0};
+volatile unsigned char serialEchoHead = 0;
+volatile unsigned char serialEchoTail = 0;
+// no echo while robots share the link (see sync.h)
+static uint8 serial_quiet = 0;
+// command match variables
+char command[5], buffer[5];
+// sequence number of the last command and acknowledgement state
+static uint16 command_seq = 0;
+static uint8 command_seq_valid = 0;
+static uint8 ack_pending = 0;			// start acknowledgement still to be sent
+static uint16 ack_seq = 0;
+static uint8 ack_command = 0;
+// bridge mode flag (see bridge.c)
+extern volatile uint8 bridge_active;
+
+// global variables
+extern volatile uint8 bioloid_command;			// current command
+extern volatile uint8 last_bioloid_command;		// last command
+extern volatile uint8 flag_receive_ready;		// received complete command flag
+extern volatile uint8 current_motion_page;		// current motion page
+extern volatile uint8 next_motion_page;			// next motion page if we got new command
+
+// internal function prototypes
+void serial_interpret_command ( void );
+void command_match_string ( void );
+void serial_put_queue( unsigned char data );
+unsigned char serial_get_queue(void);
+void serial_echo( unsigned char c );
+void serial_startTransmit(void);
+void serial_ackParsed(void);
+
+// the new implementation of AVR libc does not allow variables passed to _delay_ms
+static inline void delay_ms(uint16 count) {
+	while(count--) { 
+		_delay_ms(1); 
+	} 
+}
+
+
+// ISR for serial receive, Serial Port/ZigBEE use USART1
+SIGNAL(USART1_RX_vect)
+{
+	unsigned char c;
+	
+	c = hal_uartRead(HAL_UART_PC);
+
+	// in bridge mode every byte goes straight to the Dynamixel bus
+	if ( bridge_active )
+	{
+		serial_put_queue( c );
+		hal_uartEnable(HAL_UART_DXL, HAL_UART_TX_EMPTY);
+		return;
+	}
+
+// we need two versions of the ISR depending on terminal vs. RC-100 input
+// Terminal input version (serial cable or Zig2Serial)
+#if defined ZIG_2_SERIAL || defined SERIAL_CABLE
+	// clock sync frames are taken out before they reach the command buffer
+	if ( sync_receiveByte( c ) ) {
+		return;
+	}
+
+	// check if we have received a CR+LF indicating complete string
+	if (c == '\r')
+	{
+		// command complete, set flag and write termination byte to buffer
+		flag_receive_ready = 1;
+		serial_put_queue( 0xFF );
+		serial_echo('\r');
+		serial_echo('\n');
+		// test
+		serial_echo(' ');
+	} 
+	else
+	{
+		// put each received byte into the buffer until full
+		serial_put_queue( c );
+		// echo the character 
+		serial_echo(c);
+	}
+#endif
+
+// RC-100 version, packets are decoded as the bytes arrive (see rc100.c)
+#ifdef RC100
+	rc100_receiveByte( c );
+#endif
+}
+
+// ISR for serial transmit, sends echoed characters first, then logged output
+// The log text is formatted here one character at a time (see log.c)
+SIGNAL(USART1_UDRE_vect)
+{
+	int16 c;
+	unsigned char data;
+
+	// in bridge mode only Dynamixel bus data is sent
+	if ( bridge_active )
+	{
+		if ( dxl_hal_rx( &data, 1 ) == 1 ) {
+			hal_uartWrite(HAL_UART_PC, data);
+		} else {
+			hal_uartDisable(HAL_UART_PC, HAL_UART_TX_EMPTY);
+		}
+		return;
+	}
+
+	// sync frames go first, they are time stamped when the start byte is sent
+	c = sync_getTxByte();
+	if ( c >= 0 ) {
+		hal_uartWrite(HAL_UART_PC, (unsigned char) c);
+		return;
+	}
+
+	if ( serialEchoHead != serialEchoTail )
+	{
+		hal_uartWrite(HAL_UART_PC, serialEchoBuffer[serialEchoHead]);
+		serialEchoHead = (serialEchoHead + 1) % SERIAL_ECHO_BUFF;
+		return;
+	}
+	
+	c = log_getChar();
+	if ( c < 0 ) {
+		// nothing left to send, disable the interrupt until there is
+		hal_uartDisable(HAL_UART_PC, HAL_UART_TX_EMPTY);
+	} else {
+		hal_uartWrite(HAL_UART_PC, (unsigned char) c);
+	}
+}
+
+
+// initialize the serial port with the specified baud rate
+void serial_init(long baudrate)
+{
+	// in case of ZigBee comms, enable the device
+#if defined ZIG_2_SERIAL || defined RC100
+	hal_zigInit();
+	// we need to wait for the connection to get established
+	delay_ms(500);
+#endif
+
+	// 8 bit asynchronous, double speed, rx interrupt, rx and tx enabled
+	hal_uartOpen(HAL_UART_PC);
+
+	// Set baud rate
+	serial_setBaudrate( baudrate );
+
+	// initialize
+	hal_uartWrite(HAL_UART_PC, 0xFF);
+	gbSerialBufferHead = 0;
+	gbSerialBufferTail = 0;
+
+	serialEchoHead = 0;
+	serialEchoTail = 0;
+	
+	// reset commands and flags
+	bioloid_command = 0;				
+	last_bioloid_command = 0;		
+	flag_receive_ready = 0;			
+}
+
+
+// Top level serial port task
+// manages all requests to read from or write to the serial port
+// Receives commands from the serial port and writes output (excluding log output)
+// Checks the status flag provided by the ISR for operation
+// Returns:  int flag = 0 when no new command has been received
+//           int flag = 1 when new command has been received
+int serialReceiveCommand()
+{
+	// while a stored program is being uploaded all input belongs to the loader
+	// the loader keeps partial lines itself, so poll regardless of the flag
+	if ( script_isLoading() )
+	{
+		flag_receive_ready = 0;
+		script_loadFromSerial();
+		return 0;
+	}
+
+#ifdef RC100
+	// RC-100 packets are decoded in the ISR, just check for button events
+	return rc100_getCommand();
+#else
+	// check for new command	
+	if (flag_receive_ready == 0)
+	{
+		// nothing to do, go straight back to main loop
+		return 0;
+	}
+
+	// interpret the terminal command
+	serial_interpret_command();
+	
+	// set command received flag only if valid command
+	if ( bioloid_command == COMMAND_NOT_FOUND ) {
+		return 0;
+	} else {
+		return 1;
+	}
+#endif
+}
+
+// Re-assemble the 4-byte ASCII string into the matching commands
+void serial_interpret_command ( void )
+{
+	char c1 = ' ';
+
+	// an optional sequence number after the command ("WFWD #17") asks for acknowledgements
+	command_seq_valid = 0;
+	command_seq = 0;
+
+	// we have a new command, get characters
+	for ( uint8 i=0; i<4; i++ )
+	{
+		// get next character from queue, unless the sequence number has started
+		c1 = command_seq_valid ? ' ' : serial_get_queue();
+		if ( c1 >= 'a' && c1 <= 'z' ) c1 = toupper(c1); // convert to upper case if required
+		if ( c1 == 0xFF && i>0 ) c1 = ' ';				// pad with blanks 
+		if ( c1 == '#' ) {
+			command_seq_valid = 1;
+			c1 = ' ';
+		}
+		command[i] = c1;
+	}
+	command[4] = 0x00;			// finish the string
+	
+	// read the sequence number and flush the queue in case we received more than 4 bytes
+	do
+	{
+		// need to do it once even for 4 bytes to get rid of the 0xFF marking the end of string
+		c1 = serial_get_queue();
+		if ( c1 == '#' ) {
+			command_seq_valid = 1;
+		} else if ( command_seq_valid == 1 && c1 >= '0' && c1 <= '9' ) {
+			command_seq = command_seq * 10 + (c1 - '0');
+		} else if ( command_seq_valid == 1 && c1 != ' ' ) {
+			// anything after the number is ignored
+			command_seq_valid = 2;
+		}
+	} while (serial_get_qstate() != 0);
+	
+	// see if the string matches a known command
+	command_match_string();
+	
+	// reset the flag
+	flag_receive_ready = 0;
+
+	// acknowledge the command has been parsed
+	if ( command_seq_valid ) {
+		serial_ackParsed();
+	}
+
+	// finally echo the command and write new command prompt
+	if ( bioloid_command == COMMAND_MOTIONPAGE ) {
+		log_printf( "%s - MotionPageCommand %i\n> ", command, next_motion_page );
+	} else if( bioloid_command != COMMAND_NOT_FOUND ) {
+		log_printf( "%s - Command # %i\n> ", command, bioloid_command );
+	} else {
+		log_printf( "%s - Unknown Command! \n> ", command );
+	}
+}
+
+// send the parse acknowledgement for a command with a sequence number
+// the start acknowledgement follows when the command takes effect
+void serial_ackParsed(void)
+{
+	// a command that never started has been replaced by this one
+	serial_ackDropped();
+	log_printf( "!ACK %u P %lu\n", command_seq, micros() );
+	if ( bioloid_command == COMMAND_NOT_FOUND ) {
+		log_printf( "!ACK %u X %lu\n", command_seq, micros() );
+		return;
+	}
+	ack_pending = 1;
+	ack_seq = command_seq;
+	ack_command = bioloid_command;
+}
+
+// acknowledge that the last command with a sequence number has taken effect
+// Input:	(uint8)	command that has just started, a different command means
+//					the one waiting for acknowledgement was dropped
+void serial_ackStarted(uint8 command)
+{
+	if ( !ack_pending ) {
+		return;
+	}
+	if ( command != ack_command ) {
+		serial_ackDropped();
+		return;
+	}
+	ack_pending = 0;
+	log_printf( "!ACK %u S %lu\n", ack_seq, micros() );
+}
+
+// acknowledge that the last command with a sequence number won't be executed
+void serial_ackDropped(void)
+{
+	if ( !ack_pending ) {
+		return;
+	}
+	ack_pending = 0;
+	log_printf( "!ACK %u X %lu\n", ack_seq, micros() );
+}
+
+// function to match received strings to known commands
+void command_match_string ( void )
+{
+	int match;
+
+	// loop over all known commands to find a match
+	for (uint8 i=0; i<NUMBER_OF_COMMANDS; i++)
+	{
+		// the command strings sit in PROGMEM - so need to use pgmspace.h macros
+		strcpy_P(buffer, (PGM_P)pgm_read_word(&(COMMANDSTR_POINTER[i])));
+		match = strcmp(	buffer, command	);
+		if ( match == 0 )
+		{
+			// we found a match set the command
+			last_bioloid_command = bioloid_command;
+			bioloid_command = i;
+			break;
+		}
+		
+		// if we get to end of loop we haven't found a match
+		if ( i== NUMBER_OF_COMMANDS-1 )
+		{
+			last_bioloid_command = bioloid_command;
+			// 0xFF means no match found
+			bioloid_command = COMMAND_NOT_FOUND;
+		}
+	}
+		
+	// find the motion page associated with the command
+	if ( bioloid_command != COMMAND_NOT_FOUND && bioloid_command != COMMAND_STOP )
+	{
+		next_motion_page = command_getMotionPage(bioloid_command);
+	}
+	
+	// before we leave we need to check for special case of Motion Page command
+	if( bioloid_command == COMMAND_NOT_FOUND )
+	{
+		if ( command[0] == 'M' && (command[1] >= '0' && command[1] <= '9') )
+		{
+			// we definitely have a motion page, find the number
+			bioloid_command = COMMAND_MOTIONPAGE;
+			next_motion_page = command[1] - 48;	// converts ASCII to number
+			// check if next character is still a number
+			if ( command[2] >= '0' && command[2] <= '9' )
+			{
+				next_motion_page = next_motion_page * 10;
+				next_motion_page += (command[2]-48);
+			}
+			// check if next character is still a number
+			if ( command[3] >= '0' && command[3] <= '9' )
+			{
+				next_motion_page = next_motion_page * 10;
+				next_motion_page += (command[3]-48);
+			}
+		}
+	}
+
+	// check for special case of wait commands
+	if( bioloid_command == COMMAND_NOT_FOUND )
+	{
+		if ( command[0] == 'W' && (command[1] >= '0' && command[1] <= '9') )
+		{
+			// we have a wait milliseconds command, find the number
+			bioloid_command = COMMAND_WAIT_MILLISECONDS;
+			next_motion_page = command[1] - 48;	// converts ASCII to number
+			// check if next character is still a number
+			if ( command[2] >= '0' && command[2] <= '9' )
+			{
+				next_motion_page = next_motion_page * 10;
+				next_motion_page += (command[2]-48);
+			}
+			// check if next character is still a number
+			if ( command[3] >= '0' && command[3] <= '9' )
+			{
+				next_motion_page = next_motion_page * 10;
+				next_motion_page += (command[3]-48);
+			}
+		}		
+	} 
+	else if ( command[0] == 'W' && command[1] == 'S' && (command[2] >= '0' && command[2] <= '9') )
+	{
+		// we have a wait seconds command, find the number
+		bioloid_command = COMMAND_WAIT_SECONDS;
+		next_motion_page = command[2] - 48;	// converts ASCII to number
+		// check if next character is still a number
+		if ( command[3] >= '0' && command[3] <= '9' )
+		{
+			next_motion_page = next_motion_page * 10;
+			next_motion_page += (command[3]-48);
+		}
+		// convert to milliseconds
+		next_motion_page = 1000 * next_motion_page;
+	}
+
+}
+
+// find the motion page associated with a command
+// Input:	(uint8)	command as defined in global.h
+// Returns:	(uint8)	motion page to start the command with (0 if none)
+uint8 command_getMotionPage( uint8 command )
+{
+	// all walk command motion pages are in sequence and 12 pages apart each
+	if ( command >= COMMAND_WALK_FORWARD && command < COMMAND_WALK_READY )
+	{
+		return 12*(command-1) + COMMAND_WALK_READY_MP + 1;
+	}
+	
+	// cross-check against the definitions in global.h
+	switch ( command )
+	{
+		case COMMAND_WALK_READY:
+		return COMMAND_WALK_READY_MP;
+		case COMMAND_SIT:
+		return COMMAND_SIT_MP;
+		case COMMAND_STAND:
+		return COMMAND_STAND_MP;
+		case COMMAND_BALANCE:
+		return COMMAND_BALANCE_MP;
+		case COMMAND_BACK_GET_UP:
+		return COMMAND_BACK_GET_UP_MP;
+		case COMMAND_FRONT_GET_UP:
+		return COMMAND_FRONT_GET_UP_MP;
+		case COMMAND_RESET:
+		return COMMAND_RESET_MP;
+		default:
+		return 0;
+	}
+}
+
+// change the baud rate of the serial port (double speed mode, 2MHz base clock)
+void serial_setBaudrate(long baudrate)
+{
+	unsigned short Divisor;
+
+	Divisor = (unsigned short)(2000000.0 / baudrate) - 1;
+	hal_uartSetDivisor(HAL_UART_PC, Divisor);
+}
+
+// clear the receive buffer
+void serial_clear(void)
+{
+	gbSerialBufferHead = gbSerialBufferTail;
+}
+
+// write out a data string to the serial port
+// waits for logged output to finish first so the data is not interleaved
+// return the number of bytes sent
+int serial_write( unsigned char *pData, int numbyte )
+{
+	int count;
+
+	log_flush();
+	for( count=0; count<numbyte; count++ )
+	{
+		// wait for the data register to empty before writing the next byte
+		hal_uartSend(HAL_UART_PC, pData[count]);
+	}
+	return count;
+}
+
+// read a data string from the serial port
+unsigned char serial_read( unsigned char *pData, int numbyte )
+{
+	int count, numgetbyte;
+	
+	// buffer is empty, nothing to read 
+	if( gbSerialBufferHead == gbSerialBufferTail )
+		return 0;
+	
+	// check number of bytes requested does not exceed whats in the buffer
+	numgetbyte = serial_get_qstate();
+	if( numgetbyte > numbyte )
+		numgetbyte = numbyte;
+	
+	for( count=0; count<numgetbyte; count++ )
+		pData[count] = serial_get_queue();
+	
+	// return how many bytes have been read
+	return numgetbyte;
+}
+
+// get the number of bytes in the buffer
+// the size is a power of 2, so the indices wrap with a mask
+int serial_get_qstate(void)
+{
+	return (gbSerialBufferTail - gbSerialBufferHead) & (MAXNUM_SERIALBUFF-1);
+}
+
+// puts a received byte into the buffer
+void serial_put_queue( unsigned char data )
+{
+	unsigned char next = (gbSerialBufferTail + 1) & (MAXNUM_SERIALBUFF-1);
+
+	// buffer is full, character is ignored
+	if( next == gbSerialBufferHead )
+		return;
+		
+	// append the received byte to the buffer and move the tail by one byte
+	gbSerialBuffer[gbSerialBufferTail] = data;
+	gbSerialBufferTail = next;
+}
+
+// get a byte out of the buffer
+unsigned char serial_get_queue(void)
+{
+	unsigned char data;
+	
+	// buffer is empty, return 0xFF
+	if( gbSerialBufferHead == gbSerialBufferTail )
+		return 0xff;
+		
+	// buffer not empty, return next byte and move the head by one byte
+	data = gbSerialBuffer[gbSerialBufferHead];
+	gbSerialBufferHead = (gbSerialBufferHead + 1) & (MAXNUM_SERIALBUFF-1);
+		
+	return data;
+}
+
+// queue an echoed character for the transmit ISR
+// called from the receive ISR, the character is dropped if the buffer is full
+void serial_echo( unsigned char c )
+{
+	unsigned char next;
+	
+	if ( serial_quiet )
+		return;
+	next = (serialEchoTail + 1) % SERIAL_ECHO_BUFF;
+	if ( next == serialEchoHead )
+		return;
+	serialEchoBuffer[serialEchoTail] = c;
+	serialEchoTail = next;
+	serial_startTransmit();
+}
+
+// switch echo and log output off (or back on) while robots share the link
+void serial_setQuiet(uint8 quiet)
+{
+	serial_quiet = quiet;
+	log_setEnabled( !quiet );
+}
+
+// enable the transmit interrupt, it disables itself when there is nothing to send
+void serial_startTransmit(void)
+{
+	hal_uartEnable(HAL_UART_PC, HAL_UART_TX_EMPTY);
+}
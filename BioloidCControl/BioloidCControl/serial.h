@@ -1,69 +1,106 @@
-/*
- * Serial.h - Functions for the serial port PC interface on the 
- * Robotis CM-510 controller. 
- * Can either use serial cable or Zig2Serial via Zig-110
- *
- * Based on the embedded C library provided by Robotis  
- * Version 0.7		31/01/2013
- * Modified by Peter Lanius
- * Please send suggestions and bug fixes to PeterLanius@gmail.com
- * 
-*/
-
-#ifndef _SERIAL_H_
-#define _SERIAL_H_
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-// Define which mode of transport is used
-// Use SERIAL_CABLE for Rs-232 cable from USB2Dynamixel to CM-510
-// Use ZIG_2_SERIAL for Zig-110 to Zig2Serial attached to USB2Dynamixel
-// Use RC100 for RC-100 remote control with Zig-110
-#define SERIAL_CABLE
-// #define ZIG_2_SERIAL
-// #define RC100
-
-#ifdef	SERIAL_CABLE
-  #define MAXNUM_SERIALBUFF	256 // maximum 256byte string (cable)
-#else
-  #define MAXNUM_SERIALBUFF	256 // maximum 256byte string (Zig2Serial/RC-100)
-#endif
-#define DEFAULT_BAUDRATE	34  // 57132(57600)bps
-
-// ZIGBEE
-#ifdef ZIG_2_SERIAL
-  // Going by the CM-5/CM-700 schematic on the Robotis support site
-  // ZIG-100 power/reset control is PORTD PIN4 and should be an output
-  #define ZIG110_RESET	{ DDRD |= 0x10; PORTD |= 0x10; _delay_ms(10); PORTD &= ~0x10; }
-  #define ZIG110_DOWN	{ DDRD |= 0x10; PORTD |= 0x10; }
-  #define ZIG110_UP		{ DDRD |= 0x10; PORTD &= ~0x10; }
-#endif
-
-// Top level serial port task
-// manages all requests to read from or write to the serial port
-// Receives commands from the serial port and writes output (excluding printf)
-// Checks the status flag provided by the ISR for operation
-// Returns:  int flag = 0 when no new command has been received
-//           int flag = 1 when new command has been received
-int serialReceiveCommand();
-
-// Serial Port initialization with the specified baud rate
-void serial_init(long baudrate);
-
-// write out a data string to the serial port
-// return the number of bytes sent
-int serial_write( unsigned char *pData, int numbyte );
-
-// read a string from the serial port
-unsigned char serial_read( unsigned char *pData, int numbyte );
-
-// get the status of the input/output queue
-int serial_get_qstate(void);
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif /* SERIAL_H_ */
+/*
+ * Serial.h - Functions for the serial port PC interface on the 
+ * Robotis CM-510 controller. 
+ * Can either use serial cable or Zig2Serial via Zig-110
+ *
+ * Based on the embedded C library provided by Robotis  
+ * Version 0.7		31/01/2013
+ * Modified by Peter Lanius
+ * Please send suggestions and bug fixes to PeterLanius@gmail.com
+ * 
+*/
+
+#ifndef _SERIAL_H_
+#define _SERIAL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Define which mode of transport is used
+// Use SERIAL_CABLE for Rs-232 cable from USB2Dynamixel to CM-510
+// Use ZIG_2_SERIAL for Zig-110 to Zig2Serial attached to USB2Dynamixel
+// Use RC100 for RC-100 remote control with Zig-110
+#define SERIAL_CABLE
+// #define ZIG_2_SERIAL
+// #define RC100
+
+// receive buffer, power of 2 (up to 256 bytes)
+#ifdef	SERIAL_CABLE
+  #define MAXNUM_SERIALBUFF	128 // commands and bridged packets (cable)
+#else
+  #define MAXNUM_SERIALBUFF	64  // RC-100 packets are 6 bytes (Zig2Serial/RC-100)
+#endif
+#define DEFAULT_BAUDRATE	34  // 57132(57600)bps
+#define SERIAL_ECHO_BUFF	8	// echoed characters waiting to be sent
+
+// ZIGBEE
+#ifdef ZIG_2_SERIAL
+  // Going by the CM-5/CM-700 schematic on the Robotis support site
+  // ZIG-100 power/reset control is PORTD PIN4 and should be an output
+  #define ZIG110_RESET	{ DDRD |= 0x10; PORTD |= 0x10; _delay_ms(10); PORTD &= ~0x10; }
+  #define ZIG110_DOWN	{ DDRD |= 0x10; PORTD |= 0x10; }
+  #define ZIG110_UP		{ DDRD |= 0x10; PORTD &= ~0x10; }
+#endif
+
+// Top level serial port task
+// manages all requests to read from or write to the serial port
+// Receives commands from the serial port and writes output (excluding log output)
+// Checks the status flag provided by the ISR for operation
+// Returns:  int flag = 0 when no new command has been received
+//           int flag = 1 when new command has been received
+int serialReceiveCommand();
+
+// Command acknowledgements
+// A command followed by a sequence number, e.g. "WFWD #17", is acknowledged
+// twice with the micros() time stamp of the controller:
+//   !ACK 17 P 12345678		command has been parsed
+//   !ACK 17 S 12350120		command has taken effect - motion commands when the
+//							first goal position is written, others when handled
+// or with X instead of S if the command was unknown, refused or replaced by
+// another command before it started. Commands without a number get no ACKs.
+// The S/X lines can follow the command prompt, so look for "!ACK" anywhere.
+
+// acknowledge that the last command with a sequence number has taken effect
+// Input:	(uint8)	command that has just started, a different command means
+//					the one waiting for acknowledgement was dropped
+void serial_ackStarted(uint8 command);
+
+// acknowledge that the last command with a sequence number won't be executed
+void serial_ackDropped(void);
+
+// find the motion page associated with a command
+// Input:	(uint8)	command as defined in global.h
+// Returns:	(uint8)	motion page to start the command with (0 if none)
+uint8 command_getMotionPage( uint8 command );
+
+// Serial Port initialization with the specified baud rate
+void serial_init(long baudrate);
+
+// change the baud rate of the serial port
+void serial_setBaudrate(long baudrate);
+
+// clear the receive buffer
+void serial_clear(void);
+
+// switch echo and log output off (or back on) while robots share the link
+void serial_setQuiet(uint8 quiet);
+
+// enable the transmit interrupt, it disables itself when there is nothing to send
+void serial_startTransmit(void);
+
+// write out a data string to the serial port
+// return the number of bytes sent
+int serial_write( unsigned char *pData, int numbyte );
+
+// read a string from the serial port
+unsigned char serial_read( unsigned char *pData, int numbyte );
+
+// get the status of the input/output queue
+int serial_get_qstate(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SERIAL_H_ */
@@ -0,0 +1,124 @@
+/*
+ * stack.c - Stack painting and high-water monitoring
+ *   Paints the free RAM in the start-up code, scans it for the deepest
+ *   stack use and reports it (STAK command, event trace).
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <avr/io.h>
+#include "global.h"
+#include "log.h"
+#include "trace.h"
+#include "watchdog.h"
+#include "stack.h"
+
+// end of the variables (.data, .bss, .noinit), set by the linker
+extern uint8 __heap_start;
+
+#define STACK_BOTTOM	(&__heap_start)
+#define STACK_TOP		((uint8 *) RAMEND)
+
+// lowest byte the stack has used so far and the progress of the scan
+static uint8 *stack_mark = STACK_TOP;
+static uint8 *stack_scan = STACK_BOTTOM;
+
+// internal function prototypes
+static uint8 stack_scanBytes(uint16 count);
+void stack_paint(void) __attribute__((naked)) __attribute__((section(".init3")));
+
+
+// runs before main: fill the RAM between the variables and the stack
+// pointer with the pattern (the stack is still empty here)
+void stack_paint(void)
+{
+	__asm__ __volatile__ (
+	"   ldi r30, lo8(__heap_start)      \n"
+	"   ldi r31, hi8(__heap_start)      \n"
+	"   ldi r24, %[paint]               \n"
+	"   in  r26, __SP_L__               \n"
+	"   in  r27, __SP_H__               \n"
+	"   rjmp 2f                         \n"
+	"1: st  Z+, r24                     \n"
+	"2: cp  r30, r26                    \n"
+	"   cpc r31, r27                    \n"
+	"   brlo 1b                         \n"
+	:
+	: [paint] "M" (STACK_PAINT)
+	: "r24", "r26", "r27", "r30", "r31", "memory"
+	);
+}
+
+// scan part of the stack area and update the high-water mark, a fault if
+// the stack has reached the guard bytes
+void stack_check()
+{
+	uint8 *p;
+
+	if ( stack_scanBytes(STACK_SCAN_BYTES) ) {
+		TRACE(TRACE_STACK, (uint32) (STACK_TOP + 1 - stack_mark) * 100 / stack_getSize(), STACK_TOP + 1 - stack_mark);
+	}
+	// the guard bytes are checked on every call
+	for (p = STACK_BOTTOM; p < STACK_BOTTOM + STACK_GUARD; p++) {
+		if ( *p != STACK_PAINT ) {
+			watchdog_fault(WATCHDOG_STACK, WATCHDOG_NO_TASK);
+		}
+	}
+}
+
+// Returns:	(uint16) size of the area between the variables and the top of RAM (bytes)
+uint16 stack_getSize()
+{
+	return STACK_TOP + 1 - STACK_BOTTOM;
+}
+
+// scans the whole area and updates the high-water mark
+// Returns:	(uint16) deepest stack use since start-up (bytes)
+uint16 stack_getHighWater()
+{
+	// a new mark restarts the scan, it can only move down
+	stack_scan = STACK_BOTTOM;
+	while ( stack_scanBytes(0xFFFF) );
+	return STACK_TOP + 1 - stack_mark;
+}
+
+// print the stack use (STAK command)
+void stack_report()
+{
+	uint16 used = stack_getHighWater();
+	uint16 size = stack_getSize();
+
+	log_printf("\nStack used max %u of %u bytes, %u never used", used, size, size - used);
+	log_printf("\nVariables end at 0x%04X, stack pointer 0x%04X\n", (uint16) STACK_BOTTOM, SP);
+}
+
+// check up to count bytes from the scan position towards the mark, the
+// first one that doesn't hold the pattern is the new mark
+// Returns:	(uint8) 1 if the mark has moved
+static uint8 stack_scanBytes(uint16 count)
+{
+	uint8 *p = stack_scan;
+
+	while ( count-- > 0 && p < stack_mark ) {
+		if ( *p != STACK_PAINT ) {
+			stack_mark = p;
+			stack_scan = STACK_BOTTOM;
+			return 1;
+		}
+		p++;
+	}
+	// the whole area below the mark is unused, start again at the bottom
+	stack_scan = ( p < stack_mark ) ? p : STACK_BOTTOM;
+	return 0;
+}
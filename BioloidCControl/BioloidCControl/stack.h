@@ -0,0 +1,76 @@
+/*
+ * stack.h - Stack painting and high-water monitoring
+ *   Fills the free RAM between the variables and the stack with a pattern
+ *   before main() and watches how much of it the stack has used since.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Operation
+ *
+ * The start-up code (.init3) paints every byte from __heap_start (the end
+ * of .data, .bss and .noinit) up to the stack pointer with STACK_PAINT.
+ * There is no heap (malloc is not used), so this is the room the stack can
+ * grow into. A byte that no longer holds the pattern has been used by the
+ * stack, the lowest such byte is the high-water mark.
+ *
+ * stack_check() is called from a low priority task and scans at most
+ * STACK_SCAN_BYTES per call from the bottom up to the current mark, a new
+ * lower mark is recorded in the event trace (TRACE_STACK) and the scan
+ * starts again. If the stack reaches the lowest STACK_GUARD bytes it is
+ * about to overwrite the variables: that is a watchdog fault (the servos
+ * are switched off and the controller resets, see watchdog.h).
+ *
+ * The STAK command scans the whole area and prints the deepest use, the
+ * size of the area and the bytes never used. The static estimate per call
+ * path from -fstack-usage is made by stack_budget.pl after every build.
+ *
+ * In the FreeRTOS build the tasks run on their own stacks (statically
+ * allocated in .bss, see rtos.h), this only covers start-up and the code
+ * that ran before the scheduler started.
+ */
+
+#ifndef STACK_H_
+#define STACK_H_
+
+#include "global.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define STACK_PAINT			0xC5	// pattern in unused stack bytes
+#define STACK_GUARD			32		// bytes above the variables the stack must not reach
+#define STACK_SCAN_BYTES	64		// bytes checked per call of stack_check
+
+// scan part of the stack area and update the high-water mark, a fault if
+// the stack has reached the guard bytes
+void stack_check(void);
+
+// Returns:	(uint16) size of the area between the variables and the top of RAM (bytes)
+uint16 stack_getSize(void);
+
+// scans the whole area and updates the high-water mark
+// Returns:	(uint16) deepest stack use since start-up (bytes)
+uint16 stack_getHighWater(void);
+
+// print the stack use (STAK command)
+void stack_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STACK_H_ */
@@ -0,0 +1,173 @@
+# Perl script to estimate the worst case stack use of BioloidCControl per
+# call path and check it against a budget. Runs as a post-build step after
+# ram_report.pl (see BioloidCControl.cproj), a path over budget fails the
+# build.
+#
+# Usage:	perl stack_budget.pl build_directory BioloidCControl.elf [budget]
+#
+# The stack frame of every function comes from the .su files gcc writes
+# with -fstack-usage, the calls from the disassembly of the program
+# (avr-objdump -d). Every call adds 3 bytes of return address (22 bit
+# program counter), an interrupt adds 3 bytes for the return address on
+# top of the frame of its ISR. Indirect calls are resolved with the task
+# tables in BioloidCControl.c: sched_dispatch calls the functions in
+# main_tasks, rtos_taskLoop those in rtos_tasks.
+#
+# Worst case = deepest path from main + deepest ISR path (interrupts don't
+# nest, all ISRs run with interrupts disabled).
+# Functions without stack data (C library, assembler) count as 0 and are
+# listed, so are recursive calls (counted once) and unresolved indirect
+# calls. Treat the result as an estimate and compare it with the high-water
+# mark the STAK command reports on the robot (see stack.h).
+#
+# The default budget is the RAM between the variables and the top of the
+# SRAM less STACK_GUARD bytes (stack.h).
+#
+# Version: 0.9
+#
+use strict;
+use warnings;
+use File::Basename;
+
+# these need to match the ATmega2561 and stack.h
+my $ramend = 0x21FF;
+my $return_address = 3;
+my $stack_guard = 32;
+
+my $objdump_tool = 'avr-objdump';
+my $nm_tool = 'avr-nm';
+my $source_dir = dirname($0);
+
+# quit unless we have the correct number of command-line args
+my $num_args = $#ARGV + 1;
+if ($num_args < 2 || $num_args > 3) {
+	print "\nNumber of arguments: $num_args\n";
+	print "\nUsage: stack_budget.pl build_directory BioloidCControl.elf [budget] \n";
+	exit 1;
+}
+my ($dir, $elf_file, $budget) = @ARGV;
+print "\nStack Budget Program: $elf_file\n";
+
+# stack frames from the .su files: file:line:column:function<tab>bytes<tab>qualifier
+my %frames;
+my %dynamic;
+foreach my $su_file (glob("$dir/*.su")) {
+	open(my $su, '<', $su_file) or die "Can't open $su_file: $!";
+	while (my $line = <$su>) {
+		next unless ($line =~ /:([^:\s]+)\t(\d+)\t(\w+)/);
+		$frames{$1} = $2 if (!exists $frames{$1} || $2 > $frames{$1});
+		$dynamic{$1} = 1 if ($3 ne 'static');
+	}
+	close $su;
+}
+if (!%frames) {
+	print "No .su files in $dir, compile with -fstack-usage.\n";
+	exit 1;
+}
+
+# call graph from the disassembly
+my %calls;			# function => { callee => return address bytes }
+my %indirect;		# functions with icall/eicall
+my %recursive;		# functions that call themselves or a caller
+my $function = '';
+foreach my $line (`$objdump_tool -d "$elf_file"`) {
+	if ($line =~ /^[0-9a-f]+ <([^>+]+)>:/) {
+		$function = $1;
+		$calls{$function} //= {};
+	} elsif ($function ne '' && $line =~ /\t(r?call|e?icall|r?jmp)\b[^<]*(?:<([^>+]+)>)?/) {
+		my ($op, $target) = ($1, $2);
+		if ($op =~ /icall/) {
+			$indirect{$function} = 1;
+		} elsif (defined $target && $target eq $function) {
+			$recursive{$function} = 1 if ($op =~ /call/);
+		} elsif (defined $target) {
+			# a jump to the start of another function is a tail call
+			my $bytes = ($op =~ /call/) ? $return_address : 0;
+			$calls{$function}{$target} = $bytes if (($calls{$function}{$target} // -1) < $bytes);
+		}
+	}
+}
+die "$objdump_tool failed on $elf_file\n" if ($? != 0 || !%calls);
+
+# indirect calls of the schedulers
+my %task_tables = ( 'main_tasks' => 'sched_dispatch', 'rtos_tasks' => 'rtos_taskLoop' );
+if (open(my $src, '<', "$source_dir/BioloidCControl.c")) {
+	my $caller = '';
+	while (my $line = <$src>) {
+		if ($line =~ /\b(\w+)\[[^\]]*\]\s+PROGMEM\s*=\s*\{/ && exists $task_tables{$1}) {
+			$caller = $task_tables{$1};
+		} elsif ($caller ne '' && $line =~ /^\s*\{\s*(\w+)\s*,/) {
+			$calls{$caller}{$1} = $return_address;
+		} elsif ($line =~ /^\s*\};/) {
+			$caller = '';
+		}
+	}
+	close $src;
+	delete $indirect{$_} foreach (values %task_tables);
+}
+
+# deepest path from a function
+my %depth;			# function => [ bytes, path ]
+my %visiting;
+my %no_data;
+sub deepest {
+	my ($f) = @_;
+	return @{$depth{$f}} if (exists $depth{$f});
+	if ($visiting{$f}) {
+		$recursive{$f} = 1;
+		return (0, "$f (recursive)");
+	}
+	$visiting{$f} = 1;
+	my $frame = $frames{$f};
+	if (!defined $frame) {
+		$frame = 0;
+		$no_data{$f} = 1 if (exists $calls{$f} && $f !~ /^__/);
+	}
+	my ($max, $path) = (0, '');
+	foreach my $callee (sort keys %{$calls{$f} || {}}) {
+		my ($bytes, $callee_path) = deepest($callee);
+		$bytes += $calls{$f}{$callee};
+		if ($bytes > $max) {
+			($max, $path) = ($bytes, $callee_path);
+		}
+	}
+	delete $visiting{$f};
+	$depth{$f} = [ $frame + $max, ($path eq '') ? "$f($frame)" : "$f($frame) > $path" ];
+	return @{$depth{$f}};
+}
+
+# main and the interrupt service routines
+my ($main_bytes, $main_path) = deepest('main');
+my ($isr_bytes, $isr_path, $isr_name) = (0, '', '');
+printf "\n%-24s %6s  %s\n", 'Entry', 'bytes', 'deepest path (frame bytes)';
+printf "%-24s %6i  %s\n", 'main', $main_bytes, $main_path;
+foreach my $isr (sort grep { /^__vector_\d+$/ } keys %calls) {
+	my ($bytes, $path) = deepest($isr);
+	$bytes += $return_address;
+	printf "%-24s %6i  %s\n", $isr, $bytes, $path;
+	($isr_bytes, $isr_path, $isr_name) = ($bytes, $path, $isr) if ($bytes > $isr_bytes);
+}
+
+print "\nNo stack data (counted as 0): " . join(' ', sort keys %no_data) . "\n" if (%no_data);
+print "Dynamic stack frames: " . join(' ', sort grep { $dynamic{$_} } keys %dynamic) . "\n" if (%dynamic);
+print "Recursive calls (counted once): " . join(' ', sort keys %recursive) . "\n" if (%recursive);
+print "Unresolved indirect calls in: " . join(' ', sort keys %indirect) . "\n" if (%indirect);
+
+# default budget: the RAM above the variables less the guard bytes
+if (!defined $budget) {
+	foreach my $line (`$nm_tool "$elf_file"`) {
+		if ($line =~ /^00([0-9a-f]{6}) \w __heap_start$/) {
+			$budget = $ramend + 1 - (hex($1) & 0xFFFF) - $stack_guard;
+		}
+	}
+	die "No __heap_start in $elf_file, give the budget on the command line\n" if (!defined $budget);
+}
+
+my $worst = $main_bytes + $isr_bytes;
+printf "\nWorst case %i bytes (main %i + %s %i), budget %i bytes\n", $worst, $main_bytes, $isr_name || 'no ISR', $isr_bytes, $budget;
+if ($worst > $budget) {
+	print STDERR "Stack budget exceeded by " . ($worst - $budget) . " bytes.\n";
+	exit 1;
+}
+printf "%i bytes to spare.\n", $budget - $worst;
+exit 0;
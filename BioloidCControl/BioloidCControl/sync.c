@@ -0,0 +1,507 @@
+/*
+ * sync.c - Clock synchronisation for several robots sharing one ZigBee
+ *   (Zig2Serial) or serial link. The master broadcasts its clock, the
+ *   followers estimate offset and drift (see sync.h for the protocol).
+ *   The clock and frame functions only work on the structs passed to them,
+ *   so the host simulation can run several robots with the same code.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "global.h"
+#include "sync.h"
+#include "clock.h"
+#include "serial.h"
+#include "log.h"
+#include "motion_f.h"
+
+// module state
+static uint8 sync_role = SYNC_OFF;
+static sync_clock sync_clk;
+static unsigned long sync_last_millis = 0;	// last value of sync_millis()
+
+// receive side, the ISR hands complete samples to sync_task
+static sync_decoder sync_rx;
+static volatile uint8 sync_sample_ready = 0;
+static uint32 sync_sample_ms;
+static uint16 sync_sample_us;
+static uint32 sync_sample_local;
+
+// transmit side (master)
+static uint8 sync_tx_frame[SYNC_FRAME_LENGTH];
+static volatile uint8 sync_tx_pending = 0;	// frame is ready to go
+static volatile uint8 sync_tx_index = 0;	// next byte of the frame being sent
+static volatile uint32 sync_tx_stamp;		// micros() when the last start byte was sent
+static uint8 sync_tx_seq = 0;
+static unsigned long sync_last_tx = 0;
+
+// start boundary for a new command
+static uint8 sync_start_pending = 0;
+static unsigned long sync_start_time = 0;
+
+// global variables
+extern uint8 motion_state;
+
+// internal function prototypes
+static void sync_report(void);
+static void sync_resetStatistics(sync_clock *clock);
+
+
+// set the clock to the given master time at the given local time
+void sync_clockSet(sync_clock *clock, uint32 ms, uint16 us, uint32 local)
+{
+	clock->ref_ms = ms + us / 1000;
+	clock->ref_us = us % 1000;
+	clock->ref_local = local;
+}
+
+// read the master time at a given local time
+// local may be up to 35 minutes before or after the reference point
+void sync_clockRead(const sync_clock *clock, uint32 local, uint32 *ms, uint16 *us)
+{
+	int32 dt, total;
+	uint32 borrow, result;
+
+	dt = (int32)(local - clock->ref_local);
+	// rate correction, rounded, exact up to 2^18us and within 2us beyond that
+	// (2^18 * SYNC_MAX_DRIFT + 2^23 stays below 2^31)
+	if ( dt < (1L << 18) && dt > -(1L << 18) ) {
+		total = (dt * clock->drift + (1L << 23)) >> 24;
+	} else {
+		total = ((dt >> 13) * clock->drift + (1L << 10)) >> 11;
+	}
+	total += dt + clock->ref_us;
+
+	result = clock->ref_ms;
+	if ( total < 0 ) {
+		borrow = ((uint32)(-total) + 999) / 1000;
+		result -= borrow;
+		total += borrow * 1000;
+	}
+	*ms = result + (uint32) total / 1000;
+	*us = (uint32) total % 1000;
+}
+
+// move the reference point forward to keep the arithmetic in range
+void sync_clockRebase(sync_clock *clock, uint32 local)
+{
+	uint32 ms;
+	uint16 us;
+
+	sync_clockRead(clock, local, &ms, &us);
+	sync_clockSet(clock, ms, us, local);
+}
+
+// correct the clock with a sample of the master time
+// can_step - 0 if the clock must not jump (robot is moving)
+// Returns:	(uint8)	SYNC_SAMPLE_OK, _STEP, _OUTLIER or _SKIPPED
+uint8 sync_clockUpdate(sync_clock *clock, uint32 ms, uint16 us, uint32 local, uint8 can_step)
+{
+	uint32 est_ms, interval;
+	uint16 est_us;
+	int32 diff, error, total;
+
+	if ( clock->locked )
+	{
+		// error of the current estimate, anything beyond 2s is just "too big"
+		sync_clockRead(clock, local, &est_ms, &est_us);
+		diff = (int32)(ms - est_ms);
+		if ( diff > 2000 || diff < -2000 ) {
+			error = 2000000;
+		} else {
+			error = diff * 1000 + (int32) us - (int32) est_us;
+		}
+
+		if ( error <= SYNC_OUTLIER_US && error >= -SYNC_OUTLIER_US )
+		{
+			// offset: take part of the error
+			clock->outliers = 0;
+			total = (int32) est_us + error / SYNC_PHASE_GAIN;
+			while ( total < 0 ) {
+				total += 1000;
+				est_ms--;
+			}
+			sync_clockSet(clock, est_ms, (uint16) total, local);
+
+			// drift: a small part of the error rate, 16777 = 2^24/1000
+			interval = (local - clock->last_sample) / 1000;
+			if ( interval == 0 ) {
+				interval = 1;
+			}
+			clock->drift += (error * 16777L) / (int32) interval / SYNC_DRIFT_GAIN;
+			if ( clock->drift > SYNC_MAX_DRIFT ) {
+				clock->drift = SYNC_MAX_DRIFT;
+			} else if ( clock->drift < -SYNC_MAX_DRIFT ) {
+				clock->drift = -SYNC_MAX_DRIFT;
+			}
+			clock->last_sample = local;
+
+			// statistics
+			clock->last_error = error;
+			if ( error < 0 ) {
+				error = -error;
+			}
+			clock->error_sum += error;
+			if ( (uint32) error > clock->error_max ) {
+				clock->error_max = error;
+			}
+			clock->samples++;
+			return SYNC_SAMPLE_OK;
+		}
+
+		// ignore single outliers, step the clock if they keep coming
+		clock->ignored++;
+		if ( clock->outliers < SYNC_OUTLIER_LIMIT ) {
+			clock->outliers++;
+		}
+		if ( clock->outliers < SYNC_OUTLIER_LIMIT ) {
+			return SYNC_SAMPLE_OUTLIER;
+		}
+	}
+
+	// first sample or lost track - set the clock
+	if ( !can_step ) {
+		return SYNC_SAMPLE_SKIPPED;
+	}
+	sync_clockSet(clock, ms, us, local);
+	clock->last_sample = local;
+	clock->locked = 1;
+	clock->outliers = 0;
+	return SYNC_SAMPLE_STEP;
+}
+
+// build a sync frame carrying the master time of the previous frame
+void sync_encodeFrame(uint8 *frame, uint8 seq, uint32 ms, uint16 us)
+{
+	uint8 sum = 0;
+
+	frame[0] = SYNC_FRAME_START;
+	frame[1] = seq;
+	for (uint8 i=0; i<4; i++) {
+		frame[2+i] = (uint8)(ms >> (8 * i));
+	}
+	frame[6] = (uint8) us;
+	frame[7] = (uint8)(us >> 8);
+	for (uint8 i=1; i<SYNC_FRAME_LENGTH-1; i++) {
+		sum += frame[i];
+	}
+	frame[SYNC_FRAME_LENGTH-1] = sum;
+}
+
+// feed one received byte to the frame decoder
+// now - local micros() when the byte arrived
+// Returns:	(int8)	-1 - byte is not part of a sync frame
+//					 0 - byte belongs to a frame that is incomplete, invalid or
+//						 can't be used
+//					 1 - sample complete: master time (including the link delay)
+//						 in ms/us at local time local
+int8 sync_decodeByte(sync_decoder *decoder, uint8 c, uint32 now, uint32 *ms, uint16 *us, uint32 *local)
+{
+	uint8 sum, seq, consecutive;
+	uint32 master_ms;
+	uint16 master_us;
+
+	// a frame takes 1.6ms at 57600 baud, drop partial frames after a while
+	if ( decoder->index > 0 && (now - decoder->start_time) > SYNC_FRAME_TIMEOUT ) {
+		decoder->index = 0;
+	}
+
+	if ( decoder->index == 0 )
+	{
+		if ( c != SYNC_FRAME_START ) {
+			return -1;
+		}
+		decoder->start_time = now;
+		decoder->index = 1;
+		return 0;
+	}
+
+	decoder->data[decoder->index-1] = c;
+	decoder->index++;
+	if ( decoder->index < SYNC_FRAME_LENGTH ) {
+		return 0;
+	}
+	decoder->index = 0;
+
+	// check the frame
+	sum = 0;
+	for (uint8 i=0; i<SYNC_FRAME_LENGTH-2; i++) {
+		sum += decoder->data[i];
+	}
+	if ( sum != decoder->data[SYNC_FRAME_LENGTH-2] ) {
+		return 0;
+	}
+	seq = decoder->data[0];
+	master_ms = 0;
+	for (uint8 i=0; i<4; i++) {
+		master_ms |= (uint32) decoder->data[1+i] << (8 * i);
+	}
+	master_us = decoder->data[5] | (decoder->data[6] << 8);
+
+	// the time in this frame belongs to the start byte of the previous frame
+	consecutive = decoder->have_last && seq != 0 && seq == (uint8)(decoder->last_seq + 1);
+	*local = decoder->last_start;
+	decoder->last_start = decoder->start_time;
+	decoder->last_seq = seq;
+	decoder->have_last = 1;
+	if ( !consecutive || master_us > 999 ) {
+		return 0;
+	}
+
+	// the start byte arrived SYNC_LINK_DELAY_US after it was sent
+	master_us += SYNC_LINK_DELAY_US;
+	*ms = master_ms + master_us / 1000;
+	*us = master_us % 1000;
+	return 1;
+}
+
+// handle the sync commands (SYNM, SYNF, SYNQ, SYNX)
+void sync_command(uint8 command)
+{
+	if ( command == COMMAND_SYNC_STATUS ) {
+		sync_report();
+		return;
+	}
+
+	// the timebase of the motion engine must not change during a motion
+	if ( motion_state != MOTION_STOPPED ) {
+		log_printf("\nStop the robot before changing the sync mode.\n> ");
+		return;
+	}
+
+	cli();
+	sync_role = SYNC_OFF;
+	sync_tx_pending = 0;
+	sync_tx_index = 0;
+	sync_sample_ready = 0;
+	memset(&sync_rx, 0, sizeof(sync_rx));
+	sei();
+	memset(&sync_clk, 0, sizeof(sync_clk));
+	sync_start_pending = 0;
+
+	if ( command == COMMAND_SYNC_MASTER )
+	{
+		// the master's shared time is its own clock
+		sync_clockSet(&sync_clk, millis(), 0, micros());
+		sync_clk.locked = 1;
+		sync_last_millis = millis();
+		sync_tx_seq = 0;
+		sync_last_tx = millis() - SYNC_INTERVAL;	// first frame right away
+		log_printf("\nSync master - quiet until SYNX.\n");
+		log_flush();
+		serial_setQuiet(1);
+		sync_role = SYNC_MASTER;
+	}
+	else if ( command == COMMAND_SYNC_FOLLOWER )
+	{
+		log_printf("\nSync follower - quiet until SYNX.\n");
+		log_flush();
+		serial_setQuiet(1);
+		sync_role = SYNC_FOLLOWER;
+	}
+	else
+	{
+		serial_setQuiet(0);
+		log_printf("\nSync off.\n> ");
+	}
+}
+
+// sync task, call once per main loop pass (sends frames, processes samples)
+void sync_task()
+{
+	uint32 stamp, ms;
+	uint16 us;
+
+	if ( sync_role == SYNC_OFF ) {
+		return;
+	}
+
+	// keep the reference point recent
+	if ( (micros() - sync_clk.ref_local) >= SYNC_REBASE_US ) {
+		sync_clockRebase(&sync_clk, micros());
+	}
+
+	if ( sync_role == SYNC_MASTER )
+	{
+		// time for the next frame? the previous one has to be out first
+		if ( sync_tx_pending || sync_tx_index != 0 || (millis() - sync_last_tx) < SYNC_INTERVAL ) {
+			return;
+		}
+		sync_last_tx = millis();
+		ms = 0;
+		us = 0;
+		if ( sync_tx_seq != 0 ) {
+			// time of the start byte of the previous frame
+			cli();
+			stamp = sync_tx_stamp;
+			sei();
+			sync_clockRead(&sync_clk, stamp, &ms, &us);
+		}
+		sync_encodeFrame(sync_tx_frame, sync_tx_seq, ms, us);
+		// sequence number 0 is only used for the first frame
+		sync_tx_seq++;
+		if ( sync_tx_seq == 0 ) {
+			sync_tx_seq = 1;
+		}
+		sync_tx_pending = 1;
+		serial_startTransmit();
+	}
+	else if ( sync_sample_ready )
+	{
+		// the clock may only be stepped while the robot is stopped
+		if ( sync_clockUpdate(&sync_clk, sync_sample_ms, sync_sample_us, sync_sample_local, motion_state == MOTION_STOPPED) == SYNC_SAMPLE_STEP ) {
+			sync_last_millis = sync_sample_ms;
+		}
+		sync_sample_ready = 0;
+	}
+}
+
+// Returns:	(uint8)	1 if motions run on the shared timebase (master or locked follower)
+uint8 sync_isActive()
+{
+	return sync_role == SYNC_MASTER || (sync_role == SYNC_FOLLOWER && sync_clk.locked);
+}
+
+// Returns:	(unsigned long)	shared time in ms when active, otherwise millis()
+unsigned long sync_millis()
+{
+	uint32 ms;
+	uint16 us;
+
+	if ( !sync_isActive() ) {
+		return millis();
+	}
+	sync_clockRead(&sync_clk, micros(), &ms, &us);
+	// corrections can move the clock back a little, the motion timing needs it monotonic
+	if ( (long)(ms - sync_last_millis) < 0 ) {
+		ms = sync_last_millis;
+	}
+	sync_last_millis = ms;
+	return ms;
+}
+
+// hold back the start of a new command until the next start boundary
+// start - set to the boundary when the command can start
+// Returns:	(uint8)	1 - keep waiting, 0 - start now
+uint8 sync_waitForStart(uint8 command, unsigned long *start)
+{
+	unsigned long now;
+
+	// STOP is never held back and cancels a pending start
+	if ( command == COMMAND_STOP ) {
+		sync_start_pending = 0;
+		return 0;
+	}
+
+	now = sync_millis();
+	if ( !sync_start_pending ) {
+		sync_start_time = ((now + SYNC_START_MARGIN) / SYNC_START_GRID + 1) * SYNC_START_GRID;
+		sync_start_pending = 1;
+	}
+	if ( (long)(now - sync_start_time) < 0 ) {
+		return 1;
+	}
+	sync_start_pending = 0;
+	*start = sync_start_time;
+	return 0;
+}
+
+// called by the serial receive ISR with every byte
+// Returns:	(uint8)	1 if the byte was part of a sync frame
+uint8 sync_receiveByte(uint8 c)
+{
+	uint32 ms, local;
+	uint16 us;
+	int8 result;
+
+	if ( sync_role != SYNC_FOLLOWER ) {
+		return 0;
+	}
+	result = sync_decodeByte(&sync_rx, c, micros(), &ms, &us, &local);
+	if ( result < 0 ) {
+		return 0;
+	}
+	// keep the sample unless the last one hasn't been processed yet
+	if ( result == 1 && !sync_sample_ready ) {
+		sync_sample_ms = ms;
+		sync_sample_us = us;
+		sync_sample_local = local;
+		sync_sample_ready = 1;
+	}
+	return 1;
+}
+
+// called by the serial transmit ISR
+// Returns:	(int16)	next byte of a sync frame or -1 if none is being sent
+int16 sync_getTxByte()
+{
+	uint8 c;
+
+	if ( sync_tx_index == 0 )
+	{
+		if ( !sync_tx_pending ) {
+			return -1;
+		}
+		// the time stamp goes out with the next frame
+		sync_tx_pending = 0;
+		sync_tx_stamp = micros();
+	}
+	c = sync_tx_frame[sync_tx_index++];
+	if ( sync_tx_index >= SYNC_FRAME_LENGTH ) {
+		sync_tx_index = 0;
+	}
+	return c;
+}
+
+// print the synchronisation status (output is enabled for the report)
+static void sync_report()
+{
+	int32 mean = 0;
+	PGM_P role;
+
+	if ( sync_clk.samples > 0 ) {
+		mean = sync_clk.error_sum / sync_clk.samples;
+	}
+	if ( sync_role == SYNC_MASTER ) {
+		role = PSTR("master");
+	} else if ( sync_role == SYNC_FOLLOWER ) {
+		role = sync_clk.locked ? PSTR("follower, locked") : PSTR("follower, not locked");
+	} else {
+		role = PSTR("off");
+	}
+
+	serial_setQuiet(0);
+	log_printf("\nSync ");
+	log_printf_P(role);
+	// drift in ppb = drift * 10^9 / 2^24 = drift * 3815 / 64
+	log_printf("\nSamples %u, ignored %u, drift %li ppb\n", sync_clk.samples, sync_clk.ignored, (sync_clk.drift * 3815L) / 64);
+	log_printf("Error last %li us, mean %li us, max %lu us\n> ", sync_clk.last_error, mean, sync_clk.error_max);
+	log_flush();
+	if ( sync_role != SYNC_OFF ) {
+		serial_setQuiet(1);
+	}
+	sync_resetStatistics(&sync_clk);
+}
+
+// clear the statistics after a report
+static void sync_resetStatistics(sync_clock *clock)
+{
+	clock->error_sum = 0;
+	clock->error_max = 0;
+	clock->samples = 0;
+	clock->ignored = 0;
+}
@@ -0,0 +1,193 @@
+/*
+ * sync.h - Clock synchronisation for several robots sharing one ZigBee
+ *   (Zig2Serial) or serial link, so they can play motions in step.
+ *   One robot is the master and broadcasts its clock, the followers
+ *   estimate offset and drift and run their motion timing on the master's
+ *   timebase.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Operation
+ *
+ * Send SYNF to every follower, then SYNM to the master (all robots must be
+ * stopped). From then on the robots stay quiet on the link: no echo and no
+ * log output, since every robot hears everything the others send. SYNQ
+ * prints the synchronisation status, SYNX returns to normal operation.
+ *
+ * The master sends a sync frame every SYNC_INTERVAL ms:
+ *   SYNC_FRAME_START, sequence number, master time in ms (4 bytes),
+ *   microseconds on top of that (2 bytes), 8-bit sum of the 7 data bytes
+ * The master takes its time stamp in the transmit ISR when the start byte
+ * goes into the data register, the followers take theirs in the receive
+ * ISR when the start byte has arrived. SYNC_LINK_DELAY_US covers the time
+ * in between. Each frame carries the time stamp of the previous frame's
+ * start byte, so the ISRs only record micros() and never do any maths.
+ * A follower uses a frame if it received the previous one as well, the
+ * sequence number tells. Sequence number 0 marks the first frame after
+ * SYNM, it carries no time. Terminal text never contains SYNC_FRAME_START,
+ * so the frames can be mixed with commands from the PC (a terminal
+ * program on the PC shows them as a few odd characters).
+ *
+ * Followers lock on to the first frame (the clock is stepped, which is
+ * only done while the robot is stopped) and then track the master with a
+ * PI loop: a quarter of each error corrects the offset, 1/64 of the error
+ * rate corrects the drift (gains tuned with the host simulation). Frames with an error above SYNC_OUTLIER_US are
+ * ignored, they are usually ZigBee retries.
+ *
+ * Motion playback
+ *
+ * While synchronised, executeMotionSequence runs on sync_millis(). A new
+ * command starts on the next multiple of SYNC_START_GRID ms that is at
+ * least SYNC_START_MARGIN ms away, so robots that receive the same
+ * broadcast command start together. Each step then starts at the
+ * scheduled end of the previous one instead of whenever the main loop
+ * gets to it, so the robots don't drift apart over a long motion.
+ * A robot that finishes a step early (servos in position before the play
+ * time is up) waits for the boundary, one that is late shortens the next
+ * step to catch up. walk_init (walk ready page) blocks and is not
+ * scheduled, identical robots take the same time for it.
+ *
+ * Skew
+ *
+ * SYNQ reports the error of the last sample and the mean and maximum
+ * error against the master since the last report. The skew between two
+ * followers is at most the sum of their errors plus the difference in
+ * link delay. The host simulation in host/sync_sim.c runs several robots
+ * on a simulated link and reports the skew it achieves.
+ */
+
+#ifndef SYNC_H_
+#define SYNC_H_
+
+#include "global.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// synchronisation roles
+#define SYNC_OFF			0
+#define SYNC_MASTER			1
+#define SYNC_FOLLOWER		2
+
+// protocol settings
+#define SYNC_FRAME_START	0x01	// SOH, never used in terminal text
+#define SYNC_FRAME_LENGTH	9		// start byte, 7 data bytes, checksum
+#define SYNC_INTERVAL		1000	// master sends a sync frame every second (ms)
+#define SYNC_FRAME_TIMEOUT	5000	// give up on a partial frame after 5ms (us)
+#define SYNC_LINK_DELAY_US	174		// one byte at 57600 baud, add the ZigBee latency if known (us)
+
+// estimator settings
+#define SYNC_PHASE_GAIN		4		// each sample corrects the offset by 1/4 of the error
+#define SYNC_DRIFT_GAIN		64		// and the drift by 1/64 of the error rate
+#define SYNC_OUTLIER_US		5000	// samples with a larger error are ignored (us)
+#define SYNC_OUTLIER_LIMIT	8		// consecutive outliers before the clock is stepped
+#define SYNC_MAX_DRIFT		4096	// drift limit, 2^-24 units (244ppm)
+#define SYNC_REBASE_US		262144	// move the reference point forward after 2^18us
+
+// motion start settings
+#define SYNC_START_GRID		1000	// commands start on multiples of 1s of master time
+#define SYNC_START_MARGIN	200		// at least 200ms after the command has been received
+
+// results of sync_clockUpdate
+#define SYNC_SAMPLE_OK		0		// sample used to correct the clock
+#define SYNC_SAMPLE_STEP	1		// clock was set to the master time
+#define SYNC_SAMPLE_OUTLIER	2		// sample ignored
+#define SYNC_SAMPLE_SKIPPED	3		// clock would need a step but can't be stepped now
+
+// clock estimate: master time as a function of the local micros() count
+typedef struct {
+	uint32 ref_ms;			// master time at the reference point (ms)
+	uint16 ref_us;			// and the microseconds on top (0-999)
+	uint32 ref_local;		// local micros() at the reference point
+	int32 drift;			// rate correction in 2^-24 units (positive = local clock is slow)
+	uint32 last_sample;		// local micros() of the last sample used
+	uint8 locked;			// clock has been set to the master time
+	uint8 outliers;			// consecutive outliers
+	// statistics since the last report
+	int32 last_error;		// error of the last sample (us)
+	uint32 error_sum;		// sum of the absolute errors (us)
+	uint32 error_max;		// maximum absolute error (us)
+	uint16 samples;			// samples used
+	uint16 ignored;			// outliers ignored
+} sync_clock;
+
+// receiver for the sync frames
+typedef struct {
+	uint8 index;			// bytes of the current frame received (0 = waiting for start)
+	uint8 data[SYNC_FRAME_LENGTH-1];
+	uint32 start_time;		// local micros() when the start byte arrived
+	uint32 last_start;		// start byte time of the last complete frame
+	uint8 last_seq;			// and its sequence number
+	uint8 have_last;		// last_start/last_seq are valid
+} sync_decoder;
+
+// set the clock to the given master time at the given local time
+void sync_clockSet(sync_clock *clock, uint32 ms, uint16 us, uint32 local);
+
+// read the master time at a given local time
+void sync_clockRead(const sync_clock *clock, uint32 local, uint32 *ms, uint16 *us);
+
+// move the reference point forward to keep the arithmetic in range
+void sync_clockRebase(sync_clock *clock, uint32 local);
+
+// correct the clock with a sample of the master time
+// can_step - 0 if the clock must not jump (robot is moving)
+// Returns:	(uint8)	SYNC_SAMPLE_OK, _STEP, _OUTLIER or _SKIPPED
+uint8 sync_clockUpdate(sync_clock *clock, uint32 ms, uint16 us, uint32 local, uint8 can_step);
+
+// build a sync frame carrying the master time of the previous frame
+void sync_encodeFrame(uint8 *frame, uint8 seq, uint32 ms, uint16 us);
+
+// feed one received byte to the frame decoder
+// now - local micros() when the byte arrived
+// Returns:	(int8)	-1 - byte is not part of a sync frame
+//					 0 - byte belongs to a frame that is incomplete, invalid or
+//						 can't be used
+//					 1 - sample complete: master time (including the link delay)
+//						 in ms/us at local time local
+int8 sync_decodeByte(sync_decoder *decoder, uint8 c, uint32 now, uint32 *ms, uint16 *us, uint32 *local);
+
+// handle the sync commands (SYNM, SYNF, SYNQ, SYNX)
+void sync_command(uint8 command);
+
+// sync task, call once per main loop pass (sends frames, processes samples)
+void sync_task(void);
+
+// Returns:	(uint8)	1 if motions run on the shared timebase (master or locked follower)
+uint8 sync_isActive(void);
+
+// Returns:	(unsigned long)	shared time in ms when active, otherwise millis()
+unsigned long sync_millis(void);
+
+// hold back the start of a new command until the next start boundary
+// start - set to the boundary when the command can start
+// Returns:	(uint8)	1 - keep waiting, 0 - start now
+uint8 sync_waitForStart(uint8 command, unsigned long *start);
+
+// called by the serial receive ISR with every byte
+// Returns:	(uint8)	1 if the byte was part of a sync frame
+uint8 sync_receiveByte(uint8 c);
+
+// called by the serial transmit ISR
+// Returns:	(int16)	next byte of a sync frame or -1 if none is being sent
+int16 sync_getTxByte(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SYNC_H_ */
@@ -0,0 +1,124 @@
+/*
+ * trace.c - Binary event trace for the command and motion state machines
+ *   Holds the ring buffer and sends it over the serial port. Events are
+ *   recorded by the inline TRACE() macro in trace.h.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <avr/io.h>
+#include "global.h"
+#include "clock.h"
+#include "serial.h"
+#include "trace.h"
+
+#ifdef EVENT_TRACE
+trace_record trace_buffer[TRACE_LENGTH];
+uint8 trace_head = 0;				// next record to write
+uint16 trace_total = 0;				// events recorded since start-up
+uint8 trace_frozen = 0;				// recording stopped after a fault
+#endif
+
+// running checksum of the dump
+static uint8 trace_checksum;
+
+// internal function prototypes
+static void trace_send(uint32 value, uint8 bytes);
+
+
+// stop recording until the trace has been sent (keeps the events before a fault)
+void trace_freeze()
+{
+#ifdef EVENT_TRACE
+	trace_frozen = 1;
+#endif
+}
+
+// send the trace in binary over the serial port, recording continues afterwards
+void trace_dump()
+{
+	uint8 count = 0;
+
+#ifdef EVENT_TRACE
+	trace_record *r;
+	uint8 i, index;
+
+	// stop recording while we send
+	trace_frozen = 1;
+	count = ( trace_total < TRACE_LENGTH ) ? trace_total : TRACE_LENGTH;
+#endif
+
+	serial_write((unsigned char *) "TRCE", 4);
+	trace_checksum = 0;
+	trace_send(TRACE_VERSION, 1);
+	trace_send(CLOCK_TICKS_PER_US, 1);
+	trace_send(count, 1);
+#ifdef EVENT_TRACE
+	trace_send(trace_total, 2);
+	trace_send(clock_ticks(), 4);
+	// oldest record first
+	index = (trace_head - count) & (TRACE_LENGTH - 1);
+	for (i=0; i<count; i++)
+	{
+		r = &trace_buffer[index];
+		trace_send(r->time, 4);
+		trace_send(r->id, 1);
+		trace_send(r->a, 1);
+		trace_send(r->b, 2);
+		index = (index + 1) & (TRACE_LENGTH - 1);
+	}
+	trace_frozen = 0;
+#else
+	// trace not compiled in
+	trace_send(0, 2);
+	trace_send(clock_ticks(), 4);
+#endif
+	trace_send(trace_checksum, 1);
+}
+
+// copy the last events (oldest first), used for the watchdog fault record
+// Returns: (uint8) number of records copied
+uint8 trace_copyLast(trace_record *dest, uint8 count)
+{
+#ifdef EVENT_TRACE
+	uint8 i, index;
+
+	if ( trace_total < count ) {
+		count = trace_total;
+	}
+	index = (trace_head - count) & (TRACE_LENGTH - 1);
+	for (i=0; i<count; i++)
+	{
+		dest[i] = trace_buffer[index];
+		index = (index + 1) & (TRACE_LENGTH - 1);
+	}
+	return count;
+#else
+	return 0;
+#endif
+}
+
+// send a value little endian and add it to the checksum
+static void trace_send(uint32 value, uint8 bytes)
+{
+	uint8 c;
+
+	while ( bytes-- > 0 )
+	{
+		c = (uint8) value;
+		serial_write(&c, 1);
+		trace_checksum += c;
+		value >>= 8;
+	}
+}
@@ -0,0 +1,157 @@
+/*
+ * trace.h - Binary event trace for the command and motion state machines
+ *   TRACE() writes an 8 byte record (time stamp, event id, two arguments)
+ *   to a ring buffer in RAM. The TRCE command sends the buffer in binary
+ *   over the serial port, trace_decode.pl turns it into a timeline.
+ *   Compiled in when EVENT_TRACE is defined in global.h.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Recording
+ *
+ * A record is written with interrupts disabled: the time stamp is the low
+ * 32 bits of the clock.c timebase (0.5us ticks, taken from TCNT5 and the
+ * overflow count without the retry loop of clock_ticks), then the id and
+ * arguments are stored and the write index moves on. The ring keeps the
+ * last TRACE_LENGTH events, older ones are overwritten.
+ *
+ * When a servo alarm stops the motion engine the trace is frozen, so the
+ * events leading up to it are kept until they have been sent with TRCE.
+ * A major alarm (low battery) sends the trace before the main loop stops.
+ *
+ * Binary dump (TRCE command), all values little endian:
+ *   'T' 'R' 'C' 'E'
+ *   version (1), ticks per us (1), number of records (1),
+ *   events recorded since start-up (2), time stamp of the dump (4)
+ *   records, oldest first: time (4), event id (1), arg a (1), arg b (2)
+ *   8-bit sum of all bytes after 'TRCE'
+ *
+ * Events (id, a, b)
+ *   TRACE_COMMAND		new command handed to the motion engine, last command
+ *   TRACE_MOTION_STATE	new motion state, current motion page
+ *   TRACE_PAGE			motion page unpacked, number of steps
+ *   TRACE_STEP			step started, motion page
+ *   TRACE_REPEAT		repeat counter, motion page
+ *   TRACE_EXIT_PAGE	reason (0 STOP, 1 new command), exit page
+ *   TRACE_WALK_SHIFT	1 seamless shift / 0 exit page first, new page
+ *   TRACE_ALARM_SERVO	servo id, error code
+ *   TRACE_ALARM_FLEX	-, motion page (compliance could not be set)
+ *   TRACE_ALARM_VOLTAGE	-, battery voltage in mV
+ *   TRACE_EMERGENCY_STOP	command that was stopped, -
+ *   TRACE_RESUME		command that is resumed, -
+ *   TRACE_SYNC_START	command, start time (low 16 bits of ms) in sync mode
+ *   TRACE_BUTTON		button id, event type (see button.h)
+ *   TRACE_STACK		new stack high-water mark: % of the area, bytes (see stack.h)
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "global.h"
+#include "clock.h"
+#include "hal.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define TRACE_LENGTH			64		// records kept, must be a power of 2
+#define TRACE_VERSION			1
+
+// event ids
+#define TRACE_COMMAND			1
+#define TRACE_MOTION_STATE		2
+#define TRACE_PAGE				3
+#define TRACE_STEP				4
+#define TRACE_REPEAT			5
+#define TRACE_EXIT_PAGE			6
+#define TRACE_WALK_SHIFT		7
+#define TRACE_ALARM_SERVO		8
+#define TRACE_ALARM_FLEX		9
+#define TRACE_ALARM_VOLTAGE		10
+#define TRACE_EMERGENCY_STOP	11
+#define TRACE_RESUME			12
+#define TRACE_SYNC_START		13
+#define TRACE_BUTTON			14
+#define TRACE_STACK				15
+
+// one event
+typedef struct {
+	uint32 time;			// clock ticks
+	uint8 id;
+	uint8 a;
+	uint16 b;
+} trace_record;
+
+#ifdef EVENT_TRACE
+
+extern trace_record trace_buffer[TRACE_LENGTH];
+extern uint8 trace_head;
+extern uint16 trace_total;
+extern uint8 trace_frozen;
+
+// record an event (inline to keep the cost down)
+static inline void trace_event(uint8 id, uint8 a, uint16 b)
+{
+	trace_record *r;
+	uint8 sreg;
+	uint16 t, o;
+
+	if ( trace_frozen ) {
+		return;
+	}
+	sreg = SREG;
+	cli();
+	t = hal_clockCount();
+	o = (uint16) clock_overflows;
+	if ( hal_clockOverflowPending() && t < 0x8000 ) {
+		o++;
+	}
+	r = &trace_buffer[trace_head];
+	r->time = ((uint32) o << 16) | t;
+	r->id = id;
+	r->a = a;
+	r->b = b;
+	trace_head = (trace_head + 1) & (TRACE_LENGTH - 1);
+	trace_total++;
+	SREG = sreg;
+}
+
+#define TRACE(id, a, b)		trace_event((id), (a), (b))
+
+#else
+
+#define TRACE(id, a, b)
+
+#endif
+
+// stop recording until the trace has been sent (keeps the events before a fault)
+void trace_freeze(void);
+
+// send the trace in binary over the serial port, recording continues afterwards
+void trace_dump(void);
+
+// copy the last events (oldest first), used for the watchdog fault record
+// Returns: (uint8) number of records copied
+uint8 trace_copyLast(trace_record *dest, uint8 count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,116 @@
+# Perl script to print the event trace sent by the TRCE command of
+# BioloidCControl as a timeline (see trace.h for the format)
+#
+# Usage:	perl trace_decode.pl capture.bin
+#
+# capture.bin is the serial data received after sending TRCE (or after a
+# major alarm), saved with a terminal program that can log binary data.
+# Anything before the 'TRCE' marker is skipped.
+#
+# Output: one line per event with the time relative to the first event
+# and to the previous one in ms, e.g.
+#	   12.345	+2.100	STATE		STEP_IN_MOTION			page 35
+#
+# Version: 0.9
+#
+use strict;
+use warnings;
+
+# these need to match trace.h, motion_f.h and the command list in serial.c
+my $version = 1;
+my @commands = qw( STOP WFWD WBWD WLT WRT WLSD WRSD WFLS WFRS WBLS WBRS WAL WAR
+				   WFLT WFRT WBLT WBRT WRDY SIT STND BAL M FGUP BGUP RSET WS W
+				   RUN LOAD SAVE BRDG SYNM SYNF SYNQ SYNX TASK PROF TRCE STAK );
+my @states = qw( MOTION_STOPPED STEP_IN_MOTION STEP_IN_PAUSE STEP_FINISHED
+				 PAUSE_FINISHED PAGE_FINISHED MOTION_ALARM ROBOT_SLIPPED );
+
+my @buttons = qw( START UP DOWN LEFT RIGHT );
+my @button_events = qw( none pressed released long-press );
+
+sub command_name { my ($c) = @_; return $c < @commands ? $commands[$c] : "command $c"; }
+sub state_name { my ($s) = @_; return $s < @states ? $states[$s] : "state $s"; }
+
+# event id => [ name, sub that formats the arguments ]
+my %events = (
+	1  => [ 'COMMAND',	sub { sprintf('%-23s last %s', command_name($_[0]), command_name($_[1])) } ],
+	2  => [ 'STATE',	sub { sprintf('%-23s page %u', state_name($_[0]), $_[1]) } ],
+	3  => [ 'PAGE',		sub { sprintf('page %-18u %u steps', $_[0], $_[1]) } ],
+	4  => [ 'STEP',		sub { sprintf('step %-18u page %u', $_[0], $_[1]) } ],
+	5  => [ 'REPEAT',	sub { sprintf('repeat %-16u page %u', $_[0], $_[1]) } ],
+	6  => [ 'EXIT',		sub { sprintf('%-23s exit page %u', $_[0] ? 'new command' : 'STOP', $_[1]) } ],
+	7  => [ 'SHIFT',	sub { sprintf('%-23s page %u', $_[0] ? 'seamless' : 'via exit page', $_[1]) } ],
+	8  => [ 'ALARM',	sub { sprintf('servo ID%-15u error 0x%02X', $_[0], $_[1]) } ],
+	9  => [ 'ALARM',	sub { sprintf('%-23s page %u', 'joint flexibility', $_[1]) } ],
+	10 => [ 'ALARM',	sub { sprintf('%-23s %umV', 'low battery', $_[1]) } ],
+	11 => [ 'E-STOP',	sub { sprintf('stopped %s', command_name($_[0])) } ],
+	12 => [ 'RESUME',	sub { sprintf('resumed %s', command_name($_[0])) } ],
+	13 => [ 'SYNC',		sub { sprintf('%-23s starts at ...%ums', command_name($_[0]), $_[1]) } ],
+	14 => [ 'BUTTON',	sub { sprintf('%-23s %s', $buttons[$_[0]] // "button $_[0]", $button_events[$_[1]] // "event $_[1]") } ],
+	15 => [ 'STACK',	sub { sprintf('high-water %-12s %u bytes', "$_[0]%", $_[1]) } ],
+);
+
+# quit unless we have the correct number of command-line args
+my $num_args = $#ARGV + 1;
+if ($num_args != 1) {
+	print "\nUsage: trace_decode.pl capture.bin \n";
+	exit 1;
+}
+
+open(my $in, '<:raw', $ARGV[0]) or die "Can't open $ARGV[0]: $!\n";
+my $data = do { local $/; <$in> };
+close($in);
+
+my $start = index($data, 'TRCE');
+die "No event trace found in $ARGV[0]\n" if $start < 0;
+my $pos = $start + 4;
+my $sum = 0;
+
+# read an unsigned little endian value and add it to the checksum
+sub take {
+	my ($bytes) = @_;
+	die "Trace is truncated\n" if $pos + $bytes > length($data);
+	my $value = 0;
+	for my $i (0 .. $bytes-1) {
+		my $c = ord(substr($data, $pos + $i, 1));
+		$sum = ($sum + $c) & 0xFF;
+		$value |= $c << (8 * $i);
+	}
+	$pos += $bytes;
+	return $value;
+}
+
+my $trace_version = take(1);
+die "Unknown trace version $trace_version\n" if $trace_version != $version;
+my $ticks_per_us = take(1);
+my $count = take(1);
+my $total = take(2);
+my $dump_time = take(4);
+my @records;
+for (1 .. $count) {
+	my @r = ( take(4), take(1), take(1), take(2) );
+	push @records, \@r;
+}
+my $expected = $sum;
+my $checksum = take(1);
+die sprintf("Checksum error (0x%02X, expected 0x%02X)\n", $checksum, $expected) if $checksum != $expected;
+
+if ($count == 0) {
+	print $total == 0 ? "No events recorded (or EVENT_TRACE not defined in global.h)\n" : "No events\n";
+	exit 0;
+}
+printf "%u events, %u recorded since start-up\n\n", $count, $total;
+
+# time stamps are 32-bit clock ticks (wrap after 35 minutes), add up the differences
+my $ticks_per_ms = $ticks_per_us * 1000;
+my $last = $records[0][0];
+my $t = 0;
+foreach my $r (@records) {
+	my ($time, $id, $a, $b) = @$r;
+	my $d = (($time - $last) & 0xFFFFFFFF) / $ticks_per_ms;
+	$t += $d;
+	$last = $time;
+	my $event = $events{$id};
+	my ($name, $text) = $event ? ($event->[0], $event->[1]->($a, $b)) : ("EVENT $id", "a $a b $b");
+	printf "%10.3f\t+%.3f\t%-8s\t%s\n", $t, $d, $name, $text;
+}
+printf "\nDump sent %.3fms after the last event\n", (($dump_time - $last) & 0xFFFFFFFF) / $ticks_per_ms;
@@ -0,0 +1,219 @@
+/*
+ * watchdog.c - Watchdog and deadline monitor for the main control loop
+ *   Sets up the AVR watchdog in interrupt and reset mode, switches the
+ *   servos off and writes the fault record that survives the reset.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/wdt.h>
+#include "global.h"
+#include "hal.h"
+#include "clock.h"
+#include "log.h"
+#include "dxl_hal.h"
+#include "sched.h"
+#include "rtos.h"
+#include "trace.h"
+#include "watchdog.h"
+
+// global variables
+extern volatile uint8 bioloid_command;
+extern uint8 motion_state;
+
+// fault record and reset cause, not cleared by the start-up code
+watchdog_record watchdog_fault_record __attribute__((section(".noinit")));
+static uint8 watchdog_mcusr __attribute__((section(".noinit")));
+
+static uint8 watchdog_running = 0;
+static uint32 watchdog_start_time = 0;
+
+// internal function prototypes
+static uint8 watchdog_checksum(void);
+void watchdog_earlyInit(void) HAL_INIT3;
+
+
+// runs before main: the watchdog stays enabled after a watchdog reset and
+// would reset the controller again during start-up
+void watchdog_earlyInit(void)
+{
+	watchdog_mcusr = MCUSR;
+	MCUSR = 0;
+	wdt_disable();
+	// RAM contents are random after power-up or a brown-out
+	if ( watchdog_mcusr & ((1<<PORF) | (1<<BORF)) ) {
+		watchdog_fault_record.magic = 0;
+	}
+}
+
+// first watchdog timeout, the second one resets the controller
+ISR (WDT_vect)
+{
+#ifdef FREERTOS
+	watchdog_fault(WATCHDOG_HANG, rtos_currentTask());
+#else
+	watchdog_fault(WATCHDOG_HANG, sched_currentTask());
+#endif
+}
+
+// start the watchdog and the deadline monitor
+void watchdog_start()
+{
+#ifdef WATCHDOG
+	uint8 sreg;
+
+	watchdog_start_time = micros();
+	sreg = SREG;
+	cli();
+	wdt_reset();
+	// timed sequence, interrupt and reset mode
+	WDTCSR = (1<<WDCE) | (1<<WDE);
+	WDTCSR = (1<<WDIE) | (1<<WDE) | (WATCHDOG_TIMEOUT & 0x07) | ((WATCHDOG_TIMEOUT & 0x08) ? (1<<WDP3) : 0);
+	watchdog_running = 1;
+	SREG = sreg;
+#endif
+}
+
+// stop the watchdog and the deadline monitor
+void watchdog_stop()
+{
+	uint8 sreg;
+
+	sreg = SREG;
+	cli();
+	wdt_reset();
+	wdt_disable();
+	WDTCSR = 0;
+	watchdog_running = 0;
+	SREG = sreg;
+}
+
+// Returns: (uint8) 1 if the watchdog is running
+uint8 watchdog_isRunning()
+{
+	return watchdog_running;
+}
+
+// Returns: (uint32) micros() when the watchdog was last started
+uint32 watchdog_startTime()
+{
+	return watchdog_start_time;
+}
+
+// switch the servos off, record the fault and reset the controller
+void watchdog_fault(uint8 reason, uint8 task)
+{
+	watchdog_record *r = &watchdog_fault_record;
+
+	cli();
+	// robot safety first
+	dxl_hal_torque_off();
+
+	if ( r->magic != WATCHDOG_MAGIC || watchdog_checksum() != r->checksum ) {
+		r->magic = WATCHDOG_MAGIC;
+		r->faults = 0;
+	}
+	r->faults++;
+	r->reason = reason;
+	r->task = task;
+#ifdef FREERTOS
+	rtos_getTaskName(task, r->name);
+#else
+	sched_getTaskName(task, r->name);
+#endif
+	r->command = bioloid_command;
+	r->motion_state = motion_state;
+	r->time = millis();
+	r->misses = sched_getMisses();
+	r->reported = 0;
+	r->events = trace_copyLast(r->trace, WATCHDOG_TRACE_EVENTS);
+	r->checksum = watchdog_checksum();
+
+	// reset after the shortest timeout
+	WDTCSR = (1<<WDCE) | (1<<WDE);
+	WDTCSR = (1<<WDE);
+	while (1) {
+		hal_wait();
+	}
+}
+
+// print the fault record if the last reset was caused by a fault
+void watchdog_report()
+{
+	watchdog_record *r = &watchdog_fault_record;
+	char name[5];
+	uint32 ticks_per_ms = CLOCK_TICKS_PER_US * 1000UL;
+	uint32 last;
+	uint8 i;
+
+	if ( !(watchdog_mcusr & (1<<WDRF)) ) {
+		return;
+	}
+	if ( r->magic != WATCHDOG_MAGIC || watchdog_checksum() != r->checksum || r->reported ) {
+		log_printf("\nWatchdog reset without a fault record.");
+		return;
+	}
+
+	for (i=0; i<4; i++) {
+		name[i] = r->name[i];
+	}
+	name[4] = 0;
+	if ( r->reason == WATCHDOG_HANG ) {
+		log_printf("\nWatchdog fault %u: task %s hung", r->faults, name);
+	} else if ( r->reason == WATCHDOG_STACK ) {
+		log_printf("\nWatchdog fault %u: task %s overran its stack", r->faults, name);
+	} else {
+		log_printf("\nWatchdog fault %u: task %s missed its deadline", r->faults, name);
+	}
+	log_printf(" after %lums, servo torque was switched off.", r->time);
+	log_printf("\nCommand %u, motion state %u, %lu deadline misses", r->command, r->motion_state, r->misses);
+	// events before the fault, times relative to the last one
+	if ( r->events > 0 ) {
+		log_printf("\nLast events (ms, id, a, b):");
+		last = r->trace[r->events-1].time;
+		for (i=0; i<r->events; i++) {
+			log_printf("\n -%lu %u %u", (last - r->trace[i].time) / ticks_per_ms, r->trace[i].id, r->trace[i].a);
+			log_printf(" %u", r->trace[i].b);
+		}
+	}
+	log_printf("\n");
+
+	r->reported = 1;
+	r->checksum = watchdog_checksum();
+}
+
+// Returns: (uint16) number of faults since power-up
+uint16 watchdog_getFaults()
+{
+	if ( watchdog_fault_record.magic != WATCHDOG_MAGIC || watchdog_checksum() != watchdog_fault_record.checksum ) {
+		return 0;
+	}
+	return watchdog_fault_record.faults;
+}
+
+// Returns: (uint8) 8-bit sum of the fault record without the checksum
+static uint8 watchdog_checksum()
+{
+	uint8 *p = (uint8 *) &watchdog_fault_record;
+	uint8 sum = 0;
+	uint8 i;
+
+	for (i=0; i<offsetof(watchdog_record, checksum); i++) {
+		sum += p[i];
+	}
+	return sum;
+}
@@ -0,0 +1,119 @@
+/*
+ * watchdog.h - Watchdog and deadline monitor for the main control loop
+ *   The AVR watchdog resets the controller when the main loop hangs, the
+ *   scheduler checks that every critical task is served in time. Both
+ *   switch the servo torque off and keep a fault record across the reset.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Operation
+ *
+ * Hangs: the watchdog runs in interrupt and reset mode with a timeout of
+ * WATCHDOG_TIMEOUT. sched_dispatch() checks in on every pass, long motions
+ * played with executeMotion() check in after every step. A task that does
+ * not return (waiting for a servo that never stops moving, a bus that is
+ * never released) lets the timeout expire, the watchdog interrupt records
+ * the fault and the second timeout resets the controller. Code that keeps
+ * interrupts disabled is only caught by the reset, without a fault record.
+ *
+ * Deadlines: tasks with a watchdog limit in the task table (see the main
+ * loop in BioloidCControl.c) must complete a run within that many ms of
+ * the previous one. The scheduler checks this before it checks in, a task
+ * that is starved by the others is reported as a deadline fault.
+ *
+ * On a fault the torque of all servos is switched off with a broadcast
+ * (sent directly on USART0 without interrupts), then the fault record is
+ * written and the controller resets. The record lives in .noinit RAM and
+ * survives the reset: reason, task, command, motion state, deadline misses
+ * and the last WATCHDOG_TRACE_EVENTS events of the event trace (if
+ * EVENT_TRACE is defined). watchdog_report() prints it after start-up.
+ *
+ * The watchdog is stopped while the PC owns the Dynamixel bus (bridge
+ * mode) and when a major alarm ends the main loop.
+ */
+
+#ifndef WATCHDOG_H_
+#define WATCHDOG_H_
+
+#include <avr/wdt.h>
+#include "global.h"
+#include "trace.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define WATCHDOG_TIMEOUT		WDTO_2S		// hang detection (the walk ready pose takes 1.2s)
+#define WATCHDOG_TRACE_EVENTS	8			// events kept in the fault record
+#define WATCHDOG_MAGIC			0xFA17
+
+// fault reasons
+#define WATCHDOG_NO_FAULT		0
+#define WATCHDOG_HANG			1			// the watchdog timed out in a task
+#define WATCHDOG_DEADLINE		2			// a task was not served within its limit
+#define WATCHDOG_STACK			3			// a task overran its stack (FreeRTOS build)
+
+#define WATCHDOG_NO_TASK		0xFF
+
+// fault record kept across the reset
+typedef struct {
+	uint16 magic;
+	uint16 faults;			// faults since power-up
+	uint8 reason;
+	uint8 task;				// index in the task table
+	char name[4];			// task name
+	uint8 command;			// bioloid_command at the time of the fault
+	uint8 motion_state;
+	uint32 time;			// ms since start-up
+	uint32 misses;			// deadline misses since start-up
+	uint8 reported;			// printed after the reset
+	uint8 events;			// number of trace records
+	trace_record trace[WATCHDOG_TRACE_EVENTS];
+	uint8 checksum;
+} watchdog_record;
+
+// start the watchdog and the deadline monitor
+void watchdog_start(void);
+
+// stop the watchdog and the deadline monitor
+void watchdog_stop(void);
+
+// Returns: (uint8) 1 if the watchdog is running
+uint8 watchdog_isRunning(void);
+
+// Returns: (uint32) micros() when the watchdog was last started
+uint32 watchdog_startTime(void);
+
+// check in, restarts the watchdog timeout
+static inline void watchdog_checkIn(void)
+{
+	wdt_reset();
+}
+
+// switch the servos off, record the fault and reset the controller
+void watchdog_fault(uint8 reason, uint8 task) __attribute__((noreturn));
+
+// print the fault record if the last reset was caused by a fault
+void watchdog_report(void);
+
+// Returns: (uint16) number of faults since power-up
+uint16 watchdog_getFaults(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WATCHDOG_H_ */
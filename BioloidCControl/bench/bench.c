@@ -0,0 +1,236 @@
+/*
+ * bench.c - Cycle counts of firmware functions on the ATmega2561 (simavr)
+ *   Built with the real firmware modules for the ATmega2561 and run under
+ *   simavr, times the functions below with a cycle counter and sends one
+ *   line per benchmark on USART1:
+ *
+ *     BENCH <name> <cycles>
+ *
+ *   followed by BENCH_END. bench_report.pl turns the output into a CSV file
+ *   per commit (see host/CMakeLists.txt, target bench_avr).
+ *
+ * Cycle counter: TIMER4 runs at the CPU clock (prescaler 1), its overflow
+ * interrupt counts the upper 16 bits. The cost of starting and stopping
+ * the counter is measured first and taken off every result, the overflow
+ * interrupt itself (about 40 cycles per 65536) is included. The firmware
+ * clock (TIMER5) is not started, so millis() stays at 0 and nothing else
+ * interrupts the benchmarks. Functions that wait for the bus include the
+ * UART time at 1Mbps as simavr models it.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include "global.h"
+#include "hal.h"
+#include "adc.h"
+#include "dynamixel.h"
+#include "motion_f.h"
+#include "pid.h"
+#include "pose.h"
+
+// upper 16 bits of the cycle counter
+static volatile uint16 bench_overflows;
+// cycles of an empty measurement
+static uint32 bench_overhead = 0;
+
+// firmware state the benchmarks set up (BioloidCControl.c, pose.c, serial.c, ...)
+extern volatile int16 current_pose[NUM_AX12_SERVOS];
+extern uint16 goal_pose[NUM_AX12_SERVOS];
+extern char command[5];
+extern int giBusUsing;
+extern int gbCommStatus;
+extern unsigned long lastread;
+extern unsigned long last_time;
+extern int sample_time;
+extern volatile int16 pid_input[PID_DIMENSION];
+extern volatile int16 pid_setpoint[PID_DIMENSION];
+
+// firmware functions without a header
+void command_match_string(void);
+void processGyroKalman(void);
+void dxl_hal_put_queue(unsigned char data);
+
+// time code and report it under name (a string in Flash)
+#define BENCH(name, code)	do { bench_start(); code; bench_report(name, bench_stop()); } while (0)
+
+ISR(TIMER4_OVF_vect)
+{
+	bench_overflows++;
+}
+
+static inline void bench_start(void) __attribute__((always_inline));
+static inline void bench_start(void)
+{
+	bench_overflows = 0;
+	TCNT4 = 0;
+	TIFR4 = _BV(TOV4);
+	TCCR4B = _BV(CS40);
+}
+
+// Returns:	(uint32) cycles since bench_start
+static inline uint32 bench_stop(void) __attribute__((always_inline));
+static inline uint32 bench_stop(void)
+{
+	uint16 count;
+	uint32 cycles;
+
+	TCCR4B = 0;
+	count = TCNT4;
+	cycles = ((uint32) bench_overflows << 16) + count;
+	// an overflow the interrupt hasn't counted yet
+	if ( TIFR4 & _BV(TOV4) ) {
+		cycles += 0x10000UL;
+		TIFR4 = _BV(TOV4);
+	}
+	return cycles;
+}
+
+// send a line on USART1 (blocking, simavr prints it)
+static void bench_print(const char *line)
+{
+	while ( *line ) {
+		hal_uartSend(HAL_UART_PC, *line++);
+	}
+}
+
+static void bench_report(PGM_P name, uint32 cycles)
+{
+	char line[64];
+
+	snprintf_P(line, sizeof(line), PSTR("BENCH %S %lu\n"), name, cycles - bench_overhead);
+	bench_print(line);
+}
+
+// benchmark with a number after its name (e.g. the motion page)
+static void bench_reportNumber(PGM_P name, uint16 number, uint32 cycles)
+{
+	char line[64];
+
+	snprintf_P(line, sizeof(line), PSTR("BENCH %S/%u %lu\n"), name, number, cycles - bench_overhead);
+	bench_print(line);
+}
+
+// a status packet for a READ of two bytes from ID 1 in the Dynamixel receive buffer
+static void bench_statusPacket(void)
+{
+	static const uint8 status[8] PROGMEM = { 0xFF, 0xFF, 0x01, 0x04, 0x00, 0x00, 0x02, 0xF8 };
+	uint8 i;
+
+	for (i=0; i<sizeof(status); i++) {
+		dxl_hal_put_queue(pgm_read_byte(&status[i]));
+	}
+	dxl_set_txpacket_id(1);
+	dxl_set_txpacket_instruction(INST_READ);
+	dxl_set_txpacket_parameter(0, DXL_PRESENT_POSITION_L);
+	dxl_set_txpacket_parameter(1, 2);
+	dxl_set_txpacket_length(4);
+	giBusUsing = 1;
+	gbCommStatus = COMM_TXSUCCESS;
+}
+
+static void bench_command(PGM_P name, PGM_P text)
+{
+	strcpy_P(command, text);
+	BENCH(name, command_match_string());
+}
+
+int main(void)
+{
+	static const char cmd_first[] PROGMEM = "STOP";
+	static const char cmd_last[] PROGMEM = "STAK";
+	static const char cmd_page[] PROGMEM = "M123";
+	static const uint16 dms_values[] PROGMEM = { 60, 200, 700 };
+	uint16 i;
+
+	// USART1 for the results, 57600 baud like the PC link
+	hal_uartOpen(HAL_UART_PC);
+	hal_uartSetDivisor(HAL_UART_PC, 34);
+	TCCR4A = 0;
+	TIMSK4 = _BV(TOIE4);
+	sei();
+
+	// cost of the measurement itself
+	bench_start();
+	bench_overhead = bench_stop();
+
+	// motion pages
+	motionPageInit();
+	for (i=1; i<=NUM_MOTION_PAGES; i++) {
+		uint32 cycles;
+		bench_start();
+		unpackMotion(i);
+		cycles = bench_stop();
+		bench_reportNumber(PSTR("unpackMotion"), i, cycles);
+	}
+
+	// servo speeds for a 0.4s step with every servo moving
+	for (i=0; i<NUM_AX12_SERVOS; i++) {
+		current_pose[i] = 512;
+		goal_pose[i] = 300 + 25*i;
+	}
+	BENCH(PSTR("calculatePoseServoSpeeds"), calculatePoseServoSpeeds(400));
+
+	// Dynamixel packets: sending a READ (includes the bus time at 1Mbps),
+	// parsing its status packet from the receive buffer
+	dxl_initialize(0, DEFAULT_BAUDNUMBER);
+	dxl_set_txpacket_id(1);
+	dxl_set_txpacket_instruction(INST_READ);
+	dxl_set_txpacket_parameter(0, DXL_PRESENT_POSITION_L);
+	dxl_set_txpacket_parameter(1, 2);
+	dxl_set_txpacket_length(4);
+	giBusUsing = 0;
+	BENCH(PSTR("dxl_tx_packet"), dxl_tx_packet());
+	bench_statusPacket();
+	BENCH(PSTR("dxl_rx_packet"), dxl_rx_packet());
+
+	// balance: Kalman filter 20ms after the last update, PID due
+	lastread = (unsigned long) -20;
+	BENCH(PSTR("processGyroKalman"), processGyroKalman());
+	pid_init();
+	pid_setMode(AUTOMATIC);
+	pid_input[0] = 40;
+	pid_input[1] = -25;
+	pid_setpoint[0] = 0;
+	pid_setpoint[1] = 0;
+	last_time = (unsigned long) -sample_time;
+	BENCH(PSTR("pid_compute"), pid_compute());
+
+	// sensors
+	for (i=0; i<sizeof(dms_values)/sizeof(dms_values[0]); i++) {
+		uint16 value = pgm_read_word(&dms_values[i]);
+		uint32 cycles;
+		bench_start();
+		adc_convertDMStoCM(value);
+		cycles = bench_stop();
+		bench_reportNumber(PSTR("adc_convertDMStoCM"), value, cycles);
+	}
+
+	// command parser: the first command, the last one, a motion page (no match)
+	bench_command(PSTR("command_match_string/first"), cmd_first);
+	bench_command(PSTR("command_match_string/last"), cmd_last);
+	bench_command(PSTR("command_match_string/page"), cmd_page);
+
+	bench_print("BENCH_END\n");
+	hal_uartWaitSent(HAL_UART_PC);
+	// simavr stops when the CPU sleeps with interrupts disabled
+	cli();
+	sleep_cpu();
+	while (1);
+}
@@ -0,0 +1,88 @@
+# Perl script to record the cycle counts of the simavr benchmarks per commit
+# Run by the bench_avr target of host/CMakeLists.txt or by hand.
+#
+# Usage:	perl bench_report.pl bench_output results.csv [commit]
+#
+# Reads the BENCH lines that bench.c prints on USART1 (the output of
+# run_avr) and merges them into a CSV file with the columns
+#
+#   commit,benchmark,cycles
+#
+# Rows of the same commit are replaced, rows of other commits are kept, so
+# the file builds up a history that can be compared between commits (e.g.
+# with a spreadsheet or by grepping a benchmark). The commit defaults to the
+# short hash of the git HEAD, with "+" appended if the tree has changes.
+# Fails if the output doesn't end with BENCH_END (simulation stopped early).
+#
+# Version: 0.9
+#
+use strict;
+use warnings;
+
+# quit unless we have the correct number of command-line args
+my $num_args = $#ARGV + 1;
+if ($num_args < 2 || $num_args > 3) {
+	print "\nNumber of arguments: $num_args\n";
+	print "\nUsage: bench_report.pl bench_output results.csv [commit] \n";
+	exit 1;
+}
+
+my ($output_file, $csv_file) = @ARGV;
+my $commit = ($num_args == 3) ? $ARGV[2] : '';
+if ($commit eq '') {
+	$commit = `git rev-parse --short HEAD 2>/dev/null`;
+	chomp $commit;
+	$commit = 'unknown' if ($commit eq '');
+	$commit .= '+' if (`git status --porcelain --untracked-files=no 2>/dev/null` ne '');
+}
+
+# results of this run, in the order they were printed
+my @results;
+my $finished = 0;
+open(my $output, '<', $output_file) or die "Can't open $output_file: $!\n";
+while (my $line = <$output>) {
+	$line =~ s/\r?\n$//;
+	if ($line =~ /BENCH_END/) {
+		$finished = 1;
+		last;
+	}
+	if ($line =~ /BENCH (\S+) (\d+)/) {
+		push @results, [$1, $2];
+	}
+}
+close($output);
+die "$output_file: no BENCH_END, the benchmarks did not finish\n" unless $finished;
+die "$output_file: no results\n" unless @results;
+
+# keep the rows of the other commits
+my @rows;
+if (open(my $csv, '<', $csv_file)) {
+	<$csv>;
+	while (my $line = <$csv>) {
+		$line =~ s/\r?\n$//;
+		my ($row_commit) = split(/,/, $line);
+		push @rows, $line if (defined $row_commit && $row_commit ne $commit);
+	}
+	close($csv);
+}
+
+open(my $csv, '>', $csv_file) or die "Can't write $csv_file: $!\n";
+print $csv "commit,benchmark,cycles\n";
+print $csv "$_\n" foreach @rows;
+print $csv "$commit,$_->[0],$_->[1]\n" foreach @results;
+close($csv);
+
+# summary: totals per function, a page number or argument after the / counts together
+my (%total, %count, @order);
+foreach my $result (@results) {
+	my ($function) = split(/\//, $result->[0]);
+	push @order, $function unless exists $total{$function};
+	$total{$function} += $result->[1];
+	$count{$function}++;
+}
+printf "\nBenchmarks of %s (%s)\n", $commit, $csv_file;
+printf "%-28s %5s %10s %10s %10s\n", 'Function', 'runs', 'mean', 'mean us', 'total';
+foreach my $function (@order) {
+	my $mean = $total{$function} / $count{$function};
+	printf "%-28s %5d %10.0f %10.1f %10d\n", $function, $count{$function}, $mean, $mean / 16, $total{$function};
+}
@@ -0,0 +1,178 @@
+# Perl script to compare performance figures with the checked-in baseline
+# Run by the perf_gate target and test of host/CMakeLists.txt or by hand.
+#
+# Usage:	perl perf_gate.pl [-u] [-t percent] baseline.csv results...
+#   -u		update the baseline with the results instead of comparing
+#   -t		threshold for metrics without one of their own (default 2%)
+#
+# Reads the results of one or more of
+#   - bench.c under simavr (the bench_avr output): "BENCH <name> <cycles>"
+#     becomes the metric cycles/<name>, e.g. cycles/unpackMotion/38
+#   - host/perf_host.c: "PERF <metric> <value>", bus bytes per walk cycle
+#     and the longest task runs of the main loop
+#   - avr-size (Berkeley format) of the firmware: flash/text_data (text +
+#     data) and sram/data_bss (data + bss)
+# and compares them with the baseline, a CSV file with the columns
+#
+#   metric,baseline,threshold
+#
+# Lower is better for every metric. A result more than threshold percent
+# above its baseline is a regression; the script lists them with the
+# function (the metric up to the first /) and page or argument. A result
+# without a baseline row (e.g. the flash, SRAM and cycle figures the first
+# time avr-gcc and simavr are there) can't be checked and fails as well,
+# until it gets its row with -u. The script exits with 1 if there is one
+# of either. Metrics of the baseline that aren't in the results (e.g. the
+# cycle counts without avr-gcc and simavr) are listed as not measured.
+# With -u the measured metrics get their new values, other rows and the
+# thresholds are kept; commit the baseline after an intended change.
+#
+# Version: 0.9
+#
+use strict;
+use warnings;
+
+my $update = 0;
+my $default_threshold = 2;
+while (@ARGV && $ARGV[0] =~ /^-/) {
+	my $option = shift @ARGV;
+	if ($option eq '-u') {
+		$update = 1;
+	} elsif ($option eq '-t' && @ARGV) {
+		$default_threshold = shift @ARGV;
+	} else {
+		@ARGV = ();
+	}
+}
+
+# quit unless we have the correct number of command-line args
+my $num_args = $#ARGV + 1;
+if ($num_args < 2) {
+	print "\nNumber of arguments: $num_args\n";
+	print "\nUsage: perf_gate.pl [-u] [-t percent] baseline.csv results... \n";
+	exit 1;
+}
+
+my ($baseline_file, @result_files) = @ARGV;
+
+# results, in the order they were printed
+my (%result, @order);
+sub add_result {
+	my ($metric, $value) = @_;
+	push @order, $metric unless exists $result{$metric};
+	$result{$metric} = $value;
+}
+
+foreach my $result_file (@result_files) {
+	my ($benchmarks, $finished) = (0, 0);
+	open(my $results, '<', $result_file) or die "Can't open $result_file: $!\n";
+	while (my $line = <$results>) {
+		$line =~ s/\r?\n$//;
+		next if ($line =~ /^#/);
+		if ($line =~ /BENCH_END/) {
+			$finished = 1;
+		} elsif ($line =~ /BENCH (\S+) (\d+)/) {
+			add_result("cycles/$1", $2);
+			$benchmarks++;
+		} elsif ($line =~ /^PERF (\S+) (\d+)/) {
+			add_result($1, $2);
+		} elsif ($line =~ /^\s*(\d+)\s+(\d+)\s+(\d+)\s+\d+\s+[0-9a-f]+\s+\S+/) {
+			# avr-size: text data bss dec hex filename
+			add_result('flash/text_data', $1 + $2);
+			add_result('sram/data_bss', $2 + $3);
+		}
+	}
+	close($results);
+	die "$result_file: no BENCH_END, the benchmarks did not finish\n" if ($benchmarks && !$finished);
+}
+die "No results in @result_files\n" unless @order;
+
+# the baseline, in file order
+my (%baseline, %threshold, @baseline_order);
+if (open(my $csv, '<', $baseline_file)) {
+	<$csv>;
+	while (my $line = <$csv>) {
+		$line =~ s/\r?\n$//;
+		next if ($line eq '' || $line =~ /^#/);
+		my ($metric, $value, $threshold) = split(/,/, $line);
+		next unless (defined $value && $value =~ /^\d+$/);
+		push @baseline_order, $metric;
+		$baseline{$metric} = $value;
+		$threshold{$metric} = $threshold if (defined $threshold && $threshold ne '');
+	}
+	close($csv);
+} elsif (!$update) {
+	die "Can't open $baseline_file: $!\n";
+}
+
+if ($update) {
+	my @metrics = @baseline_order;
+	foreach my $metric (@order) {
+		push @metrics, $metric unless exists $baseline{$metric};
+		$baseline{$metric} = $result{$metric};
+	}
+	open(my $csv, '>', $baseline_file) or die "Can't write $baseline_file: $!\n";
+	print $csv "metric,baseline,threshold\n";
+	foreach my $metric (@metrics) {
+		my $threshold = exists $threshold{$metric} ? $threshold{$metric} : '';
+		print $csv "$metric,$baseline{$metric},$threshold\n";
+	}
+	close($csv);
+	printf "%s: %d metrics updated, %d kept\n", $baseline_file, scalar @order, @metrics - @order;
+	exit 0;
+}
+
+# compare, regressions first
+my (@regressions, @improvements, @new, @missing);
+my $unchanged = 0;
+foreach my $metric (@order) {
+	if (!exists $baseline{$metric}) {
+		push @new, $metric;
+		next;
+	}
+	my $base = $baseline{$metric};
+	my $threshold = exists $threshold{$metric} ? $threshold{$metric} : $default_threshold;
+	my $change = ($base == 0) ? ($result{$metric} == 0 ? 0 : 100) : ($result{$metric} - $base) * 100 / $base;
+	if ($change > $threshold) {
+		push @regressions, [$metric, $change, $threshold];
+	} elsif ($change < -$threshold) {
+		push @improvements, [$metric, $change, $threshold];
+	} else {
+		$unchanged++;
+	}
+}
+foreach my $metric (@baseline_order) {
+	push @missing, $metric unless exists $result{$metric};
+}
+
+sub print_change {
+	my ($label, $change) = @_;
+	my ($metric, $percent, $threshold) = @$change;
+	# the function or figure, then the page or argument
+	my ($function, $argument) = ($metric =~ /^(.*?\/[^\/]+)(?:\/(.*))?$/);
+	$function = $metric unless defined $function;
+	printf "%-11s %-36s %-8s %10d %10d %+8.1f%% (%s%%)\n", $label, $function, defined $argument ? $argument : '',
+		$baseline{$metric}, $result{$metric}, $percent, $threshold;
+}
+
+printf "\nPerformance against %s\n", $baseline_file;
+printf "%-11s %-36s %-8s %10s %10s %9s\n", '', 'Metric', 'page/arg', 'baseline', 'result', 'change';
+print_change('REGRESSION', $_) foreach @regressions;
+print_change('improved', $_) foreach @improvements;
+printf "%-11s %-36s %-8s %10s %10d\n", 'NO BASELINE', $_, '', '', $result{$_} foreach @new;
+printf "%d unchanged, %d regressions, %d improved, %d without baseline, %d not measured\n",
+	$unchanged, scalar @regressions, scalar @improvements, scalar @new, scalar @missing;
+if (@missing) {
+	my %groups;
+	foreach my $metric (@missing) {
+		my ($group) = split(/\//, $metric);
+		$groups{$group}++;
+	}
+	printf "not measured: %s\n", join(', ', map { "$_ ($groups{$_})" } sort keys %groups);
+}
+if (@new) {
+	print "Add the baseline rows and commit them: perf_gate.pl -u $baseline_file @result_files\n";
+} elsif (@improvements && !@regressions) {
+	print "Update the baseline to keep the improvements: perf_gate.pl -u $baseline_file @result_files\n";
+}
+exit((@regressions || @new) ? 1 : 0);
@@ -0,0 +1,228 @@
+# Perl script for a worst case execution time report of the main loop
+# Run by the wcet_report target of host/CMakeLists.txt or by hand.
+#
+# Usage:	perl wcet_report.pl [-p period] wcet_graph.txt [results...]
+#   -p		control period in ms the paths are checked against (default 10,
+#			the gyro interval)
+#
+# Adds up the worst case of every path of every main loop task described
+# in the call graph (wcet_graph.txt, the format is explained there) from
+#   - CPU time: the cycle counts of bench.c under simavr ("BENCH <name>
+#     <cycles>", the bench_avr output) at 16MHz, or the figures of the
+#     source comments where there is no measurement
+#   - Dynamixel bus: bytes sent at 1Mbps and the reply timeout
+#     of dxl_hal.c ((bytes + 10) * 12us + 250us)
+#   - PC port: 57600 baud, 10 bits per character
+#   - waits and delays as given
+# and lists the paths that take longer than the control period, longest
+# first. The scheduler runs one task at a time to completion (sched.h), so
+# such a path delays every other task by that much: these are the blocking
+# paths to get rid of first. A total with + has terms that weren't
+# measured (it is a lower bound). The longest run of each task measured on
+# the host build (perf_host output, "PERF task_max_us/<task>", virtual
+# time without CPU time) is shown beside the estimate if given.
+#
+# Version: 0.9
+#
+use strict;
+use warnings;
+
+my $cpu_mhz = 16;
+my $dxl_byte_us = 10;				# 1Mbps, 10 bits per byte
+my $dxl_timeout_byte_us = 12;		# dxl_hal_set_timeout
+my $dxl_return_delay_us = 250;
+my $serial_byte_us = 1000000 * 10 / 57600;
+
+my $period_ms = 10;
+if (@ARGV >= 2 && $ARGV[0] eq '-p') {
+	shift @ARGV;
+	$period_ms = shift @ARGV;
+}
+
+# quit unless we have the correct number of command-line args
+my $num_args = $#ARGV + 1;
+if ($num_args < 1 || $period_ms !~ /^\d+(\.\d+)?$/ || $period_ms <= 0) {
+	print "\nNumber of arguments: $num_args\n";
+	print "\nUsage: wcet_report.pl [-p period] wcet_graph.txt [results...] \n";
+	exit 1;
+}
+
+my ($graph_file, @result_files) = @ARGV;
+
+# measurements
+my (%cycles, %host_us);
+foreach my $result_file (@result_files) {
+	open(my $results, '<', $result_file) or die "Can't open $result_file: $!\n";
+	while (my $line = <$results>) {
+		$line =~ s/\r?\n$//;
+		next if ($line =~ /^#/);
+		if ($line =~ /BENCH (\S+) (\d+)/) {
+			$cycles{$1} = $2;
+		} elsif ($line =~ /^PERF task_max_us\/(\S+) (\d+)/) {
+			$host_us{$1} = $2;
+		}
+	}
+	close($results);
+}
+
+# the call graph: functions and paths are lists of terms
+my (%functions, @stages, $terms);
+open(my $graph, '<', $graph_file) or die "Can't open $graph_file: $!\n";
+while (my $line = <$graph>) {
+	$line =~ s/\r?\n$//;
+	$line =~ s/#.*//;
+	next if ($line =~ /^\s*$/);
+	if ($line =~ /^function\s+(\S+)\s*$/) {
+		$terms = $functions{$1} = [];
+	} elsif ($line =~ /^stage\s+(\S+)\s+(\d+)\s*$/) {
+		push @stages, { name => $1, period => $2, paths => [] };
+		undef $terms;
+	} elsif ($line =~ /^path\s+(.+?)\s*$/) {
+		die "$graph_file:$.: path outside a stage\n" unless @stages;
+		$terms = [];
+		push @{$stages[-1]{paths}}, { name => $1, terms => $terms };
+	} elsif ($line =~ /^\s+(\S+)\s*(.*?)\s*$/ && defined $terms) {
+		push @$terms, [$1, split(/\s+/, $2), $.];
+	} else {
+		die "$graph_file:$.: can't read '$line'\n";
+	}
+}
+close($graph);
+
+# cycles of a benchmark, the slowest one for name/*
+sub benchmark_cycles {
+	my ($name) = @_;
+	return $cycles{$name} if ($name !~ /\/\*$/);
+	my $prefix = substr($name, 0, -1);
+	my @matches = map { $cycles{$_} } grep { index($_, $prefix) == 0 } keys %cycles;
+	return undef unless @matches;
+	my $max = 0;
+	foreach (@matches) { $max = $_ if ($_ > $max); }
+	return $max;
+}
+
+# Returns: the worst case of a list of terms, split by kind (us)
+my %not_measured;
+sub add_terms {
+	my ($sum, $list, $depth) = @_;
+	die "$graph_file: function calls nested too deep\n" if ($depth > 20);
+	foreach my $term (@$list) {
+		my ($kind, @args) = @$term;
+		my $line = pop @args;
+		if ($kind eq 'cycles') {
+			my ($name, $count, $fallback) = @args;
+			if (defined $count && $count =~ /^~/) {
+				($fallback, $count) = ($count, 1);
+			}
+			$count = 1 unless defined $count;
+			my $measured = benchmark_cycles($name);
+			if (defined $measured) {
+				$sum->{cpu} += $measured / $cpu_mhz * $count;
+			} elsif (defined $fallback) {
+				$sum->{cpu} += substr($fallback, 1) * $count;
+				$sum->{estimated} = 1;
+			} else {
+				$sum->{unknown}++;
+				$not_measured{$name} = 1;
+			}
+		} elsif ($kind eq 'estimate') {
+			$sum->{cpu} += $args[0] * (defined $args[1] ? $args[1] : 1);
+			$sum->{estimated} = 1;
+		} elsif ($kind eq 'bus') {
+			my ($tx, $rx, $count) = @args;
+			my $reply = ($rx > 0) ? ($rx + 10) * $dxl_timeout_byte_us + $dxl_return_delay_us : 0;
+			$sum->{bus} += ($tx * $dxl_byte_us + $reply) * (defined $count ? $count : 1);
+		} elsif ($kind eq 'serial') {
+			$sum->{serial} += $args[0] * $serial_byte_us * (defined $args[1] ? $args[1] : 1);
+		} elsif ($kind eq 'wait') {
+			$sum->{wait} += $args[0] * (defined $args[1] ? $args[1] : 1);
+		} elsif ($kind eq 'call') {
+			my ($name, $count) = @args;
+			die "$graph_file:$line: no function $name\n" unless exists $functions{$name};
+			add_terms($sum, $functions{$name}, $depth + 1) for (1 .. (defined $count ? $count : 1));
+		} elsif ($kind eq 'unbounded') {
+			$sum->{unbounded} = 1;
+		} else {
+			die "$graph_file:$line: unknown term $kind\n";
+		}
+	}
+}
+
+# the worst case of every path
+my @paths;
+foreach my $stage (@stages) {
+	foreach my $path (@{$stage->{paths}}) {
+		my %sum = (cpu => 0, bus => 0, serial => 0, wait => 0, unknown => 0, estimated => 0, unbounded => 0);
+		add_terms(\%sum, $path->{terms}, 0);
+		$sum{total} = $sum{cpu} + $sum{bus} + $sum{serial} + $sum{wait};
+		$path->{sum} = \%sum;
+		$path->{stage} = $stage;
+		push @paths, $path;
+		$stage->{worst} = $path if (!defined $stage->{worst} || longer($path, $stage->{worst}));
+	}
+}
+
+sub longer {
+	my ($x, $y) = @_;
+	return $x->{sum}{unbounded} > $y->{sum}{unbounded}
+		|| ($x->{sum}{unbounded} == $y->{sum}{unbounded} && $x->{sum}{total} > $y->{sum}{total});
+}
+
+sub total {
+	my ($sum) = @_;
+	return 'unbounded' if ($sum->{unbounded});
+	return sprintf("%.0f%s", $sum->{total}, $sum->{unknown} ? '+' : '');
+}
+
+sub breaks_period {
+	my ($sum) = @_;
+	return $sum->{unbounded} || $sum->{total} > $period_ms * 1000;
+}
+
+my $measurements = (%cycles) ? 'bench.c under simavr' : 'no simavr measurements, CPU time from the source comments only';
+printf "\nWorst case per path (us), control period %s ms, %s\n", $period_ms, $measurements;
+printf "%-5s %6s %-30s %9s %9s %9s %10s %11s\n", 'Task', 'period', 'Path', 'CPU', 'bus', 'serial', 'wait', 'total';
+foreach my $stage (@stages) {
+	my $first = 1;
+	foreach my $path (@{$stage->{paths}}) {
+		my $sum = $path->{sum};
+		printf "%-5s %6s %-30s %8.0f%1s %9.0f %9.0f %10.0f %10s%1s\n", $first ? $stage->{name} : '',
+			$first ? "$stage->{period}ms" : '', $path->{name}, $sum->{cpu}, $sum->{estimated} ? '~' : ' ', $sum->{bus},
+			$sum->{serial}, $sum->{wait}, total($sum), breaks_period($sum) ? '!' : ' ';
+		$first = 0;
+	}
+}
+
+# per task: the longest path against the task's own period and the control period
+printf "\nBudget per task (longest path)\n";
+printf "%-5s %-30s %11s %12s %14s %10s\n", 'Task', 'Path', 'worst us', '% of period', '% of control', 'host max';
+foreach my $stage (@stages) {
+	my $sum = $stage->{worst}{sum};
+	my $host = exists $host_us{$stage->{name}} ? $host_us{$stage->{name}} : '';
+	if ($sum->{unbounded}) {
+		printf "%-5s %-30s %11s %12s %14s %10s\n", $stage->{name}, $stage->{worst}{name}, 'unbounded', '-', '-', $host;
+	} else {
+		printf "%-5s %-30s %11s %11.0f%% %13.0f%% %10s\n", $stage->{name}, $stage->{worst}{name}, total($sum),
+			$sum->{total} / ($stage->{period} * 10), $sum->{total} / ($period_ms * 10), $host;
+	}
+}
+
+# the paths that break the control period, longest first, with what takes the time
+my @breaking = sort { longer($b, $a) ? 1 : (longer($a, $b) ? -1 : 0) } grep { breaks_period($_->{sum}) } @paths;
+printf "\n%d paths longer than the control period of %s ms, longest first:\n", scalar @breaking, $period_ms;
+foreach my $path (@breaking) {
+	my $sum = $path->{sum};
+	my @parts;
+	foreach my $part (sort { $sum->{$b} <=> $sum->{$a} } qw(wait serial bus cpu)) {
+		push @parts, sprintf("%s %.1fms", $part, $sum->{$part} / 1000) if ($sum->{$part} >= 50);
+	}
+	push @parts, 'waits for the user' if ($sum->{unbounded});
+	printf "  %-5s %-30s %11s  %s\n", $path->{stage}{name}, $path->{name},
+		$sum->{unbounded} ? 'unbounded' : sprintf("%.1fms%s", $sum->{total} / 1000, $sum->{unknown} ? '+' : ''), join(', ', @parts);
+}
+
+# the main loop is as slow as its slowest path, bounded ones only
+my ($slowest) = grep { !$_->{sum}{unbounded} } sort { $b->{sum}{total} <=> $a->{sum}{total} } @paths;
+printf "Main loop worst case (bounded paths): %s %s, %.1fms\n", $slowest->{stage}{name}, $slowest->{name},
+	$slowest->{sum}{total} / 1000 if (defined $slowest);
+printf "Not measured (+): %s\n", join(', ', sort keys %not_measured) if (%not_measured);
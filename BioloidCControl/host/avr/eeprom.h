@@ -0,0 +1,18 @@
+/*
+ * avr/eeprom.h - Host stand-in for the avr-libc header. EEMEM variables
+ *   are ordinary RAM on the host, cleared at start-up and lost at exit.
+ */
+
+#ifndef HOST_AVR_EEPROM_H_
+#define HOST_AVR_EEPROM_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define EEMEM
+#define eeprom_read_byte(addr)					(*(const uint8_t *)(addr))
+#define eeprom_update_byte(addr, value)			(*(uint8_t *)(addr) = (value))
+#define eeprom_read_block(dst, src, n)			memcpy((dst), (src), (n))
+#define eeprom_update_block(src, dst, n)		memcpy((dst), (src), (n))
+
+#endif /* HOST_AVR_EEPROM_H_ */
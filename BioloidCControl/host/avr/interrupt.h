@@ -0,0 +1,19 @@
+/*
+ * avr/interrupt.h - Host stand-in for the avr-libc header. cli and sei
+ *   change the I bit of the status register, the virtual clock of the
+ *   host build (hal_host.c) only calls the interrupt service routines
+ *   while it is set. ISRs are plain functions named after the vector.
+ */
+
+#ifndef HOST_AVR_INTERRUPT_H_
+#define HOST_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define cli()					(host_sreg &= (uint8_t) ~0x80)
+#define sei()					(host_sreg |= 0x80)
+#define ISR(vector, ...)		void vector(void)
+#define SIGNAL(vector)			void vector(void)
+#define ISR_ALIASOF(vector)
+
+#endif /* HOST_AVR_INTERRUPT_H_ */
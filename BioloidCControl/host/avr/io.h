@@ -0,0 +1,39 @@
+/*
+ * avr/io.h - Host stand-in for the avr-libc header, just enough to compile
+ *   the firmware modules for the host build and the host simulations.
+ *   The peripherals are reached through hal.h, only the status register
+ *   and the watchdog registers are left here, as plain variables.
+ */
+
+#ifndef HOST_AVR_IO_H_
+#define HOST_AVR_IO_H_
+
+#include <stdint.h>
+
+#define _BV(bit)				(1 << (bit))
+#define bit_is_set(sfr, bit)	((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit)	(!((sfr) & _BV(bit)))
+
+// status register, only the I bit is used (cli/sei in avr/interrupt.h)
+extern volatile uint8_t host_sreg;
+#define SREG					host_sreg
+#define SREG_I					7
+
+// reset cause and watchdog (watchdog.c), the watchdog never fires on the host
+extern volatile uint8_t host_mcusr;
+extern volatile uint8_t host_wdtcsr;
+#define MCUSR					host_mcusr
+#define WDTCSR					host_wdtcsr
+#define PORF					0
+#define EXTRF					1
+#define BORF					2
+#define WDRF					3
+#define WDP0					0
+#define WDP1					1
+#define WDP2					2
+#define WDE						3
+#define WDCE					4
+#define WDP3					5
+#define WDIE					6
+
+#endif /* HOST_AVR_IO_H_ */
@@ -0,0 +1,50 @@
+/*
+ * avr/pgmspace.h - Host stand-in for the avr-libc header. There is only
+ *   one address space on the host, Flash reads are plain reads.
+ *   Pointers are 64 bits on the host, pgm_read_word reads a whole pointer
+ *   when it is given the address of one (pointer tables in Flash).
+ */
+
+#ifndef HOST_AVR_PGMSPACE_H_
+#define HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P					const char *
+#define PSTR(s)					(s)
+#define pgm_read_byte(addr)		(*(const uint8_t *)(addr))
+#define pgm_read_word(addr)		__builtin_choose_expr(sizeof(*(addr)) == sizeof(void *), \
+									host_pgm_read_ptr(addr), host_pgm_read_word(addr))
+#define pgm_read_dword(addr)	host_pgm_read_dword(addr)
+#define strcpy_P				strcpy
+#define strncpy_P				strncpy
+#define memcpy_P				memcpy
+
+// the firmware reads words from byte arrays, don't rely on the alignment
+static inline uint16_t host_pgm_read_word(const void *addr)
+{
+	uint16_t value;
+
+	memcpy(&value, addr, sizeof(value));
+	return value;
+}
+
+static inline uint32_t host_pgm_read_dword(const void *addr)
+{
+	uint32_t value;
+
+	memcpy(&value, addr, sizeof(value));
+	return value;
+}
+
+static inline uintptr_t host_pgm_read_ptr(const void *addr)
+{
+	uintptr_t value;
+
+	memcpy(&value, addr, sizeof(value));
+	return value;
+}
+
+#endif /* HOST_AVR_PGMSPACE_H_ */
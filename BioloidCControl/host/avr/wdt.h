@@ -0,0 +1,25 @@
+/*
+ * avr/wdt.h - Host stand-in for the avr-libc header. The watchdog never
+ *   fires on the host, the virtual clock has no timeout to watch.
+ */
+
+#ifndef HOST_AVR_WDT_H_
+#define HOST_AVR_WDT_H_
+
+#include <avr/io.h>
+
+#define WDTO_15MS				0
+#define WDTO_30MS				1
+#define WDTO_60MS				2
+#define WDTO_120MS				3
+#define WDTO_250MS				4
+#define WDTO_500MS				5
+#define WDTO_1S					6
+#define WDTO_2S					7
+#define WDTO_4S					8
+#define WDTO_8S					9
+
+#define wdt_reset()
+#define wdt_disable()			(host_wdtcsr = 0)
+
+#endif /* HOST_AVR_WDT_H_ */
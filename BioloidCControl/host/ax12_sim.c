@@ -0,0 +1,588 @@
+/*
+ * ax12_sim.c - Simulated AX-12 servos on the Dynamixel bus of the host build
+ *   Decodes the instruction packets the firmware sends on USART0, runs them
+ *   on the control tables of the simulated servos and sends the status
+ *   packets back through the UART receive path (see ax12_sim.h).
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "global.h"
+#include "dynamixel.h"
+#include "hal_host.h"
+#include "ax12_sim.h"
+
+// position units (0.29 degree) per second for one moving speed unit (0.111rpm)
+#define AX12_POS_PER_SPEED	(0.111 * 360.0 / 60.0 / (300.0 / 1023.0))
+#define AX12_PACKET			(255 + 4)		// longest instruction packet
+
+// packet byte positions (as in dynamixel.c)
+#define ID					(2)
+#define LENGTH				(3)
+#define INSTRUCTION			(4)
+#define ERRBIT				(4)
+#define PARAMETER			(5)
+
+// the servos on the bus
+static ax12_servo servos[AX12_SIM_MAX_SERVOS];
+static uint8 num_servos = 0;
+static ax12_sim_stats stats;
+
+// instruction packet being received
+static uint8 packet[AX12_PACKET];
+static uint16 packet_count = 0;
+
+// random faults (ax12_sim_setFaults)
+static ax12_sim_faults faults;
+static uint64_t fault_state = 1;
+
+// packet monitor (ax12_sim_setMonitor)
+static ax12_sim_monitor monitor = NULL;
+static void *monitor_context = NULL;
+
+// internal function prototypes
+static void ax12_sim_receive(void *context, uint8 data, uint64_t ticks);
+static void ax12_sim_packet(uint64_t ticks);
+static void ax12_reset(ax12_servo *s, uint8 id);
+static uint8 ax12_execute(ax12_servo *s, uint8 instruction, const uint8 *params, uint8 count, uint8 *reply, uint8 *reply_length);
+static uint8 ax12_write(ax12_servo *s, uint8 address, const uint8 *data, uint8 length);
+static void ax12_reply(ax12_servo *s, uint8 error, const uint8 *params, uint8 count, uint64_t ticks);
+static void ax12_update(ax12_servo *s, uint64_t ticks);
+static void ax12_step(ax12_servo *s, double dt);
+static uint8 ax12_errors(const ax12_servo *s);
+static uint8 ax12_fault(double rate);
+
+static inline uint16 ax12_word(const ax12_servo *s, uint8 address)
+{
+	return s->table[address] | (s->table[address+1] << 8);
+}
+
+static inline void ax12_setWord(ax12_servo *s, uint8 address, uint16 value)
+{
+	s->table[address] = value & 0xFF;
+	s->table[address+1] = value >> 8;
+}
+
+
+// attach count servos with the given IDs to the bus, in their power-on
+// state at position 512 (call after host_reset)
+void ax12_sim_init(uint8 count, const uint8 ids[])
+{
+	uint8 i;
+
+	if ( count > AX12_SIM_MAX_SERVOS ) {
+		count = AX12_SIM_MAX_SERVOS;
+	}
+	memset(servos, 0, sizeof(servos));
+	memset(&stats, 0, sizeof(stats));
+	for (i=0; i<count; i++) {
+		ax12_reset(&servos[i], ids[i]);
+		servos[i].position = 512;
+		ax12_setWord(&servos[i], DXL_GOAL_POSITION_L, 512);
+		ax12_setWord(&servos[i], DXL_PRESENT_POSITION_L, 512);
+	}
+	num_servos = count;
+	packet_count = 0;
+	memset(&faults, 0, sizeof(faults));
+	monitor = NULL;
+	host_uartListen(HAL_UART_DXL, ax12_sim_receive, NULL);
+}
+
+// Returns:	(ax12_servo *) the servo with an ID, NULL if there is none
+ax12_servo *ax12_sim_servo(uint8 id)
+{
+	uint8 i;
+
+	for (i=0; i<num_servos; i++) {
+		if ( servos[i].table[DXL_ID] == id ) {
+			return &servos[i];
+		}
+	}
+	return NULL;
+}
+
+// Returns:	(uint16) present position of a servo (0 if there is none)
+uint16 ax12_sim_position(uint8 id)
+{
+	ax12_servo *s = ax12_sim_servo(id);
+
+	if ( s == NULL ) {
+		return 0;
+	}
+	ax12_update(s, host_ticks());
+	return ax12_word(s, DXL_PRESENT_POSITION_L);
+}
+
+// move a servo to a position (by hand, the goal position follows)
+void ax12_sim_setPosition(uint8 id, uint16 position)
+{
+	ax12_servo *s = ax12_sim_servo(id);
+
+	if ( s != NULL ) {
+		ax12_update(s, host_ticks());
+		s->position = position;
+		s->velocity = 0;
+		ax12_setWord(s, DXL_GOAL_POSITION_L, position);
+		ax12_setWord(s, DXL_PRESENT_POSITION_L, position);
+	}
+}
+
+// set the external load on a servo (0-1023 of the maximum torque)
+void ax12_sim_setLoad(uint8 id, uint16 load)
+{
+	ax12_servo *s = ax12_sim_servo(id);
+
+	if ( s != NULL ) {
+		ax12_update(s, host_ticks());
+		s->load = load;
+	}
+}
+
+// the next count replies of a servo are not sent (BROADCAST_ID for all servos)
+void ax12_sim_dropReplies(uint8 id, uint16 count)
+{
+	uint8 i;
+
+	for (i=0; i<num_servos; i++) {
+		if ( id == BROADCAST_ID || servos[i].table[DXL_ID] == id ) {
+			servos[i].drop_replies = count;
+		}
+	}
+}
+
+// the next count replies of a servo have a wrong checksum (BROADCAST_ID for all servos)
+void ax12_sim_corruptReplies(uint8 id, uint16 count)
+{
+	uint8 i;
+
+	for (i=0; i<num_servos; i++) {
+		if ( id == BROADCAST_ID || servos[i].table[DXL_ID] == id ) {
+			servos[i].corrupt_replies = count;
+		}
+	}
+}
+
+// inject random faults at the given rates (NULL for none), the random
+// sequence starts from seed so a run can be repeated
+void ax12_sim_setFaults(const ax12_sim_faults *rates, uint32 seed)
+{
+	if ( rates != NULL ) {
+		faults = *rates;
+	} else {
+		memset(&faults, 0, sizeof(faults));
+	}
+	fault_state = 0x9E3779B97F4A7C15ULL ^ seed;
+}
+
+// watch the packets on the bus (NULL to stop), ax12_sim_init removes the monitor
+void ax12_sim_setMonitor(ax12_sim_monitor function, void *context)
+{
+	monitor = function;
+	monitor_context = context;
+}
+
+// Returns:	(const ax12_sim_stats *) bus statistics since ax12_sim_init
+const ax12_sim_stats *ax12_sim_getStats()
+{
+	return &stats;
+}
+
+
+// Bus
+
+// every byte the firmware sends: find 0xFF 0xFF ID LENGTH and collect the packet
+static void ax12_sim_receive(void *context, uint8 data, uint64_t ticks)
+{
+	(void) context;
+	stats.bytes_tx++;
+	if ( ax12_fault(faults.drop_byte) ) {
+		stats.bytes_dropped++;
+		return;
+	}
+	if ( packet_count < 2 && data != 0xFF ) {
+		packet_count = 0;
+		return;
+	}
+	// more than two 0xFF before the ID
+	if ( packet_count == 2 && data == 0xFF ) {
+		return;
+	}
+	packet[packet_count++] = data;
+	if ( packet_count < 4 ) {
+		return;
+	}
+	if ( packet[LENGTH] < 2 ) {
+		packet_count = 0;
+		return;
+	}
+	if ( packet_count == packet[LENGTH] + 4 ) {
+		ax12_sim_packet(ticks);
+		packet_count = 0;
+	}
+}
+
+// a complete instruction packet, ticks is the time its last byte was out
+static void ax12_sim_packet(uint64_t ticks)
+{
+	uint8 reply[AX12_SIM_TABLE];
+	uint8 reply_length, error, checksum = 0;
+	uint8 length = packet[LENGTH];
+	uint8 id = packet[ID];
+	uint8 instruction = packet[INSTRUCTION];
+	uint8 *params = &packet[PARAMETER];
+	uint8 count = length - 2;
+	uint8 divisor = host_uartByteTicks(HAL_UART_DXL) / 10 - 1;
+	uint16 i, j, item;
+	ax12_servo *s;
+
+	stats.packets++;
+	if ( monitor != NULL ) {
+		monitor(monitor_context, 0, packet, length + 4, ticks);
+	}
+	for (i=ID; i<length+3; i++) {
+		checksum += packet[i];
+	}
+	checksum = ~checksum;
+	if ( checksum != packet[length+3] ) {
+		stats.bad_checksums++;
+	}
+
+	for (i=0; i<num_servos; i++)
+	{
+		s = &servos[i];
+		// a servo at another baud rate doesn't understand the bus
+		if ( s->table[DXL_BAUD_RATE] != divisor ) {
+			continue;
+		}
+		if ( id != s->table[DXL_ID] && id != BROADCAST_ID ) {
+			continue;
+		}
+		ax12_update(s, ticks);
+		if ( checksum != packet[length+3] ) {
+			if ( id != BROADCAST_ID && s->table[DXL_STATUS_RETURN_LEVEL] == 2 ) {
+				ax12_reply(s, ERRBIT_CHECKSUM | ax12_errors(s), NULL, 0, ticks);
+			}
+			continue;
+		}
+		s->instructions++;
+		if ( instruction == INST_SYNC_WRITE ) {
+			// start address, data length per servo, then ID and data for each servo
+			if ( id != BROADCAST_ID || count < 2 ) {
+				continue;
+			}
+			item = params[1] + 1;
+			for (j=2; j+item<=count; j+=item) {
+				if ( params[j] == s->table[DXL_ID] ) {
+					ax12_write(s, params[0], &params[j+1], params[1]);
+				}
+			}
+			continue;
+		}
+		reply_length = 0;
+		error = ax12_execute(s, instruction, params, count, reply, &reply_length);
+		// broadcasts don't get a reply, the status return level decides the rest
+		if ( id == BROADCAST_ID ) {
+			continue;
+		}
+		if ( instruction == INST_PING || s->table[DXL_STATUS_RETURN_LEVEL] == 2
+			|| (instruction == INST_READ && s->table[DXL_STATUS_RETURN_LEVEL] == 1) ) {
+			ax12_reply(s, error, reply, reply_length, ticks);
+		}
+	}
+}
+
+// send a status packet after the return delay, unless a fault is injected
+static void ax12_reply(ax12_servo *s, uint8 error, const uint8 *params, uint8 count, uint64_t ticks)
+{
+	uint8 status[AX12_SIM_TABLE + 6];
+	uint8 checksum = 0;
+	uint8 i, length;
+
+	if ( s->drop_replies > 0 || ax12_fault(faults.timeout) ) {
+		if ( s->drop_replies > 0 ) {
+			s->drop_replies--;
+		}
+		stats.dropped++;
+		return;
+	}
+	// the alarm starts with this reply
+	if ( ax12_fault(faults.alarm) ) {
+		s->alarm_end = ticks + (uint64_t) faults.alarm_ms * 1000 * HOST_TICKS_PER_US;
+		if ( s->table[DXL_ALARM_SHUTDOWN] & ERRBIT_OVERHEAT ) {
+			s->table[DXL_TORQUE_ENABLE] = 0;
+			s->velocity = 0;
+		}
+		error |= ERRBIT_OVERHEAT;
+		stats.alarms++;
+	}
+	status[0] = 0xFF;
+	status[1] = 0xFF;
+	status[ID] = s->table[DXL_ID];
+	status[LENGTH] = count + 2;
+	status[ERRBIT] = error;
+	if ( count > 0 ) {
+		memcpy(&status[PARAMETER], params, count);
+	}
+	for (i=ID; i<count+5; i++) {
+		checksum += status[i];
+	}
+	status[count+5] = ~checksum;
+	if ( s->corrupt_replies > 0 || ax12_fault(faults.corrupt) ) {
+		if ( s->corrupt_replies > 0 ) {
+			s->corrupt_replies--;
+		}
+		status[count+5] ^= 0x55;
+		stats.corrupted++;
+	}
+	// bytes lost on the way, the rest arrives back to back
+	length = 0;
+	for (i=0; i<count+6; i++) {
+		if ( ax12_fault(faults.drop_byte) ) {
+			stats.bytes_dropped++;
+		} else {
+			status[length++] = status[i];
+		}
+	}
+	ticks += (uint64_t) s->table[DXL_RETURN_DELAY_TIME] * 2 * HOST_TICKS_PER_US;
+	if ( monitor != NULL ) {
+		monitor(monitor_context, 1, status, length, ticks);
+	}
+	host_uartReceive(HAL_UART_DXL, ticks, status, length);
+	s->replies++;
+	stats.replies++;
+	stats.bytes_rx += count + 6;
+}
+
+// Returns:	(uint8) 1 with the probability rate (xorshift, see ax12_sim_setFaults)
+static uint8 ax12_fault(double rate)
+{
+	if ( rate <= 0 ) {
+		return 0;
+	}
+	fault_state ^= fault_state << 13;
+	fault_state ^= fault_state >> 7;
+	fault_state ^= fault_state << 17;
+	return (fault_state >> 11) * (1.0 / 9007199254740992.0) < rate;
+}
+
+
+// Servo
+
+// control table at power-on (the AX-12 defaults, dynamixel.h)
+static void ax12_reset(ax12_servo *s, uint8 id)
+{
+	static const uint8 defaults[AX12_SIM_TABLE] = {
+		12, 0, 24, 1, 1, AX12_SIM_RETURN_DELAY, 0, 0, 0xFF, 0x03,	// 0-9
+		0, 70, 70, 140, 0xFF, 0x03, 2, 36, 36, 0,					// 10-19
+		0, 0, 0, 0, 0, 0, 1, 1, 32, 32,								// 20-29
+		0, 0, 0, 0, 0xFF, 0x03, 0, 0, 0, 0,							// 30-39
+		0, 0, 120, 40, 0, 0, 0, 0, 32, 0							// 40-49
+	};
+
+	memcpy(s->table, defaults, sizeof(defaults));
+	s->table[DXL_ID] = id;
+	ax12_setWord(s, DXL_GOAL_POSITION_L, (uint16)(s->position + 0.5));
+	ax12_setWord(s, DXL_PRESENT_POSITION_L, (uint16)(s->position + 0.5));
+	s->reg_length = 0;
+	s->velocity = 0;
+	s->stalled = 0;
+	s->updated = host_ticks();
+}
+
+// run an instruction for this servo
+// Returns:	(uint8) error bits of the status packet
+static uint8 ax12_execute(ax12_servo *s, uint8 instruction, const uint8 *params, uint8 count, uint8 *reply, uint8 *reply_length)
+{
+	uint8 error = 0;
+
+	switch ( instruction )
+	{
+		case INST_PING:
+			break;
+		case INST_READ:
+			if ( count != 2 || params[0] + params[1] > AX12_SIM_TABLE ) {
+				error = ERRBIT_RANGE;
+				break;
+			}
+			memcpy(reply, &s->table[params[0]], params[1]);
+			*reply_length = params[1];
+			break;
+		case INST_WRITE:
+			if ( count < 2 ) {
+				error = ERRBIT_INSTRUCTION;
+				break;
+			}
+			error = ax12_write(s, params[0], &params[1], count - 1);
+			break;
+		case INST_REG_WRITE:
+			if ( count < 2 || params[0] + count - 1 > AX12_SIM_TABLE ) {
+				error = ERRBIT_RANGE;
+				break;
+			}
+			s->reg_address = params[0];
+			s->reg_length = count - 1;
+			memcpy(s->reg_data, &params[1], count - 1);
+			s->table[DXL_REGISTERED_INSTRUCTION] = 1;
+			break;
+		case INST_ACTION:
+			if ( s->reg_length == 0 ) {
+				error = ERRBIT_INSTRUCTION;
+				break;
+			}
+			error = ax12_write(s, s->reg_address, s->reg_data, s->reg_length);
+			s->reg_length = 0;
+			s->table[DXL_REGISTERED_INSTRUCTION] = 0;
+			break;
+		case INST_RESET:
+			// back to the factory settings, ID 1 included
+			ax12_reset(s, 1);
+			break;
+		default:
+			error = ERRBIT_INSTRUCTION;
+			break;
+	}
+	return error | ax12_errors(s);
+}
+
+// write to the control table, read-only bytes are left alone
+// Returns:	(uint8) error bits
+static uint8 ax12_write(ax12_servo *s, uint8 address, const uint8 *data, uint8 length)
+{
+	uint8 old_goal[2];
+	uint8 a, i;
+	uint16 goal, cw, ccw;
+
+	if ( address + length > AX12_SIM_TABLE ) {
+		return ERRBIT_RANGE;
+	}
+	old_goal[0] = s->table[DXL_GOAL_POSITION_L];
+	old_goal[1] = s->table[DXL_GOAL_POSITION_H];
+	for (i=0; i<length; i++)
+	{
+		a = address + i;
+		if ( a <= DXL_FIRMWARE_VERSION || (a >= DXL_PRESENT_POSITION_L && a <= DXL_REGISTERED_INSTRUCTION) || a == DXL_MOVING ) {
+			continue;
+		}
+		s->table[a] = data[i];
+	}
+	// a new goal position within the angle limits switches the torque on
+	if ( address <= DXL_GOAL_POSITION_H && address + length > DXL_GOAL_POSITION_L ) {
+		goal = ax12_word(s, DXL_GOAL_POSITION_L);
+		cw = ax12_word(s, DXL_CW_ANGLE_LIMIT_L);
+		ccw = ax12_word(s, DXL_CCW_ANGLE_LIMIT_L);
+		if ( goal > 1023 || goal < cw || goal > ccw ) {
+			s->table[DXL_GOAL_POSITION_L] = old_goal[0];
+			s->table[DXL_GOAL_POSITION_H] = old_goal[1];
+			return ERRBIT_ANGLE;
+		}
+		s->table[DXL_TORQUE_ENABLE] = 1;
+		s->stalled = 0;
+	}
+	if ( s->table[DXL_TORQUE_ENABLE] == 0 ) {
+		s->velocity = 0;
+	}
+	return 0;
+}
+
+// Returns:	(uint8) error bits of the state of the servo
+static uint8 ax12_errors(const ax12_servo *s)
+{
+	uint8 error = 0;
+
+	if ( s->table[DXL_PRESENT_VOLTAGE] < s->table[DXL_LOW_VOLTAGE_LIMIT]
+		|| s->table[DXL_PRESENT_VOLTAGE] > s->table[DXL_HIGH_VOLTAGE_LIMIT] ) {
+		error |= ERRBIT_VOLTAGE;
+	}
+	if ( s->stalled ) {
+		error |= ERRBIT_OVERLOAD;
+	}
+	if ( s->updated < s->alarm_end ) {
+		error |= ERRBIT_OVERHEAT;
+	}
+	return error;
+}
+
+// bring the position up to ticks in AX12_SIM_STEP_US steps and update
+// the present values in the control table
+static void ax12_update(ax12_servo *s, uint64_t ticks)
+{
+	const uint64_t step = AX12_SIM_STEP_US * HOST_TICKS_PER_US;
+	uint16 speed, load;
+
+	while ( s->updated + step <= ticks ) {
+		s->updated += step;
+		ax12_step(s, AX12_SIM_STEP_US * 1e-6);
+	}
+	// speed and load: bit 10 is the direction (set for clockwise)
+	speed = (uint16)(fabs(s->velocity) / AX12_POS_PER_SPEED + 0.5);
+	load = s->stalled ? ax12_word(s, DXL_TORQUE_LIMIT_L) : s->load;
+	if ( speed > 0x3FF ) speed = 0x3FF;
+	if ( load > 0x3FF ) load = 0x3FF;
+	if ( s->velocity < 0 ) {
+		speed |= 0x400;
+		load |= 0x400;
+	}
+	ax12_setWord(s, DXL_PRESENT_POSITION_L, (uint16)(s->position + 0.5));
+	ax12_setWord(s, DXL_PRESENT_SPEED_L, speed);
+	ax12_setWord(s, DXL_PRESENT_LOAD_L, load);
+	s->table[DXL_MOVING] = ( s->velocity != 0 );
+}
+
+// first order lag to the goal position, limited by the moving speed and the load
+static void ax12_step(ax12_servo *s, double dt)
+{
+	double error, limit, vmax, v;
+	uint16 speed, torque;
+	uint8 margin;
+
+	// the alarm shutdown keeps the torque off while the servo overheats
+	if ( s->updated < s->alarm_end && (s->table[DXL_ALARM_SHUTDOWN] & ERRBIT_OVERHEAT) ) {
+		s->table[DXL_TORQUE_ENABLE] = 0;
+	}
+	if ( s->table[DXL_TORQUE_ENABLE] == 0 ) {
+		s->velocity = 0;
+		return;
+	}
+	error = ax12_word(s, DXL_GOAL_POSITION_L) - s->position;
+	margin = ( error > 0 ) ? s->table[DXL_CCW_COMPLIANCE_MARGIN] : s->table[DXL_CW_COMPLIANCE_MARGIN];
+	if ( fabs(error) <= (margin > 0 ? margin : 0.5) ) {
+		s->velocity = 0;
+		s->stalled = 0;
+		return;
+	}
+	torque = ax12_word(s, DXL_TORQUE_LIMIT_L);
+	if ( s->load >= torque ) {
+		// stalled: overload, torque off if the alarm shutdown says so
+		s->velocity = 0;
+		s->stalled = 1;
+		if ( s->table[DXL_ALARM_SHUTDOWN] & ERRBIT_OVERLOAD ) {
+			s->table[DXL_TORQUE_ENABLE] = 0;
+		}
+		return;
+	}
+	s->stalled = 0;
+	speed = ax12_word(s, DXL_MOVING_SPEED_L) & 0x3FF;
+	if ( speed == 0 || speed > AX12_SIM_MAX_SPEED ) {
+		speed = AX12_SIM_MAX_SPEED;
+	}
+	limit = 1.0 - (double) s->load / torque;
+	vmax = speed * AX12_POS_PER_SPEED * limit;
+	v = error / AX12_SIM_TAU;
+	if ( v > vmax ) v = vmax;
+	if ( v < -vmax ) v = -vmax;
+	s->velocity = v;
+	s->position += v * dt;
+}
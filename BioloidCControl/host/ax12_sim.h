@@ -0,0 +1,157 @@
+/*
+ * ax12_sim.h - Simulated AX-12 servos on the Dynamixel bus of the host build
+ *   A software model of up to AX12_SIM_MAX_SERVOS AX-12 servos attached to
+ *   USART0 of the stub devices (hal_host.h), so that dxl_init,
+ *   readCurrentPose, executeMotionSequence and the rest of the bus code run
+ *   unmodified on the host.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Operation
+ *
+ * The servos listen to every byte the firmware sends on the bus (the
+ * dxl_hal_tx path of dxl_hal.c) and take the instruction packets for their
+ * ID or the broadcast ID: PING, READ, WRITE, REG_WRITE, ACTION, RESET and
+ * SYNC_WRITE on a 50 byte control table (addresses in dynamixel.h). A
+ * servo only understands the bus at the baud rate in its control table.
+ * The status packet goes back through the UART receive path after the
+ * return delay (2us per unit of DXL_RETURN_DELAY_TIME) at the bus baud
+ * rate, so it arrives byte by byte in the USART0 receive interrupt and is
+ * lost if the firmware hasn't switched the bus back to receive. The
+ * status return level decides which instructions get one, like on the
+ * servo.
+ *
+ * Position: the present position follows the goal position as a first
+ * order lag (AX12_SIM_TAU) limited by the moving speed (0 = the no-load
+ * speed, 0x212 = 59rpm at 12V) and slowed down by the load set with
+ * ax12_sim_setLoad. A load at or above the torque limit stalls the servo
+ * with an overload error, the torque is switched off if the alarm shutdown
+ * bit is set. The servo stops moving within its compliance margin.
+ * Positions are updated lazily to the time of each instruction.
+ *
+ * Faults: replies can be dropped (the firmware sees a timeout) or sent
+ * with a wrong checksum, per servo for the next n instructions that would
+ * get a reply. ax12_sim_setFaults adds random faults at given rates: lost
+ * replies, wrong checksums, bytes lost on the bus in either direction (a
+ * short status packet, or an instruction packet the servos don't take)
+ * and overheating alarms. An alarm sets the overheating error bit for
+ * alarm_ms and switches the torque off while it lasts if the alarm
+ * shutdown says so, the torque stays off until it is enabled again.
+ *
+ * Monitor: a function set with ax12_sim_setMonitor sees every complete
+ * packet on the bus, the instruction packets when their last byte is out
+ * and the status packets when their first byte goes back (dropped replies
+ * are never seen, corrupted ones as sent, short ones as received).
+ */
+
+#ifndef AX12_SIM_H_
+#define AX12_SIM_H_
+
+#include <stdint.h>
+#include "global.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define AX12_SIM_MAX_SERVOS		32
+#define AX12_SIM_TABLE			50		// control table bytes (addresses 0-49)
+#define AX12_SIM_RETURN_DELAY	0		// return delay the Bioloid servos are set up with (2us units)
+#define AX12_SIM_TAU			0.015	// time constant of the position loop (s)
+#define AX12_SIM_MAX_SPEED		530		// no-load speed at 12V (moving speed units, 59rpm)
+#define AX12_SIM_STEP_US		1000	// integration step of the position
+
+// a simulated servo
+typedef struct {
+	uint8 table[AX12_SIM_TABLE];	// control table
+	uint8 reg_data[AX12_SIM_TABLE];	// data of the registered (REG_WRITE) instruction
+	uint8 reg_address;
+	uint8 reg_length;
+	double position;				// present position (0.29 degree units)
+	double velocity;				// units/s
+	uint16 load;					// external load (0-1023 of the maximum torque)
+	uint8 stalled;
+	uint64_t updated;				// position is up to date at this time (ticks)
+	uint16 drop_replies;			// faults for the next replies
+	uint16 corrupt_replies;
+	uint64_t alarm_end;				// overheating until this time (ticks)
+	uint32 instructions;			// instruction packets taken
+	uint32 replies;					// status packets sent
+} ax12_servo;
+
+// bus statistics
+typedef struct {
+	uint32 packets;					// instruction packets seen
+	uint32 bad_checksums;			// of those with a wrong checksum
+	uint32 replies;					// status packets sent
+	uint32 dropped;					// replies dropped by fault injection
+	uint32 corrupted;				// replies sent with a wrong checksum
+	uint32 bytes_dropped;			// bytes lost on the bus (both directions)
+	uint32 alarms;					// overheating alarms
+	uint32 bytes_tx;				// bytes sent by the firmware
+	uint32 bytes_rx;				// bytes sent by the servos
+} ax12_sim_stats;
+
+// rates of random faults (0 = none, 1 = always)
+typedef struct {
+	double timeout;					// per reply: not sent
+	double corrupt;					// per reply: wrong checksum
+	double drop_byte;				// per byte on the bus: lost
+	double alarm;					// per reply: the servo starts overheating
+	uint16 alarm_ms;				// how long an overheating alarm lasts
+} ax12_sim_faults;
+
+// a packet on the bus (0xFF 0xFF to checksum), from_servo is 0 for an
+// instruction packet and 1 for a status packet
+typedef void (*ax12_sim_monitor)(void *context, uint8 from_servo, const uint8 *packet, uint16 length, uint64_t ticks);
+
+// attach count servos with the given IDs to the bus, in their power-on
+// state at position 512 (call after host_reset)
+void ax12_sim_init(uint8 count, const uint8 ids[]);
+
+// Returns:	(ax12_servo *) the servo with an ID, NULL if there is none
+ax12_servo *ax12_sim_servo(uint8 id);
+
+// Returns:	(uint16) present position of a servo (0 if there is none)
+uint16 ax12_sim_position(uint8 id);
+
+// move a servo to a position (by hand, the goal position follows)
+void ax12_sim_setPosition(uint8 id, uint16 position);
+
+// set the external load on a servo (0-1023 of the maximum torque)
+void ax12_sim_setLoad(uint8 id, uint16 load);
+
+// the next count replies of a servo are not sent (BROADCAST_ID for all servos)
+void ax12_sim_dropReplies(uint8 id, uint16 count);
+
+// the next count replies of a servo have a wrong checksum (BROADCAST_ID for all servos)
+void ax12_sim_corruptReplies(uint8 id, uint16 count);
+
+// inject random faults at the given rates (NULL for none), the random
+// sequence starts from seed so a run can be repeated
+void ax12_sim_setFaults(const ax12_sim_faults *rates, uint32 seed);
+
+// watch the packets on the bus (NULL to stop), ax12_sim_init removes the monitor
+void ax12_sim_setMonitor(ax12_sim_monitor monitor, void *context);
+
+// Returns:	(const ax12_sim_stats *) bus statistics since ax12_sim_init
+const ax12_sim_stats *ax12_sim_getStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AX12_SIM_H_ */
@@ -0,0 +1,209 @@
+/*
+ * ax12_sim_test.c - Tests of the bus code against the simulated AX-12 servos
+ *   Runs dxl_init, readCurrentPose, executeMotion and executeMotionSequence
+ *   unmodified on the host against ax12_sim.c, checks the servo positions
+ *   and the injected timeouts, checksum errors and overloads, and prints
+ *   the bus time of a full pose read and a sync write.
+ *
+ * Usage:	ax12_sim_test
+ * Exit code is the number of failed checks.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "global.h"
+#include "clock.h"
+#include "serial.h"
+#include "dynamixel.h"
+#include "motion_f.h"
+#include "pose.h"
+#include "hal_host.h"
+#include "ax12_sim.h"
+
+#define CHECK(condition) test_check((condition), #condition, __LINE__)
+#define DXL_COMPLIANCE_MARGIN	2		// set by dxl_init
+
+// firmware state (BioloidCControl.c, motion.c, pose.c)
+extern const uint8 AX12_IDS[NUM_AX12_SERVOS];
+extern volatile int16 current_pose[NUM_AX12_SERVOS];
+extern volatile uint8 bioloid_command;
+extern volatile uint8 last_bioloid_command;
+extern volatile bool new_command;
+extern volatile uint8 next_motion_page;
+extern uint8 motion_state;
+extern uint16 goal_pose[NUM_AX12_SERVOS];
+
+static int failures = 0;
+
+static void test_check(int ok, const char *condition, int line)
+{
+	if ( !ok ) {
+		printf("FAILED line %i: %s\n", line, condition);
+		failures++;
+	}
+}
+
+// Returns:	(double) virtual time in us
+static double test_us(void)
+{
+	return host_ticks() / (double) HOST_TICKS_PER_US;
+}
+
+static uint8 test_id(uint8 i)
+{
+	return pgm_read_byte(&AX12_IDS[i]);
+}
+
+// Returns:	(int) 1 if every servo is within tolerance of its present position in current_pose
+static int test_poseMatches(int tolerance)
+{
+	uint8 i;
+
+	for (i=0; i<NUM_AX12_SERVOS; i++) {
+		if ( abs(current_pose[i] - ax12_sim_position(test_id(i))) > tolerance ) {
+			printf("servo %i: current_pose %i, simulated %i\n", test_id(i), current_pose[i], ax12_sim_position(test_id(i)));
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void test_firmware(void)
+{
+	int16 values[NUM_AX12_SERVOS];
+	uint8 ids[NUM_AX12_SERVOS];
+	double start;
+	uint8 i, moving;
+	uint16 goal;
+	ax12_servo *s;
+
+	serial_init(57600);
+	clock_init();
+	sei();
+
+	// start-up: pings and broadcasts
+	dxl_init(DEFAULT_BAUDNUMBER);
+	for (i=0; i<NUM_AX12_SERVOS; i++) {
+		CHECK(ax12_sim_servo(test_id(i))->replies >= 1);
+	}
+
+	// reading the pose, servos spread out by hand
+	for (i=0; i<NUM_AX12_SERVOS; i++) {
+		ax12_sim_setPosition(test_id(i), 300 + 20*i);
+	}
+	start = test_us();
+	readCurrentPose(READ_ALL, 0);
+	printf("readCurrentPose(READ_ALL): %.0fus bus time for %i servos\n", test_us() - start, NUM_AX12_SERVOS);
+	CHECK(test_poseMatches(0));
+
+	// a whole motion page: the balance pose, servos too far away for the
+	// play time get there a little later
+	executeMotion(COMMAND_BALANCE_MP);
+	host_delay(1000000);
+	for (i=0; i<NUM_AX12_SERVOS; i++) {
+		s = ax12_sim_servo(test_id(i));
+		CHECK((s->table[DXL_GOAL_POSITION_L] | (s->table[DXL_GOAL_POSITION_H] << 8)) == goal_pose[i]);
+		CHECK(abs(ax12_sim_position(test_id(i)) - goal_pose[i]) <= DXL_COMPLIANCE_MARGIN);
+	}
+
+	// sync write of all goal positions at full speed
+	dxl_write_word(BROADCAST_ID, DXL_MOVING_SPEED_L, 0);
+	for (i=0; i<NUM_AX12_SERVOS; i++) {
+		ids[i] = test_id(i);
+		values[i] = 512;
+	}
+	start = test_us();
+	dxl_sync_write_word(NUM_AX12_SERVOS, DXL_GOAL_POSITION_L, ids, values);
+	printf("dxl_sync_write_word: %.0fus bus time for %i servos\n", test_us() - start, NUM_AX12_SERVOS);
+	CHECK(dxl_get_result() == COMM_RXSUCCESS);
+	host_delay(2000000);
+	for (i=0; i<NUM_AX12_SERVOS; i++) {
+		CHECK(abs(ax12_sim_position(test_id(i)) - 512) <= DXL_COMPLIANCE_MARGIN);
+	}
+
+	// the motion state machine: sit down (page 25) and back to balance
+	bioloid_command = COMMAND_SIT;
+	last_bioloid_command = COMMAND_STOP;
+	next_motion_page = COMMAND_SIT_MP;
+	new_command = TRUE;
+	motion_state = MOTION_STOPPED;
+	start = test_us();
+	do {
+		executeMotionSequence();
+		host_delay(1000);
+	} while ( (motion_state != MOTION_STOPPED || new_command) && motion_state != MOTION_ALARM && test_us() - start < 20e6 );
+	printf("executeMotionSequence(SIT): %.0fms\n", (test_us() - start) / 1000);
+	CHECK(motion_state == MOTION_STOPPED);
+	moving = 0;
+	for (i=0; i<NUM_AX12_SERVOS; i++) {
+		moving += ax12_sim_servo(test_id(i))->table[DXL_MOVING];
+	}
+	CHECK(moving == 0);
+	readCurrentPose(READ_ALL, 0);
+	CHECK(test_poseMatches(0));
+
+	// injected faults: a timeout, then a corrupt reply, then back to normal
+	ax12_sim_dropReplies(test_id(2), 1);
+	CHECK(dxl_ping(test_id(2)) == -1);
+	CHECK(dxl_get_result() == COMM_RXTIMEOUT);
+	CHECK(dxl_ping(test_id(2)) == 0);
+	ax12_sim_corruptReplies(test_id(4), 1);
+	dxl_read_word(test_id(4), DXL_PRESENT_POSITION_L);
+	CHECK(dxl_get_result() == COMM_RXCORRUPT);
+	CHECK(dxl_read_word(test_id(4), DXL_PRESENT_POSITION_L) == ax12_sim_position(test_id(4)));
+	CHECK(dxl_get_result() == COMM_RXSUCCESS);
+	CHECK(ax12_sim_getStats()->dropped == 1 && ax12_sim_getStats()->corrupted == 1);
+
+	// a goal outside the angle limits is refused
+	s = ax12_sim_servo(test_id(6));
+	goal = s->table[DXL_GOAL_POSITION_L] | (s->table[DXL_GOAL_POSITION_H] << 8);
+	dxl_write_word(test_id(6), DXL_CCW_ANGLE_LIMIT_L, 600);
+	dxl_write_word(test_id(6), DXL_GOAL_POSITION_L, 700);
+	CHECK(dxl_get_result() == COMM_RXSUCCESS);
+	CHECK(dxl_read_word(test_id(6), DXL_GOAL_POSITION_L) == goal);
+
+	// a half load halves the speed, a full load stalls the servo
+	s = ax12_sim_servo(test_id(0));
+	ax12_sim_setLoad(test_id(0), 512);
+	dxl_write_word(test_id(0), DXL_GOAL_POSITION_L, 1000);
+	host_delay(50000);
+	dxl_read_word(test_id(0), DXL_PRESENT_SPEED_L);
+	CHECK(s->velocity > 0 && s->velocity < 0.55 * AX12_SIM_MAX_SPEED * 2.27);
+	ax12_sim_setLoad(test_id(0), 1023);
+	host_delay(10000);
+	CHECK(dxl_ping(test_id(0)) == ERRBIT_OVERLOAD);
+	CHECK(s->table[DXL_TORQUE_ENABLE] == 0);
+}
+
+int main(void)
+{
+	uint8 ids[NUM_AX12_SERVOS];
+	uint8 i;
+
+	host_reset();
+	for (i=0; i<NUM_AX12_SERVOS; i++) {
+		ids[i] = test_id(i);
+	}
+	ax12_sim_init(NUM_AX12_SERVOS, ids);
+	CHECK(host_run(test_firmware, 120000000ULL) == 0);
+
+	printf("%lu instruction packets, %lu replies, %lu bad checksums\n", (unsigned long) ax12_sim_getStats()->packets,
+		   (unsigned long) ax12_sim_getStats()->replies, (unsigned long) ax12_sim_getStats()->bad_checksums);
+	printf("%i checks failed\n", failures);
+	return failures;
+}
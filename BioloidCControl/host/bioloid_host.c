@@ -0,0 +1,123 @@
+/*
+ * bioloid_host.c - Runs the firmware on the host
+ *   Starts the firmware (main() of BioloidCControl.c) on the stub devices
+ *   of hal_host.c, prints what it sends to the PC on stdout, presses the
+ *   START button and types commands once the command prompt is up. The
+ *   Dynamixel bus has the simulated AX-12 servos of ax12_sim.c on it.
+ *
+ * Usage:	bioloid_host [seconds] [command ...]
+ *			default 10s of virtual time, commands are sent 1s apart
+ * Exit code is 1 if the command prompt never came up.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "global.h"
+#include "button.h"
+#include "hal_host.h"
+#include "ax12_sim.h"
+
+#define HOST_START_US		500000UL	// START button pressed
+#define HOST_PRESS_US		100000UL	// and held
+#define HOST_COMMAND_US		1000000UL	// between commands
+#define HOST_MAX_COMMANDS	16
+
+static const char prompt[] = "Ready for command.";
+static uint8 prompt_matched = 0;
+static uint8 ready = 0;
+static char *commands[HOST_MAX_COMMANDS];
+static int num_commands = 0;
+
+// servo IDs (BioloidCControl.c)
+extern const uint8 AX12_IDS[NUM_AX12_SERVOS];
+
+// main() of BioloidCControl.c (renamed by CMakeLists.txt)
+int firmware_main(void);
+
+static void run_firmware(void)
+{
+	firmware_main();
+}
+
+static void press_start(void *arg)
+{
+	host_buttonSet(BUTTON_ID_START, (uint8)(intptr_t) arg);
+}
+
+// type a command followed by CR
+static void send_command(void *arg)
+{
+	const char *command = arg;
+	uint8 cr = '\r';
+
+	host_uartReceive(HAL_UART_PC, host_ticks(), (const uint8 *) command, strlen(command));
+	host_uartReceive(HAL_UART_PC, host_ticks(), &cr, 1);
+}
+
+// the PC terminal: print, and schedule the commands once the prompt is seen
+static void pc_receive(void *context, uint8 data, uint64_t ticks)
+{
+	uint64_t at;
+	int i;
+
+	(void) context;
+	if ( data == '\n' || (data >= ' ' && data < 0x7F) ) {
+		putchar(data);
+	}
+	if ( ready ) {
+		return;
+	}
+	prompt_matched = ( data == prompt[prompt_matched] ) ? prompt_matched + 1 : ( data == prompt[0] );
+	if ( prompt[prompt_matched] == 0 ) {
+		ready = 1;
+		at = ticks / HOST_TICKS_PER_US;
+		for (i=0; i<num_commands; i++) {
+			at += HOST_COMMAND_US;
+			host_at(at, send_command, commands[i]);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long seconds = 10;
+	int i;
+
+	if ( argc > 1 ) seconds = strtoul(argv[1], NULL, 10);
+	if ( seconds == 0 || argc - 2 > HOST_MAX_COMMANDS ) {
+		printf("Usage: bioloid_host [seconds] [command ...] (up to %i commands)\n", HOST_MAX_COMMANDS);
+		return 2;
+	}
+	for (i=2; i<argc; i++) {
+		commands[num_commands++] = argv[i];
+	}
+
+	host_reset();
+	ax12_sim_init(NUM_AX12_SERVOS, AX12_IDS);
+	host_uartListen(HAL_UART_PC, pc_receive, NULL);
+	host_at(HOST_START_US, press_start, (void *) 1);
+	host_at(HOST_START_US + HOST_PRESS_US, press_start, (void *) 0);
+	host_run(run_firmware, seconds * 1000000ULL);
+	printf("\n[%.3fs virtual time]\n", host_ticks() / (HOST_TICKS_PER_US * 1e6));
+
+	if ( !ready ) {
+		fprintf(stderr, "The command prompt didn't come up.\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,576 @@
+/*
+ * fault_bench.c - Robustness of the firmware against bus faults
+ *   Runs the whole firmware (scheduler, command parser, motion engine and
+ *   walking) against the simulated AX-12 servos of ax12_sim.c in long
+ *   walking and motion page scenarios, while the simulation injects lost
+ *   replies, wrong checksums, lost bytes and overheating alarms at given
+ *   rates, and measures how the robot copes with them:
+ *
+ *     steps		motion steps started (and the difference to the run without faults)
+ *     missed		steps whose goal positions didn't reach every servo
+ *     overruns		runs of task_motion over their deadline (sched.c), the
+ *					longest run and the watchdog misses of all tasks
+ *     disruptions	times a servo lost its torque or the motion engine went
+ *					into MOTION_ALARM, and how many the firmware noticed itself
+ *     recovery		mean and longest time until every servo had torque again
+ *					and the motion engine was out of the alarm
+ *     wdt			watchdog resets
+ *
+ * The PC side plays the operator: it types the commands of the scenario in
+ * a loop, and RSET when the motion engine is in the alarm, followed by the
+ * last command once the robot is back.
+ *
+ * Every run starts the firmware from scratch in a child process (the
+ * firmware state can't be reset), the random faults start from the seed,
+ * so a run can be repeated.
+ *
+ * Usage:	fault_bench [-t seconds] [-s seed] [-f timeout,corrupt,drop,alarm] [-c results.csv] [scenario ...]
+ *			-t	virtual time per run after the command prompt (default 60s)
+ *			-s	seed of the random faults (default 1)
+ *			-f	one set of fault rates (per reply, per byte for drop)
+ *				instead of the default sweep
+ *			-c	append the results to a CSV file
+ *			scenarios: walk, motion (default both)
+ * Exit code is 1 if a run without faults has missed steps, disruptions or
+ * a watchdog reset, or a run didn't come to the command prompt.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include "global.h"
+#include "button.h"
+#include "dynamixel.h"
+#include "motion_f.h"
+#include "sched.h"
+#include "hal_host.h"
+#include "ax12_sim.h"
+
+#define BENCH_START_US		500000UL	// START button pressed
+#define BENCH_PRESS_US		100000UL	// and held
+#define BENCH_SETTLE_US		1000000UL	// from the command prompt to the first command
+#define BENCH_PROBE_US		1000UL		// period of the probe
+#define BENCH_GOAL_US		5000UL		// from the start of a step to the check of the goal positions
+#define BENCH_RESEND_US		1000000UL	// from the RSET to the last command again
+#define BENCH_ALARM_MS		500			// length of an injected overheating alarm
+#define BENCH_MAX_RUNS		32
+
+// a command of a scenario, at a time in its cycle
+typedef struct {
+	uint32 at_ms;
+	const char *text;
+} bench_command;
+
+typedef struct {
+	const char *name;
+	uint32 cycle_ms;				// the commands repeat after this
+	const bench_command *commands;	// ends with a NULL text
+} bench_scenario;
+
+typedef struct {
+	char label[16];
+	ax12_sim_faults rates;
+} bench_faults;
+
+// what a run measured (sent back from the child process)
+typedef struct {
+	uint8 prompt;					// came to the command prompt
+	uint8 watchdog;					// watchdog reset
+	uint32 steps;
+	uint32 missed;
+	uint32 motion_runs;
+	uint32 overruns;
+	uint32 run_max_us;
+	uint32 misses;
+	uint32 disruptions;
+	uint32 detected;
+	uint32 unrecovered;
+	double recovery_sum_ms;
+	double recovery_max_ms;
+	uint32 timeouts;				// injected (ax12_sim_getStats)
+	uint32 corrupted;
+	uint32 bytes_dropped;
+	uint32 alarms;
+} bench_result;
+
+static const bench_command walk_commands[] = {
+	{ 0,		"WFWD" },
+	{ 6000,		"WFLT" },
+	{ 10000,	"WFRT" },
+	{ 14000,	"WBWD" },
+	{ 19000,	"WLSD" },
+	{ 23000,	"STOP" },
+	{ 0,		NULL }
+};
+
+static const bench_command motion_commands[] = {
+	{ 0,		"SIT" },
+	{ 4000,		"STND" },
+	{ 8000,		"M8" },
+	{ 12000,	"M11" },
+	{ 16000,	"STND" },
+	{ 20000,	"M5" },
+	{ 24000,	"M7" },
+	{ 0,		NULL }
+};
+
+static const bench_scenario scenarios[] = {
+	{ "walk",	27000,	walk_commands },
+	{ "motion",	28000,	motion_commands },
+};
+#define NUM_SCENARIOS	(sizeof(scenarios) / sizeof(bench_scenario))
+
+// firmware state (BioloidCControl.c, motion.c, pose.c)
+extern const uint8 AX12_IDS[NUM_AX12_SERVOS];
+extern volatile uint8 current_motion_page;
+extern volatile uint8 current_step;
+extern uint8 repeat_counter;
+extern uint8 motion_state;
+extern uint16 goal_pose[NUM_AX12_SERVOS];
+
+// main() of BioloidCControl.c (renamed by CMakeLists.txt)
+int firmware_main(void);
+
+// the run in this process
+static const bench_scenario *scenario;
+static const ax12_sim_faults *rates;
+static uint32 seed = 1;
+static bench_result result;
+static const char prompt[] = "Ready for command.";
+static uint8 prompt_matched = 0;
+static uint64_t cycle_us;				// start of the current command cycle
+static uint8 next_command;
+static const char *last_command = NULL;
+static uint8 reset_sent = 0;
+static uint64_t resend_us;
+static uint8 step_page, step_number, step_repeat, step_state;
+static uint8 step_checked = 1;
+static uint64_t step_us;
+static uint8 disrupted = 0, disruption_detected;
+static uint64_t disruption_us;
+
+static void run_firmware(void)
+{
+	firmware_main();
+}
+
+static void press_start(void *arg)
+{
+	host_buttonSet(BUTTON_ID_START, (uint8)(intptr_t) arg);
+}
+
+// Returns:	(uint64_t) virtual time in us
+static uint64_t bench_us(void)
+{
+	return host_ticks() / HOST_TICKS_PER_US;
+}
+
+// type a command followed by CR
+static void bench_send(const char *command)
+{
+	uint8 cr = '\r';
+
+	host_uartReceive(HAL_UART_PC, host_ticks(), (const uint8 *) command, strlen(command));
+	host_uartReceive(HAL_UART_PC, host_ticks(), &cr, 1);
+}
+
+// Returns:	(uint8) 1 if every servo has the goal position of goal_pose
+static uint8 bench_goalsMatch(void)
+{
+	ax12_servo *s;
+	uint8 i;
+
+	for (i=0; i<NUM_AX12_SERVOS; i++) {
+		s = ax12_sim_servo(pgm_read_byte(&AX12_IDS[i]));
+		if ( (s->table[DXL_GOAL_POSITION_L] | (s->table[DXL_GOAL_POSITION_H] << 8)) != goal_pose[i] ) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Returns:	(uint8) 1 if a servo has its torque off
+static uint8 bench_limp(void)
+{
+	uint8 i;
+
+	for (i=0; i<NUM_AX12_SERVOS; i++) {
+		if ( ax12_sim_servo(pgm_read_byte(&AX12_IDS[i]))->table[DXL_TORQUE_ENABLE] == 0 ) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// the operator: commands of the scenario, RSET after an alarm
+static void bench_operator(uint64_t now)
+{
+	const bench_command *command;
+
+	if ( motion_state == MOTION_ALARM ) {
+		if ( !reset_sent ) {
+			bench_send("RSET");
+			reset_sent = 1;
+		}
+		resend_us = now + BENCH_RESEND_US;
+		return;
+	}
+	if ( reset_sent ) {
+		if ( now < resend_us ) {
+			return;
+		}
+		reset_sent = 0;
+		if ( last_command != NULL ) {
+			bench_send(last_command);
+		}
+	}
+
+	command = &scenario->commands[next_command];
+	if ( now >= cycle_us + command->at_ms * 1000ULL ) {
+		bench_send(command->text);
+		last_command = command->text;
+		next_command++;
+		if ( scenario->commands[next_command].text == NULL ) {
+			next_command = 0;
+			cycle_us += scenario->cycle_ms * 1000ULL;
+		}
+	}
+}
+
+// steps: a step starts when the motion engine goes into STEP_IN_MOTION or
+// the page, step or repeat changes in it, its goal positions are checked
+// a little later unless the next step has already started
+static void bench_steps(uint64_t now)
+{
+	uint8 state = motion_state;
+
+	if ( state == STEP_IN_MOTION && (step_state != STEP_IN_MOTION || current_motion_page != step_page
+			|| current_step != step_number || repeat_counter != step_repeat) ) {
+		result.steps++;
+		step_page = current_motion_page;
+		step_number = current_step;
+		step_repeat = repeat_counter;
+		step_us = now;
+		step_checked = 0;
+	}
+	step_state = state;
+
+	if ( !step_checked && now >= step_us + BENCH_GOAL_US ) {
+		step_checked = 1;
+		if ( current_motion_page == step_page && current_step == step_number && repeat_counter == step_repeat
+				&& state != MOTION_ALARM && !bench_goalsMatch() ) {
+			result.missed++;
+		}
+	}
+}
+
+// disruptions: a servo without torque or the motion engine in the alarm,
+// until every servo has torque again and the alarm is reset
+static void bench_disruptions(uint64_t now)
+{
+	uint8 alarm = (motion_state == MOTION_ALARM);
+	double recovery;
+
+	if ( alarm || bench_limp() ) {
+		if ( !disrupted ) {
+			disrupted = 1;
+			disruption_detected = 0;
+			disruption_us = now;
+			result.disruptions++;
+		}
+		if ( alarm ) {
+			disruption_detected = 1;
+		}
+	} else if ( disrupted ) {
+		disrupted = 0;
+		recovery = (now - disruption_us) / 1000.0;
+		result.recovery_sum_ms += recovery;
+		if ( recovery > result.recovery_max_ms ) {
+			result.recovery_max_ms = recovery;
+		}
+		result.detected += disruption_detected;
+	}
+}
+
+// every BENCH_PROBE_US from the command prompt on
+static void bench_probe(void *arg)
+{
+	uint64_t now = bench_us();
+
+	(void) arg;
+	// watchdog_fault is waiting for the reset (reset mode only), nothing runs any more
+	if ( WDTCSR == (1<<WDE) ) {
+		result.watchdog = 1;
+		return;
+	}
+	bench_operator(now);
+	bench_steps(now);
+	bench_disruptions(now);
+	host_at(now + BENCH_PROBE_US, bench_probe, NULL);
+}
+
+// the PC terminal: start the scenario and the faults at the command prompt
+static void pc_receive(void *context, uint8 data, uint64_t ticks)
+{
+	(void) context;
+	if ( result.prompt ) {
+		return;
+	}
+	prompt_matched = ( data == prompt[prompt_matched] ) ? prompt_matched + 1 : ( data == prompt[0] );
+	if ( prompt[prompt_matched] == 0 ) {
+		result.prompt = 1;
+		ax12_sim_setFaults(rates, seed);
+		cycle_us = ticks / HOST_TICKS_PER_US + BENCH_SETTLE_US;
+		host_at(ticks / HOST_TICKS_PER_US + BENCH_PROBE_US, bench_probe, NULL);
+	}
+}
+
+// one run, in the child process
+static void bench_run(uint32 seconds)
+{
+	const ax12_sim_stats *stats;
+	const sched_stats *task;
+	char name[5] = "";
+	uint8 i;
+
+	host_reset();
+	ax12_sim_init(NUM_AX12_SERVOS, AX12_IDS);
+	host_uartListen(HAL_UART_PC, pc_receive, NULL);
+	host_at(BENCH_START_US, press_start, (void *) 1);
+	host_at(BENCH_START_US + BENCH_PRESS_US, press_start, (void *) 0);
+	// the prompt comes after about 2s
+	host_run(run_firmware, 3000000ULL + seconds * 1000000ULL);
+
+	if ( disrupted ) {
+		result.unrecovered++;
+		result.detected += disruption_detected;
+	}
+	for (i=0; i<SCHED_MAX_TASKS; i++) {
+		sched_getTaskName(i, name);
+		if ( strcmp(name, "MOTN") == 0 ) {
+			task = sched_getStats(i);
+			result.motion_runs = task->runs;
+			result.overruns = task->overruns;
+			result.run_max_us = task->time_max;
+			break;
+		}
+	}
+	result.misses = sched_getMisses();
+	stats = ax12_sim_getStats();
+	result.timeouts = stats->dropped;
+	result.corrupted = stats->corrupted;
+	result.bytes_dropped = stats->bytes_dropped;
+	result.alarms = stats->alarms;
+}
+
+// Returns:	(int) 0 if the run finished, its result is in *run
+static int bench_fork(const bench_scenario *s, const bench_faults *f, uint32 seconds, bench_result *run)
+{
+	int pipes[2];
+	int status;
+	pid_t pid;
+	ssize_t length;
+
+	fflush(stdout);
+	if ( pipe(pipes) != 0 ) {
+		return -1;
+	}
+	pid = fork();
+	if ( pid < 0 ) {
+		return -1;
+	}
+	if ( pid == 0 ) {
+		close(pipes[0]);
+		// the firmware's terminal output isn't wanted here
+		if ( freopen("/dev/null", "w", stdout) == NULL ) {
+			_exit(2);
+		}
+		scenario = s;
+		rates = &f->rates;
+		bench_run(seconds);
+		length = write(pipes[1], &result, sizeof(result));
+		_exit(length == sizeof(result) ? 0 : 2);
+	}
+	close(pipes[1]);
+	length = read(pipes[0], run, sizeof(*run));
+	close(pipes[0]);
+	waitpid(pid, &status, 0);
+	return ( length == sizeof(*run) && WIFEXITED(status) && WEXITSTATUS(status) == 0 ) ? 0 : -1;
+}
+
+static void bench_print(const bench_scenario *s, const bench_faults *f, const bench_result *r, const bench_result *clean)
+{
+	printf("%-7s %-14s %6lu %+6ld %6lu %5lu/%-7lu %6lu %5lu %4lu/%-4lu %5lu %8.1f %8.1f %3s  %lu/%lu/%lu/%lu\n",
+		   s->name, f->label, (unsigned long) r->steps, (long) r->steps - (long) clean->steps,
+		   (unsigned long) r->missed, (unsigned long) r->overruns, (unsigned long) r->motion_runs,
+		   (unsigned long) r->run_max_us, (unsigned long) r->misses,
+		   (unsigned long) r->detected, (unsigned long) r->disruptions, (unsigned long) r->unrecovered,
+		   r->disruptions > r->unrecovered ? r->recovery_sum_ms / (r->disruptions - r->unrecovered) : 0.0,
+		   r->recovery_max_ms, r->watchdog ? "yes" : "no",
+		   (unsigned long) r->timeouts, (unsigned long) r->corrupted, (unsigned long) r->bytes_dropped, (unsigned long) r->alarms);
+}
+
+static void bench_csv(FILE *csv, const bench_scenario *s, const bench_faults *f, uint32 seconds, const bench_result *r)
+{
+	fprintf(csv, "%s,%g,%g,%g,%g,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.1f,%.1f,%u,%lu,%lu,%lu,%lu\n",
+			s->name, f->rates.timeout, f->rates.corrupt, f->rates.drop_byte, f->rates.alarm,
+			(unsigned long) seconds, (unsigned long) seed, (unsigned long) r->steps, (unsigned long) r->missed,
+			(unsigned long) r->motion_runs, (unsigned long) r->overruns, (unsigned long) r->run_max_us,
+			(unsigned long) r->misses, (unsigned long) r->disruptions, (unsigned long) r->detected,
+			(unsigned long) r->unrecovered,
+			r->disruptions > r->unrecovered ? r->recovery_sum_ms / (r->disruptions - r->unrecovered) : 0.0,
+			r->recovery_max_ms, r->watchdog, (unsigned long) r->timeouts, (unsigned long) r->corrupted,
+			(unsigned long) r->bytes_dropped, (unsigned long) r->alarms);
+}
+
+static void bench_addFaults(bench_faults *list, int *count, const char *label, double timeout, double corrupt, double drop, double alarm)
+{
+	bench_faults *f = &list[(*count)++];
+
+	snprintf(f->label, sizeof(f->label), "%s", label);
+	f->rates.timeout = timeout;
+	f->rates.corrupt = corrupt;
+	f->rates.drop_byte = drop;
+	f->rates.alarm = alarm;
+	f->rates.alarm_ms = BENCH_ALARM_MS;
+}
+
+int main(int argc, char *argv[])
+{
+	bench_faults sweep[BENCH_MAX_RUNS];
+	const bench_scenario *selected[NUM_SCENARIOS];
+	bench_result clean, run;
+	double timeout, corrupt, drop, alarm;
+	const char *csv_name = NULL;
+	FILE *csv = NULL;
+	uint32 seconds = 60;
+	int num_sweep = 0, num_selected = 0;
+	int failed = 0;
+	int opt, i, j;
+	unsigned int k;
+
+	while ( (opt = getopt(argc, argv, "t:s:f:c:")) != -1 ) {
+		switch ( opt ) {
+			case 't':
+				seconds = strtoul(optarg, NULL, 10);
+				break;
+			case 's':
+				seed = strtoul(optarg, NULL, 10);
+				break;
+			case 'f':
+				if ( sscanf(optarg, "%lf,%lf,%lf,%lf", &timeout, &corrupt, &drop, &alarm) != 4 ) {
+					seconds = 0;
+				}
+				bench_addFaults(sweep, &num_sweep, "none", 0, 0, 0, 0);
+				bench_addFaults(sweep, &num_sweep, "given", timeout, corrupt, drop, alarm);
+				break;
+			case 'c':
+				csv_name = optarg;
+				break;
+			default:
+				seconds = 0;
+				break;
+		}
+	}
+	for (i=optind; i<argc; i++) {
+		for (k=0; k<NUM_SCENARIOS; k++) {
+			if ( strcmp(argv[i], scenarios[k].name) == 0 ) {
+				selected[num_selected++] = &scenarios[k];
+				break;
+			}
+		}
+		if ( k == NUM_SCENARIOS || num_selected > (int) NUM_SCENARIOS ) {
+			seconds = 0;
+			break;
+		}
+	}
+	if ( seconds == 0 || num_sweep > 2 ) {
+		printf("Usage: fault_bench [-t seconds] [-s seed] [-f timeout,corrupt,drop,alarm] [-c results.csv] [walk] [motion]\n");
+		return 2;
+	}
+	if ( num_selected == 0 ) {
+		for (k=0; k<NUM_SCENARIOS; k++) {
+			selected[num_selected++] = &scenarios[k];
+		}
+	}
+	// default sweep: each kind of fault on its own, at a low and a high rate
+	if ( num_sweep == 0 ) {
+		bench_addFaults(sweep, &num_sweep, "none", 0, 0, 0, 0);
+		bench_addFaults(sweep, &num_sweep, "timeout 0.1%", 0.001, 0, 0, 0);
+		bench_addFaults(sweep, &num_sweep, "timeout 1%", 0.01, 0, 0, 0);
+		bench_addFaults(sweep, &num_sweep, "corrupt 0.1%", 0, 0.001, 0, 0);
+		bench_addFaults(sweep, &num_sweep, "corrupt 1%", 0, 0.01, 0, 0);
+		bench_addFaults(sweep, &num_sweep, "drop 0.01%", 0, 0, 0.0001, 0);
+		bench_addFaults(sweep, &num_sweep, "drop 0.1%", 0, 0, 0.001, 0);
+		bench_addFaults(sweep, &num_sweep, "alarm 0.01%", 0, 0, 0, 0.0001);
+		bench_addFaults(sweep, &num_sweep, "alarm 0.1%", 0, 0, 0, 0.001);
+	}
+	if ( csv_name != NULL ) {
+		csv = fopen(csv_name, "a");
+		if ( csv == NULL ) {
+			perror(csv_name);
+			return 2;
+		}
+		if ( ftell(csv) == 0 ) {
+			fprintf(csv, "scenario,timeout,corrupt,drop,alarm,seconds,seed,steps,missed,motion_runs,overruns,run_max_us,"
+						 "misses,disruptions,detected,unrecovered,recovery_mean_ms,recovery_max_ms,watchdog,"
+						 "injected_timeouts,injected_corrupt,injected_bytes_dropped,injected_alarms\n");
+		}
+	}
+
+	printf("Fault injection, %lus per run, seed %lu\n", (unsigned long) seconds, (unsigned long) seed);
+	printf("%-7s %-14s %6s %6s %6s %13s %6s %5s %9s %5s %8s %8s %3s  %s\n", "run", "faults", "steps", "diff",
+		   "missed", "overruns", "max us", "miss", "detected", "left", "mean ms", "max ms", "wdt",
+		   "injected timeout/corrupt/byte/alarm");
+	for (i=0; i<num_selected; i++) {
+		memset(&clean, 0, sizeof(clean));
+		for (j=0; j<num_sweep; j++) {
+			if ( bench_fork(selected[i], &sweep[j], seconds, &run) != 0 ) {
+				printf("%-7s %-14s the run crashed\n", selected[i]->name, sweep[j].label);
+				failed = 1;
+				continue;
+			}
+			if ( !run.prompt ) {
+				printf("%-7s %-14s no command prompt\n", selected[i]->name, sweep[j].label);
+				failed = 1;
+				continue;
+			}
+			if ( j == 0 ) {
+				clean = run;
+				// without faults nothing may go wrong
+				if ( run.missed || run.disruptions || run.watchdog ) {
+					failed = 1;
+				}
+			}
+			bench_print(selected[i], &sweep[j], &run, &clean);
+			if ( csv != NULL ) {
+				bench_csv(csv, selected[i], &sweep[j], seconds, &run);
+			}
+		}
+	}
+	if ( csv != NULL ) {
+		fclose(csv);
+	}
+	if ( failed ) {
+		printf("FAILED: a run without faults wasn't clean or a run didn't finish\n");
+	}
+	return failed;
+}
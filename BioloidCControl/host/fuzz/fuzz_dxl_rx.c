@@ -0,0 +1,95 @@
+/*
+ * fuzz_dxl_rx.c - Fuzz target for the Dynamixel status packet parser
+ *   Sends a READ instruction and hands the input to dxl_rx_packet as the
+ *   bytes on the bus, a few at a time like the receive ISR does, until
+ *   the parser reports success, a corrupt packet or a timeout.
+ *
+ *   byte 0		ID the READ goes to (0xFE broadcast needs no reply)
+ *   byte 1		bytes per poll of dxl_rx_packet - 1 (lower 6 bits)
+ *   rest		bytes received on the bus
+ *
+ * Runs with libFuzzer or fuzz_main.c, see host/CMakeLists.txt.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <avr/interrupt.h>
+#include "global.h"
+#include "clock.h"
+#include "dynamixel.h"
+#include "dxl_hal.h"
+#include "hal_host.h"
+
+// firmware state (dynamixel.c, dxl_hal.c)
+extern int gbCommStatus;
+extern int giBusUsing;
+void dxl_hal_put_queue(unsigned char data);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	static uint8 ready = 0;
+	size_t next, polls, i, chunk;
+	int length;
+
+	if ( size < 2 ) {
+		return 0;
+	}
+	if ( !ready ) {
+		host_reset();
+		clock_init();
+		dxl_initialize(0, DEFAULT_BAUDNUMBER);
+		sei();
+		ready = 1;
+	}
+
+	// a READ of the present position, like readCurrentPose
+	dxl_hal_clear();
+	giBusUsing = 0;
+	gbCommStatus = COMM_RXSUCCESS;
+	dxl_set_txpacket_id(data[0]);
+	dxl_set_txpacket_instruction(INST_READ);
+	dxl_set_txpacket_parameter(0, DXL_PRESENT_POSITION_L);
+	dxl_set_txpacket_parameter(1, 2);
+	dxl_set_txpacket_length(4);
+	dxl_tx_packet();
+
+	// the parser has to come to an end, at the latest when the reply times out
+	chunk = (data[1] & 0x3F) + 1;
+	next = 2;
+	for (polls=0; giBusUsing; polls++) {
+		if ( polls > size + 1000 ) {
+			fprintf(stderr, "dxl_rx_packet still waiting after %lu polls\n", (unsigned long) polls);
+			abort();
+		}
+		for (i=0; i<chunk && next<size; i++) {
+			dxl_hal_put_queue(data[next++]);
+		}
+		dxl_rx_packet();
+		// 10us per byte at 1Mbps
+		host_delay(10 * chunk);
+	}
+
+	// what the callers read from a good packet
+	if ( gbCommStatus == COMM_RXSUCCESS && data[0] != BROADCAST_ID ) {
+		dxl_get_rxpacket_error(0xFF);
+		length = dxl_get_rxpacket_length();
+		for (i=0; (int) i < length - 2; i++) {
+			dxl_get_rxpacket_parameter(i);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,252 @@
+/*
+ * fuzz_main.c - Stand-alone driver for the fuzz targets
+ *   Stands in for libFuzzer where the compiler doesn't have it (gcc): runs
+ *   LLVMFuzzerTestOneInput on every file of the corpus, then on random
+ *   mutations of them (bit flips, byte changes, inserts, deletes, pieces
+ *   of other inputs). No coverage guidance, but with the sanitizers every
+ *   out of bounds access of the targets is still found. The options are a
+ *   subset of libFuzzer's, so the tests run the same with both.
+ *
+ * Usage:	fuzz_<target> [-runs=n] [-seed=n] [-max_len=n] [-timeout=s] corpus ...
+ *   -runs		number of mutated inputs after the corpus (default 10000)
+ *   -seed		random seed (default 1, the same inputs every time)
+ *   -max_len	maximum length of a mutated input (default 512)
+ *   -timeout	seconds one input may take before it counts as a hang (default 10)
+ *   corpus		directories or files with inputs
+ * An input that crashes or hangs is written to crash-<n> and the program
+ * aborts, run it again with the file as the only corpus to reproduce.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sanitizer/common_interface_defs.h>
+
+#define FUZZ_MAX_CORPUS		1024	// corpus files read
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+typedef struct {
+	uint8_t *data;
+	size_t size;
+} fuzz_input;
+
+static fuzz_input corpus[FUZZ_MAX_CORPUS];
+static int corpus_count = 0;
+// the input being run, saved if it crashes
+static const uint8_t *current_data;
+static size_t current_size;
+static unsigned long current_run;
+static uint64_t random_state;
+
+// Returns:	(uint32_t) next number of a xorshift generator
+static uint32_t fuzz_random(void)
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 7;
+	random_state ^= random_state << 17;
+	return (uint32_t) (random_state >> 32);
+}
+
+// the sanitizers abort after their report, so the input can be saved
+const char *__asan_default_options(void)
+{
+	return "abort_on_error=1";
+}
+
+const char *__ubsan_default_options(void)
+{
+	return "abort_on_error=1:print_stacktrace=1";
+}
+
+// write the current input to crash-<run> when the program aborts
+static void fuzz_crash(int number)
+{
+	char name[32];
+	FILE *f;
+
+	snprintf(name, sizeof(name), "crash-%lu", current_run);
+	f = fopen(name, "wb");
+	if ( f ) {
+		fwrite(current_data, 1, current_size, f);
+		fclose(f);
+		fprintf(stderr, "input written to %s (%lu bytes)\n", name, (unsigned long) current_size);
+	}
+	signal(number, SIG_DFL);
+	raise(number);
+}
+
+static void fuzz_timeout(int number)
+{
+	(void) number;
+	fprintf(stderr, "input %lu hangs\n", current_run);
+	__sanitizer_print_stack_trace();
+	abort();
+}
+
+// run one input from a buffer of its exact size, so reading past its end is found
+static void fuzz_run(const uint8_t *data, size_t size, unsigned timeout)
+{
+	uint8_t *copy;
+
+	copy = malloc(size ? size : 1);
+	memcpy(copy, data, size);
+	current_data = copy;
+	current_size = size;
+	alarm(timeout);
+	LLVMFuzzerTestOneInput(copy, size);
+	alarm(0);
+	free(copy);
+	current_run++;
+}
+
+static void fuzz_addFile(const char *path)
+{
+	struct stat st;
+	FILE *f;
+
+	if ( corpus_count >= FUZZ_MAX_CORPUS || stat(path, &st) != 0 || !S_ISREG(st.st_mode) ) {
+		return;
+	}
+	f = fopen(path, "rb");
+	if ( !f ) {
+		return;
+	}
+	corpus[corpus_count].data = malloc(st.st_size + 1);
+	corpus[corpus_count].size = fread(corpus[corpus_count].data, 1, st.st_size, f);
+	fclose(f);
+	corpus_count++;
+}
+
+static void fuzz_addCorpus(const char *path)
+{
+	char name[1024];
+	struct dirent *entry;
+	DIR *dir;
+
+	dir = opendir(path);
+	if ( !dir ) {
+		fuzz_addFile(path);
+		return;
+	}
+	while ( (entry = readdir(dir)) != NULL ) {
+		if ( entry->d_name[0] != '.' ) {
+			snprintf(name, sizeof(name), "%s/%s", path, entry->d_name);
+			fuzz_addFile(name);
+		}
+	}
+	closedir(dir);
+}
+
+// change a copy of a corpus input in 1 to 4 places
+// Returns:	(size_t) length of the mutated input in buffer
+static size_t fuzz_mutate(uint8_t *buffer, size_t max_len)
+{
+	static const uint8_t interesting[] = { 0x00, 0x01, 0x02, 0x0D, 0x23, 0x3C, 0x7F, 0x80, 0xFE, 0xFF };
+	const fuzz_input *input, *other;
+	size_t size, position, length;
+	int changes;
+
+	input = &corpus[fuzz_random() % corpus_count];
+	size = input->size < max_len ? input->size : max_len;
+	memcpy(buffer, input->data, size);
+
+	for (changes = 1 + fuzz_random() % 4; changes > 0; changes--) {
+		position = size ? fuzz_random() % size : 0;
+		switch ( fuzz_random() % 6 ) {
+		case 0:
+			if ( size ) buffer[position] ^= 1 << (fuzz_random() % 8);
+			break;
+		case 1:
+			if ( size ) buffer[position] = fuzz_random();
+			break;
+		case 2:
+			if ( size ) buffer[position] = interesting[fuzz_random() % sizeof(interesting)];
+			break;
+		case 3:
+			// insert a byte
+			if ( size < max_len ) {
+				memmove(&buffer[position + 1], &buffer[position], size - position);
+				buffer[position] = fuzz_random();
+				size++;
+			}
+			break;
+		case 4:
+			// delete a few bytes
+			if ( size ) {
+				length = 1 + fuzz_random() % (size - position < 8 ? size - position : 8);
+				memmove(&buffer[position], &buffer[position + length], size - position - length);
+				size -= length;
+			}
+			break;
+		case 5:
+			// overwrite with a piece of another input
+			other = &corpus[fuzz_random() % corpus_count];
+			if ( other->size && size ) {
+				length = 1 + fuzz_random() % other->size;
+				if ( length > size - position ) length = size - position;
+				memcpy(&buffer[position], &other->data[fuzz_random() % (other->size - length + 1)], length);
+			}
+			break;
+		}
+	}
+	return size;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long runs = 10000, seed = 1, max_len = 512, timeout = 10;
+	unsigned long run;
+	uint8_t *buffer;
+	size_t size;
+	int i;
+
+	for (i=1; i<argc; i++) {
+		if ( sscanf(argv[i], "-runs=%lu", &runs) == 1 || sscanf(argv[i], "-seed=%lu", &seed) == 1
+			 || sscanf(argv[i], "-max_len=%lu", &max_len) == 1 || sscanf(argv[i], "-timeout=%lu", &timeout) == 1 ) {
+			continue;
+		}
+		if ( argv[i][0] == '-' ) {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+		fuzz_addCorpus(argv[i]);
+	}
+	if ( corpus_count == 0 ) {
+		fprintf(stderr, "Usage: %s [-runs=n] [-seed=n] [-max_len=n] [-timeout=s] corpus ...\n", argv[0]);
+		return 1;
+	}
+	signal(SIGABRT, fuzz_crash);
+	signal(SIGALRM, fuzz_timeout);
+	random_state = 0x9E3779B97F4A7C15ULL ^ seed;
+
+	for (i=0; i<corpus_count; i++) {
+		fuzz_run(corpus[i].data, corpus[i].size, timeout);
+	}
+	buffer = malloc(max_len + 1);
+	for (run=0; run<runs; run++) {
+		size = fuzz_mutate(buffer, max_len);
+		fuzz_run(buffer, size, timeout);
+	}
+	printf("%i corpus inputs and %lu mutations done\n", corpus_count, runs);
+	free(buffer);
+	return 0;
+}
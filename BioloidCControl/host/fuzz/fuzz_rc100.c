@@ -0,0 +1,59 @@
+/*
+ * fuzz_rc100.c - Fuzz target for the RC-100 packet decoder
+ *   Passes the input byte by byte to rc100_receiveByte, as the receive
+ *   ISR does with RC100 defined in serial.h, and turns the decoded button
+ *   state into commands with rc100_getCommand after every byte.
+ *
+ *   byte 0		time between two bytes in ms - 1 (up to 256ms, so button
+ *				holds, repeats and lost release packets happen)
+ *   rest		bytes received from the RC-100 (FF 55 L ~L H ~H)
+ *
+ * Runs with libFuzzer or fuzz_main.c, see host/CMakeLists.txt.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <stdint.h>
+#include <avr/interrupt.h>
+#include "global.h"
+#include "clock.h"
+#include "rc100.h"
+#include "hal_host.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	static uint8 ready = 0;
+	uint32_t gap_us;
+	size_t i;
+
+	if ( size < 1 ) {
+		return 0;
+	}
+	if ( !ready ) {
+		host_reset();
+		clock_init();
+		sei();
+		ready = 1;
+	}
+
+	gap_us = (data[0] + 1) * 1000UL;
+	for (i=1; i<size; i++) {
+		cli();
+		rc100_receiveByte(data[i]);
+		sei();
+		host_delay(gap_us);
+		rc100_getCommand();
+	}
+	return 0;
+}
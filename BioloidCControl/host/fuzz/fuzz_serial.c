@@ -0,0 +1,72 @@
+/*
+ * fuzz_serial.c - Fuzz target for the terminal command parser
+ *   Sends the input on the PC link, the receive ISR of serial.c buffers
+ *   it and the main loop side (serialReceiveCommand, serial_interpret_command
+ *   and command_match_string) parses every line ended by CR.
+ *
+ *   byte 0		bytes received per poll of serialReceiveCommand - 1 (lower
+ *				6 bits), a slow main loop lets lines pile up in the buffer
+ *   rest		bytes received at 57600 baud
+ *
+ * Runs with libFuzzer or fuzz_main.c, see host/CMakeLists.txt.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <stdint.h>
+#include <avr/interrupt.h>
+#include "global.h"
+#include "clock.h"
+#include "serial.h"
+#include "hal_host.h"
+
+// firmware state (BioloidCControl.c)
+extern volatile uint8 flag_receive_ready;
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	static uint8 ready = 0;
+	uint32_t poll_us;
+	uint64_t end;
+	size_t received;
+
+	if ( size < 1 ) {
+		return 0;
+	}
+	if ( !ready ) {
+		host_reset();
+		clock_init();
+		serial_init(57600);
+		sei();
+		ready = 1;
+	}
+
+	// the UART queues no more than HOST_RX_QUEUE bytes
+	serial_clear();
+	flag_receive_ready = 0;
+	received = size - 1;
+	if ( received > HOST_RX_QUEUE ) {
+		received = HOST_RX_QUEUE;
+	}
+	end = host_ticks() + received * host_uartByteTicks(HAL_UART_PC);
+	host_uartReceive(HAL_UART_PC, host_ticks(), &data[1], received);
+
+	// poll until the last byte is in
+	poll_us = ((data[0] & 0x3F) + 1) * host_uartByteTicks(HAL_UART_PC) / HOST_TICKS_PER_US + 1;
+	do {
+		host_delay(poll_us);
+		serialReceiveCommand();
+	} while ( host_ticks() <= end );
+	return 0;
+}
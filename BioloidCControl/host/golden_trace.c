@@ -0,0 +1,796 @@
+/*
+ * golden_trace.c - Golden bus traffic of the motion pages and walk commands
+ *   Plays every motion page of motion.h and a few walk command sequences
+ *   through executeMotionSequence against the simulated AX-12 servos
+ *   (ax12_sim.c), records the packets on the Dynamixel bus with their
+ *   virtual time and compares them with the traces checked in under
+ *   host/golden. Prints the bus bytes and bus time of every case.
+ *
+ * Usage:	golden_trace [-u] [-t us] [-v units] golden_directory [case ...]
+ *   -u		write the traces instead of comparing (after an intended change)
+ *   -t		time tolerance in us (default 2000) of the time between two lines
+ *			and of the length of a run
+ *   -v		tolerance of positions and speeds (default 2)
+ *   case	page_001 ... page_227 or a walk sequence (default all)
+ * Exit code is the number of cases that don't match.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Trace files
+ *
+ * One line per call of executeMotionSequence that used the bus, with the
+ * time of its first packet in us from the start of the case and the
+ * exchanges on the bus (an instruction packet and its status packet, if
+ * any) without the 0xFF 0xFF header and the checksum:
+ *
+ *   1204.0 > 01 04 02 24 02 < 01 04 00 00 02 | > 02 04 02 24 02 < 02 04 00 00 02
+ *   1310.0-5310.0 *5 > 01 04 02 2E 01 < 01 03 00 00 | *3 > 02 04 02 2E 01 < 02 03 00 01
+ *
+ * "*n" in front of an exchange repeats it n times in a row, in front of
+ * the line it's a run of calls with the same traffic (the MOVING polls)
+ * from the first to the last time. A packet with a wrong checksum ends
+ * with "!". The last line is the total of bytes, their time on the bus at
+ * 1Mbps and the length of the case.
+ *
+ * The golden traces are kept gzipped (<case>.trace.gz), a trace that
+ * differs is left next to the program as <case>.trace.
+ *
+ * Each case runs in a child process on a fresh firmware state, starting
+ * from all servos at 512 after dxl_init and readCurrentPose. A motion
+ * page gets its "M<page>" command. A page that goes on to a next page
+ * (the walk pages) gets STOP when its last step starts, so the case is
+ * the page and its exit page, without the pause after the last step.
+ * executeMotionSequence is called every ms like task_motion.
+ *
+ * Comparing: the exchanges must be the same apart from the times, the
+ * repeats (as many as fit into -t, one call per ms or one exchange per
+ * 100us) and the goal positions, speeds, torque limits and present
+ * positions (within -v). Everything else has to match byte for byte.
+ * Times are compared as the time from the end of the line before to the
+ * start of a line and the length of a run (within -t each), not from the
+ * start of the case: a change early in a case (e.g. an extra timer read,
+ * which takes time on the host) doesn't shift every later line.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <zlib.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "global.h"
+#include "clock.h"
+#include "serial.h"
+#include "dynamixel.h"
+#include "motion_f.h"
+#include "pose.h"
+#include "hal_host.h"
+#include "ax12_sim.h"
+
+#define CASE_LIMIT_MS		30000	// cases that take longer fail
+#define MAX_COMMANDS		6
+#define MAX_EXCHANGE		(2 * 3 * 260)	// hex text of an instruction and its reply
+
+// a walk sequence: commands and how long each one runs (ms)
+typedef struct {
+	const char *name;
+	const char *commands[MAX_COMMANDS];
+	uint16 duration[MAX_COMMANDS];
+} golden_walk;
+
+static const golden_walk walks[] = {
+	{ "walk_forward",	{ "WFWD", "STOP" },					{ 6000, 3000 } },
+	{ "walk_turns",		{ "WFWD", "WLT ", "WRT ", "STOP" },	{ 3000, 3000, 3000, 3000 } },
+	{ "walk_sides",		{ "WLSD", "WRSD", "WBWD", "STOP" },	{ 3000, 3000, 3000, 3000 } },
+	{ "walk_diagonal",	{ "WFLS", "WFRT", "WBLT", "STOP" },	{ 3000, 3000, 3000, 3000 } },
+};
+#define NUM_WALKS	(sizeof(walks) / sizeof(walks[0]))
+
+// firmware state (BioloidCControl.c, motion.c, motion.h, serial.c)
+extern const uint8 AX12_IDS[NUM_AX12_SERVOS];
+extern const uint8 * const motion_pointer[NUM_MOTION_PAGES+1];
+extern volatile uint8 bioloid_command;
+extern volatile bool new_command;
+extern volatile uint8 current_motion_page;
+extern volatile uint8 current_step;
+extern uint8 motion_state;
+extern uint8 repeat_counter;
+extern char command[5];
+void command_match_string(void);
+
+// case run by the child process
+static uint16 case_page = 0;
+static const golden_walk *case_walk = NULL;
+
+// recording: the exchange being put together, the last one of the call
+// (repeated exchange_repeats times), the traffic of the call so far and
+// the last line not yet written (repeated run_count times)
+static FILE *trace;
+static uint64_t trace_start;
+static char exchange[MAX_EXCHANGE];
+static uint64_t exchange_ticks;
+static uint8 exchange_replied;
+static char last_exchange[MAX_EXCHANGE];
+static uint32 exchange_repeats = 0;
+static char *call = NULL, *run = NULL;
+static size_t call_length = 0, call_size = 0, run_size = 0;
+static uint64_t call_ticks;
+static uint64_t run_first, run_last;
+static uint32 run_count = 0;
+static uint32 trace_bytes = 0;
+
+static int time_tolerance = 2000;
+static int value_tolerance = 2;
+
+
+// Recording
+
+static void trace_time(char *text, uint64_t ticks)
+{
+	ticks -= trace_start;
+	sprintf(text, "%llu.%llu", (unsigned long long) (ticks / HOST_TICKS_PER_US),
+			(unsigned long long) ((ticks % HOST_TICKS_PER_US) * 10 / HOST_TICKS_PER_US));
+}
+
+// write the run of calls with the same traffic
+static void trace_flushRun(void)
+{
+	char first[24], last[24];
+
+	if ( run_count == 0 ) {
+		return;
+	}
+	trace_time(first, run_first);
+	if ( run_count == 1 ) {
+		fprintf(trace, "%s %s\n", first, run);
+	} else {
+		trace_time(last, run_last);
+		fprintf(trace, "%s-%s *%lu %s\n", first, last, (unsigned long) run_count, run);
+	}
+	run_count = 0;
+}
+
+// add the repeated exchange to the traffic of the call
+static void trace_flushExchange(void)
+{
+	char prefix[16] = "";
+	size_t length;
+
+	if ( exchange_repeats == 0 ) {
+		return;
+	}
+	if ( exchange_repeats > 1 ) {
+		sprintf(prefix, "*%lu ", (unsigned long) exchange_repeats);
+	}
+	length = call_length + strlen(prefix) + strlen(last_exchange) + 4;
+	if ( length > call_size ) {
+		call_size = 2 * length;
+		call = realloc(call, call_size);
+	}
+	call_length += sprintf(call + call_length, "%s%s%s", call_length > 0 ? " | " : "", prefix, last_exchange);
+	exchange_repeats = 0;
+}
+
+// a complete exchange repeats the last one or goes into the traffic of the call
+static void trace_endExchange(void)
+{
+	if ( exchange[0] == 0 ) {
+		return;
+	}
+	if ( exchange_repeats > 0 && strcmp(last_exchange, exchange) == 0 ) {
+		exchange_repeats++;
+	} else {
+		trace_flushExchange();
+		if ( call_length == 0 ) {
+			call_ticks = exchange_ticks;
+		}
+		strcpy(last_exchange, exchange);
+		exchange_repeats = 1;
+	}
+	exchange[0] = 0;
+}
+
+// end of a call of executeMotionSequence: its traffic repeats the last line or starts a new one
+static void trace_endCall(void)
+{
+	trace_endExchange();
+	trace_flushExchange();
+	if ( call_length == 0 ) {
+		return;
+	}
+	if ( run_count > 0 && strcmp(run, call) == 0 ) {
+		run_last = call_ticks;
+		run_count++;
+	} else {
+		trace_flushRun();
+		if ( call_length + 1 > run_size ) {
+			run_size = call_size;
+			run = realloc(run, run_size);
+		}
+		strcpy(run, call);
+		run_first = run_last = call_ticks;
+		run_count = 1;
+	}
+	call_length = 0;
+}
+
+static void trace_packet(void *context, uint8 from_servo, const uint8 *packet, uint16 length, uint64_t ticks)
+{
+	char *text;
+	uint8 checksum = 0;
+	uint16 i;
+
+	(void) context;
+	trace_bytes += length;
+	for (i=2; i<length-1; i++) {
+		checksum += packet[i];
+	}
+	// a reply belongs to the instruction before it
+	if ( !from_servo || exchange_replied || exchange[0] == 0 ) {
+		trace_endExchange();
+		exchange_ticks = ticks;
+		exchange_replied = 0;
+	}
+	if ( from_servo ) {
+		exchange_replied = 1;
+	}
+	text = exchange + strlen(exchange);
+	text += sprintf(text, "%s%c", exchange[0] ? " " : "", from_servo ? '<' : '>');
+	for (i=2; i<length-1; i++) {
+		text += sprintf(text, " %02X", packet[i]);
+	}
+	if ( (uint8) ~checksum != packet[length-1] ) {
+		strcpy(text, " !");
+	}
+}
+
+static void case_command(const char *text)
+{
+	strcpy(command, text);
+	command_match_string();
+	new_command = TRUE;
+}
+
+// Returns:	(uint32) ms since the start of the case
+static uint32 case_ms(void)
+{
+	return (host_ticks() - trace_start) / (1000 * HOST_TICKS_PER_US);
+}
+
+// one call of executeMotionSequence and the 1ms to the next one
+static void case_call(void)
+{
+	executeMotionSequence();
+	trace_endCall();
+	host_delay(1000);
+}
+
+// call executeMotionSequence every ms until the motion has stopped or the time is up
+static void case_play(uint32 until_ms)
+{
+	do {
+		case_call();
+	} while ( (motion_state != MOTION_STOPPED || new_command) && motion_state != MOTION_ALARM && case_ms() < until_ms );
+}
+
+// firmware side of a case (in host_run)
+static void case_run(void)
+{
+	const uint8 *page;
+	char text[8];
+	uint32 end = 0;
+	uint8 i;
+
+	serial_init(57600);
+	clock_init();
+	sei();
+	dxl_init(DEFAULT_BAUDNUMBER);
+	motionPageInit();
+	readCurrentPose(READ_ALL, 0);
+
+	trace_start = host_ticks();
+	ax12_sim_setMonitor(trace_packet, NULL);
+	if ( case_walk != NULL ) {
+		// each command for its time, the last one (STOP) until the robot has stopped
+		for (i=0; i<MAX_COMMANDS && case_walk->commands[i] != NULL; i++) {
+			case_command(case_walk->commands[i]);
+			end += case_walk->duration[i];
+			do {
+				case_call();
+			} while ( case_ms() < end && motion_state != MOTION_ALARM );
+		}
+		case_play(CASE_LIMIT_MS);
+	} else {
+		// header of the page: next page, exit page, repeats, speed, inertial force, steps
+		page = (const uint8 *) pgm_read_word(&motion_pointer[case_page]);
+		sprintf(text, "M%u", case_page);
+		case_command(text);
+		if ( pgm_read_byte(page + NUM_AX12_SERVOS) != 0 ) {
+			do {
+				case_call();
+			} while ( (current_motion_page != case_page || current_step != pgm_read_byte(page + NUM_AX12_SERVOS + 5)
+					   || repeat_counter < pgm_read_byte(page + NUM_AX12_SERVOS + 2))
+					  && (motion_state != MOTION_STOPPED || new_command) && motion_state != MOTION_ALARM && case_ms() < CASE_LIMIT_MS );
+			case_command("STOP");
+		}
+		case_play(CASE_LIMIT_MS);
+	}
+	ax12_sim_setMonitor(NULL, NULL);
+	trace_endCall();
+	trace_flushRun();
+	if ( motion_state == MOTION_ALARM ) {
+		fprintf(trace, "alarm\n");
+	} else if ( motion_state != MOTION_STOPPED ) {
+		fprintf(trace, "no stop\n");
+	}
+	fprintf(trace, "total %lu bytes %lu us bus %lu ms\n", (unsigned long) trace_bytes,
+			(unsigned long) (trace_bytes * host_uartByteTicks(HAL_UART_DXL) / HOST_TICKS_PER_US), (unsigned long) case_ms());
+}
+
+// run a case in a child process, the trace goes to file
+// Returns:	(int) 0 if it ran to the end
+static int case_record(const char *file)
+{
+	uint8 ids[NUM_AX12_SERVOS];
+	uint8 i;
+	pid_t child;
+	int status;
+
+	fflush(stdout);
+	child = fork();
+	if ( child < 0 ) {
+		perror("fork");
+		return -1;
+	}
+	if ( child == 0 ) {
+		trace = fopen(file, "w");
+		if ( trace == NULL ) {
+			perror(file);
+			_exit(2);
+		}
+		host_reset();
+		for (i=0; i<NUM_AX12_SERVOS; i++) {
+			ids[i] = pgm_read_byte(&AX12_IDS[i]);
+		}
+		ax12_sim_init(NUM_AX12_SERVOS, ids);
+		status = host_run(case_run, (CASE_LIMIT_MS + 10000) * 1000ULL);
+		fclose(trace);
+		_exit(status);
+	}
+	if ( waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ) {
+		return -1;
+	}
+	return 0;
+}
+
+
+// Comparing
+
+// Returns:	(int) 1 if a control table address is part of a position or speed
+//				  (goal position, moving speed, torque limit, present position and speed)
+static int compare_isValue(uint8 address)
+{
+	return address >= DXL_GOAL_POSITION_L && address <= DXL_PRESENT_SPEED_H;
+}
+
+// split the hex bytes of a packet after the marker into values
+// Returns:	(int) number of bytes
+static int compare_bytes(const char *text, char marker, uint16 *bytes)
+{
+	const char *p = strchr(text, marker);
+	int count = 0;
+	unsigned int value;
+	int used;
+
+	if ( p == NULL ) {
+		return -1;
+	}
+	p++;
+	while ( sscanf(p, " %2x%n", &value, &used) == 1 && count < 260 ) {
+		bytes[count++] = value;
+		p += used;
+	}
+	return count;
+}
+
+// compare the data bytes of a write, sync write or read reply
+// address is the control table address of data[0]
+// Returns:	(int) 1 if they match within the value tolerance
+static int compare_data(const uint16 *expected, const uint16 *actual, int count, uint8 address)
+{
+	int i, a, b;
+
+	for (i=0; i<count; i++) {
+		if ( compare_isValue(address + i) && ((address + i) & 1) == 0 && i + 1 < count ) {
+			a = expected[i] | (expected[i+1] << 8);
+			b = actual[i] | (actual[i+1] << 8);
+			if ( abs(a - b) > value_tolerance ) {
+				return 0;
+			}
+			i++;
+		} else if ( expected[i] != actual[i] ) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Returns:	(int) 1 if two exchanges match within the value tolerance
+static int compare_exchange(const char *expected, const char *actual)
+{
+	uint16 e[260], a[260], er[260], ar[260];
+	int n, reply, i, item;
+
+	if ( strcmp(expected, actual) == 0 ) {
+		return 1;
+	}
+	n = compare_bytes(expected, '>', e);
+	if ( n != compare_bytes(actual, '>', a) || n < 3 || e[0] != a[0] || e[1] != a[1] || e[2] != a[2] ) {
+		return 0;
+	}
+	if ( (strchr(expected, '!') == NULL) != (strchr(actual, '!') == NULL) ) {
+		return 0;
+	}
+	// packets are ID LENGTH INSTRUCTION PARAMETERS
+	switch ( e[2] ) {
+		case INST_WRITE:
+		case INST_REG_WRITE:
+			if ( n < 4 || e[3] != a[3] || !compare_data(&e[4], &a[4], n - 4, e[3]) ) {
+				return 0;
+			}
+			break;
+		case INST_SYNC_WRITE:
+			if ( n < 5 || e[3] != a[3] || e[4] != a[4] ) {
+				return 0;
+			}
+			item = e[4] + 1;
+			for (i=5; i<n; i+=item) {
+				if ( e[i] != a[i] || !compare_data(&e[i+1], &a[i+1], (item - 1 < n - i - 1) ? item - 1 : n - i - 1, e[3]) ) {
+					return 0;
+				}
+			}
+			break;
+		default:
+			for (i=3; i<n; i++) {
+				if ( e[i] != a[i] ) {
+					return 0;
+				}
+			}
+	}
+	// status packets are ID LENGTH ERROR PARAMETERS, read replies start at the address read
+	reply = compare_bytes(expected, '<', er);
+	if ( reply != compare_bytes(actual, '<', ar) ) {
+		return 0;
+	}
+	if ( reply >= 3 ) {
+		for (i=0; i<3; i++) {
+			if ( er[i] != ar[i] ) {
+				return 0;
+			}
+		}
+		if ( e[2] == INST_READ ) {
+			return compare_data(&er[3], &ar[3], reply - 3, e[3]);
+		}
+		for (i=3; i<reply; i++) {
+			if ( er[i] != ar[i] ) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+// split a trace line into first and last time (us), run length and the traffic
+// Returns:	(int) 1 for a line of traffic, 0 for any other line
+static int compare_parse(const char *line, double *first, double *last, unsigned long *count, const char **text)
+{
+	int used;
+
+	*count = 1;
+	if ( sscanf(line, "%lf-%lf *%lu %n", first, last, count, &used) == 3 ) {
+		*text = line + used;
+		return 1;
+	}
+	if ( sscanf(line, "%lf %n", first, &used) == 1 && (line[used] == '>' || line[used] == '*') ) {
+		*last = *first;
+		*text = line + used;
+		return 1;
+	}
+	*text = line;
+	return 0;
+}
+
+// take the next exchange off the traffic of a call (the text is cut up)
+// Returns:	(char *) the exchange, NULL at the end
+static char *compare_nextExchange(char **text, unsigned long *repeats)
+{
+	char *exchange = *text;
+	char *end;
+	int used;
+
+	if ( exchange == NULL || *exchange == 0 ) {
+		return NULL;
+	}
+	end = strstr(exchange, " | ");
+	if ( end != NULL ) {
+		*end = 0;
+		*text = end + 3;
+	} else {
+		*text = NULL;
+	}
+	*repeats = 1;
+	if ( sscanf(exchange, "*%lu %n", repeats, &used) == 1 ) {
+		exchange += used;
+	}
+	return exchange;
+}
+
+// Returns:	(int) 1 if the traffic of two calls matches within the tolerances,
+//				  prints the first exchange that doesn't
+static int compare_calls(const char *expected, const char *actual, int line)
+{
+	char *e_copy = strdup(expected), *a_copy = strdup(actual);
+	char *e_text = e_copy, *a_text = a_copy;
+	char *e, *a;
+	unsigned long e_repeats, a_repeats;
+	long repeat_tolerance = time_tolerance / 100 + 1;
+	int result = 1;
+
+	do {
+		e = compare_nextExchange(&e_text, &e_repeats);
+		a = compare_nextExchange(&a_text, &a_repeats);
+		if ( e == NULL || a == NULL ) {
+			result = (e == a);
+			if ( !result ) {
+				printf("  line %i has %s exchanges than expected\n", line, e == NULL ? "more" : "fewer");
+			}
+			break;
+		}
+		if ( labs((long) e_repeats - (long) a_repeats) > repeat_tolerance || !compare_exchange(e, a) ) {
+			printf("  line %i differs\n    expected: *%lu %s\n    actual:   *%lu %s\n", line, e_repeats, e, a_repeats, a);
+			result = 0;
+		}
+	} while ( result );
+	free(e_copy);
+	free(a_copy);
+	return result;
+}
+
+// read a line of any length from a trace, plain or gzipped
+// Returns:	(int) 0 at the end of the file
+static int compare_getline(gzFile file, char **line, size_t *size)
+{
+	size_t length = 0;
+
+	if ( *line == NULL ) {
+		*size = 4096;
+		*line = malloc(*size);
+	}
+	(*line)[0] = 0;
+	while ( gzgets(file, *line + length, *size - length) != NULL ) {
+		length += strlen(*line + length);
+		if ( length > 0 && (*line)[length-1] == '\n' ) {
+			break;
+		}
+		*size *= 2;
+		*line = realloc(*line, *size);
+	}
+	return length > 0;
+}
+
+// compare a trace with its golden trace, print the first difference
+// Returns:	(int) 0 if they match
+static int compare_traces(const char *golden_file, const char *actual_file)
+{
+	gzFile golden, actual;
+	char *g_line = NULL, *a_line = NULL;
+	size_t g_size = 0, a_size = 0;
+	double g_first, g_last, a_first, a_last;
+	double g_end = 0, a_end = 0;	// last time of the line of traffic before
+	unsigned long g_count, a_count;
+	const char *g_text, *a_text;
+	int line = 0, g_traffic, a_traffic, result = 0;
+	int g_more, a_more;
+	long run_tolerance = time_tolerance / 1000 + 1;
+
+	golden = gzopen(golden_file, "rb");
+	if ( golden == NULL ) {
+		printf("  no golden trace %s (run with -u to create it)\n", golden_file);
+		return 1;
+	}
+	actual = gzopen(actual_file, "rb");
+	if ( actual == NULL ) {
+		gzclose(golden);
+		return 1;
+	}
+	while ( result == 0 ) {
+		g_more = compare_getline(golden, &g_line, &g_size);
+		a_more = compare_getline(actual, &a_line, &a_size);
+		line++;
+		if ( !g_more && !a_more ) {
+			break;
+		}
+		if ( !g_more || !a_more ) {
+			printf("  line %i: trace is %s than the golden trace\n", line, g_more ? "shorter" : "longer");
+			result = 1;
+			break;
+		}
+		g_line[strcspn(g_line, "\r\n")] = 0;
+		a_line[strcspn(a_line, "\r\n")] = 0;
+		g_traffic = compare_parse(g_line, &g_first, &g_last, &g_count, &g_text);
+		a_traffic = compare_parse(a_line, &a_first, &a_last, &a_count, &a_text);
+		if ( !g_traffic || !a_traffic ) {
+			// the totals may change within the tolerances, everything else must match
+			if ( g_traffic != a_traffic || (strncmp(g_text, "total", 5) != 0 && strcmp(g_text, a_text) != 0) ) {
+				printf("  line %i differs\n    expected: %.100s\n    actual:   %.100s\n", line, g_line, a_line);
+				result = 1;
+			}
+		} else if ( fabs((g_first - g_end) - (a_first - a_end)) > time_tolerance
+					|| fabs((g_last - g_first) - (a_last - a_first)) > time_tolerance
+					|| labs((long) g_count - (long) a_count) > run_tolerance ) {
+			printf("  line %i differs in time (after the line before, length, calls)\n"
+				   "    expected: %.1f-%.1f *%lu (+%.1f, %.1f)\n    actual:   %.1f-%.1f *%lu (+%.1f, %.1f)\n",
+				   line, g_first, g_last, g_count, g_first - g_end, g_last - g_first,
+				   a_first, a_last, a_count, a_first - a_end, a_last - a_first);
+			result = 1;
+		} else if ( !compare_calls(g_text, a_text, line) ) {
+			result = 1;
+		} else {
+			g_end = g_last;
+			a_end = a_last;
+		}
+	}
+	free(g_line);
+	free(a_line);
+	gzclose(golden);
+	gzclose(actual);
+	return result;
+}
+
+// compress a trace into its golden trace
+// Returns:	(int) 0 if it was written
+static int golden_write(const char *trace_file, const char *golden_file)
+{
+	FILE *in = fopen(trace_file, "rb");
+	gzFile out;
+	char buffer[8192];
+	size_t length;
+	int result = 0;
+
+	if ( in == NULL ) {
+		return -1;
+	}
+	out = gzopen(golden_file, "wb9");
+	if ( out == NULL ) {
+		perror(golden_file);
+		fclose(in);
+		return -1;
+	}
+	while ( (length = fread(buffer, 1, sizeof(buffer), in)) > 0 ) {
+		if ( gzwrite(out, buffer, length) != (int) length ) {
+			result = -1;
+		}
+	}
+	fclose(in);
+	if ( gzclose(out) != Z_OK ) {
+		result = -1;
+	}
+	return result;
+}
+
+// Returns:	(int) 0 if the case ran and matched (or was written)
+static int golden_case(const char *name, const char *directory, uint8 update)
+{
+	char golden_file[512], trace_file[512], total[128] = "";
+	char *line = NULL;
+	size_t size = 0;
+	FILE *file;
+	int result;
+
+	snprintf(golden_file, sizeof(golden_file), "%s/%s.trace.gz", directory, name);
+	snprintf(trace_file, sizeof(trace_file), "%s.trace", name);
+	if ( case_record(trace_file) != 0 ) {
+		printf("%-16s did not finish\n", name);
+		return 1;
+	}
+	// report the totals from the last line
+	file = fopen(trace_file, "r");
+	if ( file != NULL ) {
+		while ( getline(&line, &size, file) >= 0 ) {
+			if ( strncmp(line, "total ", 6) == 0 ) {
+				snprintf(total, sizeof(total), "%s", line + 6);
+				total[strcspn(total, "\r\n")] = 0;
+			}
+		}
+		free(line);
+		fclose(file);
+	}
+	if ( update ) {
+		result = golden_write(trace_file, golden_file);
+		printf("%-16s %s, %s\n", name, total, result == 0 ? "written" : "NOT WRITTEN");
+	} else {
+		result = compare_traces(golden_file, trace_file);
+		printf("%-16s %s, %s\n", name, total, result == 0 ? "ok" : "DIFFERS");
+	}
+	if ( result == 0 ) {
+		remove(trace_file);
+		return 0;
+	}
+	printf("  trace kept in %s\n", trace_file);
+	return 1;
+}
+
+// Returns:	(int) 1 if the case was selected on the command line
+static int golden_selected(const char *name, int argc, char *argv[], int first)
+{
+	int i;
+
+	if ( first >= argc ) {
+		return 1;
+	}
+	for (i=first; i<argc; i++) {
+		if ( strcmp(argv[i], name) == 0 ) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	char name[16];
+	const char *directory;
+	uint8 update = 0;
+	int failures = 0, option;
+	uint16 page;
+	uint8 i;
+
+	while ( (option = getopt(argc, argv, "ut:v:")) != -1 ) {
+		switch ( option ) {
+			case 'u':	update = 1; break;
+			case 't':	time_tolerance = atoi(optarg); break;
+			case 'v':	value_tolerance = atoi(optarg); break;
+			default:
+				printf("Usage: golden_trace [-u] [-t us] [-v units] golden_directory [case ...]\n");
+				return 1;
+		}
+	}
+	if ( optind >= argc ) {
+		printf("Usage: golden_trace [-u] [-t us] [-v units] golden_directory [case ...]\n");
+		return 1;
+	}
+	directory = argv[optind];
+
+	for (page=1; page<=NUM_MOTION_PAGES; page++) {
+		sprintf(name, "page_%03u", page);
+		if ( golden_selected(name, argc, argv, optind + 1) ) {
+			case_page = page;
+			case_walk = NULL;
+			failures += golden_case(name, directory, update);
+		}
+	}
+	for (i=0; i<NUM_WALKS; i++) {
+		if ( golden_selected(walks[i].name, argc, argv, optind + 1) ) {
+			case_walk = &walks[i];
+			failures += golden_case(walks[i].name, directory, update);
+		}
+	}
+	printf("%i cases differ\n", failures);
+	return failures;
+}
@@ -0,0 +1,737 @@
+/*
+ * hal_host.c - Stub devices and virtual clock of the host build
+ *   Implements the hardware abstraction layer (hal.h) for the host: the
+ *   UARTs, TIMER5, TIMER1, buttons, ADC and LEDs of the CM-510 as plain
+ *   state on a virtual clock that calls the firmware's interrupt service
+ *   routines when their events are due (see hal_host.h).
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <setjmp.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "global.h"
+#include "hal.h"
+#include "hal_host.h"
+
+// interrupt service routines of the firmware (ISR() makes them functions)
+void INT0_vect(void);
+void TIMER1_OVF_vect(void);
+void USART0_RX_vect(void);
+void USART0_UDRE_vect(void);
+void USART0_TX_vect(void);
+void USART1_RX_vect(void);
+void USART1_UDRE_vect(void);
+void TIMER5_COMPA_vect(void);
+void TIMER5_OVF_vect(void);
+
+// interrupt sources in vector order, the order of simultaneous interrupts
+#define IRQ_INT0			0
+#define IRQ_TIMER1_OVF		1
+#define IRQ_DXL_RX			2
+#define IRQ_DXL_UDRE		3
+#define IRQ_DXL_TX			4
+#define IRQ_PC_RX			5
+#define IRQ_PC_UDRE			6
+#define IRQ_TIMER5_COMPA	7
+#define IRQ_TIMER5_OVF		8
+#define IRQ_COUNT			9
+#define IRQ_NONE			0xFF
+
+#define NEVER				UINT64_MAX
+
+// UCSRnB bits besides those in hal.h
+#define UART_RX_INTERRUPT	0x80
+#define UART_RECEIVER		0x10
+
+// a UART (USART0 Dynamixel bus, USART1 PC link)
+typedef struct {
+	uint8 control;						// UCSRnB
+	uint16 divisor;						// UBRRn
+	uint8 data;							// received byte for the receive ISR
+	uint64_t sent;						// the last byte sent is out at this time
+	uint8 tx_done;						// transmit complete not yet handled
+	host_uartListener listener;
+	void *context;
+	uint64_t rx_time[HOST_RX_QUEUE];	// bytes arriving
+	uint8 rx_data[HOST_RX_QUEUE];
+	uint16 rx_head, rx_tail;
+} host_uart;
+
+// an event of the world outside the controller
+typedef struct {
+	uint64_t time;
+	void (*event)(void *arg);
+	void *arg;
+} host_event;
+
+// avr/io.h registers
+volatile uint8_t host_sreg = 0;
+volatile uint8_t host_mcusr = (1<<PORF);
+volatile uint8_t host_wdtcsr = 0;
+
+// virtual clock and host_run
+static uint64_t host_now = 0;
+static uint64_t host_end = NEVER;
+static uint8 host_running = 0;
+static uint8 host_in_isr = 0;
+static jmp_buf host_stop;
+static host_event host_events[HOST_MAX_EVENTS];
+static uint8 host_event_count = 0;
+
+// TIMER5: clock and button sampling
+static uint8 t5_running;
+static uint64_t t5_origin;				// time the count was 0
+static uint64_t t5_overflow;			// next overflow not yet handled
+static uint8 t5_sampling;				// compare A interrupt on
+static uint64_t t5_compare;				// next compare A match
+
+// buttons (bit n is button id n) and edge interrupts
+static uint8 button_pins;
+static uint8 button_edges_enabled;
+static uint8 button_edge;
+
+// ADC
+static uint16 adc_values[32];
+static uint8 adc_channel;
+static uint8 adc_left;
+static uint64_t adc_done;
+
+// LEDs and buzzer (TIMER1)
+static uint8 led_port;
+static uint8 t1_enabled;
+static uint8 t1_clock;
+static uint16 t1_top;
+static uint16 t1_duty;
+static uint64_t t1_overflow;
+static uint8 buzzer_pin;
+
+static host_uart uarts[2];
+static uint8 dxl_transmitting;
+
+// internal function prototypes
+static void host_advance(uint64_t ticks);
+static void host_advanceTo(uint64_t target);
+static void host_runEvents(void);
+static uint8 host_nextInterrupt(uint64_t *due);
+static void host_interrupt(uint8 irq);
+static uint32_t t1_period(void);
+
+
+// Host side
+
+// devices to their power-on state, time to 0, interrupts disabled
+void host_reset()
+{
+	uint8 i;
+
+	host_now = 0;
+	host_end = NEVER;
+	host_in_isr = 0;
+	host_event_count = 0;
+	host_sreg = 0;
+	host_mcusr = (1<<PORF);
+	host_wdtcsr = 0;
+	t5_running = 0;
+	t5_sampling = 0;
+	button_pins = 0;
+	button_edges_enabled = 0;
+	button_edge = 0;
+	// a centred gyro/accelerometer, nothing in front of the DMS sensor,
+	// a charged battery (12V through the 1:4 divider) and the 1.1V bandgap
+	for (i=0; i<32; i++) {
+		adc_values[i] = 512;
+	}
+	adc_values[ADC_BATTERY] = 614;
+	adc_values[ADC_DMS] = 50;
+	adc_values[ADC_ULTRASONIC] = 0;
+	adc_values[30] = 225;
+	adc_channel = 0;
+	adc_left = 0;
+	adc_done = 0;
+	led_port = 0xFF;
+	t1_enabled = 0;
+	t1_clock = 0;
+	t1_top = 0;
+	t1_duty = 0;
+	buzzer_pin = 0;
+	memset(uarts, 0, sizeof(uarts));
+	dxl_transmitting = 0;
+}
+
+// Returns:	(uint64_t) virtual time since host_reset (ticks)
+uint64_t host_ticks()
+{
+	return host_now;
+}
+
+// let virtual time pass, the devices and interrupts run meanwhile
+void host_delay(uint32_t us)
+{
+	host_advance((uint64_t) us * HOST_TICKS_PER_US);
+}
+
+// call the firmware until it returns or the virtual time reaches end_us
+// Returns:	(uint8) 1 if the time ran out, 0 if entry returned
+uint8 host_run(void (*entry)(void), uint64_t end_us)
+{
+	host_end = end_us * HOST_TICKS_PER_US;
+	if ( setjmp(host_stop) == 0 ) {
+		host_running = 1;
+		entry();
+		host_running = 0;
+		host_end = NEVER;
+		return 0;
+	}
+	// stopped in the middle of whatever the firmware was doing
+	host_running = 0;
+	host_in_isr = 0;
+	host_end = NEVER;
+	host_sreg |= 0x80;
+	return 1;
+}
+
+// call event(arg) when the virtual time reaches at_us
+void host_at(uint64_t at_us, void (*event)(void *arg), void *arg)
+{
+	uint64_t time = at_us * HOST_TICKS_PER_US;
+	uint8 i;
+
+	if ( host_event_count == HOST_MAX_EVENTS ) {
+		return;
+	}
+	// keep them sorted by time, events at the same time in the order they were added
+	i = host_event_count++;
+	while ( i > 0 && host_events[i-1].time > time ) {
+		host_events[i] = host_events[i-1];
+		i--;
+	}
+	host_events[i].time = time;
+	host_events[i].event = event;
+	host_events[i].arg = arg;
+}
+
+// send the bytes the firmware transmits on a UART to listener
+void host_uartListen(uint8 port, host_uartListener listener, void *context)
+{
+	uarts[port].listener = listener;
+	uarts[port].context = context;
+}
+
+// bytes for the firmware, arriving back to back from ticks
+// Returns:	(uint16) number of bytes queued
+uint16 host_uartReceive(uint8 port, uint64_t ticks, const uint8 *data, uint16 length)
+{
+	host_uart *u = &uarts[port];
+	uint32_t byte_ticks = host_uartByteTicks(port);
+	uint16 count, next;
+
+	// the first byte arrives at the earliest when the last queued one is in
+	if ( u->rx_head != u->rx_tail ) {
+		uint64_t last = u->rx_time[(u->rx_tail + HOST_RX_QUEUE - 1) % HOST_RX_QUEUE];
+		if ( ticks < last ) {
+			ticks = last;
+		}
+	} else if ( ticks < host_now ) {
+		ticks = host_now;
+	}
+	for (count=0; count<length; count++)
+	{
+		next = (u->rx_tail + 1) % HOST_RX_QUEUE;
+		if ( next == u->rx_head ) {
+			break;
+		}
+		ticks += byte_ticks;
+		u->rx_time[u->rx_tail] = ticks;
+		u->rx_data[u->rx_tail] = data[count];
+		u->rx_tail = next;
+	}
+	return count;
+}
+
+// Returns:	(uint32_t) time of one 10 bit frame on a UART at its current baud rate (ticks)
+uint32_t host_uartByteTicks(uint8 port)
+{
+	// one bit is (divisor + 1) ticks of the 2MHz base clock
+	return 10UL * (uarts[port].divisor + 1);
+}
+
+// Returns:	(uint64_t) time the last byte sent on a UART is out (ticks)
+uint64_t host_uartSentTicks(uint8 port)
+{
+	return uarts[port].sent;
+}
+
+// Returns:	(uint8) 1 while the Dynamixel bus buffer is switched to transmit
+uint8 host_dxlTransmitting()
+{
+	return dxl_transmitting;
+}
+
+// press (1) or release (0) a button by id
+void host_buttonSet(uint8 id, uint8 pressed)
+{
+	uint8 mask = 1 << id;
+
+	if ( pressed && !(button_pins & mask) ) {
+		button_edge = 1;
+	}
+	button_pins = pressed ? (button_pins | mask) : (button_pins & ~mask);
+}
+
+// set the 10 bit value an ADC channel reads
+void host_adcSet(uint8 channel, uint16 value)
+{
+	adc_values[channel & 0x1F] = value & 0x3FF;
+}
+
+// Returns:	(uint8) LEDs that are on
+uint8 host_ledsOn()
+{
+	return ~led_port & 0x7F;
+}
+
+// Returns:	(uint16) frequency the buzzer plays (Hz), 0 if it is silent
+uint16 host_buzzerFrequency()
+{
+	uint32_t period = t1_period();
+
+	if ( !t1_enabled || t1_duty == 0 || period == 0 ) {
+		return 0;
+	}
+	return (uint16)((1000000UL * HOST_TICKS_PER_US + period / 2) / period);
+}
+
+
+// HAL (see hal.h)
+
+// UARTs
+void hal_uartOpen(uint8 port)
+{
+	uarts[port].control = UART_RX_INTERRUPT | UART_RECEIVER | HAL_UART_TRANSMITTER;
+}
+
+void hal_uartSetDivisor(uint8 port, uint16 divisor)
+{
+	uarts[port].divisor = divisor;
+}
+
+void hal_uartClose(uint8 port)
+{
+	uarts[port].control = 0;
+}
+
+void hal_uartEnable(uint8 port, uint8 flags)
+{
+	uarts[port].control |= flags;
+}
+
+void hal_uartDisable(uint8 port, uint8 flags)
+{
+	uarts[port].control &= ~flags;
+}
+
+uint8 hal_uartIsEnabled(uint8 port, uint8 flags)
+{
+	return uarts[port].control & flags;
+}
+
+// the byte is out one frame after the previous one (or now)
+void hal_uartWrite(uint8 port, uint8 data)
+{
+	host_uart *u = &uarts[port];
+
+	if ( !(u->control & HAL_UART_TRANSMITTER) ) {
+		return;
+	}
+	if ( u->sent < host_now ) {
+		u->sent = host_now;
+	}
+	u->sent += host_uartByteTicks(port);
+	u->tx_done = 1;
+	if ( u->listener ) {
+		u->listener(u->context, data, u->sent);
+	}
+}
+
+// the transmit buffer is free while at most one byte is in the shift register
+void hal_uartSend(uint8 port, uint8 data)
+{
+	host_uart *u = &uarts[port];
+	uint32_t byte_ticks = host_uartByteTicks(port);
+
+	if ( u->sent > host_now + byte_ticks ) {
+		host_advanceTo(u->sent - byte_ticks);
+	}
+	hal_uartWrite(port, data);
+}
+
+void hal_uartWaitSent(uint8 port)
+{
+	if ( uarts[port].sent > host_now ) {
+		host_advanceTo(uarts[port].sent);
+	}
+}
+
+uint8 hal_uartRead(uint8 port)
+{
+	return uarts[port].data;
+}
+
+void hal_dxlDirection(uint8 transmit)
+{
+	dxl_transmitting = transmit;
+}
+
+void hal_zigInit()
+{
+}
+
+// Clock
+void hal_clockStart()
+{
+	t5_running = 1;
+	t5_origin = host_now;
+	t5_overflow = host_now + 0x10000;
+}
+
+uint16 hal_clockCount()
+{
+	host_advance(HOST_POLL_TICKS);
+	return t5_running ? (uint16)(host_now - t5_origin) : 0;
+}
+
+uint8 hal_clockOverflowPending()
+{
+	return t5_running && host_now >= t5_overflow;
+}
+
+// Buttons
+void hal_buttonInit()
+{
+	button_edge = 0;
+	button_edges_enabled = 1;
+}
+
+void hal_buttonEdgeInterrupts(uint8 enable)
+{
+	button_edges_enabled = enable;
+}
+
+uint8 hal_buttonIsSampling()
+{
+	return t5_sampling;
+}
+
+void hal_buttonStartSampling(uint16 ticks)
+{
+	t5_compare = host_now + ticks;
+	t5_sampling = 1;
+}
+
+void hal_buttonStopSampling()
+{
+	t5_sampling = 0;
+}
+
+uint16 hal_buttonNextSample(uint16 ticks)
+{
+	uint16 latency = (uint16)(host_now - t5_compare);
+
+	t5_compare += ticks;
+	return latency;
+}
+
+uint8 hal_buttonRead()
+{
+	return button_pins;
+}
+
+// ADC
+void hal_adcSelect(uint8 channel)
+{
+	adc_channel = channel & 0x1F;
+}
+
+void hal_adcStart()
+{
+	adc_done = host_now + HOST_ADC_TICKS;
+}
+
+uint8 hal_adcIsConverting()
+{
+	host_advance(HOST_POLL_TICKS);
+	return host_now < adc_done;
+}
+
+uint16 hal_adcResult()
+{
+	uint16 value = adc_values[adc_channel];
+
+	return adc_left ? (value >> 2) : value;
+}
+
+void hal_adcSetLeftAdjust(uint8 left)
+{
+	adc_left = left ? 1 : 0;
+}
+
+uint8 hal_adcIsLeftAdjusted()
+{
+	return adc_left;
+}
+
+// LEDs
+void hal_ledInit()
+{
+	led_port = 0x00;
+}
+
+uint8 hal_ledRead()
+{
+	return led_port;
+}
+
+void hal_ledWrite(uint8 value)
+{
+	led_port = value;
+}
+
+// Buzzer
+void hal_buzzerInit()
+{
+	t1_clock = 1;
+	t1_top = (F_CPU/2) / 1000;
+	t1_duty = 0;
+	hal_buzzerInterrupts(1);
+}
+
+void hal_buzzerInterrupts(uint8 enable)
+{
+	t1_enabled = enable;
+	if ( enable ) {
+		t1_overflow = host_now + t1_period();
+	}
+}
+
+void hal_buzzerSetTone(uint8 clock, uint16 top, uint16 duty)
+{
+	t1_clock = clock & 0x07;
+	t1_top = top;
+	t1_duty = duty;
+}
+
+uint8 hal_buzzerIsUpcounting()
+{
+	return 0;
+}
+
+void hal_buzzerOutput(uint8 on)
+{
+	buzzer_pin = on;
+}
+
+// let the virtual clock run on a little
+void hal_wait()
+{
+	host_advance(HOST_WAIT_TICKS);
+}
+
+
+// Virtual clock
+
+static void host_advance(uint64_t ticks)
+{
+	host_advanceTo(host_now + ticks);
+}
+
+// move the time to target, running the events and interrupts that are
+// due on the way in time order
+static void host_advanceTo(uint64_t target)
+{
+	uint64_t next, due;
+	uint8 irq;
+
+	for (;;)
+	{
+		host_runEvents();
+		// interrupts that are due now, one at a time like the AVR
+		while ( (irq = host_nextInterrupt(&due)) != IRQ_NONE && due <= host_now ) {
+			host_interrupt(irq);
+			host_runEvents();
+		}
+		next = ( irq != IRQ_NONE ) ? due : NEVER;
+		if ( host_event_count > 0 && host_events[0].time < next ) {
+			next = host_events[0].time;
+		}
+		if ( next > target ) {
+			break;
+		}
+		if ( next > host_end ) {
+			break;
+		}
+		host_now = next;
+	}
+	if ( target > host_end && host_running ) {
+		host_now = host_end;
+		longjmp(host_stop, 1);
+	}
+	host_now = target;
+}
+
+// call the host events that are due
+static void host_runEvents()
+{
+	host_event e;
+	uint8 i;
+
+	while ( host_event_count > 0 && host_events[0].time <= host_now )
+	{
+		e = host_events[0];
+		host_event_count--;
+		for (i=0; i<host_event_count; i++) {
+			host_events[i] = host_events[i+1];
+		}
+		e.event(e.arg);
+	}
+}
+
+// Returns:	(uint8) the interrupt that is due first, IRQ_NONE if none can run
+static uint8 host_nextInterrupt(uint64_t *due)
+{
+	uint64_t t[IRQ_COUNT];
+	uint8 irq, first;
+	uint8 port;
+	host_uart *u;
+
+	if ( bit_is_clear(host_sreg, SREG_I) || host_in_isr ) {
+		return IRQ_NONE;
+	}
+	for (irq=0; irq<IRQ_COUNT; irq++) {
+		t[irq] = NEVER;
+	}
+	if ( button_edge && button_edges_enabled ) {
+		t[IRQ_INT0] = host_now;
+	}
+	if ( t1_enabled && t1_period() > 0 ) {
+		t[IRQ_TIMER1_OVF] = t1_overflow;
+	}
+	for (port=0; port<2; port++)
+	{
+		u = &uarts[port];
+		if ( u->rx_head != u->rx_tail ) {
+			t[port ? IRQ_PC_RX : IRQ_DXL_RX] = u->rx_time[u->rx_head];
+		}
+		// the transmit buffer is free one frame before the last byte is out
+		if ( u->control & HAL_UART_TX_EMPTY ) {
+			t[port ? IRQ_PC_UDRE : IRQ_DXL_UDRE] = ( u->sent > host_now + host_uartByteTicks(port) ) ? u->sent - host_uartByteTicks(port) : host_now;
+		}
+	}
+	if ( (uarts[HAL_UART_DXL].control & HAL_UART_TX_DONE) && uarts[HAL_UART_DXL].tx_done ) {
+		t[IRQ_DXL_TX] = uarts[HAL_UART_DXL].sent;
+	}
+	if ( t5_running && t5_sampling ) {
+		t[IRQ_TIMER5_COMPA] = t5_compare;
+	}
+	if ( t5_running ) {
+		t[IRQ_TIMER5_OVF] = t5_overflow;
+	}
+
+	// earliest first, the lower vector on a tie
+	first = IRQ_NONE;
+	for (irq=0; irq<IRQ_COUNT; irq++) {
+		if ( t[irq] != NEVER && (first == IRQ_NONE || t[irq] < t[first]) ) {
+			first = irq;
+		}
+	}
+	if ( first != IRQ_NONE ) {
+		*due = t[first];
+	}
+	return first;
+}
+
+// run an interrupt service routine, interrupts are disabled while it runs
+static void host_interrupt(uint8 irq)
+{
+	host_uart *u;
+	uint64_t compare;
+	uint8 port = ( irq == IRQ_PC_RX || irq == IRQ_PC_UDRE ) ? HAL_UART_PC : HAL_UART_DXL;
+
+	host_in_isr = 1;
+	host_sreg &= ~(1<<SREG_I);
+	switch ( irq )
+	{
+		case IRQ_INT0:
+			button_edge = 0;
+			INT0_vect();
+			break;
+		case IRQ_TIMER1_OVF:
+			TIMER1_OVF_vect();
+			t1_overflow += t1_period();
+			break;
+		case IRQ_DXL_RX:
+		case IRQ_PC_RX:
+			// a byte the receiver doesn't take is lost, so is one that
+			// arrives while the bus buffer is switched to transmit
+			u = &uarts[port];
+			u->data = u->rx_data[u->rx_head];
+			u->rx_head = (u->rx_head + 1) % HOST_RX_QUEUE;
+			if ( (u->control & UART_RECEIVER) && (u->control & UART_RX_INTERRUPT)
+				&& !(port == HAL_UART_DXL && dxl_transmitting) ) {
+				if ( port == HAL_UART_DXL ) {
+					USART0_RX_vect();
+				} else {
+					USART1_RX_vect();
+				}
+			}
+			break;
+		case IRQ_DXL_UDRE:
+			USART0_UDRE_vect();
+			break;
+		case IRQ_PC_UDRE:
+			USART1_UDRE_vect();
+			break;
+		case IRQ_DXL_TX:
+			uarts[HAL_UART_DXL].tx_done = 0;
+			USART0_TX_vect();
+			break;
+		case IRQ_TIMER5_COMPA:
+			compare = t5_compare;
+			TIMER5_COMPA_vect();
+			// the next match is a whole timer cycle later unless the ISR moved it
+			if ( t5_compare == compare ) {
+				t5_compare += 0x10000;
+			}
+			break;
+		case IRQ_TIMER5_OVF:
+			// the flag is cleared when the ISR starts
+			t5_overflow += 0x10000;
+			TIMER5_OVF_vect();
+			break;
+	}
+	host_sreg |= (1<<SREG_I);
+	host_in_isr = 0;
+}
+
+// Returns:	(uint32_t) time between TIMER1 overflows (ticks), 0 if it is stopped
+static uint32_t t1_period()
+{
+	static const uint16 prescaler[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+	uint32_t cycles = 2UL * (t1_top ? t1_top : 1) * prescaler[t1_clock];
+
+	// phase correct PWM counts up to TOP and back down
+	return cycles / (F_CPU / 1000000UL / HOST_TICKS_PER_US);
+}
@@ -0,0 +1,121 @@
+/*
+ * hal_host.h - Stub devices and virtual clock of the host build
+ *   The host side of the hardware abstraction layer (hal.h): runs the
+ *   firmware on a virtual clock and lets simulations and tests drive the
+ *   UARTs, buttons and ADC and look at the LEDs and the buzzer.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Virtual clock
+ *
+ * Time is counted in TIMER5 ticks (0.5us) from host_reset. It only moves
+ * when the firmware waits: _delay_ms/_delay_us, polling a device (UART
+ * transmit buffer, ADC conversion), hal_wait() in idle and busy loops, and
+ * HOST_POLL_TICKS for every read of the timer or the ADC status, so loops
+ * that watch the clock come to an end. Computation takes no time, host
+ * timings are bus, delay and wait times, not AVR cycle counts.
+ *
+ * While time moves the devices raise their interrupts in time order (ties
+ * in vector order): TIMER5 overflow and compare A (clock, buttons), TIMER1
+ * overflow (buzzer notes), UART receive, transmit buffer empty and
+ * transmit complete, button edges. An interrupt service routine only runs
+ * while the I bit is set and no other ISR is running, like on the AVR.
+ * Pending interrupts run at the next move of the clock after sei().
+ *
+ * UARTs send and receive 10 bit frames at the baud rate the firmware set
+ * (2MHz / (divisor + 1)). The bytes the firmware sends go to a listener
+ * with the time their stop bit is out, bytes for the firmware are queued
+ * with the time they arrive. On the Dynamixel bus this is where a servo
+ * model plugs in, on the PC link a terminal or test script.
+ *
+ * Running: host_run calls the firmware (usually firmware_main, the main()
+ * of BioloidCControl.c renamed by host/CMakeLists.txt) and returns when
+ * the virtual time is up. The firmware state is not reset in between,
+ * host_reset only resets the devices and the clock.
+ */
+
+#ifndef HAL_HOST_H_
+#define HAL_HOST_H_
+
+#include <stdint.h>
+#include "global.h"
+#include "hal.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define HOST_TICKS_PER_US		2		// TIMER5 ticks (F_CPU/8)
+#define HOST_POLL_TICKS			2		// time taken by a read of the timer or ADC status
+#define HOST_WAIT_TICKS			40		// time taken by hal_wait (20us, about one idle main loop pass)
+#define HOST_ADC_TICKS			208		// one conversion (13 ADC clocks at 125kHz)
+#define HOST_RX_QUEUE			1024	// bytes waiting to arrive per UART
+#define HOST_MAX_EVENTS			32		// host_at events waiting
+
+// called for every byte the firmware sends
+typedef void (*host_uartListener)(void *context, uint8 data, uint64_t ticks);
+
+// devices to their power-on state, time to 0, interrupts disabled
+void host_reset(void);
+
+// Returns:	(uint64_t) virtual time since host_reset (ticks)
+uint64_t host_ticks(void);
+
+// let virtual time pass, the devices and interrupts run meanwhile
+void host_delay(uint32_t us);
+
+// call the firmware until it returns or the virtual time reaches end_us
+// Returns:	(uint8) 1 if the time ran out, 0 if entry returned
+uint8 host_run(void (*entry)(void), uint64_t end_us);
+
+// call event(arg) when the virtual time reaches at_us (the world outside
+// the controller: buttons, bytes from the PC, servo faults)
+void host_at(uint64_t at_us, void (*event)(void *arg), void *arg);
+
+// send the bytes the firmware transmits on a UART to listener (NULL to drop them)
+void host_uartListen(uint8 port, host_uartListener listener, void *context);
+
+// bytes for the firmware, arriving back to back from ticks (or after the
+// bytes still queued), dropped if the UART isn't receiving when they arrive
+// Returns:	(uint16) number of bytes queued
+uint16 host_uartReceive(uint8 port, uint64_t ticks, const uint8 *data, uint16 length);
+
+// Returns:	(uint32_t) time of one 10 bit frame on a UART at its current baud rate (ticks)
+uint32_t host_uartByteTicks(uint8 port);
+
+// Returns:	(uint64_t) time the last byte sent on a UART is out (ticks)
+uint64_t host_uartSentTicks(uint8 port);
+
+// Returns:	(uint8) 1 while the Dynamixel bus buffer is switched to transmit
+uint8 host_dxlTransmitting(void);
+
+// press (1) or release (0) a button by id (BUTTON_ID_START ... in button.h)
+void host_buttonSet(uint8 id, uint8 pressed);
+
+// set the 10 bit value an ADC channel reads
+void host_adcSet(uint8 channel, uint16 value);
+
+// Returns:	(uint8) LEDs that are on (LED_POWER ... in led.h)
+uint8 host_ledsOn(void);
+
+// Returns:	(uint16) frequency the buzzer plays (Hz), 0 if it is silent
+uint16 host_buzzerFrequency(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_HOST_H_ */
@@ -0,0 +1,630 @@
+/*
+ * kin_sim.c - Kinematic simulation of the motion pages and walk commands
+ *   Plays motion pages and walk command sequences through
+ *   executeMotionSequence like golden_trace.c, with the simulated AX-12
+ *   servos (ax12_sim.c) following the goal positions and speeds the
+ *   firmware sends, and moves the kinematic model of kinematics.c along
+ *   with the servo positions. Prints for every case how far the robot got
+ *   and the link collisions and ground penetration it ran into, and writes
+ *   the joint angles, torso and feet over time as CSV or as a glTF
+ *   animation.
+ *
+ * Usage:	kin_sim [-o directory] [-g] [-p ms] [-s] [case ...]
+ *   -o		write <case>.csv to the directory
+ *   -g		and <case>.gltf (an animation of boxes for the links)
+ *   -p		sample period in ms of virtual time (default 10)
+ *   -s		strict: count a case with collisions or ground penetration as failed
+ *   case	page_001 ... page_227 or a walk sequence (default all)
+ * Exit code is the number of failed cases (that didn't run to the end).
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Output
+ *
+ * CSV: one line per sample with the time (ms), the joint angles (degrees),
+ * the position (mm) and roll, pitch and yaw (degrees) of the torso, the
+ * centres of the soles (mm), the support foot (R or L), the number of
+ * colliding link pairs with the deepest pair and its depth (mm), and the
+ * deepest link below the ground and its depth (mm).
+ *
+ * glTF 2.0 (one file, the buffer embedded): a node for the torso that moves
+ * in the world (turned to the y up of glTF), a node for every joint under
+ * its parent and a box for every link, in metres. The animation has the
+ * torso translation and rotation and the joint rotations at every sample,
+ * a viewer that plays glTF animations (e.g. Blender) shows it.
+ *
+ * The cases run like in golden_trace.c, but start from the standing pose
+ * (the zero positions of kinematics.c) instead of all servos at 512,
+ * which isn't a pose the robot can stand in. The model starts with its
+ * lower foot at the origin.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "global.h"
+#include "clock.h"
+#include "serial.h"
+#include "dynamixel.h"
+#include "motion_f.h"
+#include "pose.h"
+#include "hal_host.h"
+#include "ax12_sim.h"
+#include "kinematics.h"
+
+#define CASE_LIMIT_MS		30000	// cases that take longer fail
+#define MAX_COMMANDS		6
+#define RAD_TO_DEG			(180.0 / M_PI)
+
+// a walk sequence: commands and how long each one runs (ms)
+typedef struct {
+	const char *name;
+	const char *commands[MAX_COMMANDS];
+	uint16 duration[MAX_COMMANDS];
+} kin_walk;
+
+// the same sequences as golden_trace.c
+static const kin_walk walks[] = {
+	{ "walk_forward",	{ "WFWD", "STOP" },					{ 6000, 3000 } },
+	{ "walk_turns",		{ "WFWD", "WLT ", "WRT ", "STOP" },	{ 3000, 3000, 3000, 3000 } },
+	{ "walk_sides",		{ "WLSD", "WRSD", "WBWD", "STOP" },	{ 3000, 3000, 3000, 3000 } },
+	{ "walk_diagonal",	{ "WFLS", "WFRT", "WBLT", "STOP" },	{ 3000, 3000, 3000, 3000 } },
+};
+#define NUM_WALKS	(sizeof(walks) / sizeof(walks[0]))
+
+// one sample of the model
+typedef struct {
+	double ms;
+	double angle[KIN_JOINTS];
+	kin_frame torso;
+	double sole[2][3];
+	uint8 support;
+	uint16 collisions;
+	double collision_depth;
+	const char *collision_links[2];
+	double ground_depth;
+	const char *ground_link;
+} kin_sample;
+
+// firmware state (BioloidCControl.c, motion.c, motion.h, serial.c)
+extern const uint8 AX12_IDS[NUM_AX12_SERVOS];
+extern const uint8 * const motion_pointer[NUM_MOTION_PAGES+1];
+extern volatile bool new_command;
+extern volatile uint8 current_motion_page;
+extern volatile uint8 current_step;
+extern uint8 motion_state;
+extern uint8 repeat_counter;
+extern char command[5];
+void command_match_string(void);
+
+// options
+static const char *directory = NULL;
+static uint8 gltf = 0;
+static uint8 strict = 0;
+static uint32 period_ms = 10;
+
+// case run by the child process
+static const char *case_name;
+static uint16 case_page = 0;
+static const kin_walk *case_walk = NULL;
+static uint64_t case_start;
+static uint64_t next_sample;
+static kin_state model;
+static kin_sample *samples = NULL;
+static uint32 num_samples = 0, samples_size = 0;
+
+
+// Simulation
+
+// the model at the present servo positions
+static void sim_sample(void)
+{
+	double positions[KIN_JOINTS];
+	ax12_servo *s;
+	kin_sample *k;
+	uint8 i;
+
+	for (i=0; i<KIN_JOINTS; i++) {
+		s = ax12_sim_servo(i + 1);
+		positions[i] = kin_joints[i].zero;
+		if ( s != NULL ) {
+			ax12_sim_position(i + 1);
+			positions[i] = s->position;
+		}
+	}
+	kin_update(&model, positions);
+
+	if ( num_samples == samples_size ) {
+		samples_size = samples_size ? 2 * samples_size : 1024;
+		samples = realloc(samples, samples_size * sizeof(kin_sample));
+	}
+	k = &samples[num_samples++];
+	k->ms = (host_ticks() - case_start) / (1000.0 * HOST_TICKS_PER_US);
+	memcpy(k->angle, model.angle, sizeof(k->angle));
+	k->torso = model.torso;
+	for (i=0; i<2; i++) {
+		memcpy(k->sole[i], model.sole[i].p, sizeof(k->sole[i]));
+	}
+	k->support = model.support;
+	k->collisions = model.collisions;
+	k->collision_depth = model.collision_depth;
+	k->collision_links[0] = model.collision_links[0];
+	k->collision_links[1] = model.collision_links[1];
+	k->ground_depth = model.ground_depth;
+	k->ground_link = model.ground_link;
+}
+
+static void case_command(const char *text)
+{
+	strcpy(command, text);
+	command_match_string();
+	new_command = TRUE;
+}
+
+// Returns:	(uint32) ms since the start of the case
+static uint32 case_ms(void)
+{
+	return (host_ticks() - case_start) / (1000 * HOST_TICKS_PER_US);
+}
+
+// one call of executeMotionSequence and the 1ms to the next one, the
+// model follows every period_ms
+static void case_call(void)
+{
+	executeMotionSequence();
+	host_delay(1000);
+	while ( host_ticks() >= next_sample ) {
+		sim_sample();
+		next_sample += period_ms * 1000ULL * HOST_TICKS_PER_US;
+	}
+}
+
+// call executeMotionSequence every ms until the motion has stopped or the time is up
+static void case_play(uint32 until_ms)
+{
+	do {
+		case_call();
+	} while ( (motion_state != MOTION_STOPPED || new_command) && motion_state != MOTION_ALARM && case_ms() < until_ms );
+}
+
+// firmware side of a case (in host_run), as in golden_trace.c
+static void case_run(void)
+{
+	const uint8 *page;
+	char text[8];
+	uint32 end = 0;
+	uint8 i, id;
+
+	serial_init(57600);
+	clock_init();
+	sei();
+	dxl_init(DEFAULT_BAUDNUMBER);
+	motionPageInit();
+	// standing (the zero pose of the model), not at 512 like golden_trace.c
+	for (i=0; i<NUM_AX12_SERVOS; i++) {
+		id = pgm_read_byte(&AX12_IDS[i]);
+		ax12_sim_setPosition(id, kin_joints[id-1].zero);
+	}
+	readCurrentPose(READ_ALL, 0);
+
+	case_start = next_sample = host_ticks();
+	kin_init(&model);
+	if ( case_walk != NULL ) {
+		for (i=0; i<MAX_COMMANDS && case_walk->commands[i] != NULL; i++) {
+			case_command(case_walk->commands[i]);
+			end += case_walk->duration[i];
+			do {
+				case_call();
+			} while ( case_ms() < end && motion_state != MOTION_ALARM );
+		}
+		case_play(CASE_LIMIT_MS);
+	} else {
+		// a page that goes on to a next page stops after its last step
+		page = (const uint8 *) pgm_read_word(&motion_pointer[case_page]);
+		sprintf(text, "M%u", case_page);
+		case_command(text);
+		if ( pgm_read_byte(page + NUM_AX12_SERVOS) != 0 ) {
+			do {
+				case_call();
+			} while ( (current_motion_page != case_page || current_step != pgm_read_byte(page + NUM_AX12_SERVOS + 5)
+					   || repeat_counter < pgm_read_byte(page + NUM_AX12_SERVOS + 2))
+					  && (motion_state != MOTION_STOPPED || new_command) && motion_state != MOTION_ALARM && case_ms() < CASE_LIMIT_MS );
+			case_command("STOP");
+		}
+		case_play(CASE_LIMIT_MS);
+	}
+	// the servos come to rest
+	end = case_ms() + 500;
+	while ( case_ms() < end ) {
+		case_call();
+	}
+}
+
+
+// Output
+
+static void write_csv(const char *file)
+{
+	const kin_sample *k;
+	double angles[3];
+	FILE *csv;
+	uint32 n;
+	uint8 i;
+
+	csv = fopen(file, "w");
+	if ( csv == NULL ) {
+		perror(file);
+		return;
+	}
+	fprintf(csv, "time_ms");
+	for (i=0; i<KIN_JOINTS; i++) {
+		fprintf(csv, ",%s", kin_joints[i].name);
+	}
+	fprintf(csv, ",torso_x,torso_y,torso_z,torso_roll,torso_pitch,torso_yaw,r_sole_x,r_sole_y,r_sole_z,l_sole_x,l_sole_y,l_sole_z,"
+				 "support,collisions,collision,collision_mm,ground,ground_mm\n");
+	for (n=0; n<num_samples; n++) {
+		k = &samples[n];
+		fprintf(csv, "%.1f", k->ms);
+		for (i=0; i<KIN_JOINTS; i++) {
+			fprintf(csv, ",%.2f", k->angle[i] * RAD_TO_DEG);
+		}
+		kin_angles(angles, &k->torso);
+		fprintf(csv, ",%.1f,%.1f,%.1f,%.2f,%.2f,%.2f", k->torso.p[0], k->torso.p[1], k->torso.p[2],
+				angles[0] * RAD_TO_DEG, angles[1] * RAD_TO_DEG, angles[2] * RAD_TO_DEG);
+		for (i=0; i<2; i++) {
+			fprintf(csv, ",%.1f,%.1f,%.1f", k->sole[i][0], k->sole[i][1], k->sole[i][2]);
+		}
+		fprintf(csv, ",%c,%u,", k->support == KIN_RIGHT ? 'R' : 'L', k->collisions);
+		if ( k->collisions > 0 ) {
+			fprintf(csv, "%s-%s", k->collision_links[0], k->collision_links[1]);
+		}
+		fprintf(csv, ",%.1f,%s,%.1f\n", k->collision_depth, k->ground_link ? k->ground_link : "", k->ground_depth);
+	}
+	fclose(csv);
+}
+
+// base64 of the glTF buffer
+static void gltf_base64(FILE *f, const uint8 *data, size_t length)
+{
+	static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	uint32 v;
+	size_t i;
+
+	for (i=0; i<length; i+=3) {
+		v = data[i] << 16;
+		if ( i + 1 < length ) v |= data[i+1] << 8;
+		if ( i + 2 < length ) v |= data[i+2];
+		fputc(digits[(v >> 18) & 63], f);
+		fputc(digits[(v >> 12) & 63], f);
+		fputc(i + 1 < length ? digits[(v >> 6) & 63] : '=', f);
+		fputc(i + 2 < length ? digits[v & 63] : '=', f);
+	}
+}
+
+// rotation from the z axis to the direction d (quaternion x, y, z, w)
+static void gltf_alignZ(float q[4], const double d[3])
+{
+	double length = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	double x = -d[1] / length, y = d[0] / length, w = 1 + d[2] / length;
+	double n = sqrt(x * x + y * y + w * w);
+
+	if ( n < 1e-9 ) {
+		// opposite: half a turn about x
+		q[0] = 1; q[1] = 0; q[2] = 0; q[3] = 0;
+		return;
+	}
+	q[0] = x / n; q[1] = y / n; q[2] = 0; q[3] = w / n;
+}
+
+static void gltf_children(FILE *f, int parent)
+{
+	const char *separator = "";
+	uint8 i;
+
+	fprintf(f, "\"children\":[");
+	for (i=0; i<KIN_JOINTS; i++) {
+		if ( kin_joints[i].parent == parent ) {
+			fprintf(f, "%s%u", separator, 2 + i);
+			separator = ",";
+		}
+	}
+	for (i=0; i<KIN_LINKS; i++) {
+		if ( kin_links[i].joint == parent ) {
+			fprintf(f, "%s%u", separator, 2 + KIN_JOINTS + i);
+			separator = ",";
+		}
+	}
+	fprintf(f, "]");
+}
+
+// nodes: 0 turns z up (the model) to y up (glTF), 1 the torso, 2 + joint
+// index, 2 + KIN_JOINTS + link index (boxes)
+static void write_gltf(const char *file)
+{
+	static const float cube[8][3] = {
+		{ -0.5, -0.5, -0.5 }, { 0.5, -0.5, -0.5 }, { 0.5, 0.5, -0.5 }, { -0.5, 0.5, -0.5 },
+		{ -0.5, -0.5, 0.5 }, { 0.5, -0.5, 0.5 }, { 0.5, 0.5, 0.5 }, { -0.5, 0.5, 0.5 }
+	};
+	static const uint16 faces[36] = {
+		0, 2, 1, 0, 3, 2,  4, 5, 6, 4, 6, 7,  0, 1, 5, 0, 5, 4,
+		1, 2, 6, 1, 6, 5,  2, 3, 7, 2, 7, 6,  3, 0, 4, 3, 4, 7
+	};
+	const kin_link *l;
+	float *data, *p, q[4];
+	double quaternion[4], d[3], length;
+	size_t size, rotations;
+	uint32 n;
+	uint8 i;
+	FILE *f;
+
+	// buffer: cube, faces, times, torso translations and rotations, joint rotations
+	rotations = 96 + 72 + num_samples * 4 * (1 + 3 + 4);
+	size = rotations + num_samples * 16 * KIN_JOINTS;
+	data = calloc(1, size);
+	memcpy(data, cube, 96);
+	memcpy((uint8 *) data + 96, faces, 72);
+	p = (float *) ((uint8 *) data + 168);
+	for (n=0; n<num_samples; n++) {
+		p[n] = samples[n].ms / 1000.0;
+	}
+	p += num_samples;
+	for (n=0; n<num_samples; n++) {
+		for (i=0; i<3; i++) {
+			*p++ = samples[n].torso.p[i] / 1000.0;
+		}
+	}
+	for (n=0; n<num_samples; n++) {
+		kin_quaternion(quaternion, &samples[n].torso);
+		for (i=0; i<4; i++) {
+			*p++ = quaternion[i];
+		}
+	}
+	for (i=0; i<KIN_JOINTS; i++) {
+		for (n=0; n<num_samples; n++) {
+			p[0] = p[1] = p[2] = 0;
+			p[kin_joints[i].axis] = sin(samples[n].angle[i] / 2);
+			p[3] = cos(samples[n].angle[i] / 2);
+			p += 4;
+		}
+	}
+
+	f = fopen(file, "w");
+	if ( f == NULL ) {
+		perror(file);
+		free(data);
+		return;
+	}
+	fprintf(f, "{\"asset\":{\"version\":\"2.0\",\"generator\":\"kin_sim\"},\"scene\":0,\"scenes\":[{\"name\":\"%s\",\"nodes\":[0]}],\n", case_name);
+
+	fprintf(f, "\"nodes\":[\n{\"name\":\"world\",\"rotation\":[-0.70710678,0,0,0.70710678],\"children\":[1]},\n{\"name\":\"torso\",");
+	gltf_children(f, KIN_TORSO);
+	fprintf(f, "}");
+	for (i=0; i<KIN_JOINTS; i++) {
+		fprintf(f, ",\n{\"name\":\"%s\",\"translation\":[%g,%g,%g],", kin_joints[i].name,
+				kin_joints[i].offset[0] / 1000, kin_joints[i].offset[1] / 1000, kin_joints[i].offset[2] / 1000);
+		gltf_children(f, i);
+		fprintf(f, "}");
+	}
+	for (i=0; i<KIN_LINKS; i++) {
+		l = &kin_links[i];
+		length = 0;
+		for (n=0; n<3; n++) {
+			d[n] = l->b[n] - l->a[n];
+			length += d[n] * d[n];
+		}
+		length = sqrt(length);
+		gltf_alignZ(q, d);
+		fprintf(f, ",\n{\"name\":\"%s\",\"mesh\":0,\"translation\":[%g,%g,%g],\"rotation\":[%g,%g,%g,%g],\"scale\":[%g,%g,%g]}",
+				l->name, (l->a[0] + l->b[0]) / 2000, (l->a[1] + l->b[1]) / 2000, (l->a[2] + l->b[2]) / 2000,
+				q[0], q[1], q[2], q[3], 2 * l->radius / 1000, 2 * l->radius / 1000, (length + 2 * l->radius) / 1000);
+	}
+	fprintf(f, "],\n");
+
+	fprintf(f, "\"meshes\":[{\"name\":\"link\",\"primitives\":[{\"attributes\":{\"POSITION\":0},\"indices\":1,\"material\":0}]}],\n");
+	fprintf(f, "\"materials\":[{\"pbrMetallicRoughness\":{\"baseColorFactor\":[0.6,0.6,0.65,1],\"metallicFactor\":0.2}}],\n");
+	fprintf(f, "\"accessors\":[\n");
+	fprintf(f, "{\"bufferView\":0,\"componentType\":5126,\"count\":8,\"type\":\"VEC3\",\"min\":[-0.5,-0.5,-0.5],\"max\":[0.5,0.5,0.5]},\n");
+	fprintf(f, "{\"bufferView\":1,\"componentType\":5123,\"count\":36,\"type\":\"SCALAR\"},\n");
+	fprintf(f, "{\"bufferView\":2,\"byteOffset\":0,\"componentType\":5126,\"count\":%lu,\"type\":\"SCALAR\",\"min\":[%g],\"max\":[%g]},\n",
+			(unsigned long) num_samples, samples[0].ms / 1000.0, samples[num_samples-1].ms / 1000.0);
+	fprintf(f, "{\"bufferView\":2,\"byteOffset\":%lu,\"componentType\":5126,\"count\":%lu,\"type\":\"VEC3\"},\n",
+			(unsigned long) num_samples * 4, (unsigned long) num_samples);
+	fprintf(f, "{\"bufferView\":2,\"byteOffset\":%lu,\"componentType\":5126,\"count\":%lu,\"type\":\"VEC4\"}",
+			(unsigned long) num_samples * 16, (unsigned long) num_samples);
+	for (i=0; i<KIN_JOINTS; i++) {
+		fprintf(f, ",\n{\"bufferView\":2,\"byteOffset\":%lu,\"componentType\":5126,\"count\":%lu,\"type\":\"VEC4\"}",
+				(unsigned long) (rotations - 168 + (size_t) i * num_samples * 16), (unsigned long) num_samples);
+	}
+	fprintf(f, "],\n");
+	fprintf(f, "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":96,\"target\":34962},"
+			   "{\"buffer\":0,\"byteOffset\":96,\"byteLength\":72,\"target\":34963},"
+			   "{\"buffer\":0,\"byteOffset\":168,\"byteLength\":%lu}],\n", (unsigned long) (size - 168));
+
+	// one sampler per channel, all on the sample times
+	fprintf(f, "\"animations\":[{\"name\":\"%s\",\"samplers\":[{\"input\":2,\"output\":3},{\"input\":2,\"output\":4}", case_name);
+	for (i=0; i<KIN_JOINTS; i++) {
+		fprintf(f, ",{\"input\":2,\"output\":%u}", 5 + i);
+	}
+	fprintf(f, "],\"channels\":[{\"sampler\":0,\"target\":{\"node\":1,\"path\":\"translation\"}},"
+			   "{\"sampler\":1,\"target\":{\"node\":1,\"path\":\"rotation\"}}");
+	for (i=0; i<KIN_JOINTS; i++) {
+		fprintf(f, ",{\"sampler\":%u,\"target\":{\"node\":%u,\"path\":\"rotation\"}}", 2 + i, 2 + i);
+	}
+	fprintf(f, "]}],\n");
+	fprintf(f, "\"buffers\":[{\"byteLength\":%lu,\"uri\":\"data:application/octet-stream;base64,", (unsigned long) size);
+	gltf_base64(f, (const uint8 *) data, size);
+	fprintf(f, "\"}]}\n");
+	fclose(f);
+	free(data);
+}
+
+// one line per case: time, samples, collisions, ground penetration, where the robot got to
+// Returns:	(int) 1 if the case has collisions or ground penetration
+static int print_summary(void)
+{
+	const kin_sample *k, *worst_collision = NULL, *worst_ground = NULL;
+	uint32 collisions = 0, ground = 0, n;
+	double angles[2][3], moved;
+	char text[64];
+
+	for (n=0; n<num_samples; n++) {
+		k = &samples[n];
+		if ( k->collisions > 0 ) {
+			collisions++;
+			if ( worst_collision == NULL || k->collision_depth > worst_collision->collision_depth ) {
+				worst_collision = k;
+			}
+		}
+		if ( k->ground_link != NULL ) {
+			ground++;
+			if ( worst_ground == NULL || k->ground_depth > worst_ground->ground_depth ) {
+				worst_ground = k;
+			}
+		}
+	}
+	kin_angles(angles[0], &samples[0].torso);
+	kin_angles(angles[1], &samples[num_samples-1].torso);
+	moved = hypot(samples[num_samples-1].torso.p[0] - samples[0].torso.p[0], samples[num_samples-1].torso.p[1] - samples[0].torso.p[1]);
+	printf("%-16s %6.0f %6lu %5lu", case_name, samples[num_samples-1].ms, (unsigned long) num_samples, (unsigned long) collisions);
+	text[0] = 0;
+	if ( worst_collision != NULL ) {
+		snprintf(text, sizeof(text), "%s-%s %.0fmm", worst_collision->collision_links[0], worst_collision->collision_links[1],
+				 worst_collision->collision_depth);
+	}
+	printf(" %-28s %5lu", text, (unsigned long) ground);
+	text[0] = 0;
+	if ( worst_ground != NULL ) {
+		snprintf(text, sizeof(text), "%s %.0fmm", worst_ground->ground_link, worst_ground->ground_depth);
+	}
+	printf(" %-18s %6.0f %6.0f\n", text, moved, (angles[1][2] - angles[0][2]) * RAD_TO_DEG);
+	return ( collisions > 0 || ground > 0 );
+}
+
+// run a case in a child process
+// Returns:	(int) 1 if it failed
+static int case_simulate(const char *name)
+{
+	char file[512];
+	uint8 ids[NUM_AX12_SERVOS];
+	uint8 i;
+	pid_t child;
+	int status;
+
+	fflush(stdout);
+	child = fork();
+	if ( child < 0 ) {
+		perror("fork");
+		return 1;
+	}
+	if ( child == 0 ) {
+		case_name = name;
+		host_reset();
+		for (i=0; i<NUM_AX12_SERVOS; i++) {
+			ids[i] = pgm_read_byte(&AX12_IDS[i]);
+		}
+		ax12_sim_init(NUM_AX12_SERVOS, ids);
+		host_run(case_run, (CASE_LIMIT_MS + 10000) * 1000ULL);
+		if ( num_samples == 0 ) {
+			printf("%-16s no samples\n", name);
+			_exit(1);
+		}
+		status = print_summary();
+		if ( directory != NULL ) {
+			snprintf(file, sizeof(file), "%s/%s.csv", directory, name);
+			write_csv(file);
+			if ( gltf ) {
+				snprintf(file, sizeof(file), "%s/%s.gltf", directory, name);
+				write_gltf(file);
+			}
+		}
+		fflush(stdout);
+		_exit(motion_state == MOTION_ALARM || (strict && status));
+	}
+	if ( waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ) {
+		return 1;
+	}
+	return 0;
+}
+
+// Returns:	(int) 1 if the case is on the command line or there are no cases on it
+static int case_selected(const char *name, int argc, char *argv[], int first)
+{
+	int i;
+
+	if ( first >= argc ) {
+		return 1;
+	}
+	for (i=first; i<argc; i++) {
+		if ( strcmp(argv[i], name) == 0 ) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct timespec start, end;
+	char name[16];
+	int failures = 0, cases = 0, option;
+	double seconds;
+	uint16 page;
+	uint8 i;
+
+	while ( (option = getopt(argc, argv, "o:gp:s")) != -1 ) {
+		switch ( option ) {
+			case 'o':	directory = optarg; break;
+			case 'g':	gltf = 1; break;
+			case 'p':	period_ms = atoi(optarg); break;
+			case 's':	strict = 1; break;
+			default:	period_ms = 0; break;
+		}
+	}
+	if ( period_ms == 0 || (gltf && directory == NULL) ) {
+		printf("Usage: kin_sim [-o directory] [-g] [-p ms] [-s] [case ...]\n");
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	printf("%-16s %6s %6s %5s %-28s %5s %-18s %6s %6s\n", "case", "ms", "samples", "coll", "deepest collision",
+		   "ground", "deepest", "moved", "turned");
+	for (page=1; page<=NUM_MOTION_PAGES; page++) {
+		sprintf(name, "page_%03u", page);
+		if ( case_selected(name, argc, argv, optind) ) {
+			case_page = page;
+			case_walk = NULL;
+			failures += case_simulate(name);
+			cases++;
+		}
+	}
+	for (i=0; i<NUM_WALKS; i++) {
+		if ( case_selected(walks[i].name, argc, argv, optind) ) {
+			case_walk = &walks[i];
+			failures += case_simulate(walks[i].name);
+			cases++;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("%i cases in %.1fs, %i failed\n", cases, seconds, failures);
+	return failures;
+}
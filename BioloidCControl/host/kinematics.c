@@ -0,0 +1,387 @@
+/*
+ * kinematics.c - Kinematic model of the Bioloid humanoid (Type A/B/C)
+ *   Joint and link tables, forward kinematics, the support foot and the
+ *   collision and ground checks (see kinematics.h).
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "global.h"
+#include "kinematics.h"
+
+#define KIN_RAD_PER_UNIT	(300.0 / 1024.0 * M_PI / 180.0)
+#define KIN_SOLE_LENGTH		52.0	// half length and width of a sole (mm)
+#define KIN_SOLE_WIDTH		33.0
+
+// servos the robot type has (AX12_IDS in BioloidCControl.c)
+#ifdef HUMANOID_TYPEB
+	#define KIN_HIP_YAW		1
+	#define KIN_HIP_ROLL	0
+#elif defined(HUMANOID_TYPEC)
+	#define KIN_HIP_YAW		0
+	#define KIN_HIP_ROLL	1
+#else
+	#define KIN_HIP_YAW		1
+	#define KIN_HIP_ROLL	1
+#endif
+
+const kin_joint kin_joints[KIN_JOINTS] = {
+	//  name					parent		offset (mm)			axis	sign	zero	present
+	{ "r_shoulder_pitch",	KIN_TORSO,	{ 0, -82, 105 },	KIN_Y,	-1,		235,	1 },
+	{ "l_shoulder_pitch",	KIN_TORSO,	{ 0, 82, 105 },		KIN_Y,	1,		788,	1 },
+	{ "r_shoulder_roll",	0,			{ 0, -14, 0 },		KIN_X,	-1,		279,	1 },
+	{ "l_shoulder_roll",	1,			{ 0, 14, 0 },		KIN_X,	-1,		744,	1 },
+	{ "r_elbow",			2,			{ 0, 0, -67 },		KIN_X,	-1,		462,	1 },
+	{ "l_elbow",			3,			{ 0, 0, -67 },		KIN_X,	-1,		561,	1 },
+	{ "r_hip_yaw",			KIN_TORSO,	{ 0, -37, 0 },		KIN_Z,	-1,		358,	KIN_HIP_YAW },
+	{ "l_hip_yaw",			KIN_TORSO,	{ 0, 37, 0 },		KIN_Z,	-1,		666,	KIN_HIP_YAW },
+	{ "r_hip_roll",			6,			{ 0, 0, -28 },		KIN_X,	1,		507,	KIN_HIP_ROLL },
+	{ "l_hip_roll",			7,			{ 0, 0, -28 },		KIN_X,	1,		516,	KIN_HIP_ROLL },
+	{ "r_hip_pitch",		8,			{ 0, 0, 0 },		KIN_Y,	1,		341,	1 },
+	{ "l_hip_pitch",		9,			{ 0, 0, 0 },		KIN_Y,	-1,		682,	1 },
+	{ "r_knee",				10,			{ 0, 0, -75 },		KIN_Y,	-1,		240,	1 },
+	{ "l_knee",				11,			{ 0, 0, -75 },		KIN_Y,	1,		783,	1 },
+	{ "r_ankle_pitch",		12,			{ 0, 0, -75 },		KIN_Y,	-1,		647,	1 },
+	{ "l_ankle_pitch",		13,			{ 0, 0, -75 },		KIN_Y,	1,		376,	1 },
+	{ "r_ankle_roll",		14,			{ 0, 0, 0 },		KIN_X,	-1,		507,	1 },
+	{ "l_ankle_roll",		15,			{ 0, 0, 0 },		KIN_X,	-1,		516,	1 },
+};
+
+const kin_link kin_links[KIN_LINKS] = {
+	//  name			joint		a (mm)				b (mm)				radius	part
+	{ "torso_right",	KIN_TORSO,	{ 0, -25, 5 },		{ 0, -25, 95 },		30,		KIN_PART_TORSO },
+	{ "torso_left",		KIN_TORSO,	{ 0, 25, 5 },		{ 0, 25, 95 },		30,		KIN_PART_TORSO },
+	{ "r_upper_arm",	2,			{ 0, 0, 0 },		{ 0, 0, -67 },		16,		KIN_PART_RIGHT_ARM },
+	{ "r_forearm",		4,			{ 0, 0, 0 },		{ 0, 0, -98 },		16,		KIN_PART_RIGHT_ARM },
+	{ "l_upper_arm",	3,			{ 0, 0, 0 },		{ 0, 0, -67 },		16,		KIN_PART_LEFT_ARM },
+	{ "l_forearm",		5,			{ 0, 0, 0 },		{ 0, 0, -98 },		16,		KIN_PART_LEFT_ARM },
+	{ "r_thigh",		10,			{ 0, 0, 0 },		{ 0, 0, -75 },		20,		KIN_PART_RIGHT_LEG },
+	{ "r_shin",			12,			{ 0, 0, 0 },		{ 0, 0, -75 },		20,		KIN_PART_RIGHT_LEG },
+	{ "r_foot",			16,			{ -24, 0, -5 },		{ 24, 0, -5 },		28,		KIN_PART_RIGHT_LEG },
+	{ "l_thigh",		11,			{ 0, 0, 0 },		{ 0, 0, -75 },		20,		KIN_PART_LEFT_LEG },
+	{ "l_shin",			13,			{ 0, 0, 0 },		{ 0, 0, -75 },		20,		KIN_PART_LEFT_LEG },
+	{ "l_foot",			17,			{ -24, 0, -5 },		{ 24, 0, -5 },		28,		KIN_PART_LEFT_LEG },
+};
+
+// centre of the sole in the ankle roll frame, the ankle roll joints and
+// the links of the feet
+static const double kin_sole[3] = { 0, 0, -33 };
+static const uint8 kin_ankle[2] = { 16, 17 };
+static const uint8 kin_foot[2] = { 8, 11 };
+
+// internal function prototypes
+static void kin_compose(kin_frame *out, const kin_frame *a, const kin_frame *b);
+static void kin_inverse(kin_frame *out, const kin_frame *f);
+static void kin_flatten(kin_frame *f);
+static void kin_place(kin_state *state, const kin_frame local[KIN_JOINTS], const kin_frame sole[2]);
+static double kin_lowestCorner(const kin_frame *sole);
+static double kin_segmentDistance(const double p1[3], const double q1[3], const double p2[3], const double q2[3]);
+static void kin_check(kin_state *state);
+
+
+void kin_init(kin_state *state)
+{
+	memset(state, 0, sizeof(kin_state));
+}
+
+void kin_update(kin_state *state, const double positions[KIN_JOINTS])
+{
+	kin_frame local[KIN_JOINTS], sole[2], move;
+	const kin_joint *j;
+	double c, s, depth;
+	uint8 i, other;
+
+	// joint frames in the torso frame
+	for (i=0; i<KIN_JOINTS; i++) {
+		j = &kin_joints[i];
+		state->angle[i] = j->present ? j->sign * (positions[i] - j->zero) * KIN_RAD_PER_UNIT : 0;
+		c = cos(state->angle[i]);
+		s = sin(state->angle[i]);
+		memset(&move, 0, sizeof(move));
+		memcpy(move.p, j->offset, sizeof(move.p));
+		switch ( j->axis ) {
+			case KIN_X:
+				move.r[0][0] = 1;
+				move.r[1][1] = c;	move.r[1][2] = -s;
+				move.r[2][1] = s;	move.r[2][2] = c;
+				break;
+			case KIN_Y:
+				move.r[0][0] = c;	move.r[0][2] = s;
+				move.r[1][1] = 1;
+				move.r[2][0] = -s;	move.r[2][2] = c;
+				break;
+			default:
+				move.r[0][0] = c;	move.r[0][1] = -s;
+				move.r[1][0] = s;	move.r[1][1] = c;
+				move.r[2][2] = 1;
+				break;
+		}
+		if ( j->parent == KIN_TORSO ) {
+			local[i] = move;
+		} else {
+			kin_compose(&local[i], &local[j->parent], &move);
+		}
+	}
+	for (i=0; i<2; i++) {
+		sole[i] = local[kin_ankle[i]];
+		kin_point(sole[i].p, &local[kin_ankle[i]], kin_sole);
+	}
+
+	// the first time the lower foot stands at the origin
+	if ( !state->started ) {
+		state->started = 1;
+		state->support = ( sole[KIN_LEFT].p[2] < sole[KIN_RIGHT].p[2] ) ? KIN_LEFT : KIN_RIGHT;
+		state->support_frame = sole[state->support];
+		kin_flatten(&state->support_frame);
+		memset(state->support_frame.p, 0, sizeof(state->support_frame.p));
+	}
+	kin_place(state, local, sole);
+
+	// the other foot reached the ground and takes over
+	state->ground_depth = 0;
+	state->ground_link = NULL;
+	other = !state->support;
+	depth = -kin_lowestCorner(&state->sole[other]);
+	if ( depth >= 0 ) {
+		if ( depth > KIN_GROUND_TOLERANCE ) {
+			state->ground_depth = depth;
+			state->ground_link = kin_links[kin_foot[other]].name;
+		}
+		state->support = other;
+		state->support_frame = state->sole[other];
+		kin_flatten(&state->support_frame);
+		kin_place(state, local, sole);
+	}
+	kin_check(state);
+}
+
+// the robot in the world: the support sole at support_frame
+static void kin_place(kin_state *state, const kin_frame local[KIN_JOINTS], const kin_frame sole[2])
+{
+	kin_frame inverse;
+	uint8 i;
+
+	kin_inverse(&inverse, &sole[state->support]);
+	kin_compose(&state->torso, &state->support_frame, &inverse);
+	for (i=0; i<KIN_JOINTS; i++) {
+		kin_compose(&state->joint[i], &state->torso, &local[i]);
+	}
+	for (i=0; i<2; i++) {
+		kin_compose(&state->sole[i], &state->torso, &sole[i]);
+	}
+}
+
+// collisions between the links, links below the ground
+static void kin_check(kin_state *state)
+{
+	double a[KIN_LINKS][3], b[KIN_LINKS][3];
+	const kin_frame *frame;
+	double distance, depth;
+	uint8 i, k;
+
+	for (i=0; i<KIN_LINKS; i++) {
+		frame = ( kin_links[i].joint == KIN_TORSO ) ? &state->torso : &state->joint[kin_links[i].joint];
+		kin_point(a[i], frame, kin_links[i].a);
+		kin_point(b[i], frame, kin_links[i].b);
+	}
+
+	state->collisions = 0;
+	state->collision_depth = 0;
+	state->collision_links[0] = state->collision_links[1] = NULL;
+	for (i=0; i<KIN_LINKS; i++) {
+		for (k=i+1; k<KIN_LINKS; k++) {
+			if ( kin_links[i].part == kin_links[k].part ) {
+				continue;
+			}
+			// the hips join the thighs to the torso
+			if ( kin_links[i].part == KIN_PART_TORSO && kin_links[k].joint >= 10 && kin_links[k].joint <= 11 ) {
+				continue;
+			}
+			distance = kin_segmentDistance(a[i], b[i], a[k], b[k]);
+			depth = kin_links[i].radius + kin_links[k].radius - distance;
+			if ( depth > 0 ) {
+				state->collisions++;
+				if ( depth > state->collision_depth ) {
+					state->collision_depth = depth;
+					state->collision_links[0] = kin_links[i].name;
+					state->collision_links[1] = kin_links[k].name;
+				}
+			}
+		}
+	}
+
+	// the support foot is on the ground, the soles were checked in kin_update
+	for (i=0; i<KIN_LINKS; i++) {
+		if ( i == kin_foot[state->support] ) {
+			continue;
+		}
+		if ( i == kin_foot[!state->support] ) {
+			depth = -kin_lowestCorner(&state->sole[!state->support]);
+		} else {
+			depth = kin_links[i].radius - fmin(a[i][2], b[i][2]);
+		}
+		if ( depth > KIN_GROUND_TOLERANCE && depth > state->ground_depth ) {
+			state->ground_depth = depth;
+			state->ground_link = kin_links[i].name;
+		}
+	}
+}
+
+// Returns:	(double) height of the lowest corner of a sole (mm)
+static double kin_lowestCorner(const kin_frame *sole)
+{
+	double corner[3], lowest = INFINITY;
+	uint8 i;
+
+	for (i=0; i<4; i++) {
+		corner[0] = (i & 1) ? KIN_SOLE_LENGTH : -KIN_SOLE_LENGTH;
+		corner[1] = (i & 2) ? KIN_SOLE_WIDTH : -KIN_SOLE_WIDTH;
+		corner[2] = 0;
+		kin_point(corner, sole, corner);
+		lowest = fmin(lowest, corner[2]);
+	}
+	return lowest;
+}
+
+// Returns:	(double) shortest distance between the segments p1-q1 and p2-q2
+static double kin_segmentDistance(const double p1[3], const double q1[3], const double p2[3], const double q2[3])
+{
+	double d1[3], d2[3], r[3], c1[3], c2[3];
+	double a = 0, e = 0, f = 0, b = 0, c = 0, denominator, s, t, distance = 0;
+	uint8 i;
+
+	for (i=0; i<3; i++) {
+		d1[i] = q1[i] - p1[i];
+		d2[i] = q2[i] - p2[i];
+		r[i] = p1[i] - p2[i];
+		a += d1[i] * d1[i];
+		e += d2[i] * d2[i];
+		f += d2[i] * r[i];
+		b += d1[i] * d2[i];
+		c += d1[i] * r[i];
+	}
+	// closest points of the lines, clamped to the segments
+	denominator = a * e - b * b;
+	s = ( denominator > 1e-9 ) ? fmin(fmax((b * f - c * e) / denominator, 0), 1) : 0;
+	t = (b * s + f) / e;
+	if ( t < 0 ) {
+		t = 0;
+		s = fmin(fmax(-c / a, 0), 1);
+	} else if ( t > 1 ) {
+		t = 1;
+		s = fmin(fmax((b - c) / a, 0), 1);
+	}
+	for (i=0; i<3; i++) {
+		c1[i] = p1[i] + d1[i] * s;
+		c2[i] = p2[i] + d2[i] * t;
+		distance += (c1[i] - c2[i]) * (c1[i] - c2[i]);
+	}
+	return sqrt(distance);
+}
+
+
+// Frames
+
+void kin_point(double out[3], const kin_frame *frame, const double p[3])
+{
+	double q[3];
+	uint8 i;
+
+	for (i=0; i<3; i++) {
+		q[i] = frame->r[i][0] * p[0] + frame->r[i][1] * p[1] + frame->r[i][2] * p[2] + frame->p[i];
+	}
+	memcpy(out, q, sizeof(q));
+}
+
+void kin_angles(double out[3], const kin_frame *frame)
+{
+	out[0] = atan2(frame->r[2][1], frame->r[2][2]);
+	out[1] = asin(fmin(fmax(-frame->r[2][0], -1), 1));
+	out[2] = atan2(frame->r[1][0], frame->r[0][0]);
+}
+
+void kin_quaternion(double out[4], const kin_frame *frame)
+{
+	const double (*r)[3] = frame->r;
+	double trace = r[0][0] + r[1][1] + r[2][2], s;
+
+	if ( trace > 0 ) {
+		s = 2 * sqrt(trace + 1);
+		out[3] = s / 4;
+		out[0] = (r[2][1] - r[1][2]) / s;
+		out[1] = (r[0][2] - r[2][0]) / s;
+		out[2] = (r[1][0] - r[0][1]) / s;
+	} else if ( r[0][0] > r[1][1] && r[0][0] > r[2][2] ) {
+		s = 2 * sqrt(1 + r[0][0] - r[1][1] - r[2][2]);
+		out[3] = (r[2][1] - r[1][2]) / s;
+		out[0] = s / 4;
+		out[1] = (r[0][1] + r[1][0]) / s;
+		out[2] = (r[0][2] + r[2][0]) / s;
+	} else if ( r[1][1] > r[2][2] ) {
+		s = 2 * sqrt(1 + r[1][1] - r[0][0] - r[2][2]);
+		out[3] = (r[0][2] - r[2][0]) / s;
+		out[0] = (r[0][1] + r[1][0]) / s;
+		out[1] = s / 4;
+		out[2] = (r[1][2] + r[2][1]) / s;
+	} else {
+		s = 2 * sqrt(1 + r[2][2] - r[0][0] - r[1][1]);
+		out[3] = (r[1][0] - r[0][1]) / s;
+		out[0] = (r[0][2] + r[2][0]) / s;
+		out[1] = (r[1][2] + r[2][1]) / s;
+		out[2] = s / 4;
+	}
+}
+
+// out = a * b (b in the frame a)
+static void kin_compose(kin_frame *out, const kin_frame *a, const kin_frame *b)
+{
+	kin_frame f;
+	uint8 i, k;
+
+	for (i=0; i<3; i++) {
+		for (k=0; k<3; k++) {
+			f.r[i][k] = a->r[i][0] * b->r[0][k] + a->r[i][1] * b->r[1][k] + a->r[i][2] * b->r[2][k];
+		}
+	}
+	kin_point(f.p, a, b->p);
+	*out = f;
+}
+
+static void kin_inverse(kin_frame *out, const kin_frame *f)
+{
+	uint8 i, k;
+
+	for (i=0; i<3; i++) {
+		for (k=0; k<3; k++) {
+			out->r[i][k] = f->r[k][i];
+		}
+	}
+	for (i=0; i<3; i++) {
+		out->p[i] = -(out->r[i][0] * f->p[0] + out->r[i][1] * f->p[1] + out->r[i][2] * f->p[2]);
+	}
+}
+
+// flat on the ground: same place and heading, no roll or pitch, z = 0
+static void kin_flatten(kin_frame *f)
+{
+	double yaw = atan2(f->r[1][0], f->r[0][0]);
+
+	memset(f->r, 0, sizeof(f->r));
+	f->r[0][0] = cos(yaw);	f->r[0][1] = -sin(yaw);
+	f->r[1][0] = sin(yaw);	f->r[1][1] = cos(yaw);
+	f->r[2][2] = 1;
+	f->p[2] = 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * kinematics.h - Kinematic model of the Bioloid humanoid (Type A/B/C)
+ *   Forward kinematics of the 18 joints from the servo positions, a
+ *   support foot that stands flat on the ground, and checks for links that
+ *   run into each other or into the ground. Host build only, used by
+ *   kin_sim.c.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+/*
+ * Model
+ *
+ * Coordinates in mm, x forward, y to the left, z up. The torso frame has
+ * its origin between the hip yaw joints. Every joint has a frame that
+ * moves with it, placed at an offset in the frame of its parent joint
+ * (the torso for the shoulders and hips) and turned about one of its axes
+ * by the joint angle (right hand rule):
+ *
+ *   angle = sign * (position - zero) * 300/1024 degrees
+ *
+ * The zero positions are the standing pose of motion page 26: in the
+ * model it has straight legs, the feet flat under the hips and the arms
+ * hanging down. Link lengths and offsets are approximate Type A kit
+ * dimensions (within a few mm), the leg signs follow the comments in
+ * balance.c and the arm signs the arm poses of the motion pages; the hip
+ * yaw and shoulder pitch signs are not checked against the robot, and the
+ * same dimensions are used for Type B and C. Type B has no hip roll servos
+ * (9, 10) and Type C no hip yaw servos (7, 8), their joints stay at 0.
+ *
+ * Links are capsules (a segment and a radius) fixed to a joint frame or
+ * the torso. Two links of different body parts (torso, arms, legs) collide
+ * when they are closer than the sum of their radii, except the torso and
+ * the thighs, which are joined at the hips.
+ *
+ * Ground: one foot supports the robot, its sole lies flat on the ground
+ * (z = 0) where it touched down, and the rest of the robot hangs from it.
+ * When the other sole reaches the ground it takes over, put flat on the
+ * ground where it is. A link below the ground by more than
+ * KIN_GROUND_TOLERANCE is ground penetration, so is a sole that comes down
+ * deeper than that in one update (it would hit the ground, not step on
+ * it). Poses on the ground (sitting, lying, getting up) break the
+ * assumption and show up as ground penetration.
+ */
+
+#ifndef KINEMATICS_H_
+#define KINEMATICS_H_
+
+#include "global.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define KIN_JOINTS				18		// servo IDs 1-18, joint index = ID - 1
+#define KIN_LINKS				12
+#define KIN_TORSO				-1		// parent of the shoulders and hips
+#define KIN_GROUND_TOLERANCE	3.0		// mm below the ground that still counts as touching
+#define KIN_RIGHT				0		// feet
+#define KIN_LEFT				1
+
+// axes
+#define KIN_X					0
+#define KIN_Y					1
+#define KIN_Z					2
+
+// body parts of the links
+#define KIN_PART_TORSO			0
+#define KIN_PART_RIGHT_ARM		1
+#define KIN_PART_LEFT_ARM		2
+#define KIN_PART_RIGHT_LEG		3
+#define KIN_PART_LEFT_LEG		4
+
+// a frame: rotation (columns are the axes) and origin
+typedef struct {
+	double r[3][3];
+	double p[3];
+} kin_frame;
+
+typedef struct {
+	const char *name;
+	int8 parent;					// joint index, KIN_TORSO for the torso
+	double offset[3];				// origin in the parent frame (mm)
+	uint8 axis;						// KIN_X, KIN_Y or KIN_Z
+	int8 sign;
+	uint16 zero;					// position of angle 0
+	uint8 present;					// 0 if the robot type has no servo for it
+} kin_joint;
+
+typedef struct {
+	const char *name;
+	int8 joint;						// frame it moves with, KIN_TORSO for the torso
+	double a[3];					// segment in that frame (mm)
+	double b[3];
+	double radius;
+	uint8 part;						// KIN_PART_...
+} kin_link;
+
+// the robot at one moment
+typedef struct {
+	double angle[KIN_JOINTS];		// joint angles (rad)
+	kin_frame torso;				// world frames
+	kin_frame joint[KIN_JOINTS];
+	kin_frame sole[2];				// centre of the soles (KIN_RIGHT, KIN_LEFT)
+	uint8 support;					// foot standing on the ground
+	kin_frame support_frame;		// where its sole is (world)
+	uint8 started;
+	uint16 collisions;				// link pairs that collide
+	double collision_depth;			// deepest of them (mm)
+	const char *collision_links[2];
+	double ground_depth;			// deepest link or sole below the ground (mm)
+	const char *ground_link;
+} kin_state;
+
+extern const kin_joint kin_joints[KIN_JOINTS];
+extern const kin_link kin_links[KIN_LINKS];
+
+// before the first kin_update: the support foot will be put at the origin
+void kin_init(kin_state *state);
+
+// move the robot to the servo positions (by joint index, 0.29 degree units)
+// and check it for collisions and ground penetration
+void kin_update(kin_state *state, const double positions[KIN_JOINTS]);
+
+// Returns:	(void) point p of a frame in world coordinates (out)
+void kin_point(double out[3], const kin_frame *frame, const double p[3]);
+
+// Returns:	(void) roll, pitch and yaw (rad, applied in that order) of a frame (out)
+void kin_angles(double out[3], const kin_frame *frame);
+
+// Returns:	(void) rotation of a frame as a quaternion x, y, z, w (out)
+void kin_quaternion(double out[4], const kin_frame *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KINEMATICS_H_ */
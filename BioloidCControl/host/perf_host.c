@@ -0,0 +1,262 @@
+/*
+ * perf_host.c - Performance figures of the firmware on the host build
+ *   Runs the whole firmware (main loop, command parser, walking) against
+ *   the simulated AX-12 servos, walks with each walk command for a few
+ *   walk cycles and prints the figures the performance gate
+ *   (bench/perf_gate.pl) compares with the baseline, one per line:
+ *
+ *     PERF <metric> <value>
+ *
+ *     bus_bytes/<command>		bytes on the Dynamixel bus per walk cycle (both directions)
+ *     task_max_us/<task>		longest run of a task of the main loop (sched.c)
+ *     main_loop/max_us			longest run of any task
+ *     main_loop/late_max_us	longest delay of a task start
+ *
+ * Times are virtual time of hal_host.c: bus transfers, waits and delays,
+ * not computation (the cycle counts come from bench.c under simavr). A
+ * walk cycle is the time from a step of the walk pages to the next start
+ * of the same page and step, measured after the walk has settled.
+ *
+ * Usage:	perf_host [-o file]
+ *   -o		write the figures to a file instead of stdout
+ * Exit code is 1 if the command prompt didn't come up or a walk didn't
+ * repeat.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "global.h"
+#include "button.h"
+#include "motion_f.h"
+#include "sched.h"
+#include "hal_host.h"
+#include "ax12_sim.h"
+
+#define PERF_START_US		500000UL	// START button pressed
+#define PERF_PRESS_US		100000UL	// and held
+#define PERF_PROBE_US		1000UL		// period of the probe
+#define PERF_PAUSE_US		1000000UL	// standing between two walks
+#define PERF_SETTLE_US		3000000UL	// walking before the measurement
+#define PERF_LIMIT_US		20000000UL	// measurement of a walk that doesn't repeat
+#define PERF_CYCLES			4			// walk cycles measured
+#define PERF_RUN_US			120000000ULL
+
+// walk commands measured
+static const char * const walks[] = { "WFWD", "WBWD", "WLSD", "WRSD", "WLT", "WRT" };
+#define NUM_WALKS	(sizeof(walks) / sizeof(walks[0]))
+
+// what the probe is doing
+#define PERF_STANDING		0
+#define PERF_SETTLING		1
+#define PERF_MEASURING		2
+#define PERF_STOPPING		3
+#define PERF_DONE			4
+
+// firmware state (BioloidCControl.c, motion.c)
+extern const uint8 AX12_IDS[NUM_AX12_SERVOS];
+extern volatile uint8 current_motion_page;
+extern volatile uint8 current_step;
+extern uint8 motion_state;
+extern uint8 repeat_counter;
+
+// main() of BioloidCControl.c (renamed by CMakeLists.txt)
+int firmware_main(void);
+
+static const char prompt[] = "Ready for command.";
+static uint8 prompt_matched = 0;
+static uint8 ready = 0;
+static uint8 phase = PERF_STANDING;
+static uint8 walk = 0;
+static uint64_t phase_us;
+static uint8 step_state = MOTION_STOPPED;
+static uint8 step_page, step_number, step_repeat;
+static uint8 marker_page, marker_step;
+static uint8 cycles;
+static uint32 marker_bytes;
+static uint64_t marker_us;
+static uint32 bytes_per_cycle[NUM_WALKS];
+static uint32 cycle_ms[NUM_WALKS];
+static uint8 cycle_page[NUM_WALKS], cycle_step[NUM_WALKS];
+static uint8 failed = 0;
+
+static void run_firmware(void)
+{
+	firmware_main();
+}
+
+static void press_start(void *arg)
+{
+	host_buttonSet(BUTTON_ID_START, (uint8)(intptr_t) arg);
+}
+
+// type a command followed by CR
+static void perf_send(const char *command)
+{
+	uint8 cr = '\r';
+
+	host_uartReceive(HAL_UART_PC, host_ticks(), (const uint8 *) command, strlen(command));
+	host_uartReceive(HAL_UART_PC, host_ticks(), &cr, 1);
+}
+
+// Returns:	(uint32) bytes on the bus so far
+static uint32 perf_busBytes(void)
+{
+	return ax12_sim_getStats()->bytes_tx + ax12_sim_getStats()->bytes_rx;
+}
+
+// every PERF_PROBE_US from the command prompt on: one walk after the other
+static void perf_probe(void *arg)
+{
+	uint64_t now = host_ticks() / HOST_TICKS_PER_US;
+	uint8 step_start;
+
+	(void) arg;
+	// a step starts when the motion engine goes into STEP_IN_MOTION or
+	// the page, step or repeat changes in it (as in fault_bench.c)
+	step_start = ( motion_state == STEP_IN_MOTION && (step_state != STEP_IN_MOTION
+			|| current_motion_page != step_page || current_step != step_number || repeat_counter != step_repeat) );
+	step_state = motion_state;
+	step_page = current_motion_page;
+	step_number = current_step;
+	step_repeat = repeat_counter;
+
+	switch ( phase ) {
+		case PERF_STANDING:
+			if ( now >= phase_us ) {
+				perf_send(walks[walk]);
+				phase = PERF_SETTLING;
+				phase_us = now + PERF_SETTLE_US;
+			}
+			break;
+		case PERF_SETTLING:
+			if ( now >= phase_us && step_start ) {
+				marker_page = current_motion_page;
+				marker_step = current_step;
+				marker_bytes = perf_busBytes();
+				marker_us = now;
+				cycle_page[walk] = marker_page;
+				cycle_step[walk] = marker_step;
+				cycles = 0;
+				phase = PERF_MEASURING;
+				phase_us = now + PERF_LIMIT_US;
+			}
+			break;
+		case PERF_MEASURING:
+			if ( step_start && current_motion_page == marker_page && current_step == marker_step ) {
+				cycles++;
+				if ( cycles == PERF_CYCLES ) {
+					bytes_per_cycle[walk] = (perf_busBytes() - marker_bytes) / PERF_CYCLES;
+					cycle_ms[walk] = (now - marker_us) / PERF_CYCLES / 1000;
+					perf_send("STOP");
+					phase = PERF_STOPPING;
+				}
+			} else if ( now >= phase_us ) {
+				fprintf(stderr, "%s didn't repeat its steps\n", walks[walk]);
+				failed = 1;
+				perf_send("STOP");
+				phase = PERF_STOPPING;
+			}
+			break;
+		case PERF_STOPPING:
+			if ( motion_state == MOTION_STOPPED ) {
+				walk++;
+				phase = ( walk < NUM_WALKS ) ? PERF_STANDING : PERF_DONE;
+				phase_us = now + PERF_PAUSE_US;
+			}
+			break;
+		default:
+			return;
+	}
+	host_at(now + PERF_PROBE_US, perf_probe, NULL);
+}
+
+// the PC terminal: start at the command prompt
+static void pc_receive(void *context, uint8 data, uint64_t ticks)
+{
+	(void) context;
+	if ( ready ) {
+		return;
+	}
+	prompt_matched = ( data == prompt[prompt_matched] ) ? prompt_matched + 1 : ( data == prompt[0] );
+	if ( prompt[prompt_matched] == 0 ) {
+		ready = 1;
+		phase_us = ticks / HOST_TICKS_PER_US + PERF_PAUSE_US;
+		host_at(ticks / HOST_TICKS_PER_US + PERF_PROBE_US, perf_probe, NULL);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const sched_stats *stats;
+	char name[5] = "";
+	uint32 max_us = 0, late_us = 0;
+	FILE *out = stdout;
+	uint8 i;
+	int option;
+
+	while ( (option = getopt(argc, argv, "o:")) != -1 ) {
+		if ( option != 'o' ) {
+			printf("Usage: perf_host [-o file]\n");
+			return 2;
+		}
+		out = fopen(optarg, "w");
+		if ( out == NULL ) {
+			perror(optarg);
+			return 2;
+		}
+	}
+
+	host_reset();
+	ax12_sim_init(NUM_AX12_SERVOS, AX12_IDS);
+	host_uartListen(HAL_UART_PC, pc_receive, NULL);
+	host_at(PERF_START_US, press_start, (void *) 1);
+	host_at(PERF_START_US + PERF_PRESS_US, press_start, (void *) 0);
+	host_run(run_firmware, PERF_RUN_US);
+
+	if ( !ready || phase != PERF_DONE ) {
+		fprintf(stderr, ready ? "The walks didn't finish.\n" : "The command prompt didn't come up.\n");
+		return 1;
+	}
+	fprintf(out, "# perf_host: virtual time of the host build\n");
+	for (i=0; i<NUM_WALKS; i++) {
+		if ( bytes_per_cycle[i] > 0 ) {
+			fprintf(out, "# %s: walk cycle %lu ms from page %u step %u\n", walks[i], (unsigned long) cycle_ms[i],
+				cycle_page[i], cycle_step[i]);
+			fprintf(out, "PERF bus_bytes/%s %lu\n", walks[i], (unsigned long) bytes_per_cycle[i]);
+		}
+	}
+	for (i=0; i<SCHED_MAX_TASKS; i++) {
+		sched_getTaskName(i, name);
+		if ( name[0] == '-' ) {
+			break;
+		}
+		// "CMD " and "BAL " without the blank
+		name[strcspn(name, " ")] = 0;
+		stats = sched_getStats(i);
+		fprintf(out, "PERF task_max_us/%s %lu\n", name, (unsigned long) stats->time_max);
+		if ( stats->time_max > max_us ) max_us = stats->time_max;
+		if ( stats->late_max > late_us ) late_us = stats->late_max;
+	}
+	fprintf(out, "PERF main_loop/max_us %lu\n", (unsigned long) max_us);
+	fprintf(out, "PERF main_loop/late_max_us %lu\n", (unsigned long) late_us);
+	if ( out != stdout ) {
+		fclose(out);
+	}
+	return failed;
+}
@@ -0,0 +1,41 @@
+/*
+ * stack_host.c - Stack monitoring of the host build
+ *   The host has no painted stack area (stack.c paints it in the AVR
+ *   start-up code), the STAK command and the run time check do nothing.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include "global.h"
+#include "log.h"
+#include "stack.h"
+
+void stack_check()
+{
+}
+
+uint16 stack_getSize()
+{
+	return 0;
+}
+
+uint16 stack_getHighWater()
+{
+	return 0;
+}
+
+void stack_report()
+{
+	log_printf("\nNo stack monitoring in the host build\n");
+}
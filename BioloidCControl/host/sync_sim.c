@@ -0,0 +1,268 @@
+/*
+ * sync_sim.c - Host simulation of the multi-robot clock sync (sync.c).
+ *   Runs one master and several followers with drifting clocks on a
+ *   simulated shared serial/ZigBee link with latency jitter, lost frames
+ *   and retries. The robots use the clock and frame functions of sync.c,
+ *   the simulation reports how fast they converge and the skew between
+ *   them, both as clock error and as the spread of the 1s start boundaries
+ *   that new commands are scheduled on.
+ *
+ * Built with the host build (CMakeLists.txt in this directory), or alone:
+ *   gcc -std=gnu99 -O2 -DHOST -I. -I../BioloidCControl -o sync_sim sync_sim.c ../BioloidCControl/sync.c
+ *
+ * Usage:	sync_sim [robots] [seconds] [jitter_us] [seed]
+ *			defaults: 4 robots (master + 3 followers), 120s, 500us, 1
+ * Exit code is 1 if the robots didn't converge or the skew over the last
+ * 10 seconds exceeds SIM_MAX_SKEW_US plus the jitter.
+ *
+ * Version 0.9
+ */
+
+/*
+ * You may freely modify and share this code, as long as you keep this
+ * notice intact. Licensed under the Creative Commons BY-SA 3.0 license:
+ *
+ *   http://creativecommons.org/licenses/by-sa/3.0/
+ *
+ * Disclaimer: To the extent permitted by law, this work is provided
+ * without any warranty. It might be defective, in which case you agree
+ * to be responsible for all resulting costs and damages.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "global.h"
+#include "sync.h"
+
+#define SIM_MAX_ROBOTS		16
+#define SIM_STEP_US			50			// simulation time step
+#define SIM_BYTE_US			174			// one byte at 57600 baud
+#define SIM_MAX_PPM			50			// crystal tolerance
+#define SIM_DROP_PERCENT	2			// frames lost per follower
+#define SIM_RETRY_PERCENT	2			// frames delivered late (ZigBee retry)
+#define SIM_RETRY_US		15000
+#define SIM_SAMPLE_US		10000		// skew is measured every 10ms
+#define SIM_MAX_SKEW_US		1000		// pass limit on top of the jitter
+#define SIM_QUEUE			64			// bytes in flight per follower
+
+// a simulated robot
+typedef struct {
+	double ppm;					// clock error
+	int64_t offset;				// local micros() at simulation start
+	sync_clock clock;
+	sync_decoder decoder;
+	// bytes on their way to this robot
+	int64_t arrival[SIM_QUEUE];
+	uint8 data[SIM_QUEUE];
+	int head, tail;
+	// last start boundary (s) passed and when
+	uint32 boundary;
+	int64_t boundary_time;
+} sim_robot;
+
+static sim_robot robots[SIM_MAX_ROBOTS];
+static int num_robots = 4;
+static uint32 random_state = 1;
+
+// stubs for the hardware side of sync.c, not used by the simulation
+uint8 motion_state = 0;
+volatile uint8_t host_sreg = 0x80;
+unsigned long millis(void) { return 0; }
+unsigned long micros(void) { return 0; }
+void log_printf_P(const char *format, ...) { (void) format; }
+void log_flush(void) { }
+void serial_setQuiet(uint8 quiet) { (void) quiet; }
+void serial_startTransmit(void) { }
+
+// repeatable random numbers
+static uint32 sim_random(uint32 range)
+{
+	random_state = random_state * 1103515245UL + 12345UL;
+	return (random_state >> 8) % range;
+}
+
+// local micros() of a robot at simulation time t
+static uint32 sim_local(const sim_robot *robot, int64_t t)
+{
+	return (uint32)(robot->offset + (int64_t)(t * (1.0 + robot->ppm * 1e-6)));
+}
+
+// shared time of a robot in us (wraps like the firmware)
+static int64_t sim_time(const sim_robot *robot, int64_t t)
+{
+	uint32 ms;
+	uint16 us;
+
+	sync_clockRead(&robot->clock, sim_local(robot, t), &ms, &us);
+	return (int64_t) ms * 1000 + us;
+}
+
+int main(int argc, char *argv[])
+{
+	int seconds = 120, jitter = 500;
+	int64_t t, end, next_tx, next_sample, converged = -1;
+	uint8 frame[SYNC_FRAME_LENGTH], seq = 0;
+	uint32 stamp = 0, ms, local;
+	uint16 us;
+	int64_t skew, skew_max = 0, skew_sum = 0, window_max = 0, boundary_max = 0;
+	long skew_count = 0;
+	int i, k;
+
+	if ( argc > 1 ) num_robots = atoi(argv[1]);
+	if ( argc > 2 ) seconds = atoi(argv[2]);
+	if ( argc > 3 ) jitter = atoi(argv[3]);
+	if ( argc > 4 ) random_state = atoi(argv[4]);
+	if ( num_robots < 2 || num_robots > SIM_MAX_ROBOTS || seconds < 20 || jitter < 0 ) {
+		printf("Usage: sync_sim [robots 2-%i] [seconds >= 20] [jitter_us] [seed]\n", SIM_MAX_ROBOTS);
+		return 2;
+	}
+	printf("%i robots, %is, link jitter %ius, %i%% lost, %i%% late by %ius\n", num_robots, seconds,
+		   jitter, SIM_DROP_PERCENT, SIM_RETRY_PERCENT, SIM_RETRY_US);
+
+	// robot 0 is the master, its shared time is its own clock
+	for (i=0; i<num_robots; i++) {
+		robots[i].ppm = (double)((int32) sim_random(2 * SIM_MAX_PPM * 10 + 1) - SIM_MAX_PPM * 10) / 10.0;
+		robots[i].offset = sim_random(4000000000UL);
+		printf("Robot %i: clock error %+.1fppm\n", i, robots[i].ppm);
+	}
+	sync_clockSet(&robots[0].clock, 0, 0, sim_local(&robots[0], 0));
+	robots[0].clock.locked = 1;
+
+	end = (int64_t) seconds * 1000000;
+	next_tx = 0;
+	next_sample = 0;
+	for (t=0; t<end; t+=SIM_STEP_US)
+	{
+		// master: send a frame every SYNC_INTERVAL as sync_task does
+		if ( t >= next_tx ) {
+			ms = 0;
+			us = 0;
+			if ( seq != 0 ) {
+				sync_clockRead(&robots[0].clock, stamp, &ms, &us);
+			}
+			sync_encodeFrame(frame, seq, ms, us);
+			seq = ( seq == 255 ) ? 1 : seq + 1;
+			stamp = sim_local(&robots[0], t);
+			next_tx += (int64_t)(SYNC_INTERVAL * 1000 / (1.0 + robots[0].ppm * 1e-6));
+
+			// the link delivers the bytes to every follower
+			for (i=1; i<num_robots; i++) {
+				sim_robot *r = &robots[i];
+				int64_t delay;
+				if ( sim_random(100) < SIM_DROP_PERCENT ) {
+					continue;
+				}
+				delay = SIM_BYTE_US + sim_random(jitter + 1);
+				if ( sim_random(100) < SIM_RETRY_PERCENT ) {
+					delay += SIM_RETRY_US;
+				}
+				for (k=0; k<SYNC_FRAME_LENGTH; k++) {
+					r->arrival[r->tail] = t + delay + k * SIM_BYTE_US;
+					r->data[r->tail] = frame[k];
+					r->tail = (r->tail + 1) % SIM_QUEUE;
+				}
+			}
+		}
+
+		// followers: receive ISR and sync_task
+		for (i=1; i<num_robots; i++) {
+			sim_robot *r = &robots[i];
+			while ( r->head != r->tail && r->arrival[r->head] <= t ) {
+				if ( sync_decodeByte(&r->decoder, r->data[r->head], sim_local(r, r->arrival[r->head]), &ms, &us, &local) == 1 ) {
+					sync_clockUpdate(&r->clock, ms, us, local, 1);
+				}
+				r->head = (r->head + 1) % SIM_QUEUE;
+			}
+		}
+		for (i=0; i<num_robots; i++) {
+			local = sim_local(&robots[i], t);
+			if ( (local - robots[i].clock.ref_local) >= SYNC_REBASE_US ) {
+				sync_clockRebase(&robots[i].clock, local);
+			}
+		}
+
+		// start boundaries: when does each robot's shared time pass the next full second
+		for (i=0; i<num_robots; i++) {
+			if ( robots[i].clock.locked ) {
+				uint32 second = (uint32)(sim_time(&robots[i], t) / 1000000);
+				if ( second != robots[i].boundary ) {
+					robots[i].boundary = second;
+					robots[i].boundary_time = t;
+				}
+			}
+		}
+
+		if ( t < next_sample ) {
+			continue;
+		}
+		next_sample += SIM_SAMPLE_US;
+
+		// clock skew between all robots
+		int64_t lo = 0, hi = 0;
+		int locked = 1;
+		for (i=0; i<num_robots; i++) {
+			int64_t v = sim_time(&robots[i], t) - sim_time(&robots[0], t);
+			if ( !robots[i].clock.locked ) {
+				locked = 0;
+			}
+			if ( v < lo ) lo = v;
+			if ( v > hi ) hi = v;
+		}
+		skew = hi - lo;
+		if ( !locked ) {
+			continue;
+		}
+		if ( skew > SIM_MAX_SKEW_US + jitter ) {
+			converged = -1;
+		} else if ( converged < 0 ) {
+			converged = t;
+		}
+		if ( converged >= 0 ) {
+			skew_sum += skew;
+			skew_count++;
+			if ( skew > skew_max ) skew_max = skew;
+		}
+		if ( skew > window_max ) window_max = skew;
+
+		// spread of the last start boundary, once all robots have passed it
+		int same = 1;
+		int64_t first = robots[0].boundary_time, last = robots[0].boundary_time;
+		for (i=1; i<num_robots; i++) {
+			if ( robots[i].boundary != robots[0].boundary ) same = 0;
+			if ( robots[i].boundary_time < first ) first = robots[i].boundary_time;
+			if ( robots[i].boundary_time > last ) last = robots[i].boundary_time;
+		}
+		if ( same && converged >= 0 && first > converged && last - first > boundary_max ) {
+			boundary_max = last - first;
+		}
+
+		// report every 10 seconds
+		if ( t % 10000000 < SIM_SAMPLE_US ) {
+			printf("%4llis: skew max %6lli us, drift estimate", (long long)(t / 1000000), (long long) window_max);
+			for (i=1; i<num_robots; i++) {
+				printf(" %+6.1f", robots[i].clock.drift / 16.777216);
+			}
+			printf(" ppm (actual");
+			for (i=1; i<num_robots; i++) {
+				printf(" %+6.1f", (robots[0].ppm - robots[i].ppm) / (1.0 + robots[i].ppm * 1e-6));
+			}
+			printf(")\n");
+			if ( t + 10000000 < end ) {
+				window_max = 0;
+			}
+		}
+	}
+
+	if ( converged < 0 ) {
+		printf("Not converged: skew is above %ius\n", SIM_MAX_SKEW_US + jitter);
+		return 1;
+	}
+	printf("Converged after %.1fs\n", converged / 1e6);
+	printf("Clock skew after convergence: mean %lli us, max %lli us\n", (long long)(skew_sum / skew_count), (long long) skew_max);
+	printf("Start boundary skew after convergence: max %lli us (includes %ius simulation step)\n", (long long) boundary_max, SIM_STEP_US);
+	for (i=1; i<num_robots; i++) {
+		printf("Robot %i: %u samples, %u ignored\n", i, robots[i].clock.samples, robots[i].clock.ignored);
+	}
+	return window_max > SIM_MAX_SKEW_US + jitter;
+}
@@ -0,0 +1,17 @@
+/*
+ * util/delay.h - Host stand-in for the avr-libc header. The busy waits of
+ *   the firmware let the virtual clock of the host build run on for the
+ *   same time (hal_host.c), the devices and interrupts run meanwhile.
+ */
+
+#ifndef HOST_UTIL_DELAY_H_
+#define HOST_UTIL_DELAY_H_
+
+#include <stdint.h>
+
+void host_delay(uint32_t us);
+
+#define _delay_ms(ms)			host_delay((uint32_t)((ms) * 1000))
+#define _delay_us(us)			host_delay((uint32_t)(us))
+
+#endif /* HOST_UTIL_DELAY_H_ */